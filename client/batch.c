@@ -0,0 +1,219 @@
+#define _GNU_SOURCE
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "batch.h"
+#include "papa.h"
+
+#define BENCH_DRAIN_MS 10000        // Time the last replies get after everything is sent
+
+typedef struct {
+    int answered;
+    int failed;
+} batch_t;
+
+typedef struct {
+    uint64_t *send_ns;
+    uint64_t *rtt_ns;
+    int answered;
+    int failed;
+} bench_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void sleep_ns(const uint64_t ns) {
+    const struct timespec pause = {.tv_sec = (time_t) (ns / 1000000000ULL), .tv_nsec = (long) (ns % 1000000000ULL)};
+    nanosleep(&pause, NULL);
+}
+
+// --- Batch ---
+
+static void print_reply(void *data, const bool ok, const char *reply) {
+    batch_t *batch = data;
+    batch->answered++;
+    if (!ok) batch->failed++;
+
+    // Multi-line replies (status, meters) end with a newline of their own
+    const size_t length = strlen(reply);
+    printf("%s%s", reply, length > 0 && reply[length - 1] == '\n' ? "" : "\n");
+}
+
+int batch_run(const char *socket_path, const char *path) {
+    const bool from_stdin = !path || strcmp(path, "-") == 0;
+    FILE *input = from_stdin ? stdin : fopen(path, "r");
+    if (!input) {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+
+    papa_conn_t *conn = papa_connect(socket_path);
+    if (!conn) {
+        perror("connect");
+        fprintf(stderr, "Error: Could not connect to audio player. Is it running?\n");
+        if (!from_stdin) fclose(input);
+        return EXIT_FAILURE;
+    }
+
+    // Typed commands are answered before the next prompt; scripts and pipes are pipelined
+    const bool interactive = isatty(fileno(input));
+    batch_t batch = {0};
+    int sent = 0;
+    bool lost = false;
+    char *line = NULL;
+    size_t line_cap = 0;
+    ssize_t length;
+    while (!lost && (length = getline(&line, &line_cap, input)) >= 0) {
+        while (length > 0 && strchr(" \t\r\n", line[length - 1])) line[--length] = '\0';
+        const char *command = line + strspn(line, " \t");
+        if (command[0] == '\0' || command[0] == '#') continue;
+
+        double seconds;
+        if (sscanf(command, "sleep %lf", &seconds) == 1 && seconds >= 0.0) {
+            // Everything before the pause has taken effect when it starts
+            lost = !papa_flush(conn, -1);
+            fflush(stdout);
+            sleep_ns((uint64_t) (seconds * 1e9));
+            continue;
+        }
+
+        if (papa_send(conn, command, print_reply, &batch) == 0) {
+            lost = true;
+            break;
+        }
+        sent++;
+        // Print what has arrived so far, so output keeps up with long scripts
+        lost = (interactive ? !papa_flush(conn, -1) : papa_dispatch(conn, 0) < 0);
+    }
+    if (!lost) lost = !papa_flush(conn, -1);
+    papa_close(conn);
+    free(line);
+    if (!from_stdin) fclose(input);
+    fflush(stdout);
+
+    if (lost) {
+        fprintf(stderr, "Error: Connection to papad lost after %d of %d replies\n", batch.answered, sent);
+        return EXIT_FAILURE;
+    }
+    if (batch.failed > 0) {
+        fprintf(stderr, "Error: %d of %d commands failed\n", batch.failed, sent);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+// --- Bench ---
+
+static void bench_reply(void *data, const bool ok, const char *reply) {
+    bench_t *bench = data;
+    const int i = bench->answered++;
+    bench->rtt_ns[i] = now_ns() - bench->send_ns[i];
+    if (!ok && bench->failed++ == 0) {
+        fprintf(stderr, "First error: %s\n", reply);
+    }
+}
+
+static int compare_u64(const void *a, const void *b) {
+    const uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+    return x < y ? -1 : x > y;
+}
+
+// Nearest-rank percentile of sorted samples
+static double percentile_us(const uint64_t *sorted, const int count, const double p) {
+    int rank = (int) ceil(p / 100.0 * count);
+    if (rank < 1) rank = 1;
+    return (double) sorted[rank - 1] / 1e3;
+}
+
+int batch_bench(const char *socket_path, const int count, const double rate, const char *command) {
+    if (count <= 0 || rate < 0.0 || !command || !command[0]) {
+        fprintf(stderr, "Error: --bench expects \"<count> [<rate>] [command]\"\n");
+        return EXIT_FAILURE;
+    }
+
+    papa_conn_t *conn = papa_connect(socket_path);
+    if (!conn) {
+        perror("connect");
+        fprintf(stderr, "Error: Could not connect to audio player. Is it running?\n");
+        return EXIT_FAILURE;
+    }
+
+    // The session setup is not part of the samples
+    bool ok = false;
+    char *reply = papa_call(conn, command, &ok);
+    if (!reply || !ok) {
+        fprintf(stderr, "Error: %s\n", reply ? reply : "Could not send command to audio player");
+        free(reply);
+        papa_close(conn);
+        return EXIT_FAILURE;
+    }
+    free(reply);
+
+    bench_t bench = {
+            .send_ns = calloc((size_t) count, sizeof(uint64_t)),
+            .rtt_ns = calloc((size_t) count, sizeof(uint64_t))
+    };
+    if (!bench.send_ns || !bench.rtt_ns) {
+        fprintf(stderr, "Error: Out of memory\n");
+        free(bench.send_ns);
+        free(bench.rtt_ns);
+        papa_close(conn);
+        return EXIT_FAILURE;
+    }
+
+    // Open loop: each command leaves at its own slot whatever the replies do, so a stall shows up in the
+    // latencies of the commands queued behind it instead of slowing the sender down
+    const uint64_t interval_ns = rate > 0.0 ? (uint64_t) (1e9 / rate) : 0;
+    const uint64_t start_ns = now_ns();
+    bool lost = false;
+    for (int i = 0; i < count && !lost; i++) {
+        const uint64_t due_ns = start_ns + (uint64_t) i * interval_ns;
+        for (uint64_t now = now_ns(); now < due_ns && !lost; now = now_ns()) {
+            if (papa_pending(conn) == 0) {
+                sleep_ns(due_ns - now);
+            } else {
+                lost = papa_dispatch(conn, (int) ((due_ns - now) / 1000000)) < 0;
+            }
+        }
+        bench.send_ns[i] = now_ns();
+        lost = lost || papa_send(conn, command, bench_reply, &bench) == 0;
+    }
+    const uint64_t sent_ns = now_ns() - start_ns;
+    lost = lost || !papa_flush(conn, BENCH_DRAIN_MS);
+    const uint64_t elapsed_ns = now_ns() - start_ns;
+    papa_close(conn);
+
+    if (lost || bench.answered < count) {
+        fprintf(stderr, "Error: Connection to papad lost after %d of %d replies\n", bench.answered, count);
+        free(bench.send_ns);
+        free(bench.rtt_ns);
+        return EXIT_FAILURE;
+    }
+
+    qsort(bench.rtt_ns, (size_t) count, sizeof(uint64_t), compare_u64);
+    double sum = 0.0;
+    for (int i = 0; i < count; i++) sum += (double) bench.rtt_ns[i];
+
+    if (rate > 0.0) {
+        printf("%d x \"%s\" at %.0f/s on one session\n", count, command, rate);
+    } else {
+        printf("%d x \"%s\" back to back on one session\n", count, command);
+    }
+    printf("  sent in %.1f ms (%.0f/s), answered in %.1f ms (%.0f/s), %d errors\n", sent_ns / 1e6,
+           count / (sent_ns / 1e9 > 0.0 ? sent_ns / 1e9 : 1e-9), elapsed_ns / 1e6, count / (elapsed_ns / 1e9),
+           bench.failed);
+    printf("  round trip  min %.1f  p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f  mean %.1f us\n",
+           bench.rtt_ns[0] / 1e3, percentile_us(bench.rtt_ns, count, 50.0), percentile_us(bench.rtt_ns, count, 90.0),
+           percentile_us(bench.rtt_ns, count, 99.0), percentile_us(bench.rtt_ns, count, 99.9),
+           bench.rtt_ns[count - 1] / 1e3, sum / count / 1e3);
+
+    free(bench.send_ns);
+    free(bench.rtt_ns);
+    return bench.failed > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,13 @@
+#ifndef ASYNC_AUDIO_PLAYER_BATCH_H
+#define ASYNC_AUDIO_PLAYER_BATCH_H
+
+// Send the commands in path (NULL or "-" for stdin), one per line, pipelined over one session and print
+// the replies in order. Blank lines and lines starting with # are skipped, and "sleep <seconds>" waits
+// for the replies so far before pausing. Returns EXIT_FAILURE when a command failed or papad went away.
+int batch_run(const char *socket_path, const char *path);
+
+// Fire count commands at rate per second (0 = back to back) on one session and print the round-trip
+// latency percentiles. Returns an exit status.
+int batch_bench(const char *socket_path, int count, double rate, const char *command);
+
+#endif // ASYNC_AUDIO_PLAYER_BATCH_H
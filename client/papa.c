@@ -1,11 +1,13 @@
 #include <stdio.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <sys/socket.h>
-#include <sys/un.h>
 #include <getopt.h>
 #include "pw_monitor.h"
+#include "papa.h"
+#include "trigger_bench.h"
+#include "batch.h"
 
 // Socket path definition
 #define BUFFER_SIZE 1024
@@ -20,6 +22,23 @@ static struct option long_options[] = {
     {"status", no_argument, 0, 't'},
     {"help", no_argument, 0, 'h'},
     {"list-devices", no_argument, 0, 'd'},
+    {"cache", no_argument, 0, 'c'},
+    {"go", no_argument, 0, 'g'},
+    {"goto", required_argument, 0, 'G'},
+    {"pause-show", no_argument, 0, 'P'},
+    {"volume", required_argument, 0, 'v'},
+    {"bus-gain", required_argument, 0, 'B'},
+    {"mute", required_argument, 0, 'm'},
+    {"unmute", required_argument, 0, 'u'},
+    {"meters", no_argument, 0, 'M'},
+    {"delay", required_argument, 0, 'D'},
+    {"pan", required_argument, 0, 'n'},
+    {"signal", required_argument, 0, 'S'},
+    {"measure-latency", required_argument, 0, 'L'},
+    {"socket", required_argument, 0, 'U'},
+    {"trigger-bench", required_argument, 0, 'T'},
+    {"batch", optional_argument, 0, 'b'},
+    {"bench", required_argument, 0, 'e'},
     {0, 0, 0, 0}
 };
 
@@ -35,74 +54,59 @@ static void print_help(const char *program_name) {
     printf("  --reload              Reload configuration\n");
     printf("  --status              Show current status\n");
     printf("  --list-devices        List available PipeWire audio devices\n");
+    printf("  --cache               Show sample cache usage and hit rate\n");
+    printf("  --go                  Fire the next cue (or resume a paused show)\n");
+    printf("  --goto <cue_id>       Jump to a cue and fire it\n");
+    printf("  --pause-show          Hold cue actions that have not started yet\n");
+    printf("  --volume <track>=<g>  Set a playing track's gain\n");
+    printf("  --bus-gain <bus>=<g>  Set the group gain of a bus\n");
+    printf("  --mute <bus>          Mute a bus\n");
+    printf("  --unmute <bus>        Unmute a bus\n");
+    printf("  --meters              Show peak/RMS levels (dBFS) and clip counts\n");
+    printf("  --delay <dev>:<ch>=<ms>  Set a channel's alignment delay on an output\n");
+    printf("  --pan <track>=<x>,<y>[,<s>]  Move a spatial track, gliding over s seconds\n");
+    printf("  --signal \"<type> [channels] [key=value ...]\"  Play a test signal (sine, white, pink,\n");
+    printf("                        sweep, ident) or stop it (off)\n");
+    printf("  --measure-latency \"<dev> <ch> [capture=<dev>] [input=<ch>] [signal=mls|chirp]\"\n");
+    printf("                        Measure round-trip latency of an output channel over a loopback\n");
+    printf("  --trigger-bench <n>   Compare n trigger round trips over shared memory and the socket\n");
+    printf("  --batch [file]        Send the commands in file (stdin without it), one per line, over one\n");
+    printf("                        connection; \"sleep <s>\" pauses, # starts a comment\n");
+    printf("  --bench \"<n> [rate] [command]\"  Send n commands (default ping) at rate per second\n");
+    printf("                        (default back to back) and print round-trip percentiles\n");
+    printf("  --socket <path>       Talk to the papad listening on path (give it before the command)\n");
     printf("  --help                Show this help message\n");
 }
 
-// Get the socket path for the current user
-static char* get_socket_path(char* buffer, size_t size)
-{
-    if (!buffer || size == 0)
-    {
-        return NULL;
-    }
-
-    // Ensure the runtime directory exists
-    char dir_path[256];
-    snprintf(dir_path, sizeof(dir_path), "/var/run/user/%d/papa", (int)getuid());
-
-    // Construct the socket path
-    snprintf(buffer, size, "%s/papad.sock", dir_path);
-    return buffer;
-}
-
-
-// Send command to socket server
-static int send_command(const char *command) {
-    int sock;
-    struct sockaddr_un addr;
-    char buffer[BUFFER_SIZE];
+// Socket of another papad instance, set by --socket
+static const char *socket_override = NULL;
 
-    char socket_path[256];
-    get_socket_path(socket_path, sizeof(socket_path));
-
-    // Create socket
-    sock = socket(AF_UNIX, SOCK_STREAM, 0);
-    if (sock < 0) {
-        perror("socket");
-        return EXIT_FAILURE;
-    }
-
-    // Setup address structure
-    memset(&addr, 0, sizeof(struct sockaddr_un));
-    addr.sun_family = AF_UNIX;
-    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
-
-    // Connect to server
-    if (connect(sock, (struct sockaddr *)&addr, sizeof(struct sockaddr_un)) < 0) {
-        perror("connect");
-        fprintf(stderr, "Error: Could not connect to audio player. Is it running?\n");
-        close(sock);
+// Send command to papad and print its reply; quietly returns EXIT_FAILURE when it is not running if quiet
+static int send_request(const char *command, bool quiet) {
+    papa_conn_t *conn = papa_connect(socket_override);
+    if (!conn) {
+        if (!quiet) {
+            perror("connect");
+            fprintf(stderr, "Error: Could not connect to audio player. Is it running?\n");
+        }
         return EXIT_FAILURE;
     }
 
-    // Send command
-    if (write(sock, command, strlen(command)) < 0) {
-        perror("write");
-        close(sock);
+    char *reply = papa_call(conn, command, NULL);
+    papa_close(conn);
+    if (!reply) {
+        fprintf(stderr, "Error: Could not send command to audio player\n");
         return EXIT_FAILURE;
     }
-
-    // Receive response
-    ssize_t bytes_read = read(sock, buffer, sizeof(buffer) - 1);
-    if (bytes_read > 0) {
-        buffer[bytes_read] = '\0';
-        printf("%s\n", buffer);
-    }
-
-    close(sock);
+    printf("%s\n", reply);
+    free(reply);
     return EXIT_SUCCESS;
 }
 
+static int send_command(const char *command) {
+    return send_request(command, false);
+}
+
 // Main function for client mode
 int main(int argc, char *argv[]) {
     int option_index = 0;
@@ -115,8 +119,33 @@ int main(int argc, char *argv[]) {
     }
 
     // Parse command line arguments
-    while ((c = getopt_long(argc, argv, "lp:s:arth", long_options, &option_index)) != -1) {
+    while ((c = getopt_long(argc, argv, "lp:s:arthdcgG:Pv:B:m:u:MD:n:S:L:U:T:b::e:", long_options, &option_index)) != -1) {
         switch (c) {
+            case 'U':
+                socket_override = optarg;
+                break;
+            case 'T': {
+                char socket_path[108];
+                return trigger_bench_run(socket_override ? socket_override
+                                                         : papa_socket_path(socket_path, sizeof(socket_path), false),
+                                         atoi(optarg));
+            }
+            case 'b': {
+                // "--batch file" as well as "--batch=file", which is also how a #! line passes it
+                const char *path = optarg ? optarg : (optind < argc ? argv[optind] : NULL);
+                return batch_run(socket_override, path);
+            }
+            case 'e': {
+                char *rest;
+                const long count = strtol(optarg, &rest, 10);
+                rest += strspn(rest, " ");
+                double rate = 0.0;
+                if (*rest >= '0' && *rest <= '9') {
+                    rate = strtod(rest, &rest);
+                    rest += strspn(rest, " ");
+                }
+                return batch_bench(socket_override, (int) count, rate, *rest ? rest : "ping");
+            }
             case 'l':
                 return send_command("list");
             case 'p':
@@ -148,8 +177,84 @@ int main(int argc, char *argv[]) {
                 print_help(argv[0]);
                 return EXIT_FAILURE;
             case 'd':
+                // The daemon answers from its registry cache; query PipeWire directly without it
+                if (send_request("devices", true) == EXIT_SUCCESS) {
+                    return EXIT_SUCCESS;
+                }
                 list_audio_devices();
                 return EXIT_SUCCESS;
+            case 'c':
+                return send_command("cache");
+            case 'g':
+                return send_command("go");
+            case 'G': {
+                char command[BUFFER_SIZE];
+                snprintf(command, sizeof(command), "goto %s", optarg);
+                return send_command(command);
+            }
+            case 'P':
+                return send_command("pause-show");
+            case 'v': {
+                char *sep = strchr(optarg, '=');
+                if (!sep) {
+                    fprintf(stderr, "Error: --volume expects <track>=<gain>\n");
+                    return EXIT_FAILURE;
+                }
+                char command[BUFFER_SIZE];
+                snprintf(command, sizeof(command), "volume %.*s %s", (int) (sep - optarg), optarg, sep + 1);
+                return send_command(command);
+            }
+            case 'B': {
+                char *sep = strchr(optarg, '=');
+                if (!sep) {
+                    fprintf(stderr, "Error: --bus-gain expects <bus>=<gain>\n");
+                    return EXIT_FAILURE;
+                }
+                char command[BUFFER_SIZE];
+                snprintf(command, sizeof(command), "bus %.*s gain %s", (int) (sep - optarg), optarg, sep + 1);
+                return send_command(command);
+            }
+            case 'M':
+                return send_command("meters");
+            case 'n': {
+                char *sep = strchr(optarg, '=');
+                float x, y, seconds = 0.0f;
+                if (!sep || sscanf(sep + 1, "%f,%f,%f", &x, &y, &seconds) < 2) {
+                    fprintf(stderr, "Error: --pan expects <track>=<x>,<y>[,<seconds>]\n");
+                    return EXIT_FAILURE;
+                }
+                char command[BUFFER_SIZE];
+                snprintf(command, sizeof(command), "pan %.*s %g %g %g", (int) (sep - optarg), optarg, x, y, seconds);
+                return send_command(command);
+            }
+            case 'S': {
+                char command[BUFFER_SIZE];
+                snprintf(command, sizeof(command), "signal %s", optarg);
+                return send_command(command);
+            }
+            case 'L': {
+                char command[BUFFER_SIZE];
+                snprintf(command, sizeof(command), "measure-latency %s", optarg);
+                return send_command(command);
+            }
+            case 'D': {
+                char *colon = strrchr(optarg, ':');
+                char *sep = colon ? strchr(colon, '=') : NULL;
+                if (!sep) {
+                    fprintf(stderr, "Error: --delay expects <device>:<channel>=<ms>\n");
+                    return EXIT_FAILURE;
+                }
+                char command[BUFFER_SIZE];
+                snprintf(command, sizeof(command), "delay %.*s %.*s %s", (int) (colon - optarg), optarg,
+                         (int) (sep - colon - 1), colon + 1, sep + 1);
+                return send_command(command);
+            }
+            case 'm':
+            case 'u': {
+                char command[BUFFER_SIZE];
+                snprintf(command, sizeof(command), "bus %s %s", optarg, c == 'm' ? "mute" : "unmute");
+                return send_command(command);
+            }
         }
     }
 
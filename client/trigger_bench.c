@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include "trigger_bench.h"
+#include "papa.h"
+
+#define BENCH_TIMEOUT_US 1000000
+#define BENCH_GAP_NS 2000000        // Pause between samples so each one finds papad idle
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void pause_between(void) {
+    const struct timespec gap = {.tv_sec = 0, .tv_nsec = BENCH_GAP_NS};
+    nanosleep(&gap, NULL);
+}
+
+// One "ping" from connecting to the server closing the connection; received_ns is papad's clock when the
+// command was handled, on the same CLOCK_MONOTONIC as ours
+static bool socket_ping(const char *socket_path, uint64_t *received_ns) {
+    const int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0) return false;
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+
+    const char *command = "ping";
+    char response[128];
+    size_t length = 0;
+    bool ok = connect(sock, (struct sockaddr *) &addr, sizeof(addr)) == 0 &&
+              write(sock, command, strlen(command)) == (ssize_t) strlen(command);
+    ssize_t n;
+    while (ok && length < sizeof(response) - 1 && (n = read(sock, response + length, sizeof(response) - 1 - length)) > 0) {
+        length += (size_t) n;
+    }
+    close(sock);
+    response[length] = '\0';
+
+    unsigned long long received = 0;
+    if (!ok || sscanf(response, "OK: pong %llu", &received) != 1) return false;
+    *received_ns = received;
+    return true;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    const uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+    return x < y ? -1 : x > y;
+}
+
+static void print_distribution(const char *name, uint64_t *samples, const int count) {
+    qsort(samples, count, sizeof(uint64_t), compare_u64);
+    double sum = 0.0;
+    for (int i = 0; i < count; i++) sum += (double) samples[i];
+    printf("  %-10s min %8.1f  median %8.1f  p99 %8.1f  max %8.1f  mean %8.1f us\n", name,
+           samples[0] / 1e3, samples[count / 2] / 1e3, samples[(count * 99) / 100] / 1e3,
+           samples[count - 1] / 1e3, sum / count / 1e3);
+}
+
+int trigger_bench_run(const char *socket_path, const int count) {
+    if (count <= 0) {
+        fprintf(stderr, "Error: --trigger-bench needs a positive count\n");
+        return EXIT_FAILURE;
+    }
+
+    papa_trigger_t *trigger = papa_trigger_open(socket_path);
+    if (!trigger) {
+        fprintf(stderr, "Error: No trigger ring; is 'triggers: enabled: true' set in papad's configuration?\n");
+        return EXIT_FAILURE;
+    }
+
+    // Caller cost, acknowledge latency and skew (trigger to the time papad schedules from) of both paths
+    uint64_t *samples = calloc((size_t) count * 5, sizeof(uint64_t));
+    papa_conn_t *conn = papa_connect(socket_path);
+    if (!samples || !conn) {
+        free(samples);
+        papa_close(conn);
+        papa_trigger_close(trigger);
+        return EXIT_FAILURE;
+    }
+    uint64_t *ring_write = samples, *ring_ack = samples + count;
+    uint64_t *socket_call = samples + 2 * count, *socket_skew = samples + 3 * count;
+    uint64_t *session_call = samples + 4 * count;
+
+    for (int i = 0; i < count; i++) {
+        const uint64_t start = now_ns();
+        const uint64_t seq = papa_trigger_send(trigger, TRIGGER_PING, NULL);
+        const uint64_t written = now_ns();
+        if (seq == 0 || !papa_trigger_wait(trigger, seq, BENCH_TIMEOUT_US)) {
+            fprintf(stderr, "Error: papad did not consume trigger %d\n", i);
+            free(samples);
+            papa_close(conn);
+            papa_trigger_close(trigger);
+            return EXIT_FAILURE;
+        }
+        ring_write[i] = written - start;
+        ring_ack[i] = now_ns() - start;
+        pause_between();
+    }
+    papa_trigger_close(trigger);
+
+    for (int i = 0; i < count; i++) {
+        const uint64_t start = now_ns();
+        uint64_t received = 0;
+        if (!socket_ping(socket_path, &received)) {
+            fprintf(stderr, "Error: ping over the socket failed\n");
+            free(samples);
+            papa_close(conn);
+            return EXIT_FAILURE;
+        }
+        socket_call[i] = now_ns() - start;
+        socket_skew[i] = received > start ? received - start : 0;
+        pause_between();
+    }
+
+    // The same command on one persistent connection
+    for (int i = 0; i < count; i++) {
+        const uint64_t start = now_ns();
+        bool ok = false;
+        char *reply = papa_call(conn, "ping", &ok);
+        free(reply);
+        if (!ok) {
+            fprintf(stderr, "Error: ping over the session failed\n");
+            free(samples);
+            papa_close(conn);
+            return EXIT_FAILURE;
+        }
+        session_call[i] = now_ns() - start;
+        pause_between();
+    }
+    papa_close(conn);
+
+    printf("%d triggers each\n", count);
+    printf("Shared memory (records are timed from their own timestamp, skew 0):\n");
+    print_distribution("write", ring_write, count);
+    print_distribution("acked", ring_ack, count);
+    printf("Text socket, one connection per command:\n");
+    print_distribution("call", socket_call, count);
+    print_distribution("skew", socket_skew, count);
+    printf("Text socket, persistent session:\n");
+    print_distribution("call", session_call, count);
+    free(samples);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,9 @@
+#ifndef ASYNC_AUDIO_PLAYER_TRIGGER_BENCH_H
+#define ASYNC_AUDIO_PLAYER_TRIGGER_BENCH_H
+
+// Time count pings through the shared-memory trigger ring against the same number of "ping" commands
+// over the text socket, one-shot and on a persistent session, and print the latency distributions.
+// Returns an exit status.
+int trigger_bench_run(const char *socket_path, int count);
+
+#endif // ASYNC_AUDIO_PLAYER_TRIGGER_BENCH_H
@@ -0,0 +1,351 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include "papa.h"
+
+#define PAPA_HELLO "session\n"          // Turns the connection into a pipelined session
+#define PAPA_HELLO_REPLY "OK: session "
+#define PAPA_HEADER_MAX 20              // Digits of a reply length plus the newline
+#define PAPA_PATH_MAX 108               // sockaddr_un.sun_path
+
+typedef struct {
+    papa_reply_fn fn;
+    void *data;
+} request_t;
+
+struct papa_conn {
+    char path[PAPA_PATH_MAX];
+    int fd;
+    bool failed;                // Set by a callback that found the session unusable
+
+    char *out;                  // Commands not yet written
+    size_t out_len, out_sent, out_cap;
+    char *in;                   // Replies not yet complete
+    size_t in_len, in_cap;
+
+    request_t *requests;        // Waiting for replies, oldest at first
+    size_t first, count, cap;
+    uint64_t sent;
+};
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000ULL + (uint64_t) ts.tv_nsec / 1000000ULL;
+}
+
+static bool reserve(char **buffer, size_t *cap, const size_t needed) {
+    if (needed <= *cap) return true;
+    size_t size = *cap ? *cap : 1024;
+    while (size < needed) size *= 2;
+    char *grown = realloc(*buffer, size);
+    if (!grown) return false;
+    *buffer = grown;
+    *cap = size;
+    return true;
+}
+
+static bool append_output(papa_conn_t *conn, const char *data, const size_t length) {
+    if (!reserve(&conn->out, &conn->out_cap, conn->out_len + length)) return false;
+    memcpy(conn->out + conn->out_len, data, length);
+    conn->out_len += length;
+    return true;
+}
+
+static bool push_request(papa_conn_t *conn, papa_reply_fn fn, void *data) {
+    if (conn->first > 0 && conn->first + conn->count == conn->cap) {
+        memmove(conn->requests, conn->requests + conn->first, conn->count * sizeof(request_t));
+        conn->first = 0;
+    }
+    if (conn->first + conn->count == conn->cap) {
+        const size_t cap = conn->cap ? conn->cap * 2 : 16;
+        request_t *grown = realloc(conn->requests, cap * sizeof(request_t));
+        if (!grown) return false;
+        conn->requests = grown;
+        conn->cap = cap;
+    }
+    conn->requests[conn->first + conn->count++] = (request_t) {fn, data};
+    return true;
+}
+
+static request_t pop_request(papa_conn_t *conn) {
+    const request_t request = conn->requests[conn->first++];
+    if (--conn->count == 0) conn->first = 0;
+    return request;
+}
+
+// Drop the connection and fail every command still waiting
+static void disconnect(papa_conn_t *conn, const char *reason) {
+    if (conn->fd >= 0) {
+        close(conn->fd);
+        conn->fd = -1;
+    }
+    conn->out_len = conn->out_sent = 0;
+    conn->in_len = 0;
+    while (conn->count > 0) {
+        const request_t request = pop_request(conn);
+        if (request.fn) request.fn(request.data, false, reason);
+    }
+}
+
+static void hello_done(void *data, bool ok, const char *reply) {
+    papa_conn_t *conn = data;
+    if (!ok || strncmp(reply, PAPA_HELLO_REPLY, strlen(PAPA_HELLO_REPLY)) != 0) {
+        conn->failed = true;
+    }
+}
+
+static bool open_socket(papa_conn_t *conn) {
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, conn->path, sizeof(addr.sun_path) - 1);
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0) {
+        const int err = errno;
+        close(fd);
+        errno = err;
+        return false;
+    }
+
+    conn->fd = fd;
+    conn->failed = false;
+    return append_output(conn, PAPA_HELLO, strlen(PAPA_HELLO)) && push_request(conn, hello_done, conn);
+}
+
+// Write what the socket takes without blocking; false when the connection is gone
+static bool flush_output(papa_conn_t *conn) {
+    while (conn->out_sent < conn->out_len) {
+        const ssize_t n = send(conn->fd, conn->out + conn->out_sent, conn->out_len - conn->out_sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            conn->out_sent += (size_t) n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        }
+    }
+    conn->out_len = conn->out_sent = 0;
+    return true;
+}
+
+// Read what has arrived; false on end of file or error
+static bool read_input(papa_conn_t *conn) {
+    for (;;) {
+        if (!reserve(&conn->in, &conn->in_cap, conn->in_len + 4096 + 1)) return false;
+        const ssize_t n = read(conn->fd, conn->in + conn->in_len, conn->in_cap - conn->in_len - 1);
+        if (n > 0) {
+            conn->in_len += (size_t) n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        }
+    }
+}
+
+// Run callbacks for every complete "<length>\n<body>" reply; -1 when the stream makes no sense
+static int parse_replies(papa_conn_t *conn) {
+    int handled = 0;
+    size_t offset = 0;
+
+    while (offset < conn->in_len) {
+        size_t length = 0;
+        size_t i = offset;
+        for (; i < conn->in_len && conn->in[i] >= '0' && conn->in[i] <= '9' && i - offset < PAPA_HEADER_MAX; i++) {
+            length = length * 10 + (size_t) (conn->in[i] - '0');
+        }
+        if (i == conn->in_len) break;   // Header not complete yet
+        if (i == offset || conn->in[i] != '\n' || conn->count == 0) {
+            // An older papad answers the session request as an unknown one-shot command
+            if (conn->count > 0 && conn->requests[conn->first].fn == hello_done) conn->failed = true;
+            return -1;
+        }
+
+        const size_t body = i + 1;
+        if (conn->in_len - body < length) break;
+
+        // Terminate the body in place; the byte after it is restored once the callback is done
+        if (!reserve(&conn->in, &conn->in_cap, conn->in_len + 1)) return -1;
+        const char saved = conn->in[body + length];
+        conn->in[body + length] = '\0';
+        const request_t request = pop_request(conn);
+        if (request.fn) {
+            request.fn(request.data, strncmp(conn->in + body, "ERROR", 5) != 0, conn->in + body);
+        }
+        conn->in[body + length] = saved;
+        offset = body + length;
+        handled++;
+        if (conn->failed) return -1;
+    }
+
+    memmove(conn->in, conn->in + offset, conn->in_len - offset);
+    conn->in_len -= offset;
+    return handled;
+}
+
+// Whether papad still holds an idle connection open
+static bool connection_alive(const papa_conn_t *conn) {
+    struct pollfd pfd = {.fd = conn->fd, .events = POLLIN};
+    if (poll(&pfd, 1, 0) <= 0) return true;
+    char byte;
+    return !(pfd.revents & (POLLHUP | POLLERR)) && recv(conn->fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT) != 0;
+}
+
+papa_conn_t *papa_connect(const char *socket_path) {
+    papa_conn_t *conn = calloc(1, sizeof(papa_conn_t));
+    if (!conn) return NULL;
+    conn->fd = -1;
+
+    if (socket_path) {
+        snprintf(conn->path, sizeof(conn->path), "%s", socket_path);
+    } else if (!papa_socket_path(conn->path, sizeof(conn->path), false)) {
+        free(conn);
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+
+    if (!open_socket(conn)) {
+        const int err = errno;
+        papa_close(conn);
+        errno = err;
+        return NULL;
+    }
+    return conn;
+}
+
+uint64_t papa_send(papa_conn_t *conn, const char *command, papa_reply_fn fn, void *data) {
+    if (!conn || !command || strchr(command, '\n')) return 0;
+
+    // Reuse the connection; bring it back when papad dropped it (a restart, for instance)
+    if (conn->fd >= 0 && conn->count == 0 && !connection_alive(conn)) {
+        disconnect(conn, "ERROR: Connection to papad lost");
+    }
+    if (conn->fd < 0 && !open_socket(conn)) return 0;
+
+    if (!append_output(conn, command, strlen(command)) || !append_output(conn, "\n", 1) ||
+        !push_request(conn, fn, data)) {
+        return 0;
+    }
+
+    // Get the command on its way now; the reply is collected by papa_dispatch
+    if (!flush_output(conn)) {
+        // The caller learns of this one from the return value, not from its callback
+        if (--conn->count == 0) conn->first = 0;
+        disconnect(conn, "ERROR: Connection to papad lost");
+        return 0;
+    }
+    return ++conn->sent;
+}
+
+int papa_dispatch(papa_conn_t *conn, const int timeout_ms) {
+    if (!conn || conn->fd < 0) return -1;
+
+    const uint64_t deadline = timeout_ms > 0 ? now_ms() + (uint64_t) timeout_ms : 0;
+    for (;;) {
+        if (!flush_output(conn)) {
+            disconnect(conn, "ERROR: Connection to papad lost");
+            return -1;
+        }
+        const bool open = read_input(conn);
+        const int handled = parse_replies(conn);
+        if (handled < 0) {
+            disconnect(conn, conn->failed ? "ERROR: papad does not support persistent connections"
+                                          : "ERROR: Malformed reply from papad");
+            return -1;
+        }
+        if (!open) {
+            disconnect(conn, "ERROR: Connection to papad lost");
+            return -1;
+        }
+        if (handled > 0 || timeout_ms == 0 || (conn->count == 0 && !papa_wants_write(conn))) {
+            return handled;
+        }
+
+        int wait_ms = -1;
+        if (timeout_ms > 0) {
+            const uint64_t now = now_ms();
+            if (now >= deadline) return 0;
+            wait_ms = (int) (deadline - now);
+        }
+        struct pollfd pfd = {.fd = conn->fd, .events = POLLIN | (papa_wants_write(conn) ? POLLOUT : 0)};
+        const int ready = poll(&pfd, 1, wait_ms);
+        if (ready == 0) return 0;
+        if (ready < 0 && errno != EINTR) {
+            disconnect(conn, "ERROR: Connection to papad lost");
+            return -1;
+        }
+    }
+}
+
+int papa_get_fd(const papa_conn_t *conn) {
+    return conn ? conn->fd : -1;
+}
+
+bool papa_wants_write(const papa_conn_t *conn) {
+    return conn && conn->out_sent < conn->out_len;
+}
+
+size_t papa_pending(const papa_conn_t *conn) {
+    return conn ? conn->count : 0;
+}
+
+bool papa_flush(papa_conn_t *conn, const int timeout_ms) {
+    const uint64_t deadline = timeout_ms > 0 ? now_ms() + (uint64_t) timeout_ms : 0;
+    while (papa_pending(conn) > 0) {
+        int wait_ms = -1;
+        if (timeout_ms >= 0) {
+            const uint64_t now = now_ms();
+            if (timeout_ms > 0 && now >= deadline) return false;
+            wait_ms = timeout_ms > 0 ? (int) (deadline - now) : 0;
+        }
+        const int handled = papa_dispatch(conn, wait_ms);
+        if (handled < 0 || (handled == 0 && timeout_ms == 0)) return false;
+    }
+    return true;
+}
+
+typedef struct {
+    bool done;
+    bool ok;
+    char *reply;
+} call_result_t;
+
+static void call_done(void *data, bool ok, const char *reply) {
+    call_result_t *result = data;
+    result->done = true;
+    result->ok = ok;
+    result->reply = strdup(reply);
+}
+
+char *papa_call(papa_conn_t *conn, const char *command, bool *ok) {
+    call_result_t result = {0};
+    if (papa_send(conn, command, call_done, &result) == 0) return NULL;
+
+    // Replies to commands queued earlier come first
+    while (!result.done) {
+        if (papa_dispatch(conn, -1) < 0 && !result.done) break;
+    }
+    if (ok) *ok = result.ok;
+    return result.reply;
+}
+
+void papa_close(papa_conn_t *conn) {
+    if (!conn) return;
+
+    disconnect(conn, "ERROR: Connection closed");
+    free(conn->out);
+    free(conn->in);
+    free(conn->requests);
+    free(conn);
+}
@@ -0,0 +1,51 @@
+#ifndef ASYNC_AUDIO_PLAYER_PAPA_H
+#define ASYNC_AUDIO_PLAYER_PAPA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "socket_path.h"
+#include "papa_trigger.h"
+
+// libpapa: control connection to papad. One persistent connection carries any number of commands;
+// they are pipelined (sent without waiting for earlier replies) and answered in order. Calls are
+// asynchronous: papa_send queues a command with a callback, papa_dispatch moves data and runs the
+// callbacks, and papa_get_fd lets the connection join a controller's own poll loop. A connection is
+// not thread-safe; use one per thread.
+typedef struct papa_conn papa_conn_t;
+
+// Reply to one command. ok is false for "ERROR: ..." replies and when the connection was lost before
+// the reply came, in which case reply describes that.
+typedef void (*papa_reply_fn)(void *data, bool ok, const char *reply);
+
+// Connect to the papad listening on socket_path, NULL for the shared default (papa_socket_path).
+// Returns NULL with errno set when papad is not reachable.
+papa_conn_t *papa_connect(const char *socket_path);
+
+// Queue command (one line, no newline) and return its request number, or 0 when the connection is
+// down and cannot be re-established. fn may be NULL to ignore the reply.
+uint64_t papa_send(papa_conn_t *conn, const char *command, papa_reply_fn fn, void *data);
+
+// Write queued commands and run callbacks of the replies that arrived, waiting up to timeout_ms for
+// progress (0 = do not wait, -1 = until at least one reply). Returns the number of replies handled,
+// or -1 when the connection was lost; a later papa_send reconnects.
+int papa_dispatch(papa_conn_t *conn, int timeout_ms);
+
+// Descriptor to poll for POLLIN, and for POLLOUT while papa_wants_write; -1 when disconnected
+int papa_get_fd(const papa_conn_t *conn);
+bool papa_wants_write(const papa_conn_t *conn);
+
+// Commands still waiting for their reply
+size_t papa_pending(const papa_conn_t *conn);
+
+// Dispatch until every queued command is answered; false on timeout or connection loss
+bool papa_flush(papa_conn_t *conn, int timeout_ms);
+
+// Send one command and wait for its reply (caller frees); NULL when the connection failed.
+// ok, when given, tells an "OK" reply from an "ERROR" one.
+char *papa_call(papa_conn_t *conn, const char *command, bool *ok);
+
+// Close the connection; callbacks of unanswered commands run with ok false
+void papa_close(papa_conn_t *conn);
+
+#endif // ASYNC_AUDIO_PLAYER_PAPA_H
@@ -0,0 +1,167 @@
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include "papa_trigger.h"
+#include "socket_path.h"
+
+#define WAIT_SPIN_NS 200000     // Busy-wait this long before sleeping between checks
+#define WAIT_SLEEP_NS 50000
+
+struct papa_trigger {
+    trigger_ring_t *ring;
+    uint64_t head;              // Local copy, only this handle writes it
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Send "trigger-ring" and receive the ring's descriptor with the response
+static int request_ring(const char *socket_path) {
+    const int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0) {
+        perror("socket");
+        return -1;
+    }
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+    if (connect(sock, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+        perror("connect");
+        fprintf(stderr, "Error: Could not connect to audio player. Is it running?\n");
+        close(sock);
+        return -1;
+    }
+
+    const char *command = "trigger-ring";
+    if (write(sock, command, strlen(command)) < 0) {
+        perror("write");
+        close(sock);
+        return -1;
+    }
+
+    char response[256];
+    struct iovec iov = {.iov_base = response, .iov_len = sizeof(response) - 1};
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg = {.msg_iov = &iov, .msg_iovlen = 1, .msg_control = control.buf,
+                         .msg_controllen = sizeof(control.buf)};
+    const ssize_t n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+    close(sock);
+    if (n <= 0) {
+        fprintf(stderr, "Error: No response to trigger-ring\n");
+        return -1;
+    }
+    response[n] = '\0';
+
+    int fd = -1;
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+        }
+    }
+    if (fd < 0) {
+        fprintf(stderr, "%s\n", response);
+    }
+    return fd;
+}
+
+papa_trigger_t *papa_trigger_open(const char *socket_path) {
+    char default_path[108];
+    if (!socket_path) {
+        socket_path = papa_socket_path(default_path, sizeof(default_path), false);
+        if (!socket_path) return NULL;
+    }
+
+    const int fd = request_ring(socket_path);
+    if (fd < 0) return NULL;
+
+    trigger_ring_t *ring = mmap(NULL, sizeof(trigger_ring_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ring == MAP_FAILED) {
+        perror("mmap");
+        return NULL;
+    }
+    if (ring->magic != TRIGGER_RING_MAGIC || ring->version != TRIGGER_RING_VERSION ||
+        ring->slots != TRIGGER_RING_SLOTS || ring->record_size != sizeof(trigger_record_t)) {
+        fprintf(stderr, "Error: Trigger ring layout does not match this client\n");
+        munmap(ring, sizeof(trigger_ring_t));
+        return NULL;
+    }
+
+    papa_trigger_t *trigger = calloc(1, sizeof(papa_trigger_t));
+    if (!trigger) {
+        munmap(ring, sizeof(trigger_ring_t));
+        return NULL;
+    }
+    trigger->ring = ring;
+    trigger->head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    return trigger;
+}
+
+uint64_t papa_trigger_send(papa_trigger_t *trigger, const trigger_type_t type, const char *id) {
+    if (!trigger || atomic_load_explicit(&trigger->ring->closed, memory_order_relaxed)) return 0;
+
+    trigger_ring_t *ring = trigger->ring;
+    if (trigger->head - atomic_load_explicit(&ring->tail, memory_order_acquire) >= TRIGGER_RING_SLOTS) {
+        return 0;
+    }
+
+    trigger_record_t *record = &ring->records[trigger->head & (TRIGGER_RING_SLOTS - 1)];
+    record->type = type;
+    record->reserved = 0;
+    memset(record->id, 0, sizeof(record->id));
+    if (id) {
+        strncpy(record->id, id, sizeof(record->id) - 1);
+    }
+    record->time_ns = now_ns();
+
+    // Publish the record; papad reads head with acquire before touching the slot
+    atomic_store_explicit(&ring->head, ++trigger->head, memory_order_release);
+    return trigger->head;
+}
+
+bool papa_trigger_wait(papa_trigger_t *trigger, const uint64_t seq, const int64_t timeout_us) {
+    if (!trigger) return false;
+
+    const uint64_t start = now_ns();
+    const uint64_t deadline = start + (uint64_t) (timeout_us > 0 ? timeout_us : 0) * 1000ULL;
+    for (;;) {
+        if (atomic_load_explicit(&trigger->ring->tail, memory_order_acquire) >= seq) return true;
+        if (atomic_load_explicit(&trigger->ring->closed, memory_order_relaxed)) return false;
+
+        const uint64_t now = now_ns();
+        if (now >= deadline) return false;
+        if (now - start < WAIT_SPIN_NS) {
+            sched_yield();
+        } else {
+            const struct timespec pause = {.tv_sec = 0, .tv_nsec = WAIT_SLEEP_NS};
+            nanosleep(&pause, NULL);
+        }
+    }
+}
+
+uint64_t papa_trigger_failed(const papa_trigger_t *trigger) {
+    return trigger ? atomic_load_explicit(&trigger->ring->rejected, memory_order_relaxed) : 0;
+}
+
+void papa_trigger_close(papa_trigger_t *trigger) {
+    if (!trigger) return;
+
+    atomic_store(&trigger->ring->closed, 1);
+    munmap(trigger->ring, sizeof(trigger_ring_t));
+    free(trigger);
+}
@@ -0,0 +1,31 @@
+#ifndef ASYNC_AUDIO_PLAYER_PAPA_TRIGGER_H
+#define ASYNC_AUDIO_PLAYER_PAPA_TRIGGER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "trigger_ring.h"
+
+// Client side of papad's shared-memory trigger ring. Writing a trigger is a store into shared memory:
+// no syscall and no wakeup of papad, which picks the record up on its next pass over the rings. Each
+// record carries the time it was written, and papad times the action from there. One ring per handle;
+// a handle must only be written from one thread at a time.
+typedef struct papa_trigger papa_trigger_t;
+
+// Ask the papad listening on socket_path (NULL for the default) for a ring; NULL with a message on
+// stderr when it refuses
+papa_trigger_t *papa_trigger_open(const char *socket_path);
+
+// Queue a trigger; returns its sequence number, or 0 when the ring is full or papad closed it.
+// id names the cue or track, NULL for go and ping.
+uint64_t papa_trigger_send(papa_trigger_t *trigger, trigger_type_t type, const char *id);
+
+// Wait up to timeout_us until papad has consumed the record with sequence seq; spins briefly, then sleeps
+bool papa_trigger_wait(papa_trigger_t *trigger, uint64_t seq, int64_t timeout_us);
+
+// Records papad could not carry out (unknown cue or track)
+uint64_t papa_trigger_failed(const papa_trigger_t *trigger);
+
+// Release the ring; papad reuses it on its next check
+void papa_trigger_close(papa_trigger_t *trigger);
+
+#endif // ASYNC_AUDIO_PLAYER_PAPA_TRIGGER_H
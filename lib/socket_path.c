@@ -0,0 +1,74 @@
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "socket_path.h"
+
+#define SOCKET_NAME "papad.sock"
+
+static bool usable_dir(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode) && access(path, W_OK | X_OK) == 0;
+}
+
+static bool socket_exists(const char *dir_path) {
+    char path[PATH_MAX];
+    struct stat st;
+    return snprintf(path, sizeof(path), "%s/%s", dir_path, SOCKET_NAME) < (int) sizeof(path) &&
+           stat(path, &st) == 0 && S_ISSOCK(st.st_mode);
+}
+
+char *papa_socket_path(char *buffer, size_t size, bool create) {
+    if (!buffer || size == 0) {
+        return NULL;
+    }
+
+    // An explicit path wins, so several instances can run side by side
+    const char *override = getenv("PAPA_SOCKET");
+    if (override && override[0] != '\0') {
+        return snprintf(buffer, size, "%s", override) < (int) size ? buffer : NULL;
+    }
+
+    const char *xdg = getenv("XDG_RUNTIME_DIR");
+    char dir_path[PATH_MAX];
+    char fallback[PATH_MAX];
+    const int uid = (int) getuid();
+
+    // Prefer XDG_RUNTIME_DIR, otherwise /run/user/<uid>
+    if (xdg && xdg[0] != '\0') {
+        if (snprintf(dir_path, sizeof(dir_path), "%s/%s", xdg, RUNTIME_SUBDIR) >= (int) sizeof(dir_path)) {
+            return NULL;
+        }
+    } else if (snprintf(dir_path, sizeof(dir_path), "/run/user/%d/%s", uid, RUNTIME_SUBDIR) >= (int) sizeof(dir_path)) {
+        return NULL;
+    }
+    if (snprintf(fallback, sizeof(fallback), "/tmp/%s-%d", RUNTIME_SUBDIR, uid) >= (int) sizeof(fallback)) {
+        return NULL;
+    }
+
+    bool usable;
+    if (create) {
+        // Ensure the runtime subdirectory exists with 0700 and is writable
+        usable = (mkdir(dir_path, 0700) == 0 || errno == EEXIST) && usable_dir(dir_path);
+        if (!usable) {
+            // Fall back to /tmp/<subdir>-<uid>, then to a fresh directory if that one belongs to someone else
+            if ((mkdir(fallback, 0700) < 0 && errno != EEXIST) || !usable_dir(fallback)) {
+                if (snprintf(fallback, sizeof(fallback), "/tmp/%s-%d-XXXXXX", RUNTIME_SUBDIR, uid) >=
+                    (int) sizeof(fallback) || !mkdtemp(fallback)) {
+                    return NULL;
+                }
+            }
+        }
+    } else {
+        // Clients follow papad to the fallback only when its socket is there
+        usable = socket_exists(dir_path) || !socket_exists(fallback);
+    }
+
+    if (snprintf(buffer, size, "%s/%s", usable ? dir_path : fallback, SOCKET_NAME) >= (int) size) {
+        return NULL;
+    }
+    return buffer;
+}
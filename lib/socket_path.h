@@ -0,0 +1,18 @@
+#ifndef ASYNC_AUDIO_PLAYER_SOCKET_PATH_H
+#define ASYNC_AUDIO_PLAYER_SOCKET_PATH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifndef RUNTIME_SUBDIR
+#define RUNTIME_SUBDIR "papa"
+#endif
+
+// Control socket location, shared by papad and its clients so both resolve the same path:
+// $PAPA_SOCKET when set, else $XDG_RUNTIME_DIR/papa/papad.sock (/run/user/<uid>/papa without
+// XDG_RUNTIME_DIR), else /tmp/papa-<uid>/papad.sock when the runtime directory is not usable.
+// With create, the directory is created 0700 as papad needs it; clients only look for an existing
+// socket. Returns buffer, or NULL when the path does not fit.
+char *papa_socket_path(char *buffer, size_t size, bool create);
+
+#endif // ASYNC_AUDIO_PLAYER_SOCKET_PATH_H
@@ -0,0 +1,260 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "arena.h"
+#include "log.h"
+
+#define ARENA_ALIGN 64                      // Cache line; also the block header size
+#define ARENA_HUGE_PAGE (2 * 1024 * 1024)
+#define ARENA_MAGIC_FREE 0x46524545u        // "FREE"
+#define ARENA_MAGIC_USED 0x55534544u        // "USED"
+
+// Header in front of every block; free blocks form an address-ordered list
+typedef struct arena_block {
+    size_t size;                // Including this header
+    struct arena_block *next;   // Next free block, only valid while free
+    uint32_t magic;
+} arena_block_t;
+
+_Static_assert(sizeof(arena_block_t) <= ARENA_ALIGN, "arena header must fit in one alignment unit");
+
+static struct {
+    pthread_mutex_t lock;
+    char *base;
+    size_t capacity;
+    size_t used;
+    size_t peak;
+    size_t allocations;
+    size_t heap_fallbacks;
+    bool huge_pages;
+    bool locked;
+    arena_block_t *free_list;
+} arena = {
+        .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static size_t align_up(size_t value, size_t align) {
+    return (value + align - 1) & ~(align - 1);
+}
+
+static bool in_arena(const void *ptr) {
+    return arena.base && (const char *) ptr >= arena.base && (const char *) ptr < arena.base + arena.capacity;
+}
+
+bool arena_init(const global_config_t *config) {
+    if (!config) return false;
+
+    if (config->memory.lock_all) {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+            log_warn("mlockall failed: %s (check RLIMIT_MEMLOCK)", strerror(errno));
+        } else {
+            log_info("Locked all process memory");
+        }
+    }
+
+    // The arena lives for the whole process; reloads keep the existing mapping
+    if (arena.base || config->memory.arena_mb <= 0) return true;
+
+    size_t size = align_up((size_t) config->memory.arena_mb * 1024 * 1024, ARENA_HUGE_PAGE);
+    void *base = MAP_FAILED;
+
+    if (config->memory.huge_pages) {
+        base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (base == MAP_FAILED) {
+            log_warn("Huge page arena unavailable (%s), using regular pages", strerror(errno));
+        } else {
+            arena.huge_pages = true;
+        }
+    }
+    if (base == MAP_FAILED) {
+        base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            log_error("Failed to map %zu byte arena: %s", size, strerror(errno));
+            return false;
+        }
+        if (config->memory.huge_pages) {
+            madvise(base, size, MADV_HUGEPAGE);
+        }
+    }
+
+    // mlock also faults every page in, so nothing is left to fault on the audio path
+    if (config->memory.lock) {
+        if (mlock(base, size) == 0) {
+            arena.locked = true;
+        } else {
+            log_warn("Failed to lock arena: %s (check RLIMIT_MEMLOCK)", strerror(errno));
+        }
+    }
+    if (!arena.locked) {
+        memset(base, 0, size);
+    }
+
+    pthread_mutex_lock(&arena.lock);
+    arena.base = base;
+    arena.capacity = size;
+    arena.free_list = (arena_block_t *) arena.base;
+    arena.free_list->size = size;
+    arena.free_list->next = NULL;
+    arena.free_list->magic = ARENA_MAGIC_FREE;
+    pthread_mutex_unlock(&arena.lock);
+
+    log_info("Audio arena: %zu MiB%s%s", size / (1024 * 1024),
+             arena.huge_pages ? ", huge pages" : "", arena.locked ? ", locked" : "");
+    return true;
+}
+
+// First fit from the free list, splitting off the remainder (lock held)
+static void *alloc_locked(size_t size) {
+    const size_t need = align_up(size, ARENA_ALIGN) + ARENA_ALIGN;
+
+    for (arena_block_t **link = &arena.free_list; *link; link = &(*link)->next) {
+        arena_block_t *block = *link;
+        if (block->size < need) continue;
+
+        if (block->size - need >= 2 * ARENA_ALIGN) {
+            arena_block_t *rest = (arena_block_t *) ((char *) block + need);
+            rest->size = block->size - need;
+            rest->next = block->next;
+            rest->magic = ARENA_MAGIC_FREE;
+            block->size = need;
+            *link = rest;
+        } else {
+            *link = block->next;
+        }
+
+        block->magic = ARENA_MAGIC_USED;
+        block->next = NULL;
+        arena.used += block->size;
+        arena.allocations++;
+        if (arena.used > arena.peak) arena.peak = arena.used;
+        return (char *) block + ARENA_ALIGN;
+    }
+
+    return NULL;
+}
+
+void *arena_alloc(size_t size) {
+    if (size == 0) size = 1;
+
+    pthread_mutex_lock(&arena.lock);
+    void *ptr = arena.base ? alloc_locked(size) : NULL;
+    if (!ptr && arena.base) {
+        if (arena.heap_fallbacks++ == 0) {
+            log_warn("Audio arena exhausted, falling back to heap allocation");
+        }
+    }
+    pthread_mutex_unlock(&arena.lock);
+
+    return ptr ? ptr : malloc(size);
+}
+
+void *arena_calloc(size_t count, size_t size) {
+    if (size && count > SIZE_MAX / size) return NULL;
+
+    void *ptr = arena_alloc(count * size);
+    if (ptr) memset(ptr, 0, count * size);
+    return ptr;
+}
+
+void *arena_realloc(void *ptr, size_t size) {
+    if (!ptr) return arena_alloc(size);
+    if (!in_arena(ptr)) return realloc(ptr, size);
+
+    const arena_block_t *block = (const arena_block_t *) ((char *) ptr - ARENA_ALIGN);
+    const size_t old_size = block->size - ARENA_ALIGN;
+    if (size <= old_size) return ptr;
+
+    void *grown = arena_alloc(size);
+    if (!grown) return NULL;
+    memcpy(grown, ptr, old_size);
+    arena_free(ptr);
+    return grown;
+}
+
+void arena_free(void *ptr) {
+    if (!ptr) return;
+    if (!in_arena(ptr)) {
+        free(ptr);
+        return;
+    }
+
+    arena_block_t *block = (arena_block_t *) ((char *) ptr - ARENA_ALIGN);
+    pthread_mutex_lock(&arena.lock);
+
+    if (block->magic != ARENA_MAGIC_USED) {
+        pthread_mutex_unlock(&arena.lock);
+        log_error("Invalid or double free of arena block %p", ptr);
+        return;
+    }
+    block->magic = ARENA_MAGIC_FREE;
+    arena.used -= block->size;
+
+    // Insert in address order and merge with adjacent free neighbours
+    arena_block_t *prev = NULL;
+    arena_block_t *next = arena.free_list;
+    while (next && next < block) {
+        prev = next;
+        next = next->next;
+    }
+
+    block->next = next;
+    if (next && (char *) block + block->size == (char *) next) {
+        block->size += next->size;
+        block->next = next->next;
+    }
+
+    if (prev && (char *) prev + prev->size == (char *) block) {
+        prev->size += block->size;
+        prev->next = block->next;
+    } else if (prev) {
+        prev->next = block;
+    } else {
+        arena.free_list = block;
+    }
+
+    pthread_mutex_unlock(&arena.lock);
+}
+
+int arena_format_status(char *buffer, size_t size) {
+    pthread_mutex_lock(&arena.lock);
+    int written;
+    if (!arena.base) {
+        written = snprintf(buffer, size, "Arena: disabled (heap allocation)\n");
+    } else {
+        written = snprintf(buffer, size, "Arena: %.1f / %.1f MiB used, peak %.1f MiB, %zu allocations, %zu heap fallbacks%s%s\n",
+                           arena.used / (1024.0 * 1024.0), arena.capacity / (1024.0 * 1024.0),
+                           arena.peak / (1024.0 * 1024.0), arena.allocations, arena.heap_fallbacks,
+                           arena.huge_pages ? ", huge pages" : "", arena.locked ? ", locked" : "");
+    }
+    pthread_mutex_unlock(&arena.lock);
+    return written;
+}
+
+void arena_report(void) {
+    char line[256];
+    arena_format_status(line, sizeof(line));
+    line[strcspn(line, "\n")] = '\0';
+    log_info("%s", line);
+}
+
+void arena_cleanup(void) {
+    pthread_mutex_lock(&arena.lock);
+    if (arena.base) {
+        if (arena.used > 0) {
+            log_warn("Releasing audio arena with %zu bytes still allocated", arena.used);
+        }
+        if (arena.locked) munlock(arena.base, arena.capacity);
+        munmap(arena.base, arena.capacity);
+    }
+    arena.base = NULL;
+    arena.capacity = 0;
+    arena.used = 0;
+    arena.free_list = NULL;
+    arena.locked = false;
+    arena.huge_pages = false;
+    pthread_mutex_unlock(&arena.lock);
+}
@@ -0,0 +1,28 @@
+#ifndef ASYNC_AUDIO_PLAYER_ARENA_H
+#define ASYNC_AUDIO_PLAYER_ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "types.h"
+
+// Reserve, lock and prefault the audio memory arena
+bool arena_init(const global_config_t *config);
+
+// Allocate from the arena; falls back to the heap when disabled or exhausted
+void *arena_alloc(size_t size);
+void *arena_calloc(size_t count, size_t size);
+void *arena_realloc(void *ptr, size_t size);
+
+// Release memory from arena_alloc/arena_calloc/arena_realloc
+void arena_free(void *ptr);
+
+// Log arena usage
+void arena_report(void);
+
+// Format a one-line usage summary into buffer
+int arena_format_status(char *buffer, size_t size);
+
+// Unmap the arena
+void arena_cleanup(void);
+
+#endif // ASYNC_AUDIO_PLAYER_ARENA_H
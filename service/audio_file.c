@@ -1,12 +1,17 @@
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <errno.h>
 #include "audio_file.h"
+#include "pcm_cache.h"
+#include "sample_cache.h"
+#include "arena.h"
 #include "log.h"
 
 #define BUFFER_FRAMES 4096
 
 audio_file_t *audio_file_open(const char *path, const bool loop, const float volume) {
-    audio_file_t *af = calloc(1, sizeof(audio_file_t));
+    audio_file_t *af = arena_calloc(1, sizeof(audio_file_t));
     if (!af) {
         log_error("Failed to allocate audio file structure");
         return NULL;
@@ -15,21 +20,36 @@ audio_file_t *audio_file_open(const char *path, const bool loop, const float vol
     // Initialize SF_INFO structure
     memset(&af->info, 0, sizeof(SF_INFO));
 
-    // Open the sound file
-    af->file = sf_open(path, SFM_READ, &af->info);
-    if (!af->file) {
-        log_error("Failed to open audio file: %s (%s)", path, sf_strerror(NULL));
-        free(af);
-        return NULL;
+    // Prefer samples resident in memory, then decoded PCM on disk, then the source itself
+    pcm_cache_header_t header;
+    af->samples = sample_cache_acquire(path);
+    af->cache_fd = af->samples ? -1 : pcm_cache_open(path, &header);
+    if (af->samples) {
+        af->info.channels = af->samples->channels;
+        af->info.samplerate = af->samples->samplerate;
+        af->info.frames = af->samples->frames;
+        af->info.seekable = 1;
+    } else if (af->cache_fd >= 0) {
+        af->info.channels = (int) header.channels;
+        af->info.samplerate = (int) header.samplerate;
+        af->info.frames = (sf_count_t) header.frames;
+        af->info.seekable = 1;
+    } else {
+        // Open the sound file
+        af->file = sf_open(path, SFM_READ, &af->info);
+        if (!af->file) {
+            log_error("Failed to open audio file: %s (%s)", path, sf_strerror(NULL));
+            arena_free(af);
+            return NULL;
+        }
     }
 
     // Allocate buffer
     af->buffer_size = BUFFER_FRAMES * af->info.channels;
-    af->buffer = malloc(af->buffer_size * sizeof(float));
+    af->buffer = arena_alloc(af->buffer_size * sizeof(float));
     if (!af->buffer) {
         log_error("Failed to allocate audio buffer");
-        sf_close(af->file);
-        free(af);
+        audio_file_close(af);
         return NULL;
     }
 
@@ -37,16 +57,56 @@ audio_file_t *audio_file_open(const char *path, const bool loop, const float vol
     af->volume = volume;
     af->position = 0;
 
-    log_info("Opened audio file: %s (channels: %d, rate: %d)",
-             path, af->info.channels, af->info.samplerate);
+    log_info("Opened audio file: %s (channels: %d, rate: %d%s)", path, af->info.channels, af->info.samplerate,
+             af->samples ? ", in memory" : af->cache_fd >= 0 ? ", cached" : "");
 
     return af;
 }
 
+// Read frames from the current position of whichever backend is open
+static size_t read_frames(audio_file_t *af, float *output, const size_t frames) {
+    if (af->samples) {
+        const sf_count_t available = af->info.frames - af->position;
+        const size_t n = available < (sf_count_t) frames ? (size_t) available : frames;
+        memcpy(output, af->samples->samples + af->position * af->info.channels, n * af->info.channels * sizeof(float));
+        af->position += n;
+        return n;
+    }
+
+    if (af->cache_fd < 0) {
+        const sf_count_t n = sf_readf_float(af->file, output, frames);
+        if (n <= 0) return 0;
+        af->position += n;
+        return (size_t) n;
+    }
+
+    const sf_count_t available = af->info.frames - af->position;
+    const size_t wanted = available < (sf_count_t) frames ? (size_t) available : frames;
+    const size_t frame_bytes = af->info.channels * sizeof(float);
+    const off_t offset = sizeof(pcm_cache_header_t) + (off_t) af->position * frame_bytes;
+
+    size_t done = 0;
+    while (done < wanted * frame_bytes) {
+        const ssize_t n = pread(af->cache_fd, (char *) output + done, wanted * frame_bytes - done, offset + done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += (size_t) n;
+    }
+
+    af->position += done / frame_bytes;
+    return done / frame_bytes;
+}
+
 size_t audio_file_read(audio_file_t *af, float *output, const size_t frames) {
     if (!af || !output) return 0;
 
-    size_t frames_read = sf_readf_float(af->file, output, frames);
+    size_t frames_read = read_frames(af, output, frames);
+
+    // Handle looping
+    if (frames_read < frames && af->loop && audio_file_seek(af, 0)) {
+        const size_t remaining = frames - frames_read;
+        frames_read += read_frames(af, output + (frames_read * af->info.channels), remaining);
+    }
 
     // Apply volume
     if (af->volume != 1.0f) {
@@ -55,25 +115,23 @@ size_t audio_file_read(audio_file_t *af, float *output, const size_t frames) {
         }
     }
 
-    // Handle looping
-    if (frames_read < frames && af->loop) {
-        sf_seek(af->file, 0, SEEK_SET);
-        const size_t remaining = frames - frames_read;
-        const size_t additional = sf_readf_float(af->file, output + (frames_read * af->info.channels), remaining);
-        frames_read += additional;
-    }
-
-    af->position += frames_read;
     return frames_read;
 }
 
 bool audio_file_seek(audio_file_t *af, const sf_count_t position) {
     if (!af) return false;
 
-    const sf_count_t result = sf_seek(af->file, position, SEEK_SET);
-    if (result < 0) {
-        log_error("Failed to seek in audio file: %s", sf_strerror(af->file));
-        return false;
+    if (af->samples || af->cache_fd >= 0) {
+        if (position < 0 || position > af->info.frames) {
+            log_error("Failed to seek in cached audio file: position %lld out of range", (long long) position);
+            return false;
+        }
+    } else {
+        const sf_count_t result = sf_seek(af->file, position, SEEK_SET);
+        if (result < 0) {
+            log_error("Failed to seek in audio file: %s", sf_strerror(af->file));
+            return false;
+        }
     }
 
     af->position = position;
@@ -86,6 +144,10 @@ void audio_file_close(audio_file_t *af) {
     if (af->file) {
         sf_close(af->file);
     }
-    free(af->buffer);
-    free(af);
+    if (af->cache_fd >= 0) {
+        close(af->cache_fd);
+    }
+    sample_cache_release(af->samples);
+    arena_free(af->buffer);
+    arena_free(af);
 }
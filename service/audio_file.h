@@ -5,8 +5,12 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+struct sample_cache_entry;
+
 typedef struct {
     SNDFILE *file;
+    int cache_fd;       // Decoded PCM cache file, -1 when reading through libsndfile
+    const struct sample_cache_entry *samples;   // In-memory samples, referenced while open
     SF_INFO info;
     float *buffer;
     size_t buffer_size;
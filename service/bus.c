@@ -0,0 +1,798 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <spa/param/audio/format-utils.h>
+#include <spa/pod/builder.h>
+#include "bus.h"
+#include "meter.h"
+#include "output_stage.h"
+#include "panner.h"
+#include "drift.h"
+#include "track_manager.h"
+#include "arena.h"
+#include "thread_policy.h"
+#include "log.h"
+
+#define BUS_MAX_TRACKS 32
+#define BUS_CHUNK_FRAMES 1024           // Member tracks are rendered in blocks of at most this size
+#define BUS_MAX_TRACK_CHANNELS 16
+#define DUCK_DETECTOR_RELEASE_MS 20.0f  // Holds the sidechain envelope across waveform zero crossings
+
+// Member track and where its channels land in the mix
+typedef struct {
+    _Atomic(track_instance_t *) track;
+    int channels;
+    uint64_t route[BUS_MAX_TRACK_CHANNELS];     // Bus channel mask per track channel
+    int priority;
+
+    // Ducking this track applies to lower priorities, coefficients are per sample
+    bool ducks;
+    float duck_floor;       // Linear gain while the sidechain is above threshold
+    float duck_threshold;   // Linear sidechain level that triggers ducking
+    float attack_coef;
+    float release_coef;
+    float detector_coef;
+
+    // Sidechain state, owned by the data thread
+    float envelope;
+    float duck_gain;
+
+    // Spatial sources (mono or stereo) are panned instead of routed
+    bool spatial;
+    float spread;               // Half the stereo spread, radians
+    float x, y;                 // Current position, data thread
+    float from_x, from_y;
+    float to_x, to_y;
+    uint32_t glide_frames;      // Length of the running move, 0 when idle
+    uint32_t glide_pos;
+    float pan_gain[2][SPA_AUDIO_MAX_CHANNELS];  // Gains reached at the end of the last block
+
+    // Move requests from control threads, published seqlock style (odd while writing)
+    _Atomic uint32_t move_sequence;
+    uint32_t move_seen;
+    _Atomic float move_x;
+    _Atomic float move_y;
+    _Atomic uint32_t move_frames;
+    _Atomic uint64_t move_at_ns;
+    bool move_pending;          // Copied request waiting for its start time
+    float pending_x, pending_y;
+    uint32_t pending_frames;
+    uint64_t pending_at_ns;
+} bus_slot_t;
+
+struct bus {
+    const bus_config_t *config;
+    const global_config_t *global;
+    struct pw_stream *stream;
+    bus_render_fn render;
+    int channels;
+    const char *names[SPA_AUDIO_MAX_CHANNELS];  // Channel names of the bus output
+    bus_slot_t slots[BUS_MAX_TRACKS];
+    int track_count;
+    float *scratch;                             // One rendered block of a member track
+    float *duck_key;                            // Ducking gain from all higher priorities, per frame
+    float *group_key;                           // Ducking gain from the priority being mixed
+    bool connected;
+    reconnect_state_t reconnect;                // Outage of the output device, main loop
+
+    _Atomic float gain_target;
+    _Atomic bool muted;
+    _Atomic float duck_depth;                   // Deepest ducking gain at the end of the last quantum
+    float gain;                                 // Applied gain, owned by the data thread
+
+    // Lets bus_detach wait out a cycle that may still be rendering a removed track
+    _Atomic bool in_process;
+    _Atomic uint64_t cycles;
+
+    // Cost of the process callback, written by the data thread
+    _Atomic uint64_t cost_last_ns;
+    _Atomic uint64_t cost_peak_ns;
+    _Atomic uint64_t cost_total_ns;
+    _Atomic uint64_t quantum_ns;
+
+    panner_t *panner;                           // Speaker layout for spatial members
+    output_stage_t *output_stage;               // Device processing after the group gain
+    drift_t *drift;                             // Clock-drift resampler between mix and group gain
+    meter_t meter;                              // Output levels leaving the bus
+};
+
+// Run the sidechain of a ducking track and fold its gain curve into group_key
+static void follow_envelope(bus_slot_t *slot, const float *src, float *group_key, size_t n_frames) {
+    for (size_t f = 0; f < n_frames; f++) {
+        float level = 0.0f;
+        for (int ch = 0; ch < slot->channels; ch++) {
+            const float a = fabsf(src[f * slot->channels + ch]);
+            if (a > level) level = a;
+        }
+        slot->envelope = level > slot->envelope ? level : level + (slot->envelope - level) * slot->detector_coef;
+
+        const float target = slot->envelope > slot->duck_threshold ? slot->duck_floor : 1.0f;
+        const float coef = target < slot->duck_gain ? slot->attack_coef : slot->release_coef;
+        slot->duck_gain = target + (slot->duck_gain - target) * coef;
+
+        if (slot->duck_gain < group_key[f]) group_key[f] = slot->duck_gain;
+    }
+}
+
+static void apply_key(float *samples, const float *key, size_t n_frames, int channels) {
+    for (size_t f = 0; f < n_frames; f++) {
+        for (int ch = 0; ch < channels; ch++) {
+            samples[f * channels + ch] *= key[f];
+        }
+    }
+}
+
+// Add one rendered block to the mix
+static void mix_slot(const bus_slot_t *slot, const float *src, float *dst, size_t n_frames, int bus_channels) {
+    for (size_t f = 0; f < n_frames; f++) {
+        for (int ch = 0; ch < slot->channels; ch++) {
+            const float sample = src[f * slot->channels + ch];
+            for (uint64_t mask = slot->route[ch]; mask; mask &= mask - 1) {
+                dst[f * bus_channels + __builtin_ctzll(mask)] += sample;
+            }
+        }
+    }
+}
+
+// Position of each channel of a spatial source: mono sits at the position, stereo is rotated by
+// half the spread either side of it around the listener
+static void source_gains(const bus_t *bus, const bus_slot_t *slot, float gains[2][SPA_AUDIO_MAX_CHANNELS]) {
+    if (slot->channels == 1) {
+        panner_gains(bus->panner, slot->x, slot->y, gains[0]);
+        return;
+    }
+    const float c = cosf(slot->spread), s = sinf(slot->spread);
+    panner_gains(bus->panner, slot->x * c - slot->y * s, slot->x * s + slot->y * c, gains[0]);
+    panner_gains(bus->panner, slot->x * c + slot->y * s, -slot->x * s + slot->y * c, gains[1]);
+}
+
+// Pick up a move request and advance the running move to the end of this block
+static void advance_position(bus_slot_t *slot, size_t n_frames, uint64_t chunk_ns) {
+    const uint32_t sequence = atomic_load_explicit(&slot->move_sequence, memory_order_acquire);
+    if (sequence != slot->move_seen && (sequence & 1) == 0) {
+        const float x = atomic_load_explicit(&slot->move_x, memory_order_relaxed);
+        const float y = atomic_load_explicit(&slot->move_y, memory_order_relaxed);
+        const uint32_t frames = atomic_load_explicit(&slot->move_frames, memory_order_relaxed);
+        const uint64_t at_ns = atomic_load_explicit(&slot->move_at_ns, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->move_sequence, memory_order_relaxed) == sequence) {
+            slot->move_seen = sequence;
+            slot->move_pending = true;
+            slot->pending_x = x;
+            slot->pending_y = y;
+            slot->pending_frames = frames;
+            slot->pending_at_ns = at_ns;
+        }
+    }
+
+    if (slot->move_pending && slot->pending_at_ns <= chunk_ns) {
+        slot->move_pending = false;
+        slot->from_x = slot->x;
+        slot->from_y = slot->y;
+        slot->to_x = slot->pending_x;
+        slot->to_y = slot->pending_y;
+        slot->glide_frames = slot->pending_frames > 0 ? slot->pending_frames : 1;
+        slot->glide_pos = 0;
+    }
+
+    if (slot->glide_frames > 0) {
+        slot->glide_pos += (uint32_t) n_frames;
+        const float t = slot->glide_pos >= slot->glide_frames ? 1.0f : (float) slot->glide_pos / slot->glide_frames;
+        slot->x = slot->from_x + (slot->to_x - slot->from_x) * t;
+        slot->y = slot->from_y + (slot->to_y - slot->from_y) * t;
+        if (t >= 1.0f) slot->glide_frames = 0;
+    }
+}
+
+// Add a spatial source to the mix, ramping every speaker gain from the last block's value
+static void mix_spatial(const bus_t *bus, bus_slot_t *slot, const float *src, float *dst, size_t n_frames,
+                        uint64_t chunk_ns) {
+    const int channels = bus->channels;
+    float gains[2][SPA_AUDIO_MAX_CHANNELS];
+
+    advance_position(slot, n_frames, chunk_ns);
+    source_gains(bus, slot, gains);
+
+    const float inverse = 1.0f / (float) n_frames;
+    for (int c = 0; c < slot->channels; c++) {
+        for (int ch = 0; ch < channels; ch++) {
+            const float start = slot->pan_gain[c][ch];
+            const float end = gains[c][ch];
+            slot->pan_gain[c][ch] = end;
+            if (start == 0.0f && end == 0.0f) continue;
+
+            const float step = (end - start) * inverse;
+            for (size_t f = 0; f < n_frames; f++) {
+                dst[f * channels + ch] += src[f * slot->channels + c] * (start + step * (float) (f + 1));
+            }
+        }
+    }
+}
+
+// Mix all members into n_frames of dst, before the group gain
+static void mix_members(void *data, float *dst, size_t n_frames, uint64_t cycle_ns) {
+    bus_t *bus = data;
+    const int channels = bus->channels;
+    const uint32_t rate = (uint32_t) bus->config->samplerate;
+
+    memset(dst, 0, n_frames * channels * sizeof(float));
+
+    // Members ordered by priority, highest first, so each sidechain is known before lower priorities mix
+    track_instance_t *tracks[BUS_MAX_TRACKS];
+    bus_slot_t *order[BUS_MAX_TRACKS];
+    int count = 0;
+    for (int i = 0; i < BUS_MAX_TRACKS; i++) {
+        tracks[i] = atomic_load_explicit(&bus->slots[i].track, memory_order_acquire);
+        if (!tracks[i]) continue;
+
+        int pos = count++;
+        while (pos > 0 && order[pos - 1]->priority < bus->slots[i].priority) {
+            order[pos] = order[pos - 1];
+            pos--;
+        }
+        order[pos] = &bus->slots[i];
+    }
+
+    for (size_t offset = 0; offset < n_frames; offset += BUS_CHUNK_FRAMES) {
+        const size_t chunk = n_frames - offset < BUS_CHUNK_FRAMES ? n_frames - offset : BUS_CHUNK_FRAMES;
+        const uint64_t chunk_ns = cycle_ns + offset * 1000000000ULL / rate;
+        bool ducked = false;
+
+        for (int g = 0; g < count;) {
+            const int priority = order[g]->priority;
+            bool group_ducks = false;
+
+            for (; g < count && order[g]->priority == priority; g++) {
+                bus_slot_t *slot = order[g];
+                bus->render(tracks[slot - bus->slots], bus->scratch, chunk, chunk_ns);
+
+                if (slot->ducks) {
+                    if (!group_ducks) {
+                        for (size_t f = 0; f < chunk; f++) bus->group_key[f] = 1.0f;
+                        group_ducks = true;
+                    }
+                    follow_envelope(slot, bus->scratch, bus->group_key, chunk);
+                }
+                if (ducked) {
+                    apply_key(bus->scratch, bus->duck_key, chunk, slot->channels);
+                }
+                if (slot->spatial) {
+                    mix_spatial(bus, slot, bus->scratch, dst + offset * channels, chunk, chunk_ns);
+                } else {
+                    mix_slot(slot, bus->scratch, dst + offset * channels, chunk, channels);
+                }
+            }
+
+            // Tracks of equal priority never duck each other; the group's key applies from the next one down
+            if (group_ducks) {
+                for (size_t f = 0; f < chunk; f++) {
+                    const float key = ducked && bus->duck_key[f] < bus->group_key[f] ? bus->duck_key[f] : bus->group_key[f];
+                    bus->duck_key[f] = key;
+                }
+                ducked = true;
+            }
+        }
+    }
+
+    float deepest = 1.0f;
+    for (int i = 0; i < count; i++) {
+        if (order[i]->ducks && order[i]->duck_gain < deepest) deepest = order[i]->duck_gain;
+    }
+    atomic_store_explicit(&bus->duck_depth, deepest, memory_order_relaxed);
+
+}
+
+static void on_bus_process(void *userdata) {
+    bus_t *bus = userdata;
+    thread_policy_register_data_thread();
+
+    atomic_store(&bus->in_process, true);
+    const uint64_t begin_ns = track_manager_now_ns();
+
+    struct pw_buffer *b = pw_stream_dequeue_buffer(bus->stream);
+    if (!b) {
+        log_error("Bus %s: out of buffers", bus->config->id);
+        goto done;
+    }
+
+    struct spa_buffer *buf = b->buffer;
+    float *dst = buf->datas[0].data;
+    if (!dst) goto done;
+
+    const int channels = bus->channels;
+    const uint32_t rate = (uint32_t) bus->config->samplerate;
+    size_t n_frames = buf->datas[0].maxsize / sizeof(float) / channels;
+    if (b->requested > 0 && b->requested < n_frames) {
+        n_frames = b->requested;
+    }
+
+    struct pw_time time;
+    uint64_t cycle_ns;
+    const bool have_time = pw_stream_get_time_n(bus->stream, &time, sizeof(time)) == 0 && time.now > 0;
+    if (have_time) {
+        cycle_ns = (uint64_t) time.now;
+    } else {
+        cycle_ns = begin_ns;
+    }
+
+    if (bus->drift) {
+        drift_process(bus->drift, have_time ? &time : NULL, mix_members, bus, dst, n_frames, cycle_ns);
+    } else {
+        mix_members(bus, dst, n_frames, cycle_ns);
+    }
+
+    // Group gain reaches its target by the end of this quantum
+    const float target = atomic_load(&bus->muted) ? 0.0f : atomic_load(&bus->gain_target);
+    if (bus->gain != target) {
+        const float step = (target - bus->gain) / (float) n_frames;
+        for (size_t f = 0; f < n_frames; f++) {
+            bus->gain += step;
+            for (int ch = 0; ch < channels; ch++) {
+                dst[f * channels + ch] *= bus->gain;
+            }
+        }
+        bus->gain = target;
+    } else if (target != 1.0f) {
+        for (size_t i = 0; i < n_frames * channels; i++) {
+            dst[i] *= target;
+        }
+    }
+
+    output_stage_process(bus->output_stage, dst, n_frames);
+    meter_process(&bus->meter, dst, n_frames, channels);
+
+    buf->datas[0].chunk->offset = 0;
+    buf->datas[0].chunk->stride = channels * sizeof(float);
+    buf->datas[0].chunk->size = n_frames * channels * sizeof(float);
+    pw_stream_queue_buffer(bus->stream, b);
+
+    atomic_store_explicit(&bus->quantum_ns, n_frames * 1000000000ULL / rate, memory_order_relaxed);
+
+    done:;
+    const uint64_t cost = track_manager_now_ns() - begin_ns;
+    atomic_store_explicit(&bus->cost_last_ns, cost, memory_order_relaxed);
+    atomic_fetch_add_explicit(&bus->cost_total_ns, cost, memory_order_relaxed);
+    if (cost > atomic_load_explicit(&bus->cost_peak_ns, memory_order_relaxed)) {
+        atomic_store_explicit(&bus->cost_peak_ns, cost, memory_order_relaxed);
+    }
+    atomic_fetch_add(&bus->cycles, 1);
+    atomic_store(&bus->in_process, false);
+}
+
+static void on_bus_state_changed(void *userdata, enum pw_stream_state old, enum pw_stream_state state,
+                                 const char *error) {
+    bus_t *bus = userdata;
+
+    switch (state) {
+        case PW_STREAM_STATE_ERROR:
+            bus->connected = false;
+            log_error("Bus %s stream error: %s", bus->config->id, error ? error : "Unknown error");
+            break;
+        case PW_STREAM_STATE_STREAMING:
+            if (old != PW_STREAM_STATE_STREAMING) {
+                bus->connected = true;
+                if (bus->reconnect.waiting) {
+                    const uint64_t outage_ns = reconnect_done(&bus->reconnect, track_manager_now_ns());
+                    log_info("Bus %s reconnected after %.0f ms (%u attempts)", bus->config->id, outage_ns / 1e6,
+                             bus->reconnect.attempts);
+                } else {
+                    log_info("Bus started: %s", bus->config->id);
+                }
+            }
+            break;
+        case PW_STREAM_STATE_UNCONNECTED:
+            if (bus->connected) {
+                log_warn("Bus disconnected: %s", bus->config->id);
+                if (bus->global->reconnect.enabled) {
+                    reconnect_lost(&bus->reconnect, track_manager_now_ns(),
+                                   (uint32_t) bus->global->reconnect.initial_backoff_ms);
+                }
+            }
+            bus->connected = false;
+            break;
+        default:
+            break;
+    }
+}
+
+static const struct pw_stream_events bus_stream_events = {
+        PW_VERSION_STREAM_EVENTS,
+        .process = on_bus_process,
+        .state_changed = on_bus_state_changed,
+};
+
+static bool connect_stream(bus_t *bus, struct pw_loop *loop, const registry_t *registry) {
+    const output_config_t *output = &bus->config->output;
+
+    char channel_names[1024] = "";
+    size_t used = 0;
+    for (int i = 0; i < bus->channels; i++) {
+        const int written = snprintf(channel_names + used, sizeof(channel_names) - used, "%s%s",
+                                     i > 0 ? "," : "", bus->names[i]);
+        if (written < 0 || (size_t) written >= sizeof(channel_names) - used) {
+            log_error("Bus %s: channel names string too long", bus->config->id);
+            return false;
+        }
+        used += written;
+    }
+
+    struct pw_properties *props = pw_properties_new(
+            PW_KEY_MEDIA_TYPE, "Audio",
+            PW_KEY_MEDIA_CATEGORY, "Playback",
+            PW_KEY_MEDIA_ROLE, "Music",
+            PW_KEY_NODE_NAME, bus->config->id,
+            PW_KEY_NODE_DESCRIPTION, bus->config->id,
+            NULL
+    );
+    if (!props) {
+        log_error("Failed to create bus stream properties");
+        return false;
+    }
+
+    char target[128];
+    if (registry_target(registry, output->device, target, sizeof(target))) {
+        pw_properties_set(props, PW_KEY_TARGET_OBJECT, target);
+        // Wait for this device to come back rather than being moved to another one
+        if (bus->global->reconnect.enabled) {
+            pw_properties_set(props, PW_KEY_NODE_DONT_RECONNECT, "true");
+        }
+    }
+    pw_properties_set(props, PW_KEY_NODE_CHANNELNAMES, channel_names);
+    pw_properties_setf(props, PW_KEY_AUDIO_CHANNELS, "%d", bus->channels);
+
+    // Takes ownership of props
+    bus->stream = pw_stream_new_simple(loop, bus->config->id, props, &bus_stream_events, bus);
+    if (!bus->stream) {
+        log_error("Failed to create stream for bus %s", bus->config->id);
+        return false;
+    }
+
+    uint8_t buffer[1024];
+    struct spa_pod_builder b;
+    spa_pod_builder_init(&b, buffer, sizeof(buffer));
+
+    struct spa_audio_info_raw audio_info = {
+            .format = SPA_AUDIO_FORMAT_F32,
+            .channels = bus->channels,
+            .rate = bus->config->samplerate
+    };
+    for (int i = 0; i < bus->channels; i++) {
+        audio_info.position[i] = get_channel_position(bus->names[i]);
+        if (audio_info.position[i] == SPA_AUDIO_CHANNEL_UNKNOWN) {
+            log_warn("Unknown channel name '%s' on bus %s, using UNKNOWN", bus->names[i], bus->config->id);
+        }
+    }
+
+    const struct spa_pod *params[1];
+    params[0] = spa_format_audio_raw_build(&b, SPA_PARAM_EnumFormat, &audio_info);
+
+    if (pw_stream_connect(
+            bus->stream,
+            PW_DIRECTION_OUTPUT,
+            PW_ID_ANY,
+            PW_STREAM_FLAG_AUTOCONNECT | PW_STREAM_FLAG_MAP_BUFFERS | PW_STREAM_FLAG_RT_PROCESS,
+            params,
+            1
+    ) < 0) {
+        log_error("Failed to connect stream for bus %s", bus->config->id);
+        pw_stream_destroy(bus->stream);
+        bus->stream = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+bus_t *bus_create(struct pw_loop *loop, const registry_t *registry, const global_config_t *global,
+                  const bus_config_t *config, bus_render_fn render) {
+    if (!loop || !config || !config->id || !render) return NULL;
+
+    if (config->samplerate <= 0) {
+        log_error("Bus %s: invalid sample rate %d", config->id, config->samplerate);
+        return NULL;
+    }
+
+    // Touched on every quantum, so keep it in the locked arena
+    bus_t *bus = arena_calloc(1, sizeof(bus_t));
+    if (!bus) {
+        log_error("Failed to allocate bus %s", config->id);
+        return NULL;
+    }
+
+    bus->config = config;
+    bus->global = global;
+    bus->render = render;
+    bus->gain = config->mute ? 0.0f : config->gain;
+    atomic_init(&bus->gain_target, config->gain);
+    atomic_init(&bus->muted, config->mute);
+    atomic_init(&bus->duck_depth, 1.0f);
+
+    static const char *default_names[] = {"FL", "FR"};
+    if (config->output.mapping_count > 0) {
+        bus->channels = config->output.mapping_count < (int) SPA_AUDIO_MAX_CHANNELS
+                        ? config->output.mapping_count : (int) SPA_AUDIO_MAX_CHANNELS;
+        for (int i = 0; i < bus->channels; i++) {
+            bus->names[i] = config->output.mapping[i];
+        }
+    } else {
+        bus->channels = 2;
+        bus->names[0] = default_names[0];
+        bus->names[1] = default_names[1];
+    }
+
+    meter_init(&bus->meter, bus->channels, config->samplerate);
+    bus->panner = panner_create(&config->panner, bus->names, bus->channels);
+    bus->output_stage = output_stage_create(global, config->output.device, bus->names, bus->channels,
+                                            config->samplerate);
+    bus->drift = drift_create(global, bus->channels, config->samplerate);
+
+    bus->scratch = arena_calloc(BUS_CHUNK_FRAMES * BUS_MAX_TRACK_CHANNELS, sizeof(float));
+    bus->duck_key = arena_calloc(BUS_CHUNK_FRAMES, sizeof(float));
+    bus->group_key = arena_calloc(BUS_CHUNK_FRAMES, sizeof(float));
+    if (!bus->scratch || !bus->duck_key || !bus->group_key || !connect_stream(bus, loop, registry)) {
+        arena_free(bus->scratch);
+        arena_free(bus->duck_key);
+        arena_free(bus->group_key);
+        panner_destroy(bus->panner);
+        output_stage_destroy(bus->output_stage);
+        drift_destroy(bus->drift);
+        arena_free(bus);
+        return NULL;
+    }
+
+    log_info("Bus %s: %d channels at %d Hz, gain %.2f%s", config->id, bus->channels, config->samplerate,
+             config->gain, config->mute ? ", muted" : "");
+    return bus;
+}
+
+const char *bus_get_id(const bus_t *bus) {
+    return bus ? bus->config->id : NULL;
+}
+
+const char *bus_get_device(const bus_t *bus) {
+    return bus ? bus->config->output.device : NULL;
+}
+
+struct output_stage *bus_get_output_stage(bus_t *bus) {
+    return bus ? bus->output_stage : NULL;
+}
+
+struct drift *bus_get_drift(bus_t *bus) {
+    return bus ? bus->drift : NULL;
+}
+
+bool bus_attach(bus_t *bus, track_instance_t *track) {
+    if (!bus || !track || !track->audio_file) return false;
+
+    const SF_INFO *info = &track->audio_file->info;
+    if (info->samplerate != bus->config->samplerate) {
+        log_error("Track %s is %d Hz but bus %s runs at %d Hz", track->config->id, info->samplerate,
+                  bus->config->id, bus->config->samplerate);
+        return false;
+    }
+    if (info->channels > BUS_MAX_TRACK_CHANNELS) {
+        log_error("Track %s has %d channels, buses accept at most %d", track->config->id, info->channels,
+                  BUS_MAX_TRACK_CHANNELS);
+        return false;
+    }
+
+    bus_slot_t *slot = NULL;
+    for (int i = 0; i < BUS_MAX_TRACKS && !slot; i++) {
+        if (!atomic_load(&bus->slots[i].track)) slot = &bus->slots[i];
+    }
+    if (!slot) {
+        log_error("Bus %s is full", bus->config->id);
+        return false;
+    }
+
+    // Mapped channels go to the bus channel of the same name; unmapped mono feeds every channel
+    const output_config_t *mapping = &track->config->output;
+    slot->channels = info->channels;
+    for (int ch = 0; ch < info->channels; ch++) {
+        slot->route[ch] = 0;
+        if (mapping->mapping_count > 0) {
+            for (int i = 0; ch < mapping->mapping_count && i < bus->channels; i++) {
+                if (strcmp(mapping->mapping[ch], bus->names[i]) == 0) slot->route[ch] |= 1ULL << i;
+            }
+            if (!slot->route[ch]) {
+                log_warn("Track %s: channel %d has no match on bus %s and is dropped", track->config->id, ch,
+                         bus->config->id);
+            }
+        } else if (info->channels == 1) {
+            slot->route[ch] = bus->channels < 64 ? (1ULL << bus->channels) - 1 : ~0ULL;
+        } else if (ch < bus->channels) {
+            slot->route[ch] = 1ULL << ch;
+        }
+    }
+
+    // Sidechain settings; the rule on a high-priority track ducks everything below it on this bus
+    const duck_config_t *duck = &track->config->ducking;
+    const float rate = (float) bus->config->samplerate;
+    slot->priority = track->config->priority;
+    slot->ducks = duck->amount_db < 0.0f;
+    slot->duck_floor = powf(10.0f, duck->amount_db / 20.0f);
+    slot->duck_threshold = powf(10.0f, duck->threshold_db / 20.0f);
+    slot->attack_coef = duck->attack_ms > 0.0f ? expf(-1000.0f / (duck->attack_ms * rate)) : 0.0f;
+    slot->release_coef = duck->release_ms > 0.0f ? expf(-1000.0f / (duck->release_ms * rate)) : 0.0f;
+    slot->detector_coef = expf(-1000.0f / (DUCK_DETECTOR_RELEASE_MS * rate));
+    slot->envelope = 0.0f;
+    slot->duck_gain = 1.0f;
+
+    // Spatial sources start at their configured position without a fade in from silence
+    slot->spatial = false;
+    if (track->config->spatial && !bus->panner) {
+        log_warn("Track %s has a position but bus %s has no panner, routing by mapping", track->config->id,
+                 bus->config->id);
+    } else if (track->config->spatial && info->channels > 2) {
+        log_warn("Track %s: only mono and stereo sources can be panned, routing by mapping", track->config->id);
+    } else if (track->config->spatial) {
+        slot->spatial = true;
+        slot->spread = track->config->spread * (float) M_PI / 360.0f;
+        slot->x = track->config->position_x;
+        slot->y = track->config->position_y;
+        slot->glide_frames = 0;
+        slot->move_pending = false;
+        slot->move_seen = atomic_load(&slot->move_sequence);
+        source_gains(bus, slot, slot->pan_gain);
+    }
+
+    atomic_store_explicit(&slot->track, track, memory_order_release);
+    bus->track_count++;
+    return true;
+}
+
+bool bus_set_position(bus_t *bus, track_instance_t *track, float x, float y, double seconds, uint64_t at_ns) {
+    if (!bus || !track) return false;
+
+    for (int i = 0; i < BUS_MAX_TRACKS; i++) {
+        bus_slot_t *slot = &bus->slots[i];
+        if (atomic_load(&slot->track) != track) continue;
+        if (!slot->spatial) return false;
+
+        const double frames = seconds > 0.0 ? seconds * bus->config->samplerate : 0.0;
+        const uint32_t sequence = atomic_load_explicit(&slot->move_sequence, memory_order_relaxed);
+        atomic_store_explicit(&slot->move_sequence, sequence + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        atomic_store_explicit(&slot->move_x, x, memory_order_relaxed);
+        atomic_store_explicit(&slot->move_y, y, memory_order_relaxed);
+        atomic_store_explicit(&slot->move_frames, frames < UINT32_MAX ? (uint32_t) frames : UINT32_MAX,
+                              memory_order_relaxed);
+        atomic_store_explicit(&slot->move_at_ns, at_ns, memory_order_relaxed);
+        atomic_store_explicit(&slot->move_sequence, sequence + 2, memory_order_release);
+        return true;
+    }
+    return false;
+}
+
+void bus_detach(bus_t *bus, track_instance_t *track) {
+    if (!bus || !track) return;
+
+    for (int i = 0; i < BUS_MAX_TRACKS; i++) {
+        if (atomic_load(&bus->slots[i].track) != track) continue;
+
+        atomic_store(&bus->slots[i].track, NULL);
+        bus->track_count--;
+
+        // A cycle already running may still hold the pointer; wait for it to finish
+        const uint64_t cycle = atomic_load(&bus->cycles);
+        while (atomic_load(&bus->in_process) && atomic_load(&bus->cycles) == cycle) {
+            usleep(100);
+        }
+        return;
+    }
+}
+
+void bus_set_gain(bus_t *bus, float gain) {
+    if (!bus) return;
+    atomic_store(&bus->gain_target, gain < 0.0f ? 0.0f : gain);
+}
+
+void bus_set_mute(bus_t *bus, bool mute) {
+    if (!bus) return;
+    atomic_store(&bus->muted, mute);
+}
+
+void bus_device_changed(bus_t *bus, const char *device, bool added, uint64_t now_ns) {
+    if (!bus || !device || !bus->config->output.device || strcmp(bus->config->output.device, device) != 0) return;
+    if (!bus->global->reconnect.enabled) return;
+
+    if (added) {
+        reconnect_device_added(&bus->reconnect, now_ns);
+    } else {
+        if (!bus->reconnect.waiting) {
+            log_warn("Bus %s lost its output %s", bus->config->id, device);
+        }
+        bus->connected = false;
+        reconnect_lost(&bus->reconnect, now_ns, (uint32_t) bus->global->reconnect.initial_backoff_ms);
+    }
+}
+
+bool bus_reconnect(bus_t *bus, struct pw_loop *loop, const registry_t *registry, uint64_t now_ns,
+                   uint64_t *skipped_ns) {
+    if (!bus || !registry_available(registry, bus->config->output.device)) return false;
+    if (!reconnect_due(&bus->reconnect, now_ns, (uint32_t) bus->global->reconnect.max_backoff_ms)) return false;
+
+    log_info("Bus %s: reconnecting to %s (attempt %u)", bus->config->id,
+             bus->config->output.device ? bus->config->output.device : "default", bus->reconnect.attempts);
+    if (skipped_ns) {
+        *skipped_ns = reconnect_take_skipped(&bus->reconnect, now_ns);
+    }
+
+    // A fresh stream resolves the target again, the node has a new serial after a replug
+    if (bus->stream) {
+        pw_stream_destroy(bus->stream);
+        bus->stream = NULL;
+    }
+    return connect_stream(bus, loop, registry);
+}
+
+int bus_format_status(bus_t *bus, char *buffer, size_t size) {
+    if (!bus) return 0;
+
+    const uint64_t cycles = atomic_load(&bus->cycles);
+    const double avg_us = cycles ? atomic_load(&bus->cost_total_ns) / (double) cycles / 1000.0 : 0.0;
+    const double peak_us = atomic_load(&bus->cost_peak_ns) / 1000.0;
+    const uint64_t quantum_ns = atomic_load(&bus->quantum_ns);
+    const double load = quantum_ns ? avg_us * 1000.0 * 100.0 / quantum_ns : 0.0;
+
+    char ducking[32] = "";
+    const float depth = atomic_load(&bus->duck_depth);
+    if (depth < 0.999f) {
+        snprintf(ducking, sizeof(ducking), ", ducking %.1f dB", 20.0f * log10f(depth > 1e-6f ? depth : 1e-6f));
+    }
+
+    char panner[48] = "";
+    if (bus->panner) {
+        panner_format_status(bus->panner, panner, sizeof(panner));
+    }
+
+    char stage[512] = "";
+    if (bus->output_stage) {
+        output_stage_format_status(bus->output_stage, stage, sizeof(stage));
+    }
+
+    char clock[128] = "";
+    if (bus->drift) {
+        drift_format_status(bus->drift, clock, sizeof(clock));
+    }
+
+    char reconnect[96] = "";
+    if (bus->reconnect.waiting || bus->reconnect.reconnects > 0) {
+        reconnect_format_status(&bus->reconnect, track_manager_now_ns(), reconnect, sizeof(reconnect));
+    }
+
+    return snprintf(buffer, size, "Bus %s: gain %.2f%s%s, %d tracks, %s, cpu %.1f us avg / %.1f us peak (%.2f%% of quantum)%s%s%s%s%s%s%s%s\n",
+                    bus->config->id, atomic_load(&bus->gain_target), atomic_load(&bus->muted) ? " (muted)" : "",
+                    ducking, bus->track_count, bus->connected ? "connected" : "not connected", avg_us, peak_us, load,
+                    panner[0] ? ", " : "", panner, stage[0] ? ", " : "", stage, clock[0] ? ", clock " : "", clock,
+                    reconnect[0] ? ", " : "", reconnect);
+}
+
+int bus_format_meters(bus_t *bus, char *buffer, size_t size) {
+    if (!bus) return 0;
+
+    int written = snprintf(buffer, size, "bus %s", bus->config->id);
+    written += meter_format(&bus->meter, bus->names, buffer + written, size > (size_t) written ? size - written : 0);
+    written += snprintf(buffer + written, size > (size_t) written ? size - written : 0, "\n");
+    return written;
+}
+
+void bus_destroy(bus_t *bus) {
+    if (!bus) return;
+
+    if (bus->track_count > 0) {
+        log_warn("Destroying bus %s with %d tracks attached", bus->config->id, bus->track_count);
+    }
+    if (bus->stream) {
+        pw_stream_destroy(bus->stream);
+    }
+    arena_free(bus->scratch);
+    arena_free(bus->duck_key);
+    arena_free(bus->group_key);
+    panner_destroy(bus->panner);
+    output_stage_destroy(bus->output_stage);
+    drift_destroy(bus->drift);
+    arena_free(bus);
+}
@@ -0,0 +1,62 @@
+#ifndef ASYNC_AUDIO_PLAYER_BUS_H
+#define ASYNC_AUDIO_PLAYER_BUS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "types.h"
+#include "registry.h"
+
+// Submix stage: one PipeWire stream that mixes all member tracks and applies the group gain
+typedef struct bus bus_t;
+
+// Renders one block of a member track into an interleaved buffer of its own channel count
+typedef void (*bus_render_fn)(track_instance_t *track, float *dst, size_t n_frames, uint64_t cycle_ns);
+
+// Create the bus stream and connect it to its output, resolved through the registry cache (may be NULL)
+bus_t *bus_create(struct pw_loop *loop, const registry_t *registry, const global_config_t *global,
+                  const bus_config_t *config, bus_render_fn render);
+
+const char *bus_get_id(const bus_t *bus);
+
+// Configured output device, NULL for the default
+const char *bus_get_device(const bus_t *bus);
+
+// Device processing of the bus stream, NULL when none is configured
+struct output_stage *bus_get_output_stage(bus_t *bus);
+
+// Clock-drift resampler of the bus stream, NULL when compensation is off
+struct drift *bus_get_drift(bus_t *bus);
+
+// Route a track into the mix; it is picked up on the next quantum
+bool bus_attach(bus_t *bus, track_instance_t *track);
+
+// Move a spatial member to (x, y) over seconds, starting at at_ns on the CLOCK_MONOTONIC timeline
+// (0 = next block); false if the track is not a spatial member of the bus
+bool bus_set_position(bus_t *bus, track_instance_t *track, float x, float y, double seconds, uint64_t at_ns);
+
+// Remove a track from the mix; returns once the data thread no longer references it
+void bus_detach(bus_t *bus, track_instance_t *track);
+
+// Group controls, applied as a ramp across the next quantum
+void bus_set_gain(bus_t *bus, float gain);
+void bus_set_mute(bus_t *bus, bool mute);
+
+// The registry saw device appear or go away; a bus playing to it waits for it to return (main loop)
+void bus_device_changed(bus_t *bus, const char *device, bool added, uint64_t now_ns);
+
+// Replace the stream of a bus that lost its device once the device is back and the backoff allows.
+// True when a new stream was connected; skipped_ns receives the outage time since the previous attempt.
+bool bus_reconnect(bus_t *bus, struct pw_loop *loop, const registry_t *registry, uint64_t now_ns,
+                   uint64_t *skipped_ns);
+
+// Format gain, membership and CPU cost of the bus
+int bus_format_status(bus_t *bus, char *buffer, size_t size);
+
+// Format output levels as a "bus <id> NAME=peak/rms/clips ..." line
+int bus_format_meters(bus_t *bus, char *buffer, size_t size);
+
+// Disconnect the stream; all tracks must be detached
+void bus_destroy(bus_t *bus);
+
+#endif // ASYNC_AUDIO_PLAYER_BUS_H
@@ -0,0 +1,574 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "clock_sync.h"
+#include "track_manager.h"
+#include "thread_policy.h"
+#include "log.h"
+
+#define SYNC_MAGIC "PAPA1"
+#define SYNC_DEFAULT_PORT 9870
+#define SYNC_DEFAULT_INTERVAL_MS 250
+#define SYNC_STARTUP_INTERVAL_MS 50     // Faster exchanges until the first samples are in
+#define SYNC_STARTUP_SAMPLES 8
+#define SYNC_POLL_MS 20
+#define SYNC_MAX_PEERS 32
+#define SYNC_PEER_TIMEOUT_NS 5000000000ull
+#define SYNC_MAX_CUES 8                 // Cue messages waiting for acknowledgements
+#define SYNC_RESEND_NS 50000000ull
+#define SYNC_RESEND_TRIES 5
+#define SYNC_WINDOW 16                  // Exchanges the minimum round trip is taken over
+#define SYNC_GATE_NS 100000.0           // Slack over 1.5x the minimum round trip before a sample is dropped
+#define SYNC_ALPHA 0.2                  // Offset filter gain
+#define SYNC_BETA 0.02                  // Rate filter gain
+#define SYNC_MAX_SKEW 500e-6
+#define SYNC_NAME_MAX 64
+
+// A follower as seen by the leader
+typedef struct {
+    struct sockaddr_in addr;
+    char name[SYNC_NAME_MAX];
+    uint64_t last_seen_ns;
+    uint64_t rtt_ns;            // Best round trip the follower reported
+    bool measured;              // The follower is synced and error_ns holds a measurement
+    int64_t error_ns;           // Follower's estimate of the leader clock minus the leader clock
+    double mean_error_ns;       // Average magnitude of error_ns
+    uint32_t acked_seq;
+} sync_peer_t;
+
+// Cue message being resent until every follower acknowledges it
+typedef struct {
+    uint32_t seq;
+    char cue_id[SYNC_NAME_MAX];
+    uint64_t base_ns;
+    uint64_t sent_ns;
+    int tries;
+} sync_cue_t;
+
+struct clock_sync {
+    const global_config_t *config;
+    show_ctx_t *show;
+    sync_role_t role;
+    int fd;
+    pthread_t thread;
+    _Atomic bool running;
+    pthread_mutex_t lock;       // Guards everything below against status and the fire hook
+    char name[SYNC_NAME_MAX];
+    uint64_t interval_ns;
+
+    // Leader
+    uint64_t epoch;             // Start time, tells followers the leader restarted
+    sync_peer_t peers[SYNC_MAX_PEERS];
+    int peer_count;
+    sync_cue_t cues[SYNC_MAX_CUES];
+    int cue_count;
+    uint32_t next_seq;
+
+    // Follower
+    struct sockaddr_in leader;
+    uint32_t request_seq;
+    uint32_t answered_seq;      // Last request whose response was used, duplicates are dropped
+    uint64_t next_request_ns;
+    uint64_t delays[SYNC_WINDOW];
+    int delay_count;
+    int samples;                // Accepted exchanges
+    uint32_t rejected;
+    int64_t offset_base_ns;     // Leader clock minus local clock of the first sample
+    double offset_ns;           // Filtered offset on top of offset_base_ns at offset_at_ns
+    double skew;                // Change of the offset per nanosecond
+    uint64_t offset_at_ns;
+    uint64_t min_rtt_ns;
+    double jitter_ns;           // Average magnitude of the filter residual
+    uint64_t leader_epoch;
+    uint32_t last_cue_seq;
+    uint32_t cues_received;
+    char last_cue[SYNC_NAME_MAX];
+    double last_cue_late_ms;
+};
+
+static void send_message(const clock_sync_t *sync, const struct sockaddr_in *addr, const char *message) {
+    if (sendto(sync->fd, message, strlen(message), MSG_DONTWAIT, (const struct sockaddr *) addr, sizeof(*addr)) < 0 &&
+        errno != EAGAIN) {
+        log_debug("Sync: send failed: %s", strerror(errno));
+    }
+}
+
+static bool resolve_leader(const char *spec, int default_port, struct sockaddr_in *addr) {
+    char host[256];
+    snprintf(host, sizeof(host), "%s", spec);
+    int port = default_port;
+    char *colon = strrchr(host, ':');
+    if (colon) {
+        *colon = '\0';
+        port = atoi(colon + 1);
+    }
+
+    struct addrinfo hints = {.ai_family = AF_INET, .ai_socktype = SOCK_DGRAM};
+    struct addrinfo *result = NULL;
+    const int rc = getaddrinfo(host, NULL, &hints, &result);
+    if (rc != 0 || !result) {
+        log_error("Sync: cannot resolve leader %s: %s", host, gai_strerror(rc));
+        return false;
+    }
+    memcpy(addr, result->ai_addr, sizeof(*addr));
+    addr->sin_port = htons((uint16_t) port);
+    freeaddrinfo(result);
+    return true;
+}
+
+// Leader clock estimate at local time now_ns (lock held)
+static uint64_t leader_time(const clock_sync_t *sync, const uint64_t now_ns) {
+    const double delta = sync->offset_ns + sync->skew * (double) (int64_t) (now_ns - sync->offset_at_ns);
+    return (uint64_t) ((int64_t) now_ns + sync->offset_base_ns + (int64_t) llround(delta));
+}
+
+// --- Leader ---
+
+static sync_peer_t *find_peer(clock_sync_t *sync, const struct sockaddr_in *addr, const uint64_t now_ns) {
+    for (int i = 0; i < sync->peer_count; i++) {
+        sync_peer_t *peer = &sync->peers[i];
+        if (peer->addr.sin_addr.s_addr == addr->sin_addr.s_addr && peer->addr.sin_port == addr->sin_port) {
+            return peer;
+        }
+    }
+
+    // Reuse the slot of a follower that went quiet
+    sync_peer_t *peer = NULL;
+    for (int i = 0; i < sync->peer_count && !peer; i++) {
+        if (now_ns - sync->peers[i].last_seen_ns > SYNC_PEER_TIMEOUT_NS) {
+            peer = &sync->peers[i];
+        }
+    }
+    if (!peer && sync->peer_count < SYNC_MAX_PEERS) {
+        peer = &sync->peers[sync->peer_count++];
+    }
+    if (!peer) {
+        return NULL;
+    }
+
+    memset(peer, 0, sizeof(*peer));
+    peer->addr = *addr;
+    peer->acked_seq = sync->next_seq;   // Cues fired before it joined are not resent
+    return peer;
+}
+
+static void handle_request(clock_sync_t *sync, const char *message, const struct sockaddr_in *from,
+                           const uint64_t t2) {
+    uint32_t seq;
+    char name[SYNC_NAME_MAX];
+    uint64_t t1, estimate, rtt;
+    if (sscanf(message, SYNC_MAGIC " REQ %" SCNu32 " %63s %" SCNu64 " %" SCNu64 " %" SCNu64,
+               &seq, name, &t1, &estimate, &rtt) != 5) {
+        return;
+    }
+
+    pthread_mutex_lock(&sync->lock);
+    sync_peer_t *peer = find_peer(sync, from, t2);
+    if (peer) {
+        if (peer->last_seen_ns == 0 || t2 - peer->last_seen_ns > SYNC_PEER_TIMEOUT_NS) {
+            log_info("Sync: follower %s joined from %s:%d", name, inet_ntoa(from->sin_addr), ntohs(from->sin_port));
+        }
+        snprintf(peer->name, sizeof(peer->name), "%s", name);
+        peer->last_seen_ns = t2;
+        peer->rtt_ns = rtt;
+
+        // The follower's idea of our clock when it sent, carried over half its best round trip
+        peer->measured = estimate != 0;
+        if (peer->measured) {
+            peer->error_ns = (int64_t) (estimate + rtt / 2 - t2);
+            const double magnitude = fabs((double) peer->error_ns);
+            peer->mean_error_ns = peer->mean_error_ns > 0.0 ? peer->mean_error_ns + 0.1 * (magnitude - peer->mean_error_ns)
+                                                            : magnitude;
+        }
+    }
+    pthread_mutex_unlock(&sync->lock);
+
+    char reply[160];
+    snprintf(reply, sizeof(reply), SYNC_MAGIC " RSP %" PRIu32 " %" PRIu64 " %" PRIu64 " %" PRIu64,
+             seq, t1, t2, track_manager_now_ns());
+    send_message(sync, from, reply);
+}
+
+static void handle_ack(clock_sync_t *sync, const char *message, const struct sockaddr_in *from) {
+    uint64_t epoch;
+    uint32_t seq;
+    if (sscanf(message, SYNC_MAGIC " ACK %" SCNu64 " %" SCNu32, &epoch, &seq) != 2 || epoch != sync->epoch) {
+        return;
+    }
+
+    pthread_mutex_lock(&sync->lock);
+    for (int i = 0; i < sync->peer_count; i++) {
+        sync_peer_t *peer = &sync->peers[i];
+        if (peer->addr.sin_addr.s_addr == from->sin_addr.s_addr && peer->addr.sin_port == from->sin_port &&
+            seq > peer->acked_seq) {
+            peer->acked_seq = seq;
+        }
+    }
+    pthread_mutex_unlock(&sync->lock);
+}
+
+// Send cues to the followers that have not acknowledged them (lock held)
+static void send_cues(clock_sync_t *sync, const uint64_t now_ns) {
+    for (int c = 0; c < sync->cue_count;) {
+        sync_cue_t *cue = &sync->cues[c];
+        if (cue->tries > 0 && now_ns - cue->sent_ns < SYNC_RESEND_NS) {
+            c++;
+            continue;
+        }
+
+        char message[160];
+        snprintf(message, sizeof(message), SYNC_MAGIC " CUE %" PRIu64 " %" PRIu32 " %" PRIu64 " %s",
+                 sync->epoch, cue->seq, cue->base_ns, cue->cue_id);
+        int waiting = 0;
+        for (int i = 0; i < sync->peer_count; i++) {
+            const sync_peer_t *peer = &sync->peers[i];
+            if (peer->acked_seq < cue->seq && now_ns - peer->last_seen_ns <= SYNC_PEER_TIMEOUT_NS) {
+                send_message(sync, &peer->addr, message);
+                waiting++;
+            }
+        }
+        cue->sent_ns = now_ns;
+        cue->tries++;
+
+        if (waiting == 0 || cue->tries >= SYNC_RESEND_TRIES) {
+            if (waiting > 0) {
+                log_warn("Sync: %d followers did not acknowledge cue %s", waiting, cue->cue_id);
+            }
+            memmove(&sync->cues[c], &sync->cues[c + 1], (sync->cue_count - c - 1) * sizeof(sync_cue_t));
+            sync->cue_count--;
+        } else {
+            c++;
+        }
+    }
+}
+
+// Show hook on the leader, runs with the track manager lock held
+static void on_cue_fired(void *data, const char *cue_id, const uint64_t base_ns) {
+    clock_sync_t *sync = data;
+
+    pthread_mutex_lock(&sync->lock);
+    if (sync->cue_count == SYNC_MAX_CUES) {
+        memmove(&sync->cues[0], &sync->cues[1], (SYNC_MAX_CUES - 1) * sizeof(sync_cue_t));
+        sync->cue_count--;
+    }
+    sync_cue_t *cue = &sync->cues[sync->cue_count++];
+    memset(cue, 0, sizeof(*cue));
+    cue->seq = ++sync->next_seq;
+    snprintf(cue->cue_id, sizeof(cue->cue_id), "%s", cue_id);
+    cue->base_ns = base_ns;
+    send_cues(sync, track_manager_now_ns());
+    pthread_mutex_unlock(&sync->lock);
+}
+
+// --- Follower ---
+
+static void send_request(clock_sync_t *sync, const uint64_t now_ns) {
+    pthread_mutex_lock(&sync->lock);
+    const uint64_t t1 = track_manager_now_ns();
+    const bool synced = sync->samples >= SYNC_STARTUP_SAMPLES;
+    const uint64_t estimate = synced ? leader_time(sync, t1) : 0;
+    const uint64_t interval = sync->samples < SYNC_STARTUP_SAMPLES ? SYNC_STARTUP_INTERVAL_MS * 1000000ull
+                                                                   : sync->interval_ns;
+    sync->next_request_ns = now_ns + interval;
+    const uint32_t seq = ++sync->request_seq;
+    const uint64_t rtt = sync->min_rtt_ns;
+    pthread_mutex_unlock(&sync->lock);
+
+    char message[200];
+    snprintf(message, sizeof(message), SYNC_MAGIC " REQ %" PRIu32 " %s %" PRIu64 " %" PRIu64 " %" PRIu64,
+             seq, sync->name, t1, estimate, rtt);
+    send_message(sync, &sync->leader, message);
+}
+
+static void handle_response(clock_sync_t *sync, const char *message, const uint64_t t4) {
+    uint32_t seq;
+    uint64_t t1, t2, t3;
+    if (sscanf(message, SYNC_MAGIC " RSP %" SCNu32 " %" SCNu64 " %" SCNu64 " %" SCNu64, &seq, &t1, &t2, &t3) != 4 ||
+        t4 < t1 || t3 < t2) {
+        return;
+    }
+    const uint64_t turnaround = t3 - t2;
+    const uint64_t delay = t4 - t1 > turnaround ? (t4 - t1) - turnaround : 0;
+    const int64_t sample = ((int64_t) (t2 - t1) + (int64_t) (t3 - t4)) / 2;
+
+    pthread_mutex_lock(&sync->lock);
+    // Only the outstanding request: a late or repeated response pairs t4 with the wrong exchange
+    if (seq != sync->request_seq || seq == sync->answered_seq) {
+        sync->rejected++;
+        pthread_mutex_unlock(&sync->lock);
+        return;
+    }
+    sync->answered_seq = seq;
+    sync->delays[sync->delay_count++ % SYNC_WINDOW] = delay;
+    uint64_t min_delay = UINT64_MAX;
+    for (int i = 0; i < SYNC_WINDOW && i < sync->delay_count; i++) {
+        if (sync->delays[i] < min_delay) min_delay = sync->delays[i];
+    }
+    sync->min_rtt_ns = min_delay;
+
+    if (sync->samples == 0) {
+        sync->offset_base_ns = sample;
+        sync->offset_ns = 0.0;
+        sync->skew = 0.0;
+        sync->offset_at_ns = t4;
+        sync->samples = 1;
+        log_info("Sync: first exchange with the leader, round trip %.3f ms", delay / 1e6);
+    } else if ((double) delay > 1.5 * (double) min_delay + SYNC_GATE_NS) {
+        // Queued somewhere on the way, the timestamps say more about the network than the clocks
+        sync->rejected++;
+    } else {
+        // Alpha-beta filter on the offset, the rate term follows the drift between the two clocks
+        const double dt = (double) (int64_t) (t4 - sync->offset_at_ns);
+        const double predicted = sync->offset_ns + sync->skew * dt;
+        const double residual = (double) (sample - sync->offset_base_ns) - predicted;
+        sync->offset_ns = predicted + SYNC_ALPHA * residual;
+        if (dt > 0.0 && sync->samples >= 2) {
+            sync->skew += SYNC_BETA * residual / dt;
+            if (sync->skew > SYNC_MAX_SKEW) sync->skew = SYNC_MAX_SKEW;
+            if (sync->skew < -SYNC_MAX_SKEW) sync->skew = -SYNC_MAX_SKEW;
+        }
+        sync->offset_at_ns = t4;
+        sync->jitter_ns += 0.1 * (fabs(residual) - sync->jitter_ns);
+        if (++sync->samples == SYNC_STARTUP_SAMPLES) {
+            log_info("Sync: locked to leader, offset %+.3f ms", (sync->offset_base_ns + sync->offset_ns) / 1e6);
+        }
+    }
+    pthread_mutex_unlock(&sync->lock);
+}
+
+static bool from_leader(const clock_sync_t *sync, const struct sockaddr_in *from) {
+    return from->sin_family == AF_INET && from->sin_addr.s_addr == sync->leader.sin_addr.s_addr &&
+           from->sin_port == sync->leader.sin_port;
+}
+
+static void handle_cue(clock_sync_t *sync, const char *message, const struct sockaddr_in *from) {
+    uint64_t epoch, base_ns;
+    uint32_t seq;
+    char cue_id[SYNC_NAME_MAX];
+    if (sscanf(message, SYNC_MAGIC " CUE %" SCNu64 " %" SCNu32 " %" SCNu64 " %63s", &epoch, &seq, &base_ns,
+               cue_id) != 4) {
+        return;
+    }
+
+    char ack[96];
+    snprintf(ack, sizeof(ack), SYNC_MAGIC " ACK %" PRIu64 " %" PRIu32, epoch, seq);
+    send_message(sync, from, ack);
+
+    pthread_mutex_lock(&sync->lock);
+    if (epoch != sync->leader_epoch) {
+        sync->leader_epoch = epoch;
+        sync->last_cue_seq = 0;
+    }
+    if (seq <= sync->last_cue_seq) {
+        // A resend of a cue that already fired
+        pthread_mutex_unlock(&sync->lock);
+        return;
+    }
+    sync->last_cue_seq = seq;
+
+    const uint64_t now_ns = track_manager_now_ns();
+    const bool synced = sync->samples >= SYNC_STARTUP_SAMPLES;
+    uint64_t local_ns = 0;
+    if (synced) {
+        local_ns = base_ns - (leader_time(sync, now_ns) - now_ns);
+        sync->last_cue_late_ms = local_ns < now_ns ? (now_ns - local_ns) / 1e6 : 0.0;
+    }
+    sync->cues_received++;
+    snprintf(sync->last_cue, sizeof(sync->last_cue), "%s", cue_id);
+    pthread_mutex_unlock(&sync->lock);
+
+    // The show takes the track manager lock, which the fire hook holds while taking ours
+    if (!synced) {
+        log_warn("Sync: cue %s arrived before the clock locked, firing it now", cue_id);
+    } else if (local_ns < now_ns) {
+        log_warn("Sync: cue %s arrived %.1f ms late", cue_id, (now_ns - local_ns) / 1e6);
+    }
+    show_fire_at(sync->show, cue_id, local_ns);
+}
+
+// --- Thread ---
+
+static void *sync_thread(void *arg) {
+    clock_sync_t *sync = arg;
+    thread_policy_apply(THREAD_ROLE_CONTROL);
+
+    char message[512];
+    while (atomic_load(&sync->running)) {
+        struct pollfd pfd = {.fd = sync->fd, .events = POLLIN};
+        const int ready = poll(&pfd, 1, SYNC_POLL_MS);
+
+        while (ready > 0) {
+            struct sockaddr_in from;
+            socklen_t from_len = sizeof(from);
+            const ssize_t n = recvfrom(sync->fd, message, sizeof(message) - 1, MSG_DONTWAIT,
+                                       (struct sockaddr *) &from, &from_len);
+            const uint64_t received_ns = track_manager_now_ns();
+            if (n <= 0) break;
+            message[n] = '\0';
+            if (strncmp(message, SYNC_MAGIC " ", sizeof(SYNC_MAGIC)) != 0) continue;
+
+            const char *type = message + sizeof(SYNC_MAGIC);
+            if (sync->role == SYNC_FOLLOWER && !from_leader(sync, &from)) {
+                // Followers take clock and cues from the configured leader only
+                log_debug("Sync: ignored a message from %s:%d", inet_ntoa(from.sin_addr), ntohs(from.sin_port));
+                continue;
+            }
+            if (sync->role == SYNC_LEADER && strncmp(type, "REQ ", 4) == 0) {
+                handle_request(sync, message, &from, received_ns);
+            } else if (sync->role == SYNC_LEADER && strncmp(type, "ACK ", 4) == 0) {
+                handle_ack(sync, message, &from);
+            } else if (sync->role == SYNC_FOLLOWER && strncmp(type, "RSP ", 4) == 0) {
+                handle_response(sync, message, received_ns);
+            } else if (sync->role == SYNC_FOLLOWER && strncmp(type, "CUE ", 4) == 0) {
+                handle_cue(sync, message, &from);
+            }
+        }
+
+        const uint64_t now_ns = track_manager_now_ns();
+        if (sync->role == SYNC_LEADER) {
+            pthread_mutex_lock(&sync->lock);
+            send_cues(sync, now_ns);
+            pthread_mutex_unlock(&sync->lock);
+        } else if (now_ns >= sync->next_request_ns) {
+            send_request(sync, now_ns);
+        }
+    }
+    return NULL;
+}
+
+clock_sync_t *clock_sync_create(const global_config_t *config, show_ctx_t *show) {
+    if (!config || config->sync.role == SYNC_OFF) return NULL;
+    if (config->sync.role == SYNC_FOLLOWER && !config->sync.leader) {
+        log_error("Sync: follower without a leader address");
+        return NULL;
+    }
+
+    clock_sync_t *sync = calloc(1, sizeof(clock_sync_t));
+    if (!sync) {
+        log_error("Failed to allocate sync context");
+        return NULL;
+    }
+    sync->config = config;
+    sync->show = show;
+    sync->role = config->sync.role;
+    sync->interval_ns = (uint64_t) (config->sync.interval_ms > 0 ? config->sync.interval_ms
+                                                                  : SYNC_DEFAULT_INTERVAL_MS) * 1000000ull;
+    sync->epoch = track_manager_now_ns();
+    pthread_mutex_init(&sync->lock, NULL);
+    atomic_init(&sync->running, false);
+
+    // Names travel as one token
+    if (config->sync.name) {
+        snprintf(sync->name, sizeof(sync->name), "%s", config->sync.name);
+    } else if (gethostname(sync->name, sizeof(sync->name) - 1) != 0) {
+        snprintf(sync->name, sizeof(sync->name), "papad-%d", (int) getpid());
+    }
+    for (char *c = sync->name; *c; c++) {
+        if (*c == ' ' || *c == '\t') *c = '_';
+    }
+
+    const int port = config->sync.port > 0 ? config->sync.port : SYNC_DEFAULT_PORT;
+    struct sockaddr_in bind_addr = {.sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_ANY)};
+    if (sync->role == SYNC_LEADER) {
+        bind_addr.sin_port = htons((uint16_t) port);
+    } else if (!resolve_leader(config->sync.leader, port, &sync->leader)) {
+        pthread_mutex_destroy(&sync->lock);
+        free(sync);
+        return NULL;
+    }
+
+    sync->fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (sync->fd < 0 || bind(sync->fd, (struct sockaddr *) &bind_addr, sizeof(bind_addr)) < 0) {
+        log_error("Sync: cannot open UDP socket on port %d: %s", ntohs(bind_addr.sin_port), strerror(errno));
+        if (sync->fd >= 0) close(sync->fd);
+        pthread_mutex_destroy(&sync->lock);
+        free(sync);
+        return NULL;
+    }
+
+    atomic_store(&sync->running, true);
+    if (pthread_create(&sync->thread, NULL, sync_thread, sync) != 0) {
+        log_error("Sync: failed to start thread");
+        close(sync->fd);
+        pthread_mutex_destroy(&sync->lock);
+        free(sync);
+        return NULL;
+    }
+
+    if (sync->role == SYNC_LEADER) {
+        show_set_fire_hook(show, on_cue_fired, sync);
+        log_info("Sync: leader %s on UDP port %d", sync->name, port);
+    } else {
+        log_info("Sync: follower %s of %s:%d", sync->name, inet_ntoa(sync->leader.sin_addr),
+                 ntohs(sync->leader.sin_port));
+    }
+    return sync;
+}
+
+int clock_sync_format_status(clock_sync_t *sync, char *buffer, size_t size) {
+    if (!sync) return 0;
+
+    const uint64_t now_ns = track_manager_now_ns();
+    int written = 0;
+    pthread_mutex_lock(&sync->lock);
+
+    if (sync->role == SYNC_LEADER) {
+        int active = 0;
+        for (int i = 0; i < sync->peer_count; i++) {
+            active += now_ns - sync->peers[i].last_seen_ns <= SYNC_PEER_TIMEOUT_NS;
+        }
+        written = snprintf(buffer, size, "Sync: leader %s, %d followers, %" PRIu32 " cues sent\n", sync->name,
+                           active, sync->next_seq);
+        for (int i = 0; i < sync->peer_count && written >= 0 && (size_t) written < size; i++) {
+            const sync_peer_t *peer = &sync->peers[i];
+            char error[64] = "not locked";
+            if (peer->measured) {
+                snprintf(error, sizeof(error), "error %+.3f ms (avg %.3f ms)", peer->error_ns / 1e6,
+                         peer->mean_error_ns / 1e6);
+            }
+            written += snprintf(buffer + written, size - written,
+                                "  Follower %s %s:%d: %s, round trip %.3f ms, seen %.1f s ago, cue %" PRIu32 "/%" PRIu32 " acked\n",
+                                peer->name, inet_ntoa(peer->addr.sin_addr), ntohs(peer->addr.sin_port), error,
+                                peer->rtt_ns / 1e6, (now_ns - peer->last_seen_ns) / 1e9, peer->acked_seq,
+                                sync->next_seq);
+        }
+    } else if (sync->samples < SYNC_STARTUP_SAMPLES) {
+        written = snprintf(buffer, size, "Sync: follower %s of %s:%d, locking (%d exchanges)\n", sync->name,
+                           inet_ntoa(sync->leader.sin_addr), ntohs(sync->leader.sin_port), sync->samples);
+    } else {
+        const double offset_ms = (double) (int64_t) (leader_time(sync, now_ns) - now_ns) / 1e6;
+        written = snprintf(buffer, size,
+                           "Sync: follower %s of %s:%d, offset %+.3f ms, rate %+.2f ppm, round trip %.3f ms, "
+                           "jitter %.3f ms, %" PRIu32 " exchanges dropped, %" PRIu32 " cues (last %s, late %.1f ms)\n",
+                           sync->name, inet_ntoa(sync->leader.sin_addr), ntohs(sync->leader.sin_port), offset_ms,
+                           sync->skew * 1e6, sync->min_rtt_ns / 1e6, sync->jitter_ns / 1e6, sync->rejected,
+                           sync->cues_received, sync->last_cue[0] ? sync->last_cue : "-", sync->last_cue_late_ms);
+    }
+
+    pthread_mutex_unlock(&sync->lock);
+    return written;
+}
+
+void clock_sync_destroy(clock_sync_t *sync) {
+    if (!sync) return;
+
+    if (sync->role == SYNC_LEADER) {
+        show_set_fire_hook(sync->show, NULL, NULL);
+    }
+    atomic_store(&sync->running, false);
+    pthread_join(sync->thread, NULL);
+    close(sync->fd);
+    pthread_mutex_destroy(&sync->lock);
+    free(sync);
+}
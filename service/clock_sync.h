@@ -0,0 +1,25 @@
+#ifndef ASYNC_AUDIO_PLAYER_CLOCK_SYNC_H
+#define ASYNC_AUDIO_PLAYER_CLOCK_SYNC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "types.h"
+#include "show.h"
+
+// Shared timebase for several papad instances. Followers exchange four-timestamp messages with the
+// leader over UDP, as PTP and NTP do, and track the offset and rate of the leader's CLOCK_MONOTONIC.
+// Cues fired on the leader are sent with their start time on the leader clock. Each follower fires
+// the same cue at the matching local time.
+typedef struct clock_sync clock_sync_t;
+
+// Start the sync thread for config->sync.role; NULL when sync is off or the socket cannot be set up
+clock_sync_t *clock_sync_create(const global_config_t *config, show_ctx_t *show);
+
+// Format role, clock offset and, on the leader, the measured sync error of each follower
+int clock_sync_format_status(clock_sync_t *sync, char *buffer, size_t size);
+
+// Stop the thread and detach from the show
+void clock_sync_destroy(clock_sync_t *sync);
+
+#endif // ASYNC_AUDIO_PLAYER_CLOCK_SYNC_H
@@ -0,0 +1,477 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "commands.h"
+#include "sample_cache.h"
+
+// One command: handler runs it now, timed (set for commands that can be scheduled instead) at at_ns
+typedef struct {
+    const char *cmd;
+
+    int (*handler)(track_manager_ctx_t *mgr, const char *arg, char *response, size_t resp_size);
+    int (*timed)(track_manager_ctx_t *mgr, const char *arg, uint64_t at_ns, char *response, size_t resp_size);
+} command_handler_t;
+
+// Command handlers
+static int handle_play(track_manager_ctx_t *mgr, const char *track_id, const uint64_t at_ns, char *response,
+                       size_t resp_size) {
+    if (!track_id || !track_id[0]) {
+        snprintf(response, resp_size, "ERROR: Missing track ID");
+        return -1;
+    }
+
+    if (track_manager_play_at(mgr, track_id, at_ns)) {
+        snprintf(response, resp_size, "OK: Playing track %s", track_id);
+        return 0;
+    }
+
+    snprintf(response, resp_size, "ERROR: Failed to play track %s", track_id);
+    return -1;
+}
+
+static int handle_stop(track_manager_ctx_t *mgr, const char *track_id, const uint64_t at_ns, char *response,
+                       size_t resp_size) {
+    if (!track_id || !track_id[0]) {
+        snprintf(response, resp_size, "ERROR: Missing track ID");
+        return -1;
+    }
+
+    if (track_manager_stop_at(mgr, track_id, at_ns)) {
+        snprintf(response, resp_size, "OK: Stopped track %s", track_id);
+        return 0;
+    }
+
+    snprintf(response, resp_size, "ERROR: Failed to stop track %s", track_id);
+    return -1;
+}
+
+static int handle_stop_all(track_manager_ctx_t *mgr, const char *arg, char *response, size_t resp_size) {
+    (void) arg; // Unused
+
+    if (track_manager_stop_all(mgr)) {
+        snprintf(response, resp_size, "OK: Stopped all tracks");
+        return 0;
+    }
+
+    snprintf(response, resp_size, "ERROR: Failed to stop all tracks");
+    return -1;
+}
+
+static int handle_list(track_manager_ctx_t *mgr, const char *arg, char *response, size_t resp_size) {
+    (void) arg; // Unused
+    (void) mgr; // Use track manager to get list
+
+    // For now, just return a simple message
+    // In a full implementation, format a proper list of tracks
+    snprintf(response, resp_size, "OK: Track listing not yet implemented");
+    return 0;
+}
+
+static int handle_status(track_manager_ctx_t *mgr, const char *arg, char *response, size_t resp_size) {
+    (void) arg; // Unused
+    char* status = track_manager_print_status(mgr);
+    if (!status) {
+        snprintf(response, resp_size, "ERROR: Failed to get status");
+        return -1;
+    }
+
+    snprintf(response, resp_size, "%s", status);
+    free(status);
+    return 0;
+}
+
+static int handle_cache(track_manager_ctx_t *mgr, const char *arg, char *response, size_t resp_size) {
+    (void) arg; // Unused
+    (void) mgr; // Unused
+    char *status = sample_cache_print_status();
+    if (!status) {
+        snprintf(response, resp_size, "ERROR: Failed to get cache status");
+        return -1;
+    }
+
+    snprintf(response, resp_size, "%s", status);
+    free(status);
+    return 0;
+}
+
+static int handle_go(track_manager_ctx_t *mgr, const char *arg, const uint64_t at_ns, char *response,
+                     size_t resp_size) {
+    (void) arg; // Unused
+    bool resumed = false;
+    const char *cue = show_go_at(track_manager_get_show(mgr), at_ns, &resumed);
+
+    if (resumed) {
+        snprintf(response, resp_size, "OK: Resumed show");
+        return 0;
+    }
+    if (cue) {
+        snprintf(response, resp_size, "OK: Fired cue %s", cue);
+        return 0;
+    }
+
+    snprintf(response, resp_size, "ERROR: No more cues");
+    return -1;
+}
+
+static int handle_goto(track_manager_ctx_t *mgr, const char *cue_id, const uint64_t at_ns, char *response,
+                       size_t resp_size) {
+    if (!cue_id || !cue_id[0]) {
+        snprintf(response, resp_size, "ERROR: Missing cue ID");
+        return -1;
+    }
+
+    if (show_fire_at(track_manager_get_show(mgr), cue_id, at_ns)) {
+        snprintf(response, resp_size, "OK: Fired cue %s", cue_id);
+        return 0;
+    }
+
+    snprintf(response, resp_size, "ERROR: Unknown cue %s", cue_id);
+    return -1;
+}
+
+static int handle_pause_show(track_manager_ctx_t *mgr, const char *arg, char *response, size_t resp_size) {
+    (void) arg; // Unused
+
+    if (show_pause(track_manager_get_show(mgr))) {
+        snprintf(response, resp_size, "OK: Show paused");
+        return 0;
+    }
+
+    snprintf(response, resp_size, "ERROR: Failed to pause show");
+    return -1;
+}
+
+static int handle_volume(track_manager_ctx_t *mgr, const char *arg, const uint64_t at_ns, char *response,
+                         size_t resp_size) {
+    char track_id[128];
+    float gain;
+
+    if (!arg || sscanf(arg, "%127s %f", track_id, &gain) != 2 || gain < 0.0f) {
+        snprintf(response, resp_size, "ERROR: Usage: volume <track> <gain>");
+        return -1;
+    }
+
+    if (track_manager_set_volume_at(mgr, track_id, gain, at_ns)) {
+        snprintf(response, resp_size, "OK: Track %s volume %.2f", track_id, gain);
+        return 0;
+    }
+
+    snprintf(response, resp_size, "ERROR: Failed to set volume of track %s", track_id);
+    return -1;
+}
+
+static int handle_bus(track_manager_ctx_t *mgr, const char *arg, char *response, size_t resp_size) {
+    char bus_id[128];
+    char action[16];
+    float gain = 0.0f;
+
+    const int fields = arg ? sscanf(arg, "%127s %15s %f", bus_id, action, &gain) : 0;
+    bool ok;
+    if (fields >= 2 && strcmp(action, "mute") == 0) {
+        ok = track_manager_set_bus_mute(mgr, bus_id, true);
+    } else if (fields >= 2 && strcmp(action, "unmute") == 0) {
+        ok = track_manager_set_bus_mute(mgr, bus_id, false);
+    } else if (fields == 3 && strcmp(action, "gain") == 0 && gain >= 0.0f) {
+        ok = track_manager_set_bus_gain(mgr, bus_id, gain);
+    } else {
+        snprintf(response, resp_size, "ERROR: Usage: bus <bus> gain <gain>|mute|unmute");
+        return -1;
+    }
+
+    if (ok) {
+        snprintf(response, resp_size, "OK: Bus %s %s", bus_id, action);
+        return 0;
+    }
+
+    snprintf(response, resp_size, "ERROR: Unknown bus %s", bus_id);
+    return -1;
+}
+
+static int handle_pan(track_manager_ctx_t *mgr, const char *arg, const uint64_t at_ns, char *response,
+                      size_t resp_size) {
+    char track_id[128];
+    float x, y;
+    double seconds = 0.0;
+
+    const int fields = arg ? sscanf(arg, "%127s %f %f %lf", track_id, &x, &y, &seconds) : 0;
+    if (fields < 3 || seconds < 0.0) {
+        snprintf(response, resp_size, "ERROR: Usage: pan <track> <x> <y> [seconds]");
+        return -1;
+    }
+
+    if (track_manager_set_position(mgr, track_id, x, y, seconds, at_ns)) {
+        snprintf(response, resp_size, "OK: Track %s moving to (%.2f, %.2f) over %.2f s", track_id, x, y, seconds);
+        return 0;
+    }
+
+    snprintf(response, resp_size, "ERROR: Track %s is not a playing spatial source", track_id);
+    return -1;
+}
+
+static int handle_delay(track_manager_ctx_t *mgr, const char *arg, char *response, size_t resp_size) {
+    char device[256];
+    char channel[32];
+    float ms;
+
+    if (!arg || sscanf(arg, "%255s %31s %f", device, channel, &ms) != 3 || ms < 0.0f) {
+        snprintf(response, resp_size, "ERROR: Usage: delay <device|default> <channel> <ms>");
+        return -1;
+    }
+
+    if (track_manager_set_output_delay(mgr, device, channel, ms)) {
+        snprintf(response, resp_size, "OK: %s %s delay %.2f ms", device, channel, ms);
+        return 0;
+    }
+
+    snprintf(response, resp_size, "ERROR: No delay line for %s on %s or delay too long", channel, device);
+    return -1;
+}
+
+static int handle_signal(track_manager_ctx_t *mgr, const char *arg, char *response, size_t resp_size) {
+    static const char *usage = "ERROR: Usage: signal <sine|white|pink|sweep|ident|off> [channels] [freq=Hz] "
+                               "[from=Hz] [to=Hz] [seconds=s] [level=dBFS] [step=s]";
+    char args[COMMAND_MAX_LENGTH];
+    snprintf(args, sizeof(args), "%s", arg ? arg : "");
+
+    char *save = NULL;
+    const char *type = strtok_r(args, " ", &save);
+    if (type && strcmp(type, "off") == 0) {
+        if (track_manager_stop(mgr, "test_tone")) {
+            snprintf(response, resp_size, "OK: Test signal stopped");
+            return 0;
+        }
+        snprintf(response, resp_size, "ERROR: No test signal playing");
+        return -1;
+    }
+
+    generator_config_t signal;
+    if (!generator_parse_type(type, &signal)) {
+        snprintf(response, resp_size, "%s", usage);
+        return -1;
+    }
+
+    // A bare word is the channel mapping, key=value pairs adjust the signal
+    const char *mapping = NULL;
+    for (char *token = strtok_r(NULL, " ", &save); token; token = strtok_r(NULL, " ", &save)) {
+        char *value = strchr(token, '=');
+        if (!value) {
+            mapping = token;
+            continue;
+        }
+        *value++ = '\0';
+
+        char *end;
+        const float number = strtof(value, &end);
+        if (end == value || *end != '\0') {
+            snprintf(response, resp_size, "%s", usage);
+            return -1;
+        }
+        if (strcmp(token, "freq") == 0 && number > 0.0f) {
+            signal.frequency = number;
+        } else if (strcmp(token, "from") == 0 && number > 0.0f) {
+            signal.sweep_from = number;
+        } else if (strcmp(token, "to") == 0 && number > 0.0f) {
+            signal.sweep_to = number;
+        } else if (strcmp(token, "seconds") == 0 && number > 0.0f) {
+            signal.sweep_seconds = number;
+        } else if (strcmp(token, "level") == 0 && number <= 0.0f) {
+            signal.level_db = number;
+        } else if (strcmp(token, "step") == 0 && number >= 0.0f) {
+            signal.ident_seconds = number;
+        } else {
+            snprintf(response, resp_size, "%s", usage);
+            return -1;
+        }
+    }
+
+    if (track_manager_play_test_tone(mgr, &signal, mapping)) {
+        snprintf(response, resp_size, "OK: Test signal %s on %s", type, mapping ? mapping : "FL,FR");
+        return 0;
+    }
+
+    snprintf(response, resp_size, "ERROR: Failed to start test signal");
+    return -1;
+}
+
+static int handle_measure_latency(track_manager_ctx_t *mgr, const char *arg, char *response, size_t resp_size) {
+    static const char *usage = "ERROR: Usage: measure-latency <device|default> <channel> [capture=<device>] "
+                               "[input=<channel>] [signal=mls|chirp]";
+    char args[COMMAND_MAX_LENGTH];
+    snprintf(args, sizeof(args), "%s", arg ? arg : "");
+
+    char *save = NULL;
+    const char *device = strtok_r(args, " ", &save);
+    const char *channel = strtok_r(NULL, " ", &save);
+    if (!device || !channel) {
+        snprintf(response, resp_size, "%s", usage);
+        return -1;
+    }
+
+    const char *capture_device = NULL;
+    const char *capture_channel = NULL;
+    latency_signal_t signal = LATENCY_SIGNAL_MLS;
+    for (char *token = strtok_r(NULL, " ", &save); token; token = strtok_r(NULL, " ", &save)) {
+        if (strncmp(token, "capture=", 8) == 0) {
+            capture_device = token + 8;
+        } else if (strncmp(token, "input=", 6) == 0) {
+            capture_channel = token + 6;
+        } else if (strcmp(token, "signal=mls") == 0) {
+            signal = LATENCY_SIGNAL_MLS;
+        } else if (strcmp(token, "signal=chirp") == 0) {
+            signal = LATENCY_SIGNAL_CHIRP;
+        } else {
+            snprintf(response, resp_size, "%s", usage);
+            return -1;
+        }
+    }
+
+    latency_result_t result;
+    if (!track_manager_measure_latency(mgr, device, channel, capture_device, capture_channel, signal, &result)) {
+        snprintf(response, resp_size, "ERROR: Latency measurement of %s on %s failed", channel, device);
+        return -1;
+    }
+
+    snprintf(response, resp_size,
+             "OK: %s on %s: %lld samples (%.2f ms) round trip at %d Hz, output stage %u, PipeWire reports %lld, "
+             "peak %.1f dB",
+             channel, device, (long long) result.frames, result.ms, result.samplerate, result.stage_frames,
+             (long long) result.reported_frames, result.peak_db);
+    return 0;
+}
+
+static int handle_devices(track_manager_ctx_t *mgr, const char *arg, char *response, size_t resp_size) {
+    (void) arg; // Unused
+    char *devices = track_manager_format_devices(mgr);
+    if (!devices) {
+        snprintf(response, resp_size, "ERROR: Failed to list devices");
+        return -1;
+    }
+
+    snprintf(response, resp_size, "%s", devices);
+    free(devices);
+    return 0;
+}
+
+static int handle_meters(track_manager_ctx_t *mgr, const char *arg, char *response, size_t resp_size) {
+    (void) arg; // Unused
+    char *meters = track_manager_format_meters(mgr);
+    if (!meters) {
+        snprintf(response, resp_size, "ERROR: Failed to read meters");
+        return -1;
+    }
+
+    snprintf(response, resp_size, "%s", meters);
+    free(meters);
+    return 0;
+}
+
+static int handle_ping(track_manager_ctx_t *mgr, const char *arg, char *response, size_t resp_size) {
+    (void) arg; // Unused
+    (void) mgr; // Unused
+    // The receive time lets a controller see how far the socket shifts what it triggers
+    snprintf(response, resp_size, "OK: pong %llu", (unsigned long long) track_manager_now_ns());
+    return 0;
+}
+
+static int handle_reload(track_manager_ctx_t *mgr, const char *arg, char *response, size_t resp_size) {
+    (void) arg; // Unused
+    (void) mgr; // In a full implementation, this would reload the config
+
+    // This would trigger a reload signal
+    snprintf(response, resp_size, "OK: Reload signal not yet implemented");
+    return 0;
+}
+
+// Command table
+static const command_handler_t COMMANDS[] = {
+        {"play",     NULL, handle_play},
+        {"stop",     NULL, handle_stop},
+        {"stop-all", handle_stop_all, NULL},
+        {"list",     handle_list, NULL},
+        {"status",   handle_status, NULL},
+        {"reload",   handle_reload, NULL},
+        {"cache",    handle_cache, NULL},
+        {"go",       NULL, handle_go},
+        {"goto",     NULL, handle_goto},
+        {"pause-show", handle_pause_show, NULL},
+        {"volume",   NULL, handle_volume},
+        {"bus",      handle_bus, NULL},
+        {"meters",   handle_meters, NULL},
+        {"delay",    handle_delay, NULL},
+        {"pan",      NULL, handle_pan},
+        {"signal",   handle_signal, NULL},
+        {"measure-latency", handle_measure_latency, NULL},
+        {"devices",  handle_devices, NULL},
+        {"ping",     handle_ping, NULL},
+        {NULL, NULL, NULL} // Terminator
+};
+
+// Commands that wait on the audio graph for seconds before they can answer
+static const char *const SLOW_COMMANDS[] = {"measure-latency", NULL};
+
+static const command_handler_t *find_command(const char *cmd) {
+    for (const command_handler_t *handler = COMMANDS; handler->cmd != NULL; handler++) {
+        if (strcmp(handler->cmd, cmd) == 0) {
+            return handler;
+        }
+    }
+    return NULL;
+}
+
+int commands_execute(track_manager_ctx_t *mgr, const char *command, const uint64_t at_ns, char *response,
+                     const size_t resp_size) {
+    // Refuse rather than cut: a truncated command would run with the wrong arguments
+    char cmd_buf[COMMAND_MAX_LENGTH];
+    if (strlen(command) >= sizeof(cmd_buf)) {
+        snprintf(response, resp_size, "ERROR: Command too long");
+        return -1;
+    }
+    memcpy(cmd_buf, command, strlen(command) + 1);
+
+    // Split command and argument; strtok_r as the socket and OSC threads both get here
+    char *save = NULL;
+    char *cmd = strtok_r(cmd_buf, " ", &save);
+    char *arg = strtok_r(NULL, "", &save);
+
+    if (!cmd) {
+        snprintf(response, resp_size, "ERROR: Empty command");
+        return -1;
+    }
+
+    const command_handler_t *handler = find_command(cmd);
+    if (!handler) {
+        snprintf(response, resp_size, "ERROR: Unknown command '%s'", cmd);
+        return -1;
+    }
+    if (handler->timed) {
+        return handler->timed(mgr, arg, at_ns, response, resp_size);
+    }
+    return handler->handler(mgr, arg, response, resp_size);
+}
+
+// Copy the command word of a command line; false when there is none
+static bool command_name(const char *command, char *cmd, const size_t size) {
+    const size_t length = strcspn(command, " ");
+    if (length == 0 || length >= size) return false;
+    memcpy(cmd, command, length);
+    cmd[length] = '\0';
+    return true;
+}
+
+bool commands_is_timed(const char *command) {
+    char cmd[32];
+    if (!command_name(command, cmd, sizeof(cmd))) return false;
+
+    const command_handler_t *handler = find_command(cmd);
+    return handler && handler->timed;
+}
+
+bool commands_is_slow(const char *command) {
+    char cmd[32];
+    if (!command_name(command, cmd, sizeof(cmd))) return false;
+
+    for (int i = 0; SLOW_COMMANDS[i]; i++) {
+        if (strcmp(SLOW_COMMANDS[i], cmd) == 0) return true;
+    }
+    return false;
+}
@@ -0,0 +1,25 @@
+#ifndef ASYNC_AUDIO_PLAYER_COMMANDS_H
+#define ASYNC_AUDIO_PLAYER_COMMANDS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "track_manager.h"
+
+// Control commands ("play intro", "volume rain 0.4", ...) shared by the socket server and OSC
+
+#define COMMAND_MAX_LENGTH 4096     // Buffer for one command line, terminator included; longer ones are refused
+
+// Run one command and write its response ("OK: ..." or "ERROR: ..."). Timed commands (play, stop, go, goto,
+// volume, pan) take effect at at_ns on the CLOCK_MONOTONIC timeline, 0 = now; others ignore it.
+// Returns 0 on success, -1 on error.
+int commands_execute(track_manager_ctx_t *mgr, const char *command, uint64_t at_ns, char *response,
+                     size_t resp_size);
+
+// Whether the command honours at_ns; callers hold other commands until their time themselves
+bool commands_is_timed(const char *command);
+
+// Whether the command takes seconds to answer (measure-latency); callers run it off their poll thread
+bool commands_is_slow(const char *command);
+
+#endif // ASYNC_AUDIO_PLAYER_COMMANDS_H
@@ -1,4 +1,5 @@
 #include <yaml.h>
+#include <math.h>
 #include <string.h>
 #include <stdlib.h>
 #include "config.h"
@@ -17,6 +18,147 @@ static void parse_logging(yaml_document_t *doc, const yaml_node_t *node, global_
     }
 }
 
+static void parse_cache(yaml_document_t *doc, const yaml_node_t *node, global_config_t *config) {
+    if (node->type != YAML_MAPPING_NODE) return;
+
+    for (const yaml_node_pair_t *pair = node->data.mapping.pairs.start; pair < node->data.mapping.pairs.top; pair++) {
+        const yaml_node_t *key = yaml_document_get_node(doc, pair->key);
+        const yaml_node_t *value = yaml_document_get_node(doc, pair->value);
+
+        if (strcmp((char *) key->data.scalar.value, "enabled") == 0) {
+            config->cache.enabled = strcmp((char *) value->data.scalar.value, "true") == 0;
+        } else if (strcmp((char *) key->data.scalar.value, "directory") == 0) {
+            config->cache.directory = strdup((char *) value->data.scalar.value);
+        } else if (strcmp((char *) key->data.scalar.value, "workers") == 0) {
+            config->cache.workers = atoi((char *) value->data.scalar.value);
+        }
+    }
+}
+
+static void parse_preload(yaml_document_t *doc, const yaml_node_t *node, global_config_t *config) {
+    if (node->type != YAML_MAPPING_NODE) return;
+
+    for (const yaml_node_pair_t *pair = node->data.mapping.pairs.start; pair < node->data.mapping.pairs.top; pair++) {
+        const yaml_node_t *key = yaml_document_get_node(doc, pair->key);
+        const yaml_node_t *value = yaml_document_get_node(doc, pair->value);
+
+        if (strcmp((char *) key->data.scalar.value, "enabled") == 0) {
+            config->preload.enabled = strcmp((char *) value->data.scalar.value, "true") == 0;
+        } else if (strcmp((char *) key->data.scalar.value, "strict") == 0) {
+            config->preload.strict = strcmp((char *) value->data.scalar.value, "true") == 0;
+        } else if (strcmp((char *) key->data.scalar.value, "workers") == 0) {
+            config->preload.workers = atoi((char *) value->data.scalar.value);
+        }
+    }
+}
+
+static void parse_sample_cache(yaml_document_t *doc, const yaml_node_t *node, global_config_t *config) {
+    if (node->type != YAML_MAPPING_NODE) return;
+
+    for (const yaml_node_pair_t *pair = node->data.mapping.pairs.start; pair < node->data.mapping.pairs.top; pair++) {
+        const yaml_node_t *key = yaml_document_get_node(doc, pair->key);
+        const yaml_node_t *value = yaml_document_get_node(doc, pair->value);
+
+        if (strcmp((char *) key->data.scalar.value, "budget_mb") == 0) {
+            config->sample_cache.budget_mb = atoi((char *) value->data.scalar.value);
+        }
+    }
+}
+
+static void parse_memory(yaml_document_t *doc, const yaml_node_t *node, global_config_t *config) {
+    if (node->type != YAML_MAPPING_NODE) return;
+
+    for (const yaml_node_pair_t *pair = node->data.mapping.pairs.start; pair < node->data.mapping.pairs.top; pair++) {
+        const yaml_node_t *key = yaml_document_get_node(doc, pair->key);
+        const yaml_node_t *value = yaml_document_get_node(doc, pair->value);
+
+        if (strcmp((char *) key->data.scalar.value, "arena_mb") == 0) {
+            config->memory.arena_mb = atoi((char *) value->data.scalar.value);
+        } else if (strcmp((char *) key->data.scalar.value, "huge_pages") == 0) {
+            config->memory.huge_pages = strcmp((char *) value->data.scalar.value, "true") == 0;
+        } else if (strcmp((char *) key->data.scalar.value, "lock") == 0) {
+            config->memory.lock = strcmp((char *) value->data.scalar.value, "true") == 0;
+        } else if (strcmp((char *) key->data.scalar.value, "lock_all") == 0) {
+            config->memory.lock_all = strcmp((char *) value->data.scalar.value, "true") == 0;
+        }
+    }
+}
+
+// Parse a CPU list given as a sequence or as a string like "0-1,3"
+static void parse_cpu_list(yaml_document_t *doc, const yaml_node_t *node, thread_config_t *thread) {
+    int cpus[256];
+    int count = 0;
+
+    if (node->type == YAML_SEQUENCE_NODE) {
+        for (const yaml_node_item_t *item = node->data.sequence.items.start; item < node->data.sequence.items.top; item++) {
+            const yaml_node_t *cpu = yaml_document_get_node(doc, *item);
+            if (cpu->type == YAML_SCALAR_NODE && count < 256) {
+                cpus[count++] = atoi((char *) cpu->data.scalar.value);
+            }
+        }
+    } else if (node->type == YAML_SCALAR_NODE) {
+        const char *p = (char *) node->data.scalar.value;
+        while (*p && count < 256) {
+            char *end;
+            const long first = strtol(p, &end, 10);
+            if (end == p) break;
+            long last = first;
+            if (*end == '-') {
+                p = end + 1;
+                last = strtol(p, &end, 10);
+                if (end == p) break;
+            }
+            for (long cpu = first; cpu <= last && count < 256; cpu++) {
+                cpus[count++] = (int) cpu;
+            }
+            p = *end == ',' ? end + 1 : end;
+        }
+    }
+
+    free(thread->cpus);
+    thread->cpus = NULL;
+    thread->cpu_count = 0;
+    if (count > 0) {
+        thread->cpus = malloc(sizeof(int) * count);
+        if (thread->cpus) {
+            memcpy(thread->cpus, cpus, sizeof(int) * count);
+            thread->cpu_count = count;
+        }
+    }
+}
+
+static void parse_thread(yaml_document_t *doc, const yaml_node_t *node, thread_config_t *thread) {
+    if (node->type != YAML_MAPPING_NODE) return;
+
+    for (const yaml_node_pair_t *pair = node->data.mapping.pairs.start; pair < node->data.mapping.pairs.top; pair++) {
+        const yaml_node_t *key = yaml_document_get_node(doc, pair->key);
+        const yaml_node_t *value = yaml_document_get_node(doc, pair->value);
+
+        if (strcmp((char *) key->data.scalar.value, "cpus") == 0) {
+            parse_cpu_list(doc, value, thread);
+        } else if (strcmp((char *) key->data.scalar.value, "priority") == 0) {
+            thread->priority = atoi((char *) value->data.scalar.value);
+        }
+    }
+}
+
+static void parse_threads(yaml_document_t *doc, const yaml_node_t *node, global_config_t *config) {
+    if (node->type != YAML_MAPPING_NODE) return;
+
+    for (const yaml_node_pair_t *pair = node->data.mapping.pairs.start; pair < node->data.mapping.pairs.top; pair++) {
+        const yaml_node_t *key = yaml_document_get_node(doc, pair->key);
+        const yaml_node_t *value = yaml_document_get_node(doc, pair->value);
+
+        if (strcmp((char *) key->data.scalar.value, "data_loop") == 0) {
+            parse_thread(doc, value, &config->threads.data_loop);
+        } else if (strcmp((char *) key->data.scalar.value, "workers") == 0) {
+            parse_thread(doc, value, &config->threads.workers);
+        } else if (strcmp((char *) key->data.scalar.value, "control") == 0) {
+            parse_thread(doc, value, &config->threads.control);
+        }
+    }
+}
+
 static void parse_track_output(yaml_document_t *doc, const yaml_node_t *node, output_config_t *output) {
     if (node->type != YAML_MAPPING_NODE) return;
 
@@ -42,6 +184,70 @@ static void parse_track_output(yaml_document_t *doc, const yaml_node_t *node, ou
     }
 }
 
+static void parse_ducking(yaml_document_t *doc, const yaml_node_t *node, duck_config_t *ducking) {
+    if (node->type != YAML_MAPPING_NODE) return;
+
+    ducking->amount_db = -12.0f;
+    ducking->threshold_db = -40.0f;
+    ducking->attack_ms = 10.0f;
+    ducking->release_ms = 300.0f;
+
+    for (const yaml_node_pair_t *pair = node->data.mapping.pairs.start; pair < node->data.mapping.pairs.top; pair++) {
+        const yaml_node_t *key = yaml_document_get_node(doc, pair->key);
+        const yaml_node_t *value = yaml_document_get_node(doc, pair->value);
+
+        if (strcmp((char *) key->data.scalar.value, "amount_db") == 0) {
+            ducking->amount_db = atof((char *) value->data.scalar.value);
+        } else if (strcmp((char *) key->data.scalar.value, "threshold_db") == 0) {
+            ducking->threshold_db = atof((char *) value->data.scalar.value);
+        } else if (strcmp((char *) key->data.scalar.value, "attack_ms") == 0) {
+            ducking->attack_ms = atof((char *) value->data.scalar.value);
+        } else if (strcmp((char *) key->data.scalar.value, "release_ms") == 0) {
+            ducking->release_ms = atof((char *) value->data.scalar.value);
+        }
+    }
+}
+
+// Position as {x, y} in metres or {azimuth, distance} in degrees and metres (distance default 1)
+static void parse_position(yaml_document_t *doc, const yaml_node_t *node, float *x, float *y) {
+    if (node->type != YAML_MAPPING_NODE) return;
+
+    bool polar = false;
+    float azimuth = 0.0f;
+    float distance = 1.0f;
+    for (const yaml_node_pair_t *pair = node->data.mapping.pairs.start; pair < node->data.mapping.pairs.top; pair++) {
+        const yaml_node_t *key = yaml_document_get_node(doc, pair->key);
+        const yaml_node_t *value = yaml_document_get_node(doc, pair->value);
+
+        if (strcmp((char *) key->data.scalar.value, "x") == 0) {
+            *x = atof((char *) value->data.scalar.value);
+        } else if (strcmp((char *) key->data.scalar.value, "y") == 0) {
+            *y = atof((char *) value->data.scalar.value);
+        } else if (strcmp((char *) key->data.scalar.value, "azimuth") == 0) {
+            azimuth = atof((char *) value->data.scalar.value);
+            polar = true;
+        } else if (strcmp((char *) key->data.scalar.value, "distance") == 0) {
+            distance = atof((char *) value->data.scalar.value);
+        }
+    }
+
+    if (polar) {
+        *x = distance * sinf(azimuth * (float) M_PI / 180.0f);
+        *y = distance * cosf(azimuth * (float) M_PI / 180.0f);
+    }
+}
+
+static resume_mode_t parse_resume_mode(const char *mode) {
+    if (strcmp(mode, "frozen") == 0) {
+        return RESUME_FROZEN;
+    }
+    if (strcmp(mode, "advance") == 0) {
+        return RESUME_ADVANCE;
+    }
+    log_warn("Unknown resume mode '%s', using the default", mode);
+    return RESUME_DEFAULT;
+}
+
 static void parse_tracks(yaml_document_t *doc, const yaml_node_t *node, global_config_t *config) {
     if (node->type != YAML_SEQUENCE_NODE) return;
 
@@ -53,6 +259,7 @@ static void parse_tracks(yaml_document_t *doc, const yaml_node_t *node, global_c
         const yaml_node_t *track_node = yaml_document_get_node(doc, *item);
         track_config_t *track = &config->tracks[track_index++];
         memset(track, 0, sizeof(track_config_t));
+        track->spread = 60.0f;
 
         for (const yaml_node_pair_t *pair = track_node->data.mapping.pairs.start; pair < track_node->data.mapping.pairs.top; pair++) {
             const yaml_node_t *key = yaml_document_get_node(doc, pair->key);
@@ -66,6 +273,21 @@ static void parse_tracks(yaml_document_t *doc, const yaml_node_t *node, global_c
                 track->loop = strcmp((char *) value->data.scalar.value, "true") == 0;
             } else if (strcmp((char *) key->data.scalar.value, "volume") == 0) {
                 track->volume = atof((char *) value->data.scalar.value);
+            } else if (strcmp((char *) key->data.scalar.value, "critical") == 0) {
+                track->critical = strcmp((char *) value->data.scalar.value, "true") == 0;
+            } else if (strcmp((char *) key->data.scalar.value, "bus") == 0) {
+                track->bus = strdup((char *) value->data.scalar.value);
+            } else if (strcmp((char *) key->data.scalar.value, "priority") == 0) {
+                track->priority = atoi((char *) value->data.scalar.value);
+            } else if (strcmp((char *) key->data.scalar.value, "ducking") == 0) {
+                parse_ducking(doc, value, &track->ducking);
+            } else if (strcmp((char *) key->data.scalar.value, "position") == 0) {
+                parse_position(doc, value, &track->position_x, &track->position_y);
+                track->spatial = true;
+            } else if (strcmp((char *) key->data.scalar.value, "spread") == 0) {
+                track->spread = atof((char *) value->data.scalar.value);
+            } else if (strcmp((char *) key->data.scalar.value, "resume") == 0) {
+                track->resume = parse_resume_mode((char *) value->data.scalar.value);
             } else if (strcmp((char *) key->data.scalar.value, "output") == 0) {
                 parse_track_output(doc, value, &track->output);
             }
@@ -73,6 +295,543 @@ static void parse_tracks(yaml_document_t *doc, const yaml_node_t *node, global_c
     }
 }
 
+static void parse_panner(yaml_document_t *doc, const yaml_node_t *node, panner_config_t *panner) {
+    if (node->type != YAML_MAPPING_NODE) return;
+
+    panner->mode = PANNER_VBAP;
+    panner->rolloff_db = 6.0f;
+    panner->blur = 0.2f;
+
+    for (const yaml_node_pair_t *pair = node->data.mapping.pairs.start; pair < node->data.mapping.pairs.top; pair++) {
+        const yaml_node_t *key = yaml_document_get_node(doc, pair->key);
+        const yaml_node_t *value = yaml_document_get_node(doc, pair->value);
+
+        if (strcmp((char *) key->data.scalar.value, "mode") == 0) {
+            const char *mode = (char *) value->data.scalar.value;
+            if (strcmp(mode, "vbap") == 0) {
+                panner->mode = PANNER_VBAP;
+            } else if (strcmp(mode, "dbap") == 0) {
+                panner->mode = PANNER_DBAP;
+            } else if (strcmp(mode, "off") == 0) {
+                panner->mode = PANNER_OFF;
+            } else {
+                log_warn("Unknown panner mode '%s', using vbap", mode);
+            }
+        } else if (strcmp((char *) key->data.scalar.value, "rolloff_db") == 0) {
+            panner->rolloff_db = atof((char *) value->data.scalar.value);
+        } else if (strcmp((char *) key->data.scalar.value, "blur") == 0) {
+            panner->blur = atof((char *) value->data.scalar.value);
+        } else if (strcmp((char *) key->data.scalar.value, "speakers") == 0 && value->type == YAML_MAPPING_NODE) {
+            // Bus channel name -> position
+            panner->speaker_count = value->data.mapping.pairs.top - value->data.mapping.pairs.start;
+            panner->speakers = calloc(panner->speaker_count, sizeof(speaker_config_t));
+            if (!panner->speakers) {
+                panner->speaker_count = 0;
+                continue;
+            }
+
+            int speaker_index = 0;
+            for (const yaml_node_pair_t *entry = value->data.mapping.pairs.start; entry < value->data.mapping.pairs.top; entry++) {
+                speaker_config_t *speaker = &panner->speakers[speaker_index++];
+                speaker->name = strdup((char *) yaml_document_get_node(doc, entry->key)->data.scalar.value);
+                parse_position(doc, yaml_document_get_node(doc, entry->value), &speaker->x, &speaker->y);
+            }
+        }
+    }
+}
+
+static void parse_buses(yaml_document_t *doc, const yaml_node_t *node, global_config_t *config) {
+    if (node->type != YAML_SEQUENCE_NODE) return;
+
+    config->bus_count = node->data.sequence.items.top - node->data.sequence.items.start;
+    config->buses = calloc(config->bus_count, sizeof(bus_config_t));
+    if (!config->buses) {
+        config->bus_count = 0;
+        return;
+    }
+
+    int bus_index = 0;
+    for (const yaml_node_item_t *item = node->data.sequence.items.start; item < node->data.sequence.items.top; item++) {
+        const yaml_node_t *bus_node = yaml_document_get_node(doc, *item);
+        bus_config_t *bus = &config->buses[bus_index++];
+        bus->gain = 1.0f;
+        bus->samplerate = 48000;
+        if (bus_node->type != YAML_MAPPING_NODE) continue;
+
+        for (const yaml_node_pair_t *pair = bus_node->data.mapping.pairs.start; pair < bus_node->data.mapping.pairs.top; pair++) {
+            const yaml_node_t *key = yaml_document_get_node(doc, pair->key);
+            const yaml_node_t *value = yaml_document_get_node(doc, pair->value);
+
+            if (strcmp((char *) key->data.scalar.value, "id") == 0) {
+                bus->id = strdup((char *) value->data.scalar.value);
+            } else if (strcmp((char *) key->data.scalar.value, "gain") == 0) {
+                bus->gain = atof((char *) value->data.scalar.value);
+            } else if (strcmp((char *) key->data.scalar.value, "mute") == 0) {
+                bus->mute = strcmp((char *) value->data.scalar.value, "true") == 0;
+            } else if (strcmp((char *) key->data.scalar.value, "samplerate") == 0) {
+                bus->samplerate = atoi((char *) value->data.scalar.value);
+            } else if (strcmp((char *) key->data.scalar.value, "panner") == 0) {
+                parse_panner(doc, value, &bus->panner);
+            } else if (strcmp((char *) key->data.scalar.value, "output") == 0) {
+                parse_track_output(doc, value, &bus->output);
+            }
+        }
+    }
+}
+
+static void parse_limiter(yaml_document_t *doc, const yaml_node_t *node, limiter_config_t *limiter) {
+    if (node->type != YAML_MAPPING_NODE) return;
+
+    limiter->mode = LIMITER_LOOKAHEAD;
+
+    for (const yaml_node_pair_t *pair = node->data.mapping.pairs.start; pair < node->data.mapping.pairs.top; pair++) {
+        const yaml_node_t *key = yaml_document_get_node(doc, pair->key);
+        const yaml_node_t *value = yaml_document_get_node(doc, pair->value);
+
+        if (strcmp((char *) key->data.scalar.value, "mode") == 0) {
+            const char *mode = (char *) value->data.scalar.value;
+            if (strcmp(mode, "lookahead") == 0) {
+                limiter->mode = LIMITER_LOOKAHEAD;
+            } else if (strcmp(mode, "softclip") == 0) {
+                limiter->mode = LIMITER_SOFTCLIP;
+            } else if (strcmp(mode, "off") == 0) {
+                limiter->mode = LIMITER_OFF;
+            } else {
+                log_warn("Unknown limiter mode '%s', using lookahead", mode);
+            }
+        } else if (strcmp((char *) key->data.scalar.value, "ceiling_db") == 0) {
+            limiter->ceiling_db = atof((char *) value->data.scalar.value);
+        } else if (strcmp((char *) key->data.scalar.value, "lookahead_ms") == 0) {
+            limiter->lookahead_ms = atof((char *) value->data.scalar.value);
+        } else if (strcmp((char *) key->data.scalar.value, "release_ms") == 0) {
+            limiter->release_ms = atof((char *) value->data.scalar.value);
+        }
+    }
+}
+
+static void parse_filter(yaml_document_t *doc, const yaml_node_t *node, filter_config_t *filter) {
+    filter->type = FILTER_PEAKING;
+    filter->q = 0.707f;
+    filter->order = 4;
+    if (node->type != YAML_MAPPING_NODE) return;
+
+    for (const yaml_node_pair_t *pair = node->data.mapping.pairs.start; pair < node->data.mapping.pairs.top; pair++) {
+        const yaml_node_t *key = yaml_document_get_node(doc, pair->key);
+        const yaml_node_t *value = yaml_document_get_node(doc, pair->value);
+
+        if (strcmp((char *) key->data.scalar.value, "type") == 0) {
+            const char *type = (char *) value->data.scalar.value;
+            if (strcmp(type, "peaking") == 0) {
+                filter->type = FILTER_PEAKING;
+            } else if (strcmp(type, "lowshelf") == 0) {
+                filter->type = FILTER_LOWSHELF;
+            } else if (strcmp(type, "highshelf") == 0) {
+                filter->type = FILTER_HIGHSHELF;
+            } else if (strcmp(type, "lowpass") == 0) {
+                filter->type = FILTER_LOWPASS;
+            } else if (strcmp(type, "highpass") == 0) {
+                filter->type = FILTER_HIGHPASS;
+            } else if (strcmp(type, "lr_lowpass") == 0) {
+                filter->type = FILTER_LR_LOWPASS;
+            } else if (strcmp(type, "lr_highpass") == 0) {
+                filter->type = FILTER_LR_HIGHPASS;
+            } else {
+                log_warn("Unknown filter type '%s', using peaking", type);
+            }
+        } else if (strcmp((char *) key->data.scalar.value, "freq") == 0) {
+            filter->freq = atof((char *) value->data.scalar.value);
+        } else if (strcmp((char *) key->data.scalar.value, "q") == 0) {
+            filter->q = atof((char *) value->data.scalar.value);
+        } else if (strcmp((char *) key->data.scalar.value, "gain_db") == 0) {
+            filter->gain_db = atof((char *) value->data.scalar.value);
+        } else if (strcmp((char *) key->data.scalar.value, "order") == 0) {
+            filter->order = atoi((char *) value->data.scalar.value);
+        }
+    }
+}
+
+// Channel name -> list of filters
+static void parse_output_channels(yaml_document_t *doc, const yaml_node_t *node, output_stage_config_t *output) {
+    if (node->type != YAML_MAPPING_NODE) return;
+
+    output->channel_count = node->data.mapping.pairs.top - node->data.mapping.pairs.start;
+    output->channels = calloc(output->channel_count, sizeof(output_channel_config_t));
+    if (!output->channels) {
+        output->channel_count = 0;
+        return;
+    }
+
+    int channel_index = 0;
+    for (const yaml_node_pair_t *pair = node->data.mapping.pairs.start; pair < node->data.mapping.pairs.top; pair++) {
+        const yaml_node_t *key = yaml_document_get_node(doc, pair->key);
+        const yaml_node_t *value = yaml_document_get_node(doc, pair->value);
+        output_channel_config_t *channel = &output->channels[channel_index++];
+        channel->name = strdup((char *) key->data.scalar.value);
+        channel->delay_ms = -1.0f;
+        channel->delay_samples = -1;
+
+        // Either a plain list of filters or a mapping with "filters", "ir" and delays
+        const yaml_node_t *filters = value;
+        if (value->type == YAML_MAPPING_NODE) {
+            filters = NULL;
+            for (const yaml_node_pair_t *entry = value->data.mapping.pairs.start; entry < value->data.mapping.pairs.top; entry++) {
+                const yaml_node_t *entry_key = yaml_document_get_node(doc, entry->key);
+                const yaml_node_t *entry_value = yaml_document_get_node(doc, entry->value);
+                if (strcmp((char *) entry_key->data.scalar.value, "filters") == 0) {
+                    filters = entry_value;
+                } else if (strcmp((char *) entry_key->data.scalar.value, "ir") == 0) {
+                    channel->ir = strdup((char *) entry_value->data.scalar.value);
+                } else if (strcmp((char *) entry_key->data.scalar.value, "delay_ms") == 0) {
+                    channel->delay_ms = atof((char *) entry_value->data.scalar.value);
+                } else if (strcmp((char *) entry_key->data.scalar.value, "delay_samples") == 0) {
+                    channel->delay_samples = atoi((char *) entry_value->data.scalar.value);
+                }
+            }
+        }
+        if (!filters || filters->type != YAML_SEQUENCE_NODE) continue;
+
+        channel->filter_count = filters->data.sequence.items.top - filters->data.sequence.items.start;
+        channel->filters = calloc(channel->filter_count, sizeof(filter_config_t));
+        if (!channel->filters) {
+            channel->filter_count = 0;
+            continue;
+        }
+
+        int filter_index = 0;
+        for (const yaml_node_item_t *item = filters->data.sequence.items.start; item < filters->data.sequence.items.top; item++) {
+            parse_filter(doc, yaml_document_get_node(doc, *item), &channel->filters[filter_index++]);
+        }
+    }
+}
+
+static void parse_outputs(yaml_document_t *doc, const yaml_node_t *node, global_config_t *config) {
+    if (node->type != YAML_SEQUENCE_NODE) return;
+
+    config->output_count = node->data.sequence.items.top - node->data.sequence.items.start;
+    config->outputs = calloc(config->output_count, sizeof(output_stage_config_t));
+    if (!config->outputs) {
+        config->output_count = 0;
+        return;
+    }
+
+    int output_index = 0;
+    for (const yaml_node_item_t *item = node->data.sequence.items.start; item < node->data.sequence.items.top; item++) {
+        const yaml_node_t *output_node = yaml_document_get_node(doc, *item);
+        output_stage_config_t *output = &config->outputs[output_index++];
+        output->limiter.ceiling_db = -1.0f;
+        output->limiter.lookahead_ms = 1.5f;
+        output->limiter.release_ms = 50.0f;
+        output->fir_partition = 256;
+        output->max_delay_ms = 50.0f;
+        if (output_node->type != YAML_MAPPING_NODE) continue;
+
+        for (const yaml_node_pair_t *pair = output_node->data.mapping.pairs.start; pair < output_node->data.mapping.pairs.top; pair++) {
+            const yaml_node_t *key = yaml_document_get_node(doc, pair->key);
+            const yaml_node_t *value = yaml_document_get_node(doc, pair->value);
+
+            if (strcmp((char *) key->data.scalar.value, "device") == 0) {
+                output->device = strdup((char *) value->data.scalar.value);
+            } else if (strcmp((char *) key->data.scalar.value, "limiter") == 0) {
+                parse_limiter(doc, value, &output->limiter);
+            } else if (strcmp((char *) key->data.scalar.value, "channels") == 0) {
+                parse_output_channels(doc, value, output);
+            } else if (strcmp((char *) key->data.scalar.value, "fir_partition") == 0) {
+                output->fir_partition = atoi((char *) value->data.scalar.value);
+            } else if (strcmp((char *) key->data.scalar.value, "max_delay_ms") == 0) {
+                output->max_delay_ms = atof((char *) value->data.scalar.value);
+            }
+        }
+    }
+}
+
+static void parse_show(yaml_document_t *doc, const yaml_node_t *node, global_config_t *config) {
+    if (node->type != YAML_MAPPING_NODE) return;
+
+    for (const yaml_node_pair_t *pair = node->data.mapping.pairs.start; pair < node->data.mapping.pairs.top; pair++) {
+        const yaml_node_t *key = yaml_document_get_node(doc, pair->key);
+        const yaml_node_t *value = yaml_document_get_node(doc, pair->value);
+
+        if (strcmp((char *) key->data.scalar.value, "preroll_ms") == 0) {
+            config->show.preroll_ms = atoi((char *) value->data.scalar.value);
+        }
+    }
+}
+
+static void parse_sync(yaml_document_t *doc, const yaml_node_t *node, global_config_t *config) {
+    if (node->type != YAML_MAPPING_NODE) return;
+
+    for (const yaml_node_pair_t *pair = node->data.mapping.pairs.start; pair < node->data.mapping.pairs.top; pair++) {
+        const yaml_node_t *key = yaml_document_get_node(doc, pair->key);
+        const yaml_node_t *value = yaml_document_get_node(doc, pair->value);
+
+        if (strcmp((char *) key->data.scalar.value, "role") == 0) {
+            const char *role = (char *) value->data.scalar.value;
+            if (strcmp(role, "leader") == 0) {
+                config->sync.role = SYNC_LEADER;
+            } else if (strcmp(role, "follower") == 0) {
+                config->sync.role = SYNC_FOLLOWER;
+            } else if (strcmp(role, "off") == 0) {
+                config->sync.role = SYNC_OFF;
+            } else {
+                log_warn("Unknown sync role '%s', sync is off", role);
+                config->sync.role = SYNC_OFF;
+            }
+        } else if (strcmp((char *) key->data.scalar.value, "name") == 0) {
+            free(config->sync.name);
+            config->sync.name = strdup((char *) value->data.scalar.value);
+        } else if (strcmp((char *) key->data.scalar.value, "leader") == 0) {
+            free(config->sync.leader);
+            config->sync.leader = strdup((char *) value->data.scalar.value);
+        } else if (strcmp((char *) key->data.scalar.value, "port") == 0) {
+            config->sync.port = atoi((char *) value->data.scalar.value);
+        } else if (strcmp((char *) key->data.scalar.value, "interval_ms") == 0) {
+            config->sync.interval_ms = atoi((char *) value->data.scalar.value);
+        }
+    }
+}
+
+static void parse_clock(yaml_document_t *doc, const yaml_node_t *node, global_config_t *config) {
+    if (node->type != YAML_MAPPING_NODE) return;
+
+    for (const yaml_node_pair_t *pair = node->data.mapping.pairs.start; pair < node->data.mapping.pairs.top; pair++) {
+        const yaml_node_t *key = yaml_document_get_node(doc, pair->key);
+        const yaml_node_t *value = yaml_document_get_node(doc, pair->value);
+
+        if (strcmp((char *) key->data.scalar.value, "compensate") == 0) {
+            config->clock.compensate = strcmp((char *) value->data.scalar.value, "true") == 0;
+        } else if (strcmp((char *) key->data.scalar.value, "reference") == 0) {
+            free(config->clock.reference);
+            config->clock.reference = strdup((char *) value->data.scalar.value);
+        } else if (strcmp((char *) key->data.scalar.value, "bandwidth_hz") == 0) {
+            config->clock.bandwidth_hz = atof((char *) value->data.scalar.value);
+        } else if (strcmp((char *) key->data.scalar.value, "max_ppm") == 0) {
+            config->clock.max_ppm = atof((char *) value->data.scalar.value);
+        }
+    }
+}
+
+static void parse_reconnect(yaml_document_t *doc, const yaml_node_t *node, global_config_t *config) {
+    if (node->type != YAML_MAPPING_NODE) return;
+
+    for (const yaml_node_pair_t *pair = node->data.mapping.pairs.start; pair < node->data.mapping.pairs.top; pair++) {
+        const yaml_node_t *key = yaml_document_get_node(doc, pair->key);
+        const yaml_node_t *value = yaml_document_get_node(doc, pair->value);
+
+        if (strcmp((char *) key->data.scalar.value, "enabled") == 0) {
+            config->reconnect.enabled = strcmp((char *) value->data.scalar.value, "true") == 0;
+        } else if (strcmp((char *) key->data.scalar.value, "resume") == 0) {
+            const resume_mode_t resume = parse_resume_mode((char *) value->data.scalar.value);
+            if (resume != RESUME_DEFAULT) {
+                config->reconnect.resume = resume;
+            }
+        } else if (strcmp((char *) key->data.scalar.value, "initial_backoff_ms") == 0) {
+            config->reconnect.initial_backoff_ms = atoi((char *) value->data.scalar.value);
+        } else if (strcmp((char *) key->data.scalar.value, "max_backoff_ms") == 0) {
+            config->reconnect.max_backoff_ms = atoi((char *) value->data.scalar.value);
+        }
+    }
+}
+
+static void parse_triggers(yaml_document_t *doc, const yaml_node_t *node, global_config_t *config) {
+    if (node->type != YAML_MAPPING_NODE) return;
+
+    for (const yaml_node_pair_t *pair = node->data.mapping.pairs.start; pair < node->data.mapping.pairs.top; pair++) {
+        const yaml_node_t *key = yaml_document_get_node(doc, pair->key);
+        const yaml_node_t *value = yaml_document_get_node(doc, pair->value);
+
+        if (strcmp((char *) key->data.scalar.value, "enabled") == 0) {
+            config->triggers.enabled = strcmp((char *) value->data.scalar.value, "true") == 0;
+        } else if (strcmp((char *) key->data.scalar.value, "period_us") == 0) {
+            config->triggers.period_us = atoi((char *) value->data.scalar.value);
+        }
+    }
+}
+
+static void parse_osc(yaml_document_t *doc, const yaml_node_t *node, global_config_t *config) {
+    if (node->type != YAML_MAPPING_NODE) return;
+
+    for (const yaml_node_pair_t *pair = node->data.mapping.pairs.start; pair < node->data.mapping.pairs.top; pair++) {
+        const yaml_node_t *key = yaml_document_get_node(doc, pair->key);
+        const yaml_node_t *value = yaml_document_get_node(doc, pair->value);
+
+        if (strcmp((char *) key->data.scalar.value, "enabled") == 0) {
+            config->osc.enabled = strcmp((char *) value->data.scalar.value, "true") == 0;
+        } else if (strcmp((char *) key->data.scalar.value, "bind") == 0) {
+            free(config->osc.bind);
+            config->osc.bind = strdup((char *) value->data.scalar.value);
+        } else if (strcmp((char *) key->data.scalar.value, "port") == 0) {
+            config->osc.port = atoi((char *) value->data.scalar.value);
+        } else if (strcmp((char *) key->data.scalar.value, "reply") == 0) {
+            config->osc.reply = strcmp((char *) value->data.scalar.value, "true") == 0;
+        }
+    }
+}
+
+// Note, controller or program number, "any" for all
+static int parse_midi_number(const char *value) {
+    return strcmp(value, "any") == 0 ? -1 : atoi(value);
+}
+
+static void parse_midi_mappings(yaml_document_t *doc, const yaml_node_t *node, global_config_t *config) {
+    if (node->type != YAML_SEQUENCE_NODE) return;
+
+    config->midi.mapping_count = node->data.sequence.items.top - node->data.sequence.items.start;
+    config->midi.mappings = calloc(config->midi.mapping_count, sizeof(midi_mapping_t));
+    if (!config->midi.mappings) {
+        config->midi.mapping_count = 0;
+        return;
+    }
+
+    int i = 0;
+    for (const yaml_node_item_t *item = node->data.sequence.items.start; item < node->data.sequence.items.top; item++) {
+        const yaml_node_t *mapping_node = yaml_document_get_node(doc, *item);
+        midi_mapping_t *mapping = &config->midi.mappings[i++];
+        mapping->gain = 1.0f;
+        mapping->number = -1;
+        if (mapping_node->type != YAML_MAPPING_NODE) continue;
+
+        for (const yaml_node_pair_t *pair = mapping_node->data.mapping.pairs.start; pair < mapping_node->data.mapping.pairs.top; pair++) {
+            const yaml_node_t *key = yaml_document_get_node(doc, pair->key);
+            const yaml_node_t *value = yaml_document_get_node(doc, pair->value);
+            const char *name = (char *) key->data.scalar.value;
+            const char *text = (char *) value->data.scalar.value;
+
+            if (strcmp(name, "note_on") == 0) {
+                mapping->event = MIDI_EVENT_NOTE_ON;
+                mapping->number = parse_midi_number(text);
+            } else if (strcmp(name, "note_off") == 0) {
+                mapping->event = MIDI_EVENT_NOTE_OFF;
+                mapping->number = parse_midi_number(text);
+            } else if (strcmp(name, "cc") == 0) {
+                mapping->event = MIDI_EVENT_CC;
+                mapping->number = parse_midi_number(text);
+            } else if (strcmp(name, "program") == 0) {
+                mapping->event = MIDI_EVENT_PROGRAM;
+                mapping->number = parse_midi_number(text);
+            } else if (strcmp(name, "channel") == 0) {
+                mapping->channel = atoi(text);
+            } else if (strcmp(name, "action") == 0) {
+                if (strcmp(text, "play") == 0) {
+                    mapping->action = MIDI_ACTION_PLAY;
+                } else if (strcmp(text, "stop") == 0) {
+                    mapping->action = MIDI_ACTION_STOP;
+                } else if (strcmp(text, "volume") == 0) {
+                    mapping->action = MIDI_ACTION_VOLUME;
+                } else if (strcmp(text, "go") == 0) {
+                    mapping->action = MIDI_ACTION_GO;
+                } else if (strcmp(text, "goto") == 0) {
+                    mapping->action = MIDI_ACTION_GOTO;
+                } else {
+                    log_warn("Unknown MIDI action '%s'", text);
+                }
+            } else if (strcmp(name, "track") == 0 || strcmp(name, "cue") == 0) {
+                free(mapping->target);
+                mapping->target = strdup(text);
+            } else if (strcmp(name, "gain") == 0) {
+                mapping->gain = atof(text);
+            }
+        }
+    }
+}
+
+static void parse_midi(yaml_document_t *doc, const yaml_node_t *node, global_config_t *config) {
+    if (node->type != YAML_MAPPING_NODE) return;
+
+    for (const yaml_node_pair_t *pair = node->data.mapping.pairs.start; pair < node->data.mapping.pairs.top; pair++) {
+        const yaml_node_t *key = yaml_document_get_node(doc, pair->key);
+        const yaml_node_t *value = yaml_document_get_node(doc, pair->value);
+
+        if (strcmp((char *) key->data.scalar.value, "enabled") == 0) {
+            config->midi.enabled = strcmp((char *) value->data.scalar.value, "true") == 0;
+        } else if (strcmp((char *) key->data.scalar.value, "name") == 0) {
+            free(config->midi.name);
+            config->midi.name = strdup((char *) value->data.scalar.value);
+        } else if (strcmp((char *) key->data.scalar.value, "latency_ms") == 0) {
+            config->midi.latency_ms = atoi((char *) value->data.scalar.value);
+        } else if (strcmp((char *) key->data.scalar.value, "map") == 0) {
+            parse_midi_mappings(doc, value, config);
+        }
+    }
+}
+
+static void parse_cue_actions(yaml_document_t *doc, const yaml_node_t *node, cue_config_t *cue) {
+    if (node->type != YAML_SEQUENCE_NODE) return;
+
+    cue->action_count = node->data.sequence.items.top - node->data.sequence.items.start;
+    cue->actions = calloc(cue->action_count, sizeof(cue_action_t));
+    if (!cue->actions) {
+        cue->action_count = 0;
+        return;
+    }
+
+    int i = 0;
+    for (const yaml_node_item_t *item = node->data.sequence.items.start; item < node->data.sequence.items.top; item++) {
+        const yaml_node_t *action_node = yaml_document_get_node(doc, *item);
+        cue_action_t *action = &cue->actions[i++];
+        if (action_node->type != YAML_MAPPING_NODE) continue;
+
+        for (const yaml_node_pair_t *pair = action_node->data.mapping.pairs.start; pair < action_node->data.mapping.pairs.top; pair++) {
+            const yaml_node_t *key = yaml_document_get_node(doc, pair->key);
+            const yaml_node_t *value = yaml_document_get_node(doc, pair->value);
+
+            if (strcmp((char *) key->data.scalar.value, "action") == 0) {
+                const char *type = (char *) value->data.scalar.value;
+                if (strcmp(type, "play") == 0) {
+                    action->type = CUE_ACTION_PLAY;
+                } else if (strcmp(type, "stop") == 0) {
+                    action->type = CUE_ACTION_STOP;
+                } else if (strcmp(type, "volume") == 0) {
+                    action->type = CUE_ACTION_VOLUME;
+                } else if (strcmp(type, "pan") == 0) {
+                    action->type = CUE_ACTION_PAN;
+                } else {
+                    log_warn("Unknown cue action '%s' in cue %s", type, cue->id ? cue->id : "?");
+                }
+            } else if (strcmp((char *) key->data.scalar.value, "track") == 0) {
+                action->track = strdup((char *) value->data.scalar.value);
+            } else if (strcmp((char *) key->data.scalar.value, "at") == 0) {
+                action->at = atof((char *) value->data.scalar.value);
+            } else if (strcmp((char *) key->data.scalar.value, "value") == 0) {
+                action->value = atof((char *) value->data.scalar.value);
+            } else if (strcmp((char *) key->data.scalar.value, "duration") == 0) {
+                action->duration = atof((char *) value->data.scalar.value);
+            }
+        }
+
+        // Pan targets use the same x/y or azimuth/distance keys as track positions
+        parse_position(doc, action_node, &action->x, &action->y);
+    }
+}
+
+static void parse_cues(yaml_document_t *doc, const yaml_node_t *node, global_config_t *config) {
+    if (node->type != YAML_SEQUENCE_NODE) return;
+
+    config->cue_count = node->data.sequence.items.top - node->data.sequence.items.start;
+    config->cues = calloc(config->cue_count, sizeof(cue_config_t));
+    if (!config->cues) {
+        config->cue_count = 0;
+        return;
+    }
+
+    int cue_index = 0;
+    for (const yaml_node_item_t *item = node->data.sequence.items.start; item < node->data.sequence.items.top; item++) {
+        const yaml_node_t *cue_node = yaml_document_get_node(doc, *item);
+        cue_config_t *cue = &config->cues[cue_index++];
+        if (cue_node->type != YAML_MAPPING_NODE) continue;
+
+        for (const yaml_node_pair_t *pair = cue_node->data.mapping.pairs.start; pair < cue_node->data.mapping.pairs.top; pair++) {
+            const yaml_node_t *key = yaml_document_get_node(doc, pair->key);
+            const yaml_node_t *value = yaml_document_get_node(doc, pair->value);
+
+            if (strcmp((char *) key->data.scalar.value, "id") == 0) {
+                cue->id = strdup((char *) value->data.scalar.value);
+            } else if (strcmp((char *) key->data.scalar.value, "actions") == 0) {
+                parse_cue_actions(doc, value, cue);
+            }
+        }
+    }
+}
+
 global_config_t *config_load(const char *filename) {
     FILE *file = fopen(filename, "r");
     if (!file) {
@@ -98,6 +857,12 @@ global_config_t *config_load(const char *filename) {
     }
 
     global_config_t *config = calloc(1, sizeof(global_config_t));
+    config->memory.lock = true;
+    config->reconnect.enabled = true;
+    config->reconnect.resume = RESUME_FROZEN;
+    config->reconnect.initial_backoff_ms = 250;
+    config->reconnect.max_backoff_ms = 8000;
+
     yaml_node_t *root = yaml_document_get_root_node(&document);
 
     if (root && root->type == YAML_MAPPING_NODE) {
@@ -108,6 +873,36 @@ global_config_t *config_load(const char *filename) {
 
             if (strcmp((char *) key->data.scalar.value, "logging") == 0) {
                 parse_logging(&document, value, config);
+            } else if (strcmp((char *) key->data.scalar.value, "cache") == 0) {
+                parse_cache(&document, value, config);
+            } else if (strcmp((char *) key->data.scalar.value, "preload") == 0) {
+                parse_preload(&document, value, config);
+            } else if (strcmp((char *) key->data.scalar.value, "sample_cache") == 0) {
+                parse_sample_cache(&document, value, config);
+            } else if (strcmp((char *) key->data.scalar.value, "memory") == 0) {
+                parse_memory(&document, value, config);
+            } else if (strcmp((char *) key->data.scalar.value, "threads") == 0) {
+                parse_threads(&document, value, config);
+            } else if (strcmp((char *) key->data.scalar.value, "show") == 0) {
+                parse_show(&document, value, config);
+            } else if (strcmp((char *) key->data.scalar.value, "sync") == 0) {
+                parse_sync(&document, value, config);
+            } else if (strcmp((char *) key->data.scalar.value, "clock") == 0) {
+                parse_clock(&document, value, config);
+            } else if (strcmp((char *) key->data.scalar.value, "reconnect") == 0) {
+                parse_reconnect(&document, value, config);
+            } else if (strcmp((char *) key->data.scalar.value, "triggers") == 0) {
+                parse_triggers(&document, value, config);
+            } else if (strcmp((char *) key->data.scalar.value, "osc") == 0) {
+                parse_osc(&document, value, config);
+            } else if (strcmp((char *) key->data.scalar.value, "midi") == 0) {
+                parse_midi(&document, value, config);
+            } else if (strcmp((char *) key->data.scalar.value, "cues") == 0) {
+                parse_cues(&document, value, config);
+            } else if (strcmp((char *) key->data.scalar.value, "buses") == 0) {
+                parse_buses(&document, value, config);
+            } else if (strcmp((char *) key->data.scalar.value, "outputs") == 0) {
+                parse_outputs(&document, value, config);
             } else if (strcmp((char *) key->data.scalar.value, "tracks") == 0) {
                 parse_tracks(&document, value, config);
             }
@@ -127,11 +922,29 @@ void config_free(global_config_t *config) {
     // Free logging config
     free(config->logging.level);
 
+    // Free cache config
+    free(config->cache.directory);
+    free(config->clock.reference);
+    free(config->sync.name);
+    free(config->sync.leader);
+    free(config->osc.bind);
+    free(config->midi.name);
+    for (int i = 0; i < config->midi.mapping_count; i++) {
+        free(config->midi.mappings[i].target);
+    }
+    free(config->midi.mappings);
+
+    // Free thread config
+    free(config->threads.data_loop.cpus);
+    free(config->threads.workers.cpus);
+    free(config->threads.control.cpus);
+
     // Free tracks
     for (int i = 0; i < config->track_count; i++) {
         const track_config_t *track = &config->tracks[i];
         free(track->id);
         free(track->file_path);
+        free(track->bus);
         free(track->output.device);
 
         // Free each mapping string
@@ -142,6 +955,46 @@ void config_free(global_config_t *config) {
     }
     free(config->tracks);
 
+    // Free buses
+    for (int i = 0; i < config->bus_count; i++) {
+        const bus_config_t *bus = &config->buses[i];
+        free(bus->id);
+        for (int j = 0; j < bus->panner.speaker_count; j++) {
+            free(bus->panner.speakers[j].name);
+        }
+        free(bus->panner.speakers);
+        free(bus->output.device);
+        for (int j = 0; j < bus->output.mapping_count; j++) {
+            free(bus->output.mapping[j]);
+        }
+        free(bus->output.mapping);
+    }
+    free(config->buses);
+
+    // Free output stages
+    for (int i = 0; i < config->output_count; i++) {
+        const output_stage_config_t *output = &config->outputs[i];
+        free(output->device);
+        for (int j = 0; j < output->channel_count; j++) {
+            free(output->channels[j].name);
+            free(output->channels[j].filters);
+            free(output->channels[j].ir);
+        }
+        free(output->channels);
+    }
+    free(config->outputs);
+
+    // Free cues
+    for (int i = 0; i < config->cue_count; i++) {
+        const cue_config_t *cue = &config->cues[i];
+        free(cue->id);
+        for (int j = 0; j < cue->action_count; j++) {
+            free(cue->actions[j].track);
+        }
+        free(cue->actions);
+    }
+    free(config->cues);
+
     free(config);
 }
 
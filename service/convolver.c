@@ -0,0 +1,335 @@
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "convolver.h"
+#include "arena.h"
+#include "dsp.h"
+#include "fft.h"
+#include "log.h"
+#include "thread_policy.h"
+
+// Overlap-save state of one channel. Each partition of the impulse response is transformed once
+// at creation; every block then costs one forward FFT, a multiply-accumulate across the
+// frequency-domain delay line and one inverse FFT.
+typedef struct {
+    int partitions;         // 0 passes the channel through
+    float *ir_re;           // partitions x bins, scaled by 1 / N
+    float *ir_im;
+    float *fdl_re;          // Input spectra of the last partitions blocks
+    float *fdl_im;
+    int fdl_pos;            // Slot of the newest spectrum
+    float *history;         // Last 2 x partition input samples
+} fir_channel_t;
+
+struct convolver {
+    int channels;
+    uint32_t partition;
+    size_t bins;
+    fir_channel_t *fir;
+    int fir_channels;
+
+    // Worker scratch
+    fft_t *fft;
+    float *time;
+    float *acc_re;
+    float *acc_im;
+
+    // Interleaved blocks, CONVOLVER_RING_BLOCKS x partition x channels each
+    float *in_ring;
+    float *out_ring;
+
+    // Data thread position; the delay is fixed on the first call so it covers a whole quantum
+    uint64_t frames;
+    uint32_t delay_blocks;
+    uint64_t late_block;
+    _Atomic uint32_t latency;
+
+    _Atomic uint64_t published;     // Input blocks handed to the worker
+    _Atomic uint64_t completed;     // Output blocks ready to play
+    sem_t wake;
+    pthread_t thread;
+    bool started;
+    _Atomic bool stop;
+
+    // Worker cost per block and blocks that were not ready in time
+    _Atomic uint64_t blocks;
+    _Atomic uint64_t cost_total_ns;
+    _Atomic uint64_t cost_peak_ns;
+    _Atomic uint64_t late;
+};
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+// acc += x * h over all bins (complex, split arrays)
+DSP_VECTORIZE
+static void multiply_accumulate(float *restrict acc_re, float *restrict acc_im, const float *restrict x_re,
+                                const float *restrict x_im, const float *restrict h_re, const float *restrict h_im,
+                                size_t bins) {
+    for (size_t k = 0; k < bins; k++) {
+        acc_re[k] += x_re[k] * h_re[k] - x_im[k] * h_im[k];
+        acc_im[k] += x_re[k] * h_im[k] + x_im[k] * h_re[k];
+    }
+}
+
+static void convolve_block(convolver_t *convolver, uint64_t block) {
+    const int channels = convolver->channels;
+    const uint32_t partition = convolver->partition;
+    const size_t bins = convolver->bins;
+    const size_t slot = (size_t) (block % CONVOLVER_RING_BLOCKS) * partition * channels;
+    const float *in = convolver->in_ring + slot;
+    float *out = convolver->out_ring + slot;
+
+    for (int ch = 0; ch < channels; ch++) {
+        fir_channel_t *fir = &convolver->fir[ch];
+        if (fir->partitions == 0) {
+            for (uint32_t i = 0; i < partition; i++) {
+                out[(size_t) i * channels + ch] = in[(size_t) i * channels + ch];
+            }
+            continue;
+        }
+
+        memmove(fir->history, fir->history + partition, partition * sizeof(float));
+        for (uint32_t i = 0; i < partition; i++) {
+            fir->history[partition + i] = in[(size_t) i * channels + ch];
+        }
+
+        fir->fdl_pos = (fir->fdl_pos + fir->partitions - 1) % fir->partitions;
+        fft_forward(convolver->fft, fir->history, fir->fdl_re + fir->fdl_pos * bins,
+                    fir->fdl_im + fir->fdl_pos * bins);
+
+        // Partition p of the response meets the input spectrum from p blocks ago
+        memset(convolver->acc_re, 0, bins * sizeof(float));
+        memset(convolver->acc_im, 0, bins * sizeof(float));
+        for (int p = 0; p < fir->partitions; p++) {
+            const size_t x = (size_t) ((fir->fdl_pos + p) % fir->partitions) * bins;
+            const size_t h = (size_t) p * bins;
+            multiply_accumulate(convolver->acc_re, convolver->acc_im, fir->fdl_re + x, fir->fdl_im + x,
+                                fir->ir_re + h, fir->ir_im + h, bins);
+        }
+
+        // The second half of the circular result is the valid linear convolution
+        fft_inverse(convolver->fft, convolver->acc_re, convolver->acc_im, convolver->time);
+        for (uint32_t i = 0; i < partition; i++) {
+            out[(size_t) i * channels + ch] = convolver->time[partition + i];
+        }
+    }
+}
+
+static void *worker_thread(void *arg) {
+    convolver_t *convolver = arg;
+    thread_policy_apply(THREAD_ROLE_DATA);
+
+    uint64_t next = 0;
+    while (!atomic_load(&convolver->stop)) {
+        if (sem_wait(&convolver->wake) != 0) continue;
+
+        const uint64_t published = atomic_load_explicit(&convolver->published, memory_order_acquire);
+
+        // Too far behind to catch up: the ring has been overwritten, resume at the newest block
+        if (published - next >= CONVOLVER_RING_BLOCKS) {
+            next = published - 1;
+        }
+
+        while (next < published && !atomic_load(&convolver->stop)) {
+            const uint64_t begin = monotonic_ns();
+            convolve_block(convolver, next);
+            const uint64_t cost = monotonic_ns() - begin;
+
+            atomic_store_explicit(&convolver->completed, ++next, memory_order_release);
+            atomic_fetch_add_explicit(&convolver->blocks, 1, memory_order_relaxed);
+            atomic_fetch_add_explicit(&convolver->cost_total_ns, cost, memory_order_relaxed);
+            if (cost > atomic_load_explicit(&convolver->cost_peak_ns, memory_order_relaxed)) {
+                atomic_store_explicit(&convolver->cost_peak_ns, cost, memory_order_relaxed);
+            }
+        }
+    }
+    return NULL;
+}
+
+static bool init_channel(convolver_t *convolver, fir_channel_t *fir, const float *ir, size_t length) {
+    const uint32_t partition = convolver->partition;
+    const size_t bins = convolver->bins;
+    const size_t size = fft_size(convolver->fft);
+
+    fir->partitions = (int) ((length + partition - 1) / partition);
+    fir->ir_re = arena_calloc((size_t) fir->partitions * bins, sizeof(float));
+    fir->ir_im = arena_calloc((size_t) fir->partitions * bins, sizeof(float));
+    fir->fdl_re = arena_calloc((size_t) fir->partitions * bins, sizeof(float));
+    fir->fdl_im = arena_calloc((size_t) fir->partitions * bins, sizeof(float));
+    fir->history = arena_calloc(size, sizeof(float));
+    if (!fir->ir_re || !fir->ir_im || !fir->fdl_re || !fir->fdl_im || !fir->history) return false;
+
+    // Each partition zero-padded to the FFT size, with the inverse transform's scaling folded in
+    const float scale = 1.0f / (float) size;
+    for (int p = 0; p < fir->partitions; p++) {
+        memset(convolver->time, 0, size * sizeof(float));
+        const size_t start = (size_t) p * partition;
+        const size_t count = length - start < partition ? length - start : partition;
+        for (size_t i = 0; i < count; i++) {
+            convolver->time[i] = ir[start + i] * scale;
+        }
+        fft_forward(convolver->fft, convolver->time, fir->ir_re + p * bins, fir->ir_im + p * bins);
+    }
+    return true;
+}
+
+convolver_t *convolver_create(const float *const *irs, const size_t *lengths, int channels, uint32_t partition) {
+    if (!irs || !lengths || channels <= 0 || partition < 16 || (partition & (partition - 1)) != 0) return NULL;
+
+    convolver_t *convolver = arena_calloc(1, sizeof(convolver_t));
+    if (!convolver) return NULL;
+
+    convolver->channels = channels;
+    convolver->partition = partition;
+    convolver->bins = partition + 1;
+    atomic_init(&convolver->latency, 0);
+    atomic_init(&convolver->published, 0);
+    atomic_init(&convolver->completed, 0);
+    atomic_init(&convolver->stop, false);
+    atomic_init(&convolver->blocks, 0);
+    atomic_init(&convolver->cost_total_ns, 0);
+    atomic_init(&convolver->cost_peak_ns, 0);
+    atomic_init(&convolver->late, 0);
+    convolver->late_block = UINT64_MAX;
+
+    const size_t ring = (size_t) CONVOLVER_RING_BLOCKS * partition * channels;
+    convolver->fft = fft_create(2 * (size_t) partition);
+    convolver->time = arena_calloc(2 * (size_t) partition, sizeof(float));
+    convolver->acc_re = arena_calloc(convolver->bins, sizeof(float));
+    convolver->acc_im = arena_calloc(convolver->bins, sizeof(float));
+    convolver->in_ring = arena_calloc(ring, sizeof(float));
+    convolver->out_ring = arena_calloc(ring, sizeof(float));
+    convolver->fir = arena_calloc(channels, sizeof(fir_channel_t));
+    bool ok = convolver->fft && convolver->time && convolver->acc_re && convolver->acc_im && convolver->in_ring &&
+              convolver->out_ring && convolver->fir;
+
+    for (int ch = 0; ok && ch < channels; ch++) {
+        if (!irs[ch] || lengths[ch] == 0) continue;
+        ok = init_channel(convolver, &convolver->fir[ch], irs[ch], lengths[ch]);
+        convolver->fir_channels++;
+    }
+    if (!ok) {
+        log_error("Failed to allocate convolver for %d channels", channels);
+        convolver_destroy(convolver);
+        return NULL;
+    }
+
+    if (sem_init(&convolver->wake, 0, 0) != 0 ||
+        pthread_create(&convolver->thread, NULL, worker_thread, convolver) != 0) {
+        log_error("Failed to start convolver worker");
+        convolver_destroy(convolver);
+        return NULL;
+    }
+    convolver->started = true;
+    return convolver;
+}
+
+void convolver_process(convolver_t *convolver, float *samples, size_t n_frames) {
+    if (!convolver || n_frames == 0) return;
+
+    const int channels = convolver->channels;
+    const uint32_t partition = convolver->partition;
+    const size_t stride = (size_t) partition * channels;
+
+    // Results of a block are played once the blocks of one more quantum have been handed over,
+    // which gives the worker a full quantum to compute them
+    if (convolver->delay_blocks == 0) {
+        uint32_t blocks = (uint32_t) ((n_frames + partition - 1) / partition) + 1;
+        if (blocks > CONVOLVER_RING_BLOCKS - 2) blocks = CONVOLVER_RING_BLOCKS - 2;
+        convolver->delay_blocks = blocks;
+        atomic_store_explicit(&convolver->latency, blocks * partition, memory_order_relaxed);
+    }
+
+    size_t done = 0;
+    while (done < n_frames) {
+        const uint64_t block = convolver->frames / partition;
+        const size_t offset = (size_t) (convolver->frames % partition);
+        const size_t remaining = n_frames - done;
+        const size_t chunk = partition - offset < remaining ? partition - offset : remaining;
+        const size_t bytes = chunk * channels * sizeof(float);
+        float *frames = samples + done * channels;
+
+        memcpy(convolver->in_ring + (block % CONVOLVER_RING_BLOCKS) * stride + offset * channels, frames, bytes);
+
+        const uint64_t ready = atomic_load_explicit(&convolver->completed, memory_order_acquire);
+        if (block < convolver->delay_blocks) {
+            memset(frames, 0, bytes);
+        } else if (block - convolver->delay_blocks < ready) {
+            const uint64_t source = block - convolver->delay_blocks;
+            memcpy(frames, convolver->out_ring + (source % CONVOLVER_RING_BLOCKS) * stride + offset * channels,
+                   bytes);
+        } else {
+            memset(frames, 0, bytes);
+            if (convolver->late_block != block) {
+                convolver->late_block = block;
+                atomic_fetch_add_explicit(&convolver->late, 1, memory_order_relaxed);
+            }
+        }
+
+        convolver->frames += chunk;
+        done += chunk;
+        if (convolver->frames % partition == 0) {
+            atomic_store_explicit(&convolver->published, block + 1, memory_order_release);
+            sem_post(&convolver->wake);
+        }
+    }
+}
+
+uint32_t convolver_latency(const convolver_t *convolver) {
+    return convolver ? atomic_load_explicit(&convolver->latency, memory_order_relaxed) : 0;
+}
+
+int convolver_format_status(const convolver_t *convolver, int samplerate, char *buffer, size_t size) {
+    if (!convolver) return 0;
+
+    const uint64_t blocks = atomic_load(&convolver->blocks);
+    const double avg_us = blocks ? atomic_load(&convolver->cost_total_ns) / (double) blocks / 1000.0 : 0.0;
+    const double peak_us = atomic_load(&convolver->cost_peak_ns) / 1000.0;
+    const double block_us = convolver->partition * 1e6 / samplerate;
+    const int fir_channels = convolver->fir_channels > 0 ? convolver->fir_channels : 1;
+    const uint32_t latency = convolver_latency(convolver);
+
+    return snprintf(buffer, size,
+                    "fir %d channels, partition %u, latency %u frames (%.2f ms), %.1f us/channel/block "
+                    "(peak %.1f us), worker %.1f%% of real time, late %llu",
+                    convolver->fir_channels, convolver->partition, latency, latency * 1000.0 / samplerate,
+                    avg_us / fir_channels, peak_us / fir_channels, block_us > 0.0 ? avg_us / block_us * 100.0 : 0.0,
+                    (unsigned long long) atomic_load(&convolver->late));
+}
+
+void convolver_destroy(convolver_t *convolver) {
+    if (!convolver) return;
+
+    if (convolver->started) {
+        atomic_store(&convolver->stop, true);
+        sem_post(&convolver->wake);
+        pthread_join(convolver->thread, NULL);
+        sem_destroy(&convolver->wake);
+    }
+
+    for (int ch = 0; convolver->fir && ch < convolver->channels; ch++) {
+        fir_channel_t *fir = &convolver->fir[ch];
+        arena_free(fir->ir_re);
+        arena_free(fir->ir_im);
+        arena_free(fir->fdl_re);
+        arena_free(fir->fdl_im);
+        arena_free(fir->history);
+    }
+    arena_free(convolver->fir);
+    fft_destroy(convolver->fft);
+    arena_free(convolver->time);
+    arena_free(convolver->acc_re);
+    arena_free(convolver->acc_im);
+    arena_free(convolver->in_ring);
+    arena_free(convolver->out_ring);
+    arena_free(convolver);
+}
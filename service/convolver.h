@@ -0,0 +1,28 @@
+#ifndef ASYNC_AUDIO_PLAYER_CONVOLVER_H
+#define ASYNC_AUDIO_PLAYER_CONVOLVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CONVOLVER_RING_BLOCKS 16    // Blocks in flight between the data thread and the worker
+
+// Uniformly partitioned FFT convolution of each channel with its own impulse response. The FFTs run
+// on a worker thread; the data thread hands over full blocks and plays results a fixed latency later.
+typedef struct convolver convolver_t;
+
+// irs[ch] holds lengths[ch] samples; a NULL entry passes the channel through with the same latency
+convolver_t *convolver_create(const float *const *irs, const size_t *lengths, int channels, uint32_t partition);
+
+// Feed one interleaved block and replace it with the delayed, convolved output (data thread)
+void convolver_process(convolver_t *convolver, float *samples, size_t n_frames);
+
+// Added delay in frames, fixed by the first quantum; 0 before audio has run
+uint32_t convolver_latency(const convolver_t *convolver);
+
+// Format channels, latency, worker CPU time per channel and late blocks
+int convolver_format_status(const convolver_t *convolver, int samplerate, char *buffer, size_t size);
+
+// Stop the worker and free everything
+void convolver_destroy(convolver_t *convolver);
+
+#endif // ASYNC_AUDIO_PLAYER_CONVOLVER_H
@@ -0,0 +1,179 @@
+#include <math.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include "delay.h"
+#include "arena.h"
+#include "log.h"
+
+#define DELAY_BLOCK 256     // Frames written per pass; the ring holds this much beyond the longest delay
+
+typedef struct {
+    char name[32];
+    bool configured;        // Has a delay entry; others stay at zero
+    uint32_t current;       // Tap in frames, data thread
+    uint32_t previous;      // Tap being faded out
+    uint32_t fade_pos;      // fade_frames when no crossfade is running
+    _Atomic uint32_t target;
+} delay_line_t;
+
+// One interleaved ring shared by all channels, each reading at its own tap
+struct delay {
+    int channels;
+    int samplerate;
+    uint32_t max_frames;
+    uint32_t length;
+    uint32_t fade_frames;
+    uint32_t write_pos;
+    float *ring;
+    delay_line_t *lines;
+};
+
+static uint32_t configured_frames(const output_channel_config_t *channel, int samplerate) {
+    if (channel->delay_samples >= 0) return (uint32_t) channel->delay_samples;
+    return (uint32_t) lrintf(channel->delay_ms * samplerate / 1000.0f);
+}
+
+delay_t *delay_create(const output_stage_config_t *config, const char *const *names, int channels, int samplerate) {
+    if (!config || channels <= 0 || samplerate <= 0) return NULL;
+
+    // Size the line for max_delay_ms or the longest configured delay, whichever is larger
+    uint32_t max_frames = (uint32_t) lrintf(config->max_delay_ms * samplerate / 1000.0f);
+    int configured = 0;
+    for (int ch = 0; ch < channels; ch++) {
+        for (int i = 0; i < config->channel_count; i++) {
+            const output_channel_config_t *channel = &config->channels[i];
+            if (!channel->name || strcmp(channel->name, names[ch]) != 0) continue;
+            if (channel->delay_samples < 0 && channel->delay_ms < 0.0f) break;
+
+            const uint32_t frames = configured_frames(channel, samplerate);
+            if (frames > max_frames) max_frames = frames;
+            configured++;
+            break;
+        }
+    }
+    if (configured == 0) return NULL;
+
+    delay_t *delay = arena_calloc(1, sizeof(delay_t));
+    if (!delay) return NULL;
+
+    delay->channels = channels;
+    delay->samplerate = samplerate;
+    delay->max_frames = max_frames;
+    delay->length = max_frames + DELAY_BLOCK;
+    delay->fade_frames = (uint32_t) lrintf(DELAY_FADE_MS * samplerate / 1000.0f);
+    if (delay->fade_frames == 0) delay->fade_frames = 1;
+    delay->ring = arena_calloc((size_t) delay->length * channels, sizeof(float));
+    delay->lines = arena_calloc(channels, sizeof(delay_line_t));
+    if (!delay->ring || !delay->lines) {
+        log_error("Failed to allocate %u frame delay lines for %d channels", delay->length, channels);
+        delay_destroy(delay);
+        return NULL;
+    }
+
+    for (int ch = 0; ch < channels; ch++) {
+        delay_line_t *line = &delay->lines[ch];
+        snprintf(line->name, sizeof(line->name), "%s", names[ch]);
+        line->fade_pos = delay->fade_frames;
+        atomic_init(&line->target, 0);
+
+        for (int i = 0; i < config->channel_count; i++) {
+            const output_channel_config_t *channel = &config->channels[i];
+            if (!channel->name || strcmp(channel->name, names[ch]) != 0) continue;
+            if (channel->delay_samples < 0 && channel->delay_ms < 0.0f) break;
+
+            line->configured = true;
+            line->current = configured_frames(channel, samplerate);
+            atomic_store(&line->target, line->current);
+            break;
+        }
+    }
+    return delay;
+}
+
+void delay_process(delay_t *delay, float *samples, size_t n_frames) {
+    if (!delay) return;
+
+    const int channels = delay->channels;
+    const uint32_t length = delay->length;
+    const float fade_step = 1.0f / (float) delay->fade_frames;
+
+    for (size_t offset = 0; offset < n_frames; offset += DELAY_BLOCK) {
+        const uint32_t chunk = (uint32_t) (n_frames - offset < DELAY_BLOCK ? n_frames - offset : DELAY_BLOCK);
+        float *frames = samples + offset * channels;
+
+        // Append the chunk, wrapping at the end of the ring
+        const uint32_t first = length - delay->write_pos < chunk ? length - delay->write_pos : chunk;
+        memcpy(delay->ring + (size_t) delay->write_pos * channels, frames, (size_t) first * channels * sizeof(float));
+        memcpy(delay->ring, frames + (size_t) first * channels, (size_t) (chunk - first) * channels * sizeof(float));
+
+        for (int ch = 0; ch < channels; ch++) {
+            delay_line_t *line = &delay->lines[ch];
+
+            // A new target starts a crossfade once the previous one has finished
+            const uint32_t target = atomic_load_explicit(&line->target, memory_order_relaxed);
+            if (line->fade_pos >= delay->fade_frames && target != line->current) {
+                line->previous = line->current;
+                line->current = target;
+                line->fade_pos = 0;
+            }
+            if (line->current == 0 && line->fade_pos >= delay->fade_frames) continue;
+
+            uint32_t read = (delay->write_pos + length - line->current) % length;
+            uint32_t faded = (delay->write_pos + length - line->previous) % length;
+            for (uint32_t f = 0; f < chunk; f++) {
+                float out = delay->ring[(size_t) read * channels + ch];
+                if (line->fade_pos < delay->fade_frames) {
+                    const float old = delay->ring[(size_t) faded * channels + ch];
+                    out = old + (out - old) * ((float) line->fade_pos * fade_step);
+                    line->fade_pos++;
+                }
+                frames[(size_t) f * channels + ch] = out;
+                read = read + 1 < length ? read + 1 : 0;
+                faded = faded + 1 < length ? faded + 1 : 0;
+            }
+        }
+
+        delay->write_pos = (delay->write_pos + chunk) % length;
+    }
+}
+
+bool delay_set(delay_t *delay, const char *channel, float ms) {
+    if (!delay || !channel || ms < 0.0f) return false;
+
+    const uint32_t frames = (uint32_t) lrintf(ms * delay->samplerate / 1000.0f);
+    if (frames > delay->max_frames) return false;
+
+    for (int ch = 0; ch < delay->channels; ch++) {
+        delay_line_t *line = &delay->lines[ch];
+        if (strcmp(line->name, channel) != 0) continue;
+        line->configured = true;
+        atomic_store_explicit(&line->target, frames, memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+int delay_format_status(const delay_t *delay, char *buffer, size_t size) {
+    if (!delay) return 0;
+
+    int written = snprintf(buffer, size, "delay");
+    for (int ch = 0; ch < delay->channels && written >= 0; ch++) {
+        const delay_line_t *line = &delay->lines[ch];
+        if (!line->configured) continue;
+
+        const uint32_t frames = atomic_load_explicit(&line->target, memory_order_relaxed);
+        const int n = snprintf(buffer + written, size > (size_t) written ? size - written : 0, " %s %.2f ms",
+                               line->name, frames * 1000.0 / delay->samplerate);
+        if (n < 0) break;
+        written += n;
+    }
+    return written;
+}
+
+void delay_destroy(delay_t *delay) {
+    if (!delay) return;
+    arena_free(delay->ring);
+    arena_free(delay->lines);
+    arena_free(delay);
+}
@@ -0,0 +1,29 @@
+#ifndef ASYNC_AUDIO_PLAYER_DELAY_H
+#define ASYNC_AUDIO_PLAYER_DELAY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "types.h"
+
+#define DELAY_FADE_MS 10.0f     // Crossfade between the old and new tap when a delay changes
+
+// Per-channel delay lines for speaker distance compensation, sized for max_delay_ms up front
+typedef struct delay delay_t;
+
+// Build delay lines for the named channels; returns NULL when no channel has a delay configured
+delay_t *delay_create(const output_stage_config_t *config, const char *const *names, int channels, int samplerate);
+
+// Delay one interleaved block in place (data thread)
+void delay_process(delay_t *delay, float *samples, size_t n_frames);
+
+// Change a channel's delay, crossfaded on the data thread; false if the channel is unknown or
+// the delay exceeds the preallocated line
+bool delay_set(delay_t *delay, const char *channel, float ms);
+
+// Format the current delay of every delayed channel
+int delay_format_status(const delay_t *delay, char *buffer, size_t size);
+
+void delay_destroy(delay_t *delay);
+
+#endif // ASYNC_AUDIO_PLAYER_DELAY_H
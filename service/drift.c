@@ -0,0 +1,300 @@
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include "drift.h"
+#include "arena.h"
+#include "log.h"
+
+#define DRIFT_HALF 16                       // Source frames on each side of an output frame
+#define DRIFT_TAPS (2 * DRIFT_HALF)
+#define DRIFT_PHASES 256                    // Kernel rows per frame, linearly interpolated
+#define DRIFT_CUTOFF 0.92                   // Kernel cutoff as a fraction of Nyquist
+#define DRIFT_KAISER_BETA 8.6
+#define DRIFT_BLOCK 1024                    // Output frames rendered per pass
+#define DRIFT_SPEED_MIN_NS 2000000000ull    // Shortest window before publishing a speed
+#define DRIFT_SPEED_WINDOW_NS 120000000000ull
+#define DRIFT_RELOCK_S 0.05                 // Error beyond which the loop starts over (xrun, stall)
+#define DEFAULT_BANDWIDTH_HZ 0.05f
+#define DEFAULT_MAX_PPM 1000.0f
+
+static float kernel[DRIFT_PHASES + 1][DRIFT_TAPS];
+static pthread_once_t kernel_once = PTHREAD_ONCE_INIT;
+
+struct drift {
+    int channels;
+    double rate;                // Source frames per second of the reference clock
+    double kp;                  // Proportional gain per frame of error
+    double ki;                  // Integral gain per frame of error and second
+    double max_dev;             // Largest correction of the ratio
+
+    // Resampler, data thread. input holds DRIFT_TAPS frames of history followed by the frames of a pass.
+    float *input;
+    double x;                   // Position of the next output frame in input
+    uint64_t rendered;          // Source frames pulled so far
+    double ratio;               // Source frames per device frame
+
+    // Loop state, data thread
+    bool locked;
+    bool was_reference;
+    uint64_t last_play_ns;
+    double anchor_pos;
+    double expected;            // Source frames the reference clock advanced since the anchor
+    double integral;
+
+    // Device speed from the graph clock position; the window slides over the mid point
+    uint64_t speed_ns, speed_ticks;
+    uint64_t mid_ns, mid_ticks;
+
+    // Control, written by the main loop
+    _Atomic double reference_speed;
+    _Atomic bool is_reference;
+
+    // Published by the data thread
+    _Atomic double speed;
+    _Atomic double correction;
+    _Atomic float error;
+    _Atomic uint32_t relocks;
+};
+
+static double bessel_i0(const double x) {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+// Kaiser-windowed sinc; row p interpolates at p / DRIFT_PHASES of a frame past tap DRIFT_HALF - 1
+static void build_kernel(void) {
+    const double norm = bessel_i0(DRIFT_KAISER_BETA);
+    for (int p = 0; p <= DRIFT_PHASES; p++) {
+        const double frac = (double) p / DRIFT_PHASES;
+        double sum = 0.0;
+        double row[DRIFT_TAPS];
+        for (int j = 0; j < DRIFT_TAPS; j++) {
+            const double t = (double) (j - DRIFT_HALF + 1) - frac;
+            const double u = t / DRIFT_HALF;
+            const double window = fabs(u) < 1.0 ? bessel_i0(DRIFT_KAISER_BETA * sqrt(1.0 - u * u)) / norm : 0.0;
+            const double arg = M_PI * DRIFT_CUTOFF * t;
+            row[j] = (fabs(arg) < 1e-12 ? 1.0 : sin(arg) / arg) * window;
+            sum += row[j];
+        }
+        for (int j = 0; j < DRIFT_TAPS; j++) {
+            kernel[p][j] = (float) (row[j] / sum);
+        }
+    }
+}
+
+drift_t *drift_create(const global_config_t *global, int channels, int samplerate) {
+    if (!global || !global->clock.compensate || channels <= 0 || samplerate <= 0) return NULL;
+
+    pthread_once(&kernel_once, build_kernel);
+
+    drift_t *drift = arena_calloc(1, sizeof(drift_t));
+    if (!drift) {
+        log_error("Failed to allocate drift compensation");
+        return NULL;
+    }
+    drift->input = arena_calloc((size_t) (DRIFT_TAPS + 2 * DRIFT_BLOCK) * channels, sizeof(float));
+    if (!drift->input) {
+        log_error("Failed to allocate drift compensation buffer");
+        arena_free(drift);
+        return NULL;
+    }
+
+    const double bandwidth = global->clock.bandwidth_hz > 0.0f ? global->clock.bandwidth_hz : DEFAULT_BANDWIDTH_HZ;
+    const double max_ppm = global->clock.max_ppm > 0.0f ? global->clock.max_ppm : DEFAULT_MAX_PPM;
+    const double omega = 2.0 * M_PI * bandwidth;
+
+    // Second-order loop with damping 1/sqrt(2): error e in frames moves at rate * (ratio - 1)
+    drift->channels = channels;
+    drift->rate = samplerate;
+    drift->kp = M_SQRT2 * omega / samplerate;
+    drift->ki = omega * omega / samplerate;
+    drift->max_dev = max_ppm < 10000.0 ? max_ppm * 1e-6 : 0.01;
+    drift->x = DRIFT_HALF - 1;
+    drift->ratio = 1.0;
+    atomic_init(&drift->reference_speed, 1.0);
+    atomic_init(&drift->is_reference, false);
+    atomic_init(&drift->speed, 0.0);
+    atomic_init(&drift->correction, 0.0);
+    atomic_init(&drift->error, 0.0f);
+    atomic_init(&drift->relocks, 0);
+    return drift;
+}
+
+static void measure_speed(drift_t *drift, const struct pw_time *time) {
+    const uint64_t now = (uint64_t) time->now;
+    if (drift->speed_ns == 0 || time->ticks < drift->speed_ticks || now <= drift->speed_ns) {
+        // First cycle or the driver restarted its clock
+        drift->speed_ns = now;
+        drift->speed_ticks = time->ticks;
+        drift->mid_ns = 0;
+        return;
+    }
+
+    const uint64_t elapsed = now - drift->speed_ns;
+    if (elapsed < DRIFT_SPEED_MIN_NS) return;
+
+    const double graph_rate = (double) time->rate.denom / time->rate.num;
+    const double speed = (double) (time->ticks - drift->speed_ticks) / (elapsed / 1e9 * graph_rate);
+    atomic_store_explicit(&drift->speed, speed, memory_order_relaxed);
+
+    if (drift->mid_ns == 0 && elapsed >= DRIFT_SPEED_WINDOW_NS / 2) {
+        drift->mid_ns = now;
+        drift->mid_ticks = time->ticks;
+    } else if (elapsed >= DRIFT_SPEED_WINDOW_NS) {
+        drift->speed_ns = drift->mid_ns;
+        drift->speed_ticks = drift->mid_ticks;
+        drift->mid_ns = now;
+        drift->mid_ticks = time->ticks;
+    }
+}
+
+// Compare the source position reaching the device with how far the reference clock advanced and
+// set the resampling ratio for this cycle
+static void update_loop(drift_t *drift, const struct pw_time *time) {
+    if (!time || time->now <= 0 || time->rate.num == 0 || time->rate.denom == 0) return;
+
+    measure_speed(drift, time);
+
+    // When the first frame of this cycle is heard, and which source frame it is
+    const uint64_t play_ns = (uint64_t) time->now +
+                             (uint64_t) (time->delay > 0 ? time->delay : 0) * 1000000000ull * time->rate.num /
+                             time->rate.denom;
+    const double pos = (double) drift->rendered - DRIFT_TAPS + drift->x;
+    const bool is_reference = atomic_load_explicit(&drift->is_reference, memory_order_relaxed);
+
+    if (!drift->locked || is_reference != drift->was_reference) {
+        drift->locked = true;
+        drift->was_reference = is_reference;
+        drift->last_play_ns = play_ns;
+        drift->anchor_pos = pos;
+        drift->expected = 0.0;
+        if (is_reference) {
+            // Whole-frame position, so the pass-through copies samples unfiltered
+            drift->x = floor(drift->x + 0.5);
+            drift->ratio = 1.0;
+            drift->integral = 0.0;
+        }
+        return;
+    }
+
+    const double dt = (double) (int64_t) (play_ns - drift->last_play_ns) / 1e9;
+    drift->last_play_ns = play_ns;
+    drift->expected += dt * drift->rate * atomic_load_explicit(&drift->reference_speed, memory_order_relaxed);
+
+    const double error = pos - drift->anchor_pos - drift->expected;
+    atomic_store_explicit(&drift->error, (float) error, memory_order_relaxed);
+    if (fabs(error) > drift->rate * DRIFT_RELOCK_S || dt < 0.0) {
+        drift->locked = false;
+        atomic_fetch_add_explicit(&drift->relocks, 1, memory_order_relaxed);
+        return;
+    }
+    if (is_reference) return;
+
+    // Source ahead of the reference clock (error > 0) slows down the source
+    drift->integral += drift->ki * error * dt;
+    if (drift->integral > drift->max_dev) drift->integral = drift->max_dev;
+    if (drift->integral < -drift->max_dev) drift->integral = -drift->max_dev;
+
+    double correction = -(drift->kp * error + drift->integral);
+    if (correction > drift->max_dev) correction = drift->max_dev;
+    if (correction < -drift->max_dev) correction = -drift->max_dev;
+    drift->ratio = 1.0 + correction;
+    atomic_store_explicit(&drift->correction, correction, memory_order_relaxed);
+}
+
+static void interpolate(drift_t *drift, float *dst, size_t n_frames) {
+    const int channels = drift->channels;
+    const double ratio = drift->ratio;
+    double x = drift->x;
+
+    if (ratio == 1.0 && x == floor(x)) {
+        memcpy(dst, drift->input + (size_t) x * channels, n_frames * channels * sizeof(float));
+        drift->x = x + (double) n_frames;
+        return;
+    }
+
+    float coef[DRIFT_TAPS];
+    for (size_t f = 0; f < n_frames; f++, x += ratio) {
+        const double base = floor(x);
+        const double phase = (x - base) * DRIFT_PHASES;
+        const int p = (int) phase;
+        const float a = (float) (phase - p);
+        for (int j = 0; j < DRIFT_TAPS; j++) {
+            coef[j] = kernel[p][j] + a * (kernel[p + 1][j] - kernel[p][j]);
+        }
+
+        const float *src = drift->input + ((size_t) base - (DRIFT_HALF - 1)) * channels;
+        for (int ch = 0; ch < channels; ch++) {
+            float acc = 0.0f;
+            for (int j = 0; j < DRIFT_TAPS; j++) {
+                acc += coef[j] * src[j * channels + ch];
+            }
+            dst[f * channels + ch] = acc;
+        }
+    }
+    drift->x = x;
+}
+
+void drift_process(drift_t *drift, const struct pw_time *time, drift_render_fn render, void *data,
+                   float *dst, size_t n_frames, uint64_t cycle_ns) {
+    update_loop(drift, time);
+
+    const int channels = drift->channels;
+    for (size_t done = 0; done < n_frames;) {
+        const size_t chunk = n_frames - done < DRIFT_BLOCK ? n_frames - done : DRIFT_BLOCK;
+
+        // Source frames up to the last tap of the chunk's last output frame
+        const size_t last = (size_t) floor(drift->x + (double) (chunk - 1) * drift->ratio) + DRIFT_HALF + 1;
+        const size_t n_in = last > DRIFT_TAPS ? last - DRIFT_TAPS : 0;
+        // The first new source frame is heard (DRIFT_TAPS - x) / ratio output frames into the pass
+        const double due = (double) done + ((double) DRIFT_TAPS - drift->x) / drift->ratio;
+        render(data, drift->input + DRIFT_TAPS * channels, n_in, cycle_ns + (uint64_t) (due * 1e9 / drift->rate));
+
+        interpolate(drift, dst + done * channels, chunk);
+
+        // Keep the last DRIFT_TAPS frames as history for the next pass
+        memmove(drift->input, drift->input + n_in * channels, DRIFT_TAPS * channels * sizeof(float));
+        drift->x -= (double) n_in;
+        drift->rendered += n_in;
+        done += chunk;
+    }
+}
+
+double drift_get_speed(const drift_t *drift) {
+    return drift ? atomic_load_explicit(&drift->speed, memory_order_relaxed) : 0.0;
+}
+
+void drift_set_reference(drift_t *drift, double speed, bool is_reference) {
+    if (!drift) return;
+    atomic_store_explicit(&drift->reference_speed, speed > 0.0 ? speed : 1.0, memory_order_relaxed);
+    atomic_store_explicit(&drift->is_reference, is_reference, memory_order_relaxed);
+}
+
+int drift_format_status(const drift_t *drift, char *buffer, size_t size) {
+    if (!drift) return 0;
+
+    const double speed = atomic_load_explicit(&drift->speed, memory_order_relaxed);
+    char measured[32] = "measuring";
+    if (speed > 0.0) {
+        snprintf(measured, sizeof(measured), "%+.2f ppm", (speed - 1.0) * 1e6);
+    }
+    if (atomic_load_explicit(&drift->is_reference, memory_order_relaxed)) {
+        return snprintf(buffer, size, "device %s, reference", measured);
+    }
+    return snprintf(buffer, size, "device %s, correction %+.2f ppm, error %+.1f frames, %u relocks", measured,
+                    atomic_load_explicit(&drift->correction, memory_order_relaxed) * 1e6,
+                    (double) atomic_load_explicit(&drift->error, memory_order_relaxed),
+                    atomic_load_explicit(&drift->relocks, memory_order_relaxed));
+}
+
+void drift_destroy(drift_t *drift) {
+    if (!drift) return;
+    arena_free(drift->input);
+    arena_free(drift);
+}
@@ -0,0 +1,38 @@
+#ifndef ASYNC_AUDIO_PLAYER_DRIFT_H
+#define ASYNC_AUDIO_PLAYER_DRIFT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "types.h"
+
+// Clock-drift compensation of one output stream. Every device runs on its own crystal, so streams on
+// different devices slowly walk apart. The tracker measures its device clock against CLOCK_MONOTONIC
+// from the stream's timing info, and a delay-locked loop steers a fine resampler so the source advances
+// at the reference clock: the system clock, or the measured speed of a reference device.
+typedef struct drift drift_t;
+
+// Renders n_frames source frames; cycle_ns is when the first of them is due
+typedef void (*drift_render_fn)(void *data, float *dst, size_t n_frames, uint64_t cycle_ns);
+
+// NULL when compensation is off in the configuration
+drift_t *drift_create(const global_config_t *global, int channels, int samplerate);
+
+// Fill n_frames device frames of dst, pulling source frames from render (data thread). time is the
+// stream's timing info for this cycle, NULL when it is not available.
+void drift_process(drift_t *drift, const struct pw_time *time, drift_render_fn render, void *data,
+                   float *dst, size_t n_frames, uint64_t cycle_ns);
+
+// Speed of the device clock relative to CLOCK_MONOTONIC, 0 while still measuring
+double drift_get_speed(const drift_t *drift);
+
+// Follow a reference clock running at speed (1 = system clock). Streams on the reference device pass
+// through unresampled. Main loop.
+void drift_set_reference(drift_t *drift, double speed, bool is_reference);
+
+// Format measured device speed, applied correction and remaining error
+int drift_format_status(const drift_t *drift, char *buffer, size_t size);
+
+void drift_destroy(drift_t *drift);
+
+#endif // ASYNC_AUDIO_PLAYER_DRIFT_H
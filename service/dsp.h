@@ -0,0 +1,12 @@
+#ifndef ASYNC_AUDIO_PLAYER_DSP_H
+#define ASYNC_AUDIO_PLAYER_DSP_H
+
+// Hot per-sample loops are written branch free over contiguous channels so the compiler can
+// vectorize them. GCC only does that for runtime trip counts at -O3 unless asked; clang does at -O2.
+#if defined(__GNUC__) && !defined(__clang__)
+#define DSP_VECTORIZE __attribute__((optimize("tree-vectorize", "vect-cost-model=dynamic")))
+#else
+#define DSP_VECTORIZE
+#endif
+
+#endif // ASYNC_AUDIO_PLAYER_DSP_H
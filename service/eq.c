@@ -0,0 +1,273 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "eq.h"
+#include "arena.h"
+#include "dsp.h"
+#include "log.h"
+
+#define EQ_DENORMAL_FLOOR 1e-20f    // Filter state below this is flushed to zero between blocks
+
+// Normalized coefficients of one section (a0 = 1)
+typedef struct {
+    double b0, b1, b2, a1, a2;
+} biquad_t;
+
+// Coefficients and transposed direct form II state, laid out [section][channel] so the inner
+// loop runs over the contiguous channels of an interleaved frame. Channels with fewer sections
+// than the longest cascade are padded with pass-through sections.
+struct eq {
+    int channels;
+    int sections;
+    int filters;            // Configured filters in use, for status
+    int filtered_channels;
+    float *b0, *b1, *b2, *a1, *a2;
+    float *z1, *z2;
+};
+
+static const biquad_t passthrough = {1.0, 0.0, 0.0, 0.0, 0.0};
+
+// RBJ audio EQ cookbook second-order section
+static biquad_t cookbook(filter_type_t type, double freq, double q, double gain_db, int samplerate) {
+    const double w0 = 2.0 * M_PI * freq / samplerate;
+    const double c = cos(w0);
+    const double alpha = sin(w0) / (2.0 * q);
+    const double A = pow(10.0, gain_db / 40.0);
+    const double root = 2.0 * sqrt(A) * alpha;
+    double b0, b1, b2, a0, a1, a2;
+
+    switch (type) {
+        case FILTER_PEAKING:
+            b0 = 1.0 + alpha * A;
+            b1 = -2.0 * c;
+            b2 = 1.0 - alpha * A;
+            a0 = 1.0 + alpha / A;
+            a1 = -2.0 * c;
+            a2 = 1.0 - alpha / A;
+            break;
+        case FILTER_LOWSHELF:
+            b0 = A * ((A + 1.0) - (A - 1.0) * c + root);
+            b1 = 2.0 * A * ((A - 1.0) - (A + 1.0) * c);
+            b2 = A * ((A + 1.0) - (A - 1.0) * c - root);
+            a0 = (A + 1.0) + (A - 1.0) * c + root;
+            a1 = -2.0 * ((A - 1.0) + (A + 1.0) * c);
+            a2 = (A + 1.0) + (A - 1.0) * c - root;
+            break;
+        case FILTER_HIGHSHELF:
+            b0 = A * ((A + 1.0) + (A - 1.0) * c + root);
+            b1 = -2.0 * A * ((A - 1.0) + (A + 1.0) * c);
+            b2 = A * ((A + 1.0) + (A - 1.0) * c - root);
+            a0 = (A + 1.0) - (A - 1.0) * c + root;
+            a1 = 2.0 * ((A - 1.0) - (A + 1.0) * c);
+            a2 = (A + 1.0) - (A - 1.0) * c - root;
+            break;
+        case FILTER_LOWPASS:
+        case FILTER_LR_LOWPASS:
+            b0 = (1.0 - c) / 2.0;
+            b1 = 1.0 - c;
+            b2 = (1.0 - c) / 2.0;
+            a0 = 1.0 + alpha;
+            a1 = -2.0 * c;
+            a2 = 1.0 - alpha;
+            break;
+        case FILTER_HIGHPASS:
+        case FILTER_LR_HIGHPASS:
+        default:
+            b0 = (1.0 + c) / 2.0;
+            b1 = -(1.0 + c);
+            b2 = (1.0 + c) / 2.0;
+            a0 = 1.0 + alpha;
+            a1 = -2.0 * c;
+            a2 = 1.0 - alpha;
+            break;
+    }
+
+    return (biquad_t) {b0 / a0, b1 / a0, b2 / a0, a1 / a0, a2 / a0};
+}
+
+// First-order Butterworth section (bilinear transform), used by LR2 crossovers
+static biquad_t first_order(bool highpass, double freq, int samplerate) {
+    const double k = tan(M_PI * freq / samplerate);
+    const double a1 = (k - 1.0) / (k + 1.0);
+    if (highpass) {
+        return (biquad_t) {1.0 / (1.0 + k), -1.0 / (1.0 + k), 0.0, a1, 0.0};
+    }
+    return (biquad_t) {k / (1.0 + k), k / (1.0 + k), 0.0, a1, 0.0};
+}
+
+// Expand one configured filter into sections; returns the number written or -1 if invalid.
+// A Linkwitz-Riley crossover of order 2N is a Butterworth filter of order N applied twice.
+static int design(const filter_config_t *filter, int samplerate, biquad_t *out, int room) {
+    if (filter->freq <= 0.0f || filter->freq >= samplerate / 2.0f) return -1;
+
+    if (filter->type != FILTER_LR_LOWPASS && filter->type != FILTER_LR_HIGHPASS) {
+        if (room < 1) return -1;
+        out[0] = cookbook(filter->type, filter->freq, filter->q > 0.0f ? filter->q : M_SQRT1_2, filter->gain_db,
+                          samplerate);
+        return 1;
+    }
+
+    const bool highpass = filter->type == FILTER_LR_HIGHPASS;
+    switch (filter->order) {
+        case 2:
+            if (room < 2) return -1;
+            out[0] = out[1] = first_order(highpass, filter->freq, samplerate);
+            return 2;
+        case 4:
+            if (room < 2) return -1;
+            out[0] = out[1] = cookbook(filter->type, filter->freq, M_SQRT1_2, 0.0, samplerate);
+            return 2;
+        case 8: {
+            // Butterworth fourth order: pole pair Qs 1 / (2 cos(pi/8)) and 1 / (2 cos(3pi/8))
+            if (room < 4) return -1;
+            const double q1 = 1.0 / (2.0 * cos(M_PI / 8.0));
+            const double q2 = 1.0 / (2.0 * cos(3.0 * M_PI / 8.0));
+            out[0] = out[2] = cookbook(filter->type, filter->freq, q1, 0.0, samplerate);
+            out[1] = out[3] = cookbook(filter->type, filter->freq, q2, 0.0, samplerate);
+            return 4;
+        }
+        default:
+            return -1;
+    }
+}
+
+static const output_channel_config_t *find_channel(const output_stage_config_t *config, const char *name) {
+    for (int i = 0; i < config->channel_count; i++) {
+        if (config->channels[i].name && strcmp(config->channels[i].name, name) == 0) return &config->channels[i];
+    }
+    return NULL;
+}
+
+eq_t *eq_create(const output_stage_config_t *config, const char *const *names, int channels, int samplerate) {
+    if (!config || config->channel_count == 0 || channels <= 0) return NULL;
+
+    // Design every channel's cascade first to size the section arrays
+    biquad_t (*designed)[EQ_MAX_SECTIONS] = calloc(channels, sizeof(*designed));
+    int *counts = calloc(channels, sizeof(int));
+    if (!designed || !counts) {
+        free(designed);
+        free(counts);
+        return NULL;
+    }
+
+    int sections = 0;
+    int filters = 0;
+    int filtered_channels = 0;
+    for (int ch = 0; ch < channels; ch++) {
+        const output_channel_config_t *channel = find_channel(config, names[ch]);
+        if (!channel) continue;
+
+        for (int i = 0; i < channel->filter_count; i++) {
+            const int n = design(&channel->filters[i], samplerate, designed[ch] + counts[ch],
+                                 EQ_MAX_SECTIONS - counts[ch]);
+            if (n < 0) {
+                log_warn("Skipping invalid filter %d on channel %s (%.1f Hz at %d Hz)", i, names[ch],
+                         channel->filters[i].freq, samplerate);
+                continue;
+            }
+            counts[ch] += n;
+            filters++;
+        }
+        if (counts[ch] > 0) filtered_channels++;
+        if (counts[ch] > sections) sections = counts[ch];
+    }
+
+    if (sections == 0) {
+        free(designed);
+        free(counts);
+        return NULL;
+    }
+
+    eq_t *eq = arena_calloc(1, sizeof(eq_t));
+    const size_t size = (size_t) sections * channels;
+    if (eq) {
+        eq->b0 = arena_calloc(size, sizeof(float));
+        eq->b1 = arena_calloc(size, sizeof(float));
+        eq->b2 = arena_calloc(size, sizeof(float));
+        eq->a1 = arena_calloc(size, sizeof(float));
+        eq->a2 = arena_calloc(size, sizeof(float));
+        eq->z1 = arena_calloc(size, sizeof(float));
+        eq->z2 = arena_calloc(size, sizeof(float));
+    }
+    if (!eq || !eq->b0 || !eq->b1 || !eq->b2 || !eq->a1 || !eq->a2 || !eq->z1 || !eq->z2) {
+        log_error("Failed to allocate filters for %d channels", channels);
+        eq_destroy(eq);
+        free(designed);
+        free(counts);
+        return NULL;
+    }
+
+    eq->channels = channels;
+    eq->sections = sections;
+    eq->filters = filters;
+    eq->filtered_channels = filtered_channels;
+    for (int s = 0; s < sections; s++) {
+        for (int ch = 0; ch < channels; ch++) {
+            const biquad_t *section = s < counts[ch] ? &designed[ch][s] : &passthrough;
+            const size_t i = (size_t) s * channels + ch;
+            eq->b0[i] = (float) section->b0;
+            eq->b1[i] = (float) section->b1;
+            eq->b2[i] = (float) section->b2;
+            eq->a1[i] = (float) section->a1;
+            eq->a2[i] = (float) section->a2;
+        }
+    }
+
+    free(designed);
+    free(counts);
+    return eq;
+}
+
+// One section across all channels of every frame in the block
+DSP_VECTORIZE
+static void biquad_section(float *restrict samples, size_t n_frames, int channels,
+                           const float *restrict b0, const float *restrict b1, const float *restrict b2,
+                           const float *restrict a1, const float *restrict a2,
+                           float *restrict z1, float *restrict z2) {
+    for (size_t f = 0; f < n_frames; f++) {
+        float *restrict frame = samples + f * channels;
+        for (int ch = 0; ch < channels; ch++) {
+            const float x = frame[ch];
+            const float y = b0[ch] * x + z1[ch];
+            z1[ch] = b1[ch] * x - a1[ch] * y + z2[ch];
+            z2[ch] = b2[ch] * x - a2[ch] * y;
+            frame[ch] = y;
+        }
+    }
+}
+
+void eq_process(eq_t *eq, float *samples, size_t n_frames) {
+    if (!eq || n_frames == 0) return;
+
+    const int channels = eq->channels;
+    for (int s = 0; s < eq->sections; s++) {
+        const size_t i = (size_t) s * channels;
+        biquad_section(samples, n_frames, channels, eq->b0 + i, eq->b1 + i, eq->b2 + i, eq->a1 + i, eq->a2 + i,
+                       eq->z1 + i, eq->z2 + i);
+    }
+
+    // Decaying tails would otherwise end up in denormals, which are slow on most CPUs
+    const size_t size = (size_t) eq->sections * channels;
+    for (size_t i = 0; i < size; i++) {
+        if (fabsf(eq->z1[i]) < EQ_DENORMAL_FLOOR) eq->z1[i] = 0.0f;
+        if (fabsf(eq->z2[i]) < EQ_DENORMAL_FLOOR) eq->z2[i] = 0.0f;
+    }
+}
+
+int eq_format_status(const eq_t *eq, char *buffer, size_t size) {
+    if (!eq) return 0;
+    return snprintf(buffer, size, "eq %d filters on %d channels", eq->filters, eq->filtered_channels);
+}
+
+void eq_destroy(eq_t *eq) {
+    if (!eq) return;
+    arena_free(eq->b0);
+    arena_free(eq->b1);
+    arena_free(eq->b2);
+    arena_free(eq->a1);
+    arena_free(eq->a2);
+    arena_free(eq->z1);
+    arena_free(eq->z2);
+    arena_free(eq);
+}
@@ -0,0 +1,23 @@
+#ifndef ASYNC_AUDIO_PLAYER_EQ_H
+#define ASYNC_AUDIO_PLAYER_EQ_H
+
+#include <stddef.h>
+#include "types.h"
+
+#define EQ_MAX_SECTIONS 32      // Biquad sections per channel after crossovers are expanded
+
+// Per-channel biquad cascades, processed for all channels of a frame at once
+typedef struct eq eq_t;
+
+// Build the filters configured for the named channels; returns NULL when none apply
+eq_t *eq_create(const output_stage_config_t *config, const char *const *names, int channels, int samplerate);
+
+// Filter one interleaved block in place (data thread)
+void eq_process(eq_t *eq, float *samples, size_t n_frames);
+
+// Format "eq N filters on M channels"
+int eq_format_status(const eq_t *eq, char *buffer, size_t size);
+
+void eq_destroy(eq_t *eq);
+
+#endif // ASYNC_AUDIO_PLAYER_EQ_H
@@ -0,0 +1,147 @@
+#include <math.h>
+#include <stdint.h>
+#include "fft.h"
+#include "arena.h"
+
+// A real transform of size N runs as a complex transform of N / 2 points over the even and odd
+// samples, split back into the N / 2 + 1 bins of the real spectrum afterwards.
+struct fft {
+    size_t size;            // N
+    size_t half;            // M = N / 2 complex points
+    uint32_t *reverse;      // Bit-reversed index of each of the M points
+    float *twiddle_re;      // exp(-2 pi i j / M), j < M / 2
+    float *twiddle_im;
+    float *split_re;        // exp(-2 pi i k / N), k <= M
+    float *split_im;
+    float *work_re;         // M complex points
+    float *work_im;
+};
+
+fft_t *fft_create(size_t size) {
+    if (size < 4 || (size & (size - 1)) != 0) return NULL;
+
+    fft_t *fft = arena_calloc(1, sizeof(fft_t));
+    if (!fft) return NULL;
+
+    fft->size = size;
+    fft->half = size / 2;
+    const size_t m = fft->half;
+    fft->reverse = arena_calloc(m, sizeof(uint32_t));
+    fft->twiddle_re = arena_calloc(m / 2 + 1, sizeof(float));
+    fft->twiddle_im = arena_calloc(m / 2 + 1, sizeof(float));
+    fft->split_re = arena_calloc(m + 1, sizeof(float));
+    fft->split_im = arena_calloc(m + 1, sizeof(float));
+    fft->work_re = arena_calloc(m, sizeof(float));
+    fft->work_im = arena_calloc(m, sizeof(float));
+    if (!fft->reverse || !fft->twiddle_re || !fft->twiddle_im || !fft->split_re || !fft->split_im ||
+        !fft->work_re || !fft->work_im) {
+        fft_destroy(fft);
+        return NULL;
+    }
+
+    int bits = 0;
+    while (((size_t) 1 << bits) < m) bits++;
+    for (size_t i = 0; i < m; i++) {
+        uint32_t r = 0;
+        for (int b = 0; b < bits; b++) {
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        fft->reverse[i] = r;
+    }
+    for (size_t j = 0; j <= m / 2; j++) {
+        fft->twiddle_re[j] = (float) cos(2.0 * M_PI * j / m);
+        fft->twiddle_im[j] = (float) -sin(2.0 * M_PI * j / m);
+    }
+    for (size_t k = 0; k <= m; k++) {
+        fft->split_re[k] = (float) cos(2.0 * M_PI * k / size);
+        fft->split_im[k] = (float) -sin(2.0 * M_PI * k / size);
+    }
+    return fft;
+}
+
+size_t fft_size(const fft_t *fft) {
+    return fft ? fft->size : 0;
+}
+
+// In-place radix-2 butterflies over bit-reversed input; sign -1 conjugates the twiddles
+static void transform(fft_t *fft, float sign) {
+    const size_t m = fft->half;
+    float *re = fft->work_re;
+    float *im = fft->work_im;
+
+    for (size_t length = 2; length <= m; length <<= 1) {
+        const size_t half = length / 2;
+        const size_t step = m / length;
+        for (size_t start = 0; start < m; start += length) {
+            for (size_t j = 0; j < half; j++) {
+                const float wr = fft->twiddle_re[j * step];
+                const float wi = sign * fft->twiddle_im[j * step];
+                const size_t a = start + j;
+                const size_t b = a + half;
+                const float tr = re[b] * wr - im[b] * wi;
+                const float ti = re[b] * wi + im[b] * wr;
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+}
+
+void fft_forward(fft_t *fft, const float *input, float *re, float *im) {
+    const size_t m = fft->half;
+
+    for (size_t n = 0; n < m; n++) {
+        fft->work_re[fft->reverse[n]] = input[2 * n];
+        fft->work_im[fft->reverse[n]] = input[2 * n + 1];
+    }
+    transform(fft, 1.0f);
+
+    // X[k] = E[k] + W^k O[k] with E = (Z[k] + conj Z[M-k]) / 2 and O = (Z[k] - conj Z[M-k]) / 2i
+    for (size_t k = 0; k <= m; k++) {
+        const size_t a = k < m ? k : 0;
+        const size_t b = k > 0 ? m - k : 0;
+        const float zr = fft->work_re[a], zi = fft->work_im[a];
+        const float cr = fft->work_re[b], ci = -fft->work_im[b];
+        const float er = 0.5f * (zr + cr), ei = 0.5f * (zi + ci);
+        const float orr = 0.5f * (zi - ci), oi = -0.5f * (zr - cr);
+        const float wr = fft->split_re[k], wi = fft->split_im[k];
+        re[k] = er + orr * wr - oi * wi;
+        im[k] = ei + orr * wi + oi * wr;
+    }
+}
+
+void fft_inverse(fft_t *fft, const float *re, const float *im, float *output) {
+    const size_t m = fft->half;
+
+    // Z[k] = 2E[k] + 2i O[k], recovered from X[k] and conj X[M-k]; the transform then yields N x
+    for (size_t k = 0; k < m; k++) {
+        const float xr = re[k], xi = im[k];
+        const float cr = re[m - k], ci = -im[m - k];
+        const float er = xr + cr, ei = xi + ci;
+        const float dr = xr - cr, di = xi - ci;
+        const float wr = fft->split_re[k], wi = -fft->split_im[k];
+        const float orr = dr * wr - di * wi, oi = dr * wi + di * wr;
+        fft->work_re[fft->reverse[k]] = er - oi;
+        fft->work_im[fft->reverse[k]] = ei + orr;
+    }
+    transform(fft, -1.0f);
+
+    for (size_t n = 0; n < m; n++) {
+        output[2 * n] = fft->work_re[n];
+        output[2 * n + 1] = fft->work_im[n];
+    }
+}
+
+void fft_destroy(fft_t *fft) {
+    if (!fft) return;
+    arena_free(fft->reverse);
+    arena_free(fft->twiddle_re);
+    arena_free(fft->twiddle_im);
+    arena_free(fft->split_re);
+    arena_free(fft->split_im);
+    arena_free(fft->work_re);
+    arena_free(fft->work_im);
+    arena_free(fft);
+}
@@ -0,0 +1,23 @@
+#ifndef ASYNC_AUDIO_PLAYER_FFT_H
+#define ASYNC_AUDIO_PLAYER_FFT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Real-input FFT of a fixed power-of-two size; spectra are split into real and imaginary arrays of
+// size / 2 + 1 bins. Instances hold scratch memory and must not be shared between threads.
+typedef struct fft fft_t;
+
+fft_t *fft_create(size_t size);
+
+size_t fft_size(const fft_t *fft);
+
+// Forward transform of size real samples
+void fft_forward(fft_t *fft, const float *input, float *re, float *im);
+
+// Inverse transform back to size real samples, scaled by size (not normalized)
+void fft_inverse(fft_t *fft, const float *re, const float *im, float *output);
+
+void fft_destroy(fft_t *fft);
+
+#endif // ASYNC_AUDIO_PLAYER_FFT_H
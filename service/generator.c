@@ -0,0 +1,308 @@
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include "generator.h"
+#include "arena.h"
+#include "log.h"
+
+#define TABLE_BITS 12
+#define TABLE_SIZE (1u << TABLE_BITS)
+#define TABLE_FRACTION_BITS (32 - TABLE_BITS)
+#define GENERATOR_FADE_MS 10.0f     // Ramp at the edges of sweeps and identification bursts
+#define SWEEP_GAP_SECONDS 0.5f      // Silence between repeated sweeps
+#define IDENT_DUTY 0.75f            // Part of each identification step that sounds
+#define PINK_GAIN 0.5643f           // Brings the Kellet filter output to unit RMS
+
+// One sine cycle plus a guard point for interpolation, shared read-only by all generators
+static float sine_table[TABLE_SIZE + 1];
+static pthread_once_t sine_table_once = PTHREAD_ONCE_INIT;
+
+struct generator {
+    generator_config_t config;
+    int channels;
+    char (*names)[32];
+    float amplitude;
+
+    uint32_t rate;                  // Rate the increments below were computed for
+    _Atomic uint32_t pending_rate;  // Negotiated rate, set from the main loop
+
+    // Wavetable oscillator, 32-bit phase accumulator
+    uint32_t phase;
+    uint32_t increment;
+
+    // Logarithmic sweep: the increment grows by a constant factor every frame
+    double sweep_increment;
+    double sweep_start;
+    double sweep_factor;
+    uint32_t sweep_frames;
+    uint32_t sweep_period;
+    uint32_t sweep_pos;
+
+    // Noise
+    uint32_t seed;
+    float pink[7];
+
+    // Channel identification
+    uint32_t step_frames;
+    uint32_t on_frames;
+    uint32_t step_pos;
+    _Atomic int channel;
+
+    uint32_t fade_frames;
+};
+
+static void build_sine_table(void) {
+    for (uint32_t i = 0; i <= TABLE_SIZE; i++) {
+        sine_table[i] = (float) sin(2.0 * M_PI * i / TABLE_SIZE);
+    }
+}
+
+void generator_defaults(generator_config_t *config, const generator_type_t type) {
+    memset(config, 0, sizeof(*config));
+    config->type = type;
+    config->frequency = 440.0f;
+    config->sweep_from = 20.0f;
+    config->sweep_to = 20000.0f;
+    config->sweep_seconds = 10.0f;
+    switch (type) {
+        case GENERATOR_SINE:
+            config->level_db = -6.0f;
+            break;
+        case GENERATOR_SWEEP:
+            config->level_db = -12.0f;
+            break;
+        default:
+            config->level_db = -20.0f;
+            break;
+    }
+}
+
+bool generator_parse_type(const char *name, generator_config_t *config) {
+    if (!name) return false;
+
+    if (strcmp(name, "sine") == 0) {
+        generator_defaults(config, GENERATOR_SINE);
+    } else if (strcmp(name, "white") == 0) {
+        generator_defaults(config, GENERATOR_WHITE);
+    } else if (strcmp(name, "pink") == 0) {
+        generator_defaults(config, GENERATOR_PINK);
+    } else if (strcmp(name, "sweep") == 0) {
+        generator_defaults(config, GENERATOR_SWEEP);
+    } else if (strcmp(name, "ident") == 0) {
+        generator_defaults(config, GENERATOR_PINK);
+        config->ident_seconds = 2.0f;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static float clamp_frequency(float frequency, uint32_t rate) {
+    const float nyquist = 0.45f * (float) rate;
+    if (frequency < 1.0f) return 1.0f;
+    return frequency < nyquist ? frequency : nyquist;
+}
+
+// Derive the per-frame increments and lengths from the current rate
+static void configure(generator_t *generator, uint32_t rate) {
+    const generator_config_t *config = &generator->config;
+    generator->rate = rate;
+
+    const float frequency = clamp_frequency(config->frequency, rate);
+    generator->increment = (uint32_t) llrint(frequency / (double) rate * 4294967296.0);
+
+    const float from = clamp_frequency(config->sweep_from, rate);
+    const float to = clamp_frequency(config->sweep_to, rate);
+    generator->sweep_frames = (uint32_t) lrintf((config->sweep_seconds > 0.1f ? config->sweep_seconds : 0.1f) * rate);
+    generator->sweep_period = generator->sweep_frames + (uint32_t) lrintf(SWEEP_GAP_SECONDS * rate);
+    generator->sweep_start = from / (double) rate * 4294967296.0;
+    generator->sweep_factor = exp(log((double) to / from) / generator->sweep_frames);
+    generator->sweep_increment = generator->sweep_start;
+    generator->sweep_pos = 0;
+
+    generator->fade_frames = (uint32_t) lrintf(GENERATOR_FADE_MS * rate / 1000.0f);
+    if (generator->fade_frames == 0) generator->fade_frames = 1;
+
+    if (config->ident_seconds > 0.0f) {
+        generator->step_frames = (uint32_t) lrintf(config->ident_seconds * rate);
+        if (generator->step_frames < 4 * generator->fade_frames) generator->step_frames = 4 * generator->fade_frames;
+        generator->on_frames = (uint32_t) (generator->step_frames * IDENT_DUTY);
+        generator->step_pos = 0;
+    }
+}
+
+generator_t *generator_create(const generator_config_t *config, const char *const *names, int channels,
+                              int samplerate) {
+    if (!config || channels <= 0) return NULL;
+
+    pthread_once(&sine_table_once, build_sine_table);
+
+    generator_t *generator = arena_calloc(1, sizeof(generator_t));
+    if (!generator) return NULL;
+
+    generator->names = arena_calloc(channels, sizeof(*generator->names));
+    if (!generator->names) {
+        log_error("Failed to allocate generator for %d channels", channels);
+        generator_destroy(generator);
+        return NULL;
+    }
+    for (int ch = 0; ch < channels; ch++) {
+        if (names && names[ch]) {
+            snprintf(generator->names[ch], sizeof(generator->names[ch]), "%s", names[ch]);
+        } else {
+            snprintf(generator->names[ch], sizeof(generator->names[ch]), "AUX%d", ch);
+        }
+    }
+
+    generator->config = *config;
+    generator->channels = channels;
+    generator->amplitude = powf(10.0f, config->level_db / 20.0f);
+    generator->seed = 0x9e3779b9u ^ (uint32_t) (uintptr_t) generator;
+    if (generator->seed == 0) generator->seed = 1;
+    atomic_init(&generator->channel, 0);
+
+    const uint32_t rate = samplerate > 0 ? (uint32_t) samplerate : 48000;
+    atomic_init(&generator->pending_rate, rate);
+    configure(generator, rate);
+    return generator;
+}
+
+void generator_set_rate(generator_t *generator, uint32_t samplerate) {
+    if (!generator || samplerate == 0) return;
+    atomic_store_explicit(&generator->pending_rate, samplerate, memory_order_relaxed);
+}
+
+static inline float table_lookup(uint32_t phase) {
+    const uint32_t index = phase >> TABLE_FRACTION_BITS;
+    const float fraction = (float) (phase & ((1u << TABLE_FRACTION_BITS) - 1)) * (1.0f / (1u << TABLE_FRACTION_BITS));
+    const float a = sine_table[index];
+    return a + (sine_table[index + 1] - a) * fraction;
+}
+
+// Uniform white noise in [-1, 1) from a xorshift32 sequence
+static inline float white_sample(generator_t *generator) {
+    uint32_t x = generator->seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    generator->seed = x;
+    return (float) (int32_t) x * (1.0f / 2147483648.0f);
+}
+
+// Paul Kellet's refined pink filter, within 0.05 dB of -3 dB/octave above 10 Hz at 44.1-48 kHz
+static inline float pink_sample(generator_t *generator) {
+    float *b = generator->pink;
+    const float white = white_sample(generator);
+    b[0] = 0.99886f * b[0] + white * 0.0555179f;
+    b[1] = 0.99332f * b[1] + white * 0.0750759f;
+    b[2] = 0.96900f * b[2] + white * 0.1538520f;
+    b[3] = 0.86650f * b[3] + white * 0.3104856f;
+    b[4] = 0.55000f * b[4] + white * 0.5329522f;
+    b[5] = -0.7616f * b[5] - white * 0.0168980f;
+    const float pink = b[0] + b[1] + b[2] + b[3] + b[4] + b[5] + b[6] + white * 0.5362f;
+    b[6] = white * 0.115926f;
+    return pink * PINK_GAIN;
+}
+
+// Linear ramp in and out of a burst of the given length
+static inline float envelope(uint32_t pos, uint32_t length, uint32_t fade) {
+    if (pos >= length) return 0.0f;
+    const uint32_t edge = pos < length - pos ? pos : length - pos;
+    return edge < fade ? (float) edge / (float) fade : 1.0f;
+}
+
+static float next_sample(generator_t *generator) {
+    switch (generator->config.type) {
+        case GENERATOR_WHITE:
+            return white_sample(generator) * 1.7320508f;   // Unit RMS
+        case GENERATOR_PINK:
+            return pink_sample(generator);
+        case GENERATOR_SWEEP: {
+            const float gain = envelope(generator->sweep_pos, generator->sweep_frames, generator->fade_frames);
+            const float sample = table_lookup(generator->phase) * gain;
+            if (generator->sweep_pos < generator->sweep_frames) {
+                generator->phase += (uint32_t) generator->sweep_increment;
+                generator->sweep_increment *= generator->sweep_factor;
+            }
+            if (++generator->sweep_pos >= generator->sweep_period) {
+                generator->sweep_pos = 0;
+                generator->sweep_increment = generator->sweep_start;
+                generator->phase = 0;
+            }
+            return sample;
+        }
+        case GENERATOR_SINE:
+        default: {
+            const float sample = table_lookup(generator->phase);
+            generator->phase += generator->increment;
+            return sample;
+        }
+    }
+}
+
+void generator_process(generator_t *generator, float *samples, size_t n_frames) {
+    if (!generator) return;
+
+    const uint32_t rate = atomic_load_explicit(&generator->pending_rate, memory_order_relaxed);
+    if (rate != generator->rate) configure(generator, rate);
+
+    const int channels = generator->channels;
+    const float amplitude = generator->amplitude;
+
+    if (generator->config.ident_seconds <= 0.0f) {
+        for (size_t f = 0; f < n_frames; f++) {
+            const float sample = next_sample(generator) * amplitude;
+            for (int ch = 0; ch < channels; ch++) {
+                samples[f * channels + ch] = sample;
+            }
+        }
+        return;
+    }
+
+    // Identification: one channel sounds per step, the others stay silent
+    memset(samples, 0, n_frames * channels * sizeof(float));
+    int channel = atomic_load_explicit(&generator->channel, memory_order_relaxed);
+    for (size_t f = 0; f < n_frames; f++) {
+        const float gain = envelope(generator->step_pos, generator->on_frames, generator->fade_frames);
+        samples[f * channels + channel] = next_sample(generator) * amplitude * gain;
+
+        if (++generator->step_pos >= generator->step_frames) {
+            generator->step_pos = 0;
+            channel = channel + 1 < channels ? channel + 1 : 0;
+            atomic_store_explicit(&generator->channel, channel, memory_order_relaxed);
+        }
+    }
+}
+
+int generator_format_status(const generator_t *generator, char *buffer, size_t size) {
+    if (!generator) return 0;
+
+    static const char *const TYPE_NAMES[] = {"sine", "white noise", "pink noise", "sweep"};
+    const generator_config_t *config = &generator->config;
+    int written;
+    if (config->type == GENERATOR_SINE) {
+        written = snprintf(buffer, size, "sine %.1f Hz %.1f dBFS", config->frequency, config->level_db);
+    } else if (config->type == GENERATOR_SWEEP) {
+        written = snprintf(buffer, size, "sweep %.0f-%.0f Hz over %.1f s %.1f dBFS", config->sweep_from,
+                           config->sweep_to, config->sweep_seconds, config->level_db);
+    } else {
+        written = snprintf(buffer, size, "%s %.1f dBFS", TYPE_NAMES[config->type], config->level_db);
+    }
+    written += snprintf(buffer + written, size > (size_t) written ? size - written : 0, " at %u Hz",
+                        atomic_load_explicit(&generator->pending_rate, memory_order_relaxed));
+
+    if (config->ident_seconds > 0.0f) {
+        const int channel = atomic_load_explicit(&generator->channel, memory_order_relaxed);
+        written += snprintf(buffer + written, size > (size_t) written ? size - written : 0, ", ident %s (%d/%d)",
+                            generator->names[channel], channel + 1, generator->channels);
+    }
+    return written;
+}
+
+void generator_destroy(generator_t *generator) {
+    if (!generator) return;
+    arena_free(generator->names);
+    arena_free(generator);
+}
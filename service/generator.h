@@ -0,0 +1,49 @@
+#ifndef ASYNC_AUDIO_PLAYER_GENERATOR_H
+#define ASYNC_AUDIO_PLAYER_GENERATOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    GENERATOR_SINE,
+    GENERATOR_WHITE,
+    GENERATOR_PINK,
+    GENERATOR_SWEEP
+} generator_type_t;
+
+typedef struct {
+    generator_type_t type;
+    float frequency;        // Sine frequency in Hz
+    float sweep_from;       // Logarithmic sweep range in Hz
+    float sweep_to;
+    float sweep_seconds;    // Duration of one sweep, followed by a short gap before it repeats
+    float level_db;         // Sine and sweep peak, noise RMS, in dBFS
+    float ident_seconds;    // > 0 walks the channels one at a time, this long each
+} generator_config_t;
+
+// Test signal source with its own oscillator and noise state
+typedef struct generator generator_t;
+
+// Fill a config with the defaults of a signal type
+void generator_defaults(generator_config_t *config, generator_type_t type);
+
+// Parse "sine", "white", "pink", "sweep" or "ident" (pink noise walking the channels)
+bool generator_parse_type(const char *name, generator_config_t *config);
+
+// Create a generator for an interleaved stream; the rate may change later with generator_set_rate
+generator_t *generator_create(const generator_config_t *config, const char *const *names, int channels,
+                              int samplerate);
+
+// Follow the negotiated stream rate, picked up on the next process call
+void generator_set_rate(generator_t *generator, uint32_t samplerate);
+
+// Render n_frames interleaved frames (data thread)
+void generator_process(generator_t *generator, float *samples, size_t n_frames);
+
+// Format signal type and, while identifying, the channel sounding
+int generator_format_status(const generator_t *generator, char *buffer, size_t size);
+
+void generator_destroy(generator_t *generator);
+
+#endif // ASYNC_AUDIO_PLAYER_GENERATOR_H
@@ -0,0 +1,384 @@
+#include <math.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <spa/param/audio/format-utils.h>
+#include <spa/pod/builder.h>
+#include "latency.h"
+#include "arena.h"
+#include "fft.h"
+#include "generator.h"
+#include "log.h"
+#include "output_stage.h"
+#include "thread_policy.h"
+#include "track_manager.h"
+
+#define LATENCY_RATE 48000
+#define LATENCY_MLS_ORDER 15            // 32767 samples, 0.68 s at 48 kHz
+#define LATENCY_MLS_TAPS 0x6000u        // x^15 + x^14 + 1, Galois form
+#define LATENCY_CHIRP_SECONDS 1.0f
+#define LATENCY_LEVEL_DB -12.0f
+#define LATENCY_START_SECONDS 0.5f      // Allowance for playback starting after the capture
+#define LATENCY_MAX_SECONDS 1.0f        // Longest round trip that can be found
+#define LATENCY_CONNECT_SECONDS 3.0f    // Time both streams get to start
+#define LATENCY_MIN_PEAK_DB 15.0f       // Correlation peak needed over its RMS
+
+struct latency_probe {
+    char device[256];
+    char channel[32];
+    struct pw_stream *playback;
+    struct pw_stream *capture;
+    output_stage_t *stage;
+
+    float *reference;
+    uint32_t reference_frames;
+    float *recording;
+    uint32_t recording_frames;
+
+    // Playback side, data thread
+    bool play_started;
+    uint32_t play_pos;
+    uint64_t play_ns;
+    int64_t play_delay;
+
+    // Capture side, data thread; capture_started publishes capture_ns
+    uint32_t record_pos;
+    uint64_t capture_ns;
+    int64_t capture_delay;
+    _Atomic bool capture_started;
+
+    _Atomic bool finished;
+    _Atomic bool failed;
+};
+
+// Graph cycle start and the stream's reported delay in LATENCY_RATE frames
+static uint64_t cycle_time(struct pw_stream *stream, int64_t *delay) {
+    struct pw_time time;
+    if (pw_stream_get_time_n(stream, &time, sizeof(time)) == 0 && time.now > 0) {
+        if (delay && time.rate.denom > 0) {
+            *delay = time.delay * (int64_t) time.rate.num * LATENCY_RATE / (int64_t) time.rate.denom;
+        }
+        return (uint64_t) time.now;
+    }
+    return track_manager_now_ns();
+}
+
+static void on_playback_process(void *userdata) {
+    latency_probe_t *probe = userdata;
+    thread_policy_register_data_thread();
+
+    struct pw_buffer *b = pw_stream_dequeue_buffer(probe->playback);
+    if (!b) return;
+
+    struct spa_buffer *buf = b->buffer;
+    float *dst = buf->datas[0].data;
+    if (!dst) return;
+
+    size_t n_frames = buf->datas[0].maxsize / sizeof(float);
+    if (b->requested > 0 && b->requested < n_frames) {
+        n_frames = b->requested;
+    }
+    memset(dst, 0, n_frames * sizeof(float));
+
+    // The signal starts on the first cycle after the recording did, so both have a known time
+    if (atomic_load_explicit(&probe->capture_started, memory_order_acquire)) {
+        if (!probe->play_started) {
+            probe->play_ns = cycle_time(probe->playback, &probe->play_delay);
+            probe->play_started = true;
+        }
+        const uint32_t left = probe->reference_frames - probe->play_pos;
+        const uint32_t count = left < n_frames ? left : (uint32_t) n_frames;
+        memcpy(dst, probe->reference + probe->play_pos, count * sizeof(float));
+        probe->play_pos += count;
+    }
+    output_stage_process(probe->stage, dst, n_frames);
+
+    buf->datas[0].chunk->offset = 0;
+    buf->datas[0].chunk->stride = sizeof(float);
+    buf->datas[0].chunk->size = n_frames * sizeof(float);
+    pw_stream_queue_buffer(probe->playback, b);
+}
+
+static void on_capture_process(void *userdata) {
+    latency_probe_t *probe = userdata;
+    thread_policy_register_data_thread();
+
+    struct pw_buffer *b = pw_stream_dequeue_buffer(probe->capture);
+    if (!b) return;
+
+    struct spa_buffer *buf = b->buffer;
+    const float *src = buf->datas[0].data;
+    if (src && !atomic_load_explicit(&probe->finished, memory_order_relaxed)) {
+        const uint32_t offset = buf->datas[0].chunk->offset;
+        const uint32_t size = buf->datas[0].chunk->size;
+        src = (const float *) ((const uint8_t *) src + (offset < buf->datas[0].maxsize ? offset : 0));
+        const uint32_t n_frames = size / sizeof(float);
+
+        if (!atomic_load_explicit(&probe->capture_started, memory_order_relaxed)) {
+            probe->capture_ns = cycle_time(probe->capture, &probe->capture_delay);
+            atomic_store_explicit(&probe->capture_started, true, memory_order_release);
+        }
+
+        const uint32_t left = probe->recording_frames - probe->record_pos;
+        const uint32_t count = left < n_frames ? left : n_frames;
+        memcpy(probe->recording + probe->record_pos, src, count * sizeof(float));
+        probe->record_pos += count;
+        if (probe->record_pos >= probe->recording_frames) {
+            atomic_store_explicit(&probe->finished, true, memory_order_release);
+        }
+    }
+    pw_stream_queue_buffer(probe->capture, b);
+}
+
+static void on_probe_state_changed(void *userdata, enum pw_stream_state old, enum pw_stream_state state,
+                                   const char *error) {
+    latency_probe_t *probe = userdata;
+    (void) old;
+    if (state == PW_STREAM_STATE_ERROR) {
+        log_error("Latency measurement stream error: %s", error ? error : "unknown");
+        atomic_store(&probe->failed, true);
+        atomic_store(&probe->finished, true);
+    }
+}
+
+static const struct pw_stream_events playback_events = {
+        PW_VERSION_STREAM_EVENTS,
+        .process = on_playback_process,
+        .state_changed = on_probe_state_changed,
+};
+
+static const struct pw_stream_events capture_events = {
+        PW_VERSION_STREAM_EVENTS,
+        .process = on_capture_process,
+        .state_changed = on_probe_state_changed,
+};
+
+// Maximum length sequence of +-1 scaled to the measurement level
+static void render_mls(float *out, uint32_t frames, float amplitude) {
+    uint32_t lfsr = 1;
+    for (uint32_t i = 0; i < frames; i++) {
+        out[i] = (lfsr & 1u) ? amplitude : -amplitude;
+        lfsr = (lfsr >> 1) ^ ((0u - (lfsr & 1u)) & LATENCY_MLS_TAPS);
+    }
+}
+
+static bool render_chirp(float *out, uint32_t frames) {
+    generator_config_t config;
+    generator_defaults(&config, GENERATOR_SWEEP);
+    config.sweep_seconds = LATENCY_CHIRP_SECONDS;
+    config.level_db = LATENCY_LEVEL_DB;
+
+    generator_t *generator = generator_create(&config, NULL, 1, LATENCY_RATE);
+    if (!generator) return false;
+    generator_process(generator, out, frames);
+    generator_destroy(generator);
+    return true;
+}
+
+// Mono stream on one named channel; the position comes from the same table tracks use
+static struct pw_stream *connect_stream(latency_probe_t *probe, struct pw_loop *loop, const registry_t *registry,
+                                        enum pw_direction direction, const char *device, const char *channel) {
+    const bool playback = direction == PW_DIRECTION_OUTPUT;
+    struct pw_properties *props = pw_properties_new(
+            PW_KEY_MEDIA_TYPE, "Audio",
+            PW_KEY_MEDIA_CATEGORY, playback ? "Playback" : "Capture",
+            PW_KEY_MEDIA_ROLE, "Test",
+            PW_KEY_NODE_NAME, playback ? "papa_latency_playback" : "papa_latency_capture",
+            NULL
+    );
+    if (!props) return NULL;
+
+    char target[128];
+    if (registry_target(registry, device, target, sizeof(target))) {
+        pw_properties_set(props, PW_KEY_TARGET_OBJECT, target);
+    }
+    pw_properties_set(props, PW_KEY_NODE_CHANNELNAMES, channel);
+
+    struct pw_stream *stream = pw_stream_new_simple(loop, playback ? "papa_latency_playback" : "papa_latency_capture",
+                                                    props, playback ? &playback_events : &capture_events, probe);
+    if (!stream) return NULL;
+
+    uint8_t buffer[1024];
+    struct spa_pod_builder b;
+    spa_pod_builder_init(&b, buffer, sizeof(buffer));
+
+    struct spa_audio_info_raw audio_info = {
+            .format = SPA_AUDIO_FORMAT_F32,
+            .channels = 1,
+            .rate = LATENCY_RATE
+    };
+    audio_info.position[0] = get_channel_position(channel);
+    if (audio_info.position[0] == SPA_AUDIO_CHANNEL_UNKNOWN) {
+        log_warn("Unknown channel name '%s', using MONO", channel);
+        audio_info.position[0] = SPA_AUDIO_CHANNEL_MONO;
+    }
+
+    const struct spa_pod *params[1];
+    params[0] = spa_format_audio_raw_build(&b, SPA_PARAM_EnumFormat, &audio_info);
+
+    if (pw_stream_connect(stream, direction, PW_ID_ANY,
+                          PW_STREAM_FLAG_AUTOCONNECT | PW_STREAM_FLAG_MAP_BUFFERS | PW_STREAM_FLAG_RT_PROCESS,
+                          params, 1) < 0) {
+        log_error("Failed to connect latency %s stream", playback ? "playback" : "capture");
+        pw_stream_destroy(stream);
+        return NULL;
+    }
+    return stream;
+}
+
+latency_probe_t *latency_probe_create(struct pw_loop *loop, const registry_t *registry,
+                                      const global_config_t *global, const char *device, const char *channel,
+                                      const char *capture_device, const char *capture_channel,
+                                      latency_signal_t signal) {
+    if (!loop || !channel) return NULL;
+
+    latency_probe_t *probe = arena_calloc(1, sizeof(latency_probe_t));
+    if (!probe) return NULL;
+
+    snprintf(probe->device, sizeof(probe->device), "%s", device ? device : "default");
+    snprintf(probe->channel, sizeof(probe->channel), "%s", channel);
+    atomic_init(&probe->capture_started, false);
+    atomic_init(&probe->finished, false);
+    atomic_init(&probe->failed, false);
+
+    probe->reference_frames = signal == LATENCY_SIGNAL_CHIRP ? (uint32_t) (LATENCY_CHIRP_SECONDS * LATENCY_RATE)
+                                                             : (1u << LATENCY_MLS_ORDER) - 1;
+    probe->recording_frames = probe->reference_frames +
+                              (uint32_t) ((LATENCY_START_SECONDS + LATENCY_MAX_SECONDS) * LATENCY_RATE);
+    probe->reference = arena_calloc(probe->reference_frames, sizeof(float));
+    probe->recording = arena_calloc(probe->recording_frames, sizeof(float));
+    if (!probe->reference || !probe->recording) {
+        log_error("Failed to allocate latency measurement buffers");
+        latency_probe_destroy(probe);
+        return NULL;
+    }
+
+    if (signal == LATENCY_SIGNAL_CHIRP) {
+        if (!render_chirp(probe->reference, probe->reference_frames)) {
+            latency_probe_destroy(probe);
+            return NULL;
+        }
+    } else {
+        render_mls(probe->reference, probe->reference_frames, powf(10.0f, LATENCY_LEVEL_DB / 20.0f));
+    }
+
+    // Same device processing a track on this channel goes through, so it counts towards the result
+    const char *names[1] = {channel};
+    probe->stage = output_stage_create(global, probe->device, names, 1, LATENCY_RATE);
+
+    probe->capture = connect_stream(probe, loop, registry, PW_DIRECTION_INPUT, capture_device,
+                                    capture_channel ? capture_channel : "MONO");
+    probe->playback = probe->capture ? connect_stream(probe, loop, registry, PW_DIRECTION_OUTPUT, probe->device,
+                                                      channel) : NULL;
+    if (!probe->playback) {
+        latency_probe_destroy(probe);
+        return NULL;
+    }
+
+    log_info("Measuring latency of %s on %s (%s, capture from %s)", channel, probe->device,
+             signal == LATENCY_SIGNAL_CHIRP ? "chirp" : "MLS", capture_device ? capture_device : "default");
+    return probe;
+}
+
+double latency_probe_timeout(const latency_probe_t *probe) {
+    if (!probe) return 0.0;
+    return LATENCY_CONNECT_SECONDS + (double) probe->recording_frames / LATENCY_RATE;
+}
+
+bool latency_probe_finished(const latency_probe_t *probe) {
+    return !probe || atomic_load_explicit(&probe->finished, memory_order_acquire);
+}
+
+void latency_probe_stop(latency_probe_t *probe) {
+    if (!probe) return;
+    if (probe->playback) {
+        pw_stream_destroy(probe->playback);
+        probe->playback = NULL;
+    }
+    if (probe->capture) {
+        pw_stream_destroy(probe->capture);
+        probe->capture = NULL;
+    }
+}
+
+bool latency_probe_analyze(latency_probe_t *probe, latency_result_t *result) {
+    if (!probe || !result) return false;
+    if (atomic_load(&probe->failed) || !atomic_load(&probe->finished) || !probe->play_started) {
+        log_error("Latency measurement did not complete");
+        return false;
+    }
+
+    size_t size = 1;
+    while (size < (size_t) probe->recording_frames + probe->reference_frames) size <<= 1;
+    const size_t bins = size / 2 + 1;
+
+    fft_t *fft = fft_create(size);
+    float *time = calloc(size, sizeof(float));
+    float *rec_re = calloc(bins, sizeof(float));
+    float *rec_im = calloc(bins, sizeof(float));
+    float *ref_re = calloc(bins, sizeof(float));
+    float *ref_im = calloc(bins, sizeof(float));
+    bool ok = fft && time && rec_re && rec_im && ref_re && ref_im;
+
+    if (ok) {
+        // Correlation of recording and reference: IFFT(REC * conj(REF)), positive lags only
+        memcpy(time, probe->recording, probe->recording_frames * sizeof(float));
+        fft_forward(fft, time, rec_re, rec_im);
+        memset(time, 0, size * sizeof(float));
+        memcpy(time, probe->reference, probe->reference_frames * sizeof(float));
+        fft_forward(fft, time, ref_re, ref_im);
+        for (size_t k = 0; k < bins; k++) {
+            const float re = rec_re[k] * ref_re[k] + rec_im[k] * ref_im[k];
+            const float im = rec_im[k] * ref_re[k] - rec_re[k] * ref_im[k];
+            rec_re[k] = re;
+            rec_im[k] = im;
+        }
+        fft_inverse(fft, rec_re, rec_im, time);
+
+        size_t peak = 0;
+        double sum_square = 0.0;
+        for (size_t lag = 0; lag < probe->recording_frames; lag++) {
+            sum_square += (double) time[lag] * time[lag];
+            if (fabsf(time[lag]) > fabsf(time[peak])) peak = lag;
+        }
+        const double rms = sqrt(sum_square / probe->recording_frames);
+        const float peak_db = rms > 0.0 ? (float) (20.0 * log10(fabsf(time[peak]) / rms)) : 0.0f;
+
+        // The recording started earlier than the signal by the gap between their graph cycles
+        const int64_t start_offset = (int64_t) llround(
+                ((double) probe->play_ns - (double) probe->capture_ns) * LATENCY_RATE / 1e9);
+
+        result->samplerate = LATENCY_RATE;
+        result->frames = (int64_t) peak - start_offset;
+        result->ms = result->frames * 1000.0 / LATENCY_RATE;
+        result->reported_frames = probe->play_delay + probe->capture_delay;
+        result->stage_frames = output_stage_latency(probe->stage);
+        result->peak_db = peak_db;
+
+        if (peak_db < LATENCY_MIN_PEAK_DB || result->frames < 0) {
+            log_error("No clear correlation peak (%.1f dB at %lld frames), check the loopback", peak_db,
+                      (long long) result->frames);
+            ok = false;
+        }
+    } else {
+        log_error("Failed to allocate %zu point correlation", size);
+    }
+
+    fft_destroy(fft);
+    free(time);
+    free(rec_re);
+    free(rec_im);
+    free(ref_re);
+    free(ref_im);
+    return ok;
+}
+
+void latency_probe_destroy(latency_probe_t *probe) {
+    if (!probe) return;
+    latency_probe_stop(probe);
+    output_stage_destroy(probe->stage);
+    arena_free(probe->reference);
+    arena_free(probe->recording);
+    arena_free(probe);
+}
@@ -0,0 +1,47 @@
+#ifndef ASYNC_AUDIO_PLAYER_LATENCY_H
+#define ASYNC_AUDIO_PLAYER_LATENCY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "types.h"
+#include "registry.h"
+
+typedef enum {
+    LATENCY_SIGNAL_MLS,     // Maximum length sequence, robust against noise
+    LATENCY_SIGNAL_CHIRP    // Logarithmic sweep, for paths that do not pass broadband noise well
+} latency_signal_t;
+
+typedef struct {
+    int samplerate;
+    int64_t frames;             // From writing a sample into the stream to capturing it
+    double ms;
+    int64_t reported_frames;    // Playback plus capture delay reported by PipeWire
+    uint32_t stage_frames;      // Part of the round trip spent in the output stage
+    float peak_db;              // Correlation peak over the correlation RMS
+} latency_result_t;
+
+// Round-trip measurement: a test signal is played on one channel of an output the way a track would
+// play it (same routing and output stage) while a capture stream records the loopback
+typedef struct latency_probe latency_probe_t;
+
+// Connect the playback and capture streams; "default" or NULL devices follow the session defaults
+latency_probe_t *latency_probe_create(struct pw_loop *loop, const registry_t *registry,
+                                      const global_config_t *global, const char *device, const char *channel,
+                                      const char *capture_device, const char *capture_channel,
+                                      latency_signal_t signal);
+
+// Seconds after which a probe that has not finished should be abandoned
+double latency_probe_timeout(const latency_probe_t *probe);
+
+// True once the capture buffer is full or a stream failed
+bool latency_probe_finished(const latency_probe_t *probe);
+
+// Disconnect both streams; the recording stays for latency_probe_analyze (main loop, lock held)
+void latency_probe_stop(latency_probe_t *probe);
+
+// Cross-correlate the recording with the played signal; false without a clear peak
+bool latency_probe_analyze(latency_probe_t *probe, latency_result_t *result);
+
+void latency_probe_destroy(latency_probe_t *probe);
+
+#endif // ASYNC_AUDIO_PLAYER_LATENCY_H
@@ -11,6 +11,11 @@
 #include "track_manager.h"
 #include "signal_handler.h"
 #include "socket_server.h"
+#include "pcm_cache.h"
+#include "preload.h"
+#include "sample_cache.h"
+#include "arena.h"
+#include "thread_policy.h"
 
 #ifndef RUNTIME_SUBDIR
 #define RUNTIME_SUBDIR "papa"
@@ -18,8 +23,29 @@
 
 static char pid_file_path[256]; // To store the actual path
 
+// Set by --config and --socket so several instances can run side by side
+static const char *config_override = NULL;
+static const char *socket_override = NULL;
+
 // Create PID file
 static bool create_pid_file(void) {
+    // An instance on its own socket keeps its PID next to it
+    if (socket_override) {
+        if (snprintf(pid_file_path, sizeof(pid_file_path), "%s.pid", socket_override) >= (int) sizeof(pid_file_path)) {
+            log_error("PID file path too long");
+            return false;
+        }
+        FILE *file = fopen(pid_file_path, "w");
+        if (!file) {
+            log_error("Failed to create PID file: %s", pid_file_path);
+            return false;
+        }
+        fprintf(file, "%d\n", getpid());
+        fclose(file);
+        log_info("Created PID file: %s", pid_file_path);
+        return true;
+    }
+
     const char *xdg = getenv("XDG_RUNTIME_DIR");
     char dir_path[PATH_MAX];
 
@@ -79,6 +105,9 @@ static const char *CONFIG_PATHS[] = {
 
 // Find existing configuration file
 static const char *find_config_file(void) {
+    if (config_override) {
+        return access(config_override, R_OK) == 0 ? config_override : NULL;
+    }
     for (const char **path = CONFIG_PATHS; *path != NULL; path++) {
         if (access(*path, R_OK) == 0) {
             return *path;
@@ -100,15 +129,20 @@ int main(const int argc, char *argv[]) {
     // Initialize logging
     log_info("PAPA - PipeWire Async Polyphonic Audio Player starting...");
 
-    // Print help if requested
+    // Parse options, print help if requested
     for (int i = 1; i < argc; i++) {
-        if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+        if (strcmp(argv[i], "--config") == 0 && i + 1 < argc) {
+            config_override = argv[++i];
+        } else if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            socket_override = argv[++i];
+        } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
             printf("PAPA - PipeWire Async Polyphonic Audio Player\n");
-            printf("Usage: %s [--help]\n\n", argv[0]);
+            printf("Usage: %s [--config <path>] [--socket <path>] [--help]\n\n", argv[0]);
             printf("This program runs as a server. To control it, use the 'papa' client utility.\n");
             char socket_path[256];
             printf("The server listens for commands on the Unix socket at %s\n",
-                   get_socket_path(socket_path, sizeof(socket_path)) ? socket_path : "<error>");
+                   socket_override ? socket_override
+                                   : get_socket_path(socket_path, sizeof(socket_path)) ? socket_path : "<error>");
             return EXIT_SUCCESS;
         }
     }
@@ -140,6 +174,31 @@ int main(const int argc, char *argv[]) {
         log_set_level(g_config->logging.level);
     }
 
+    // Scheduling policy is picked up by each thread as it starts
+    thread_policy_init(g_config);
+
+    // Reserve locked memory for audio buffers before anything allocates them
+    if (!arena_init(g_config)) {
+        log_warn("Failed to initialize audio arena - using heap allocation");
+    }
+
+    // Apply the memory budget before preloading fills the sample cache
+    if (!sample_cache_init(g_config)) {
+        log_warn("Failed to initialize sample cache");
+    }
+
+    // Validate and warm all track files before accepting commands
+    if (!preload_run(g_config) && g_config->preload.strict) {
+        log_error("Track validation failed and preload is strict");
+        returnInt = EXIT_FAILURE;
+        goto cleanup;
+    }
+
+    // Start building the decoded PCM cache in the background
+    if (!pcm_cache_init(g_config)) {
+        log_warn("Failed to initialize PCM cache - decoding sources directly");
+    }
+
     // Initialize track manager
     g_track_manager = track_manager_init(g_config);
     if (!g_track_manager) {
@@ -148,6 +207,7 @@ int main(const int argc, char *argv[]) {
         goto cleanup;
     }
 
+    arena_report();
     log_info("Initialization complete");
 
     // Create PID file
@@ -160,7 +220,7 @@ int main(const int argc, char *argv[]) {
         log_error("Socket server is already initialized!");
         return EXIT_FAILURE; // Or appropriate error handling
     }
-    g_socket_server = socket_server_init(g_track_manager);
+    g_socket_server = socket_server_init(g_track_manager, socket_override);
     if (!g_socket_server) {
         log_error("Failed to initialize socket server");
         returnInt = EXIT_FAILURE;
@@ -174,6 +234,9 @@ int main(const int argc, char *argv[]) {
         goto cleanup;
     }
 
+    // Pin the main loop last so threads created above do not inherit its policy
+    thread_policy_apply(THREAD_ROLE_CONTROL);
+
     // Main loop
     bool running = true;
     while (running) {
@@ -194,17 +257,35 @@ int main(const int argc, char *argv[]) {
                     } else {
                         global_config_t *new_config = config_reload(reload_path);
                         if (new_config) {
+                            // Nothing on the socket may touch the old track manager past this point
+                            socket_server_quiesce(g_socket_server);
                             track_manager_stop_all(g_track_manager);
                             track_manager_cleanup(g_track_manager);
                             config_free(g_config);
                             g_config = new_config;
 
+                            thread_policy_init(g_config);
+
+                            if (!sample_cache_init(g_config)) {
+                                log_warn("Failed to reinitialize sample cache");
+                            }
+                            if (!preload_run(g_config)) {
+                                log_warn("Some tracks failed validation after reload");
+                            }
+                            if (!pcm_cache_init(g_config)) {
+                                log_warn("Failed to reinitialize PCM cache");
+                            }
+
                             g_track_manager = track_manager_init(g_config);
                             if (!g_track_manager) {
                                 log_error("Failed to reinitialize track manager");
                                 running = false;
                                 break;
                             }
+                            socket_server_set_track_manager(g_socket_server, g_track_manager);
+
+                            // As at startup, after everything that creates threads
+                            thread_policy_apply(THREAD_ROLE_CONTROL);
 
                             log_info("Configuration reloaded successfully");
                         } else {
@@ -221,7 +302,7 @@ int main(const int argc, char *argv[]) {
                 if (g_track_manager) {
                     track_manager_process_events(g_track_manager);
                 }
-                usleep(100000); // 100 ms sleep to prevent heavy loop
+                usleep(10000); // 10 ms tick keeps cue scheduling well inside the preroll
                 break;
         }
     }
@@ -236,10 +317,14 @@ int main(const int argc, char *argv[]) {
     if (g_track_manager) {
         track_manager_cleanup(g_track_manager);
     }
+    sample_cache_cleanup();
+    pcm_cache_cleanup();
     if (g_config) {
         config_free(g_config);
     }
 
+    arena_cleanup();
+
     remove_pid_file();
     signal_handler_cleanup();
     return returnInt;
@@ -0,0 +1,114 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "meter.h"
+#include "dsp.h"
+
+#define METER_PEAK_FALL_DB 20.0f        // Peak hold decay per second
+#define METER_RMS_WINDOW_MS 300.0f      // Integration time of the RMS average
+#define METER_FLOOR_DB -120.0f
+
+void meter_init(meter_t *meter, int channels, int samplerate) {
+    memset(meter, 0, sizeof(*meter));
+    meter->channels = channels < METER_MAX_CHANNELS ? channels : METER_MAX_CHANNELS;
+    meter->rate = samplerate > 0 ? (float) samplerate : 48000.0f;
+    atomic_init(&meter->sequence, 0);
+}
+
+// Block peak, sum of squares and clip count per channel, vectorized across the channels of a frame
+DSP_VECTORIZE
+static void measure_block(const float *restrict samples, size_t n_frames, int stride, int channels,
+                          float *restrict peak, float *restrict sum_square, float *restrict clips) {
+    for (int ch = 0; ch < channels; ch++) {
+        peak[ch] = 0.0f;
+        sum_square[ch] = 0.0f;
+        clips[ch] = 0.0f;
+    }
+
+    for (size_t f = 0; f < n_frames; f++) {
+        const float *frame = samples + f * stride;
+        for (int ch = 0; ch < channels; ch++) {
+            const float a = fabsf(frame[ch]);
+            peak[ch] = peak[ch] > a ? peak[ch] : a;
+            sum_square[ch] += a * a;
+            clips[ch] += a >= 1.0f ? 1.0f : 0.0f;
+        }
+    }
+}
+
+void meter_process(meter_t *meter, const float *samples, size_t n_frames, int stride) {
+    if (!meter || meter->channels <= 0 || n_frames == 0) return;
+
+    float block_peak[METER_MAX_CHANNELS];
+    float block_square[METER_MAX_CHANNELS];
+    float block_clips[METER_MAX_CHANNELS];
+    const int channels = meter->channels < stride ? meter->channels : stride;
+    measure_block(samples, n_frames, stride, channels, block_peak, block_square, block_clips);
+
+    const float seconds = (float) n_frames / meter->rate;
+    const float fall = powf(10.0f, -METER_PEAK_FALL_DB * seconds / 20.0f);
+    const float keep = expf(-seconds * 1000.0f / METER_RMS_WINDOW_MS);
+
+    for (int ch = 0; ch < channels; ch++) {
+        const float held = meter->peak[ch] * fall;
+        meter->peak[ch] = block_peak[ch] > held ? block_peak[ch] : held;
+        meter->mean_square[ch] = meter->mean_square[ch] * keep + block_square[ch] / (float) n_frames * (1.0f - keep);
+        meter->clips[ch] += (uint32_t) block_clips[ch];
+    }
+    meter->frames += n_frames;
+
+    // Mark the write as started before touching the slot, so a reader still copying it from two
+    // publications ago sees the change; the fence keeps the slot stores behind the marker
+    const uint32_t sequence = atomic_load_explicit(&meter->sequence, memory_order_relaxed);
+    atomic_store_explicit(&meter->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    meter_snapshot_t *next = &meter->snapshots[((sequence >> 1) + 1) & 1];
+    for (int ch = 0; ch < channels; ch++) {
+        next->peak[ch] = meter->peak[ch];
+        next->rms[ch] = sqrtf(meter->mean_square[ch]);
+        next->clips[ch] = meter->clips[ch];
+    }
+    next->frames = meter->frames;
+    atomic_store_explicit(&meter->sequence, sequence + 2, memory_order_release);
+}
+
+bool meter_read(const meter_t *meter, meter_snapshot_t *snapshot) {
+    if (!meter || !snapshot) return false;
+
+    // Copy the last complete publication; retry if the writer began refilling its slot meanwhile,
+    // which is marked by the sequence reaching the odd value of the publication after next
+    for (;;) {
+        const uint32_t before = atomic_load_explicit(&meter->sequence, memory_order_acquire);
+        const uint32_t published = before & ~1u;
+
+        memcpy(snapshot, &meter->snapshots[(published >> 1) & 1], sizeof(*snapshot));
+        atomic_thread_fence(memory_order_acquire);
+        const uint32_t after = atomic_load_explicit(&meter->sequence, memory_order_relaxed);
+        if (after - published < 3) return snapshot->frames > 0;
+    }
+}
+
+static float to_db(float linear) {
+    return linear > 0.0f ? fmaxf(20.0f * log10f(linear), METER_FLOOR_DB) : METER_FLOOR_DB;
+}
+
+int meter_format(const meter_t *meter, const char *const *names, char *buffer, size_t size) {
+    meter_snapshot_t snapshot;
+    if (!meter_read(meter, &snapshot)) {
+        return snprintf(buffer, size, " idle");
+    }
+
+    int written = 0;
+    for (int ch = 0; ch < meter->channels; ch++) {
+        char name[16];
+        snprintf(name, sizeof(name), "%s", names && names[ch] ? names[ch] : "");
+        if (!name[0]) snprintf(name, sizeof(name), "%d", ch);
+
+        const int n = snprintf(buffer + written, size > (size_t) written ? size - written : 0, " %s=%.1f/%.1f/%u",
+                               name, to_db(snapshot.peak[ch]), to_db(snapshot.rms[ch]), snapshot.clips[ch]);
+        if (n < 0) break;
+        written += n;
+    }
+    return written;
+}
@@ -0,0 +1,47 @@
+#ifndef ASYNC_AUDIO_PLAYER_METER_H
+#define ASYNC_AUDIO_PLAYER_METER_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define METER_MAX_CHANNELS 32
+
+// Levels published by the data thread; peak and RMS are linear
+typedef struct {
+    float peak[METER_MAX_CHANNELS];     // Peak hold, falling at METER_PEAK_FALL_DB per second
+    float rms[METER_MAX_CHANNELS];      // RMS with a METER_RMS_WINDOW_MS integration time
+    uint32_t clips[METER_MAX_CHANNELS]; // Samples at or above full scale since the meter started
+    uint64_t frames;                    // Frames measured since the meter started
+} meter_snapshot_t;
+
+// Single-writer level meter; readers take a consistent snapshot without blocking the writer
+typedef struct {
+    int channels;
+    float rate;
+
+    // Ballistics state, owned by the data thread
+    float peak[METER_MAX_CHANNELS];
+    float mean_square[METER_MAX_CHANNELS];
+    uint32_t clips[METER_MAX_CHANNELS];
+    uint64_t frames;
+
+    // Double-buffered seqlock: twice the publication count, odd while the writer fills the next slot
+    meter_snapshot_t snapshots[2];
+    _Atomic uint32_t sequence;
+} meter_t;
+
+// Reset a meter; channels above METER_MAX_CHANNELS are not measured
+void meter_init(meter_t *meter, int channels, int samplerate);
+
+// Measure one interleaved block and publish the result (data thread)
+void meter_process(meter_t *meter, const float *samples, size_t n_frames, int stride);
+
+// Copy the latest published levels; returns false if the meter has not run yet
+bool meter_read(const meter_t *meter, meter_snapshot_t *snapshot);
+
+// Append "NAME=peak/rms/clips" fields in dBFS for each channel, names may be NULL
+int meter_format(const meter_t *meter, const char *const *names, char *buffer, size_t size);
+
+#endif // ASYNC_AUDIO_PLAYER_METER_H
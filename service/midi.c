@@ -0,0 +1,277 @@
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <spa/control/control.h>
+#include <spa/node/io.h>
+#include <spa/pod/iter.h>
+#include "midi.h"
+#include "show.h"
+#include "track_manager.h"
+#include "thread_policy.h"
+#include "log.h"
+
+#define MIDI_DEFAULT_NAME "papa_midi"
+#define MIDI_DEFAULT_LATENCY_MS 30      // Covers the 10 ms control tick and a graph cycle
+#define MIDI_EVENT_SLOTS 1024           // Power of two
+
+// Message that matched a mapping, passed from the data thread to the control thread
+typedef struct {
+    uint64_t time_ns;       // CLOCK_MONOTONIC time of the message's frame
+    uint16_t mapping;
+    uint8_t value;          // Velocity, controller value or program number
+} midi_event_t;
+
+struct midi_input {
+    const global_config_t *config;
+    track_manager_ctx_t *track_manager;
+    struct pw_filter *filter;
+    void *port;
+    char name[128];
+    uint64_t latency_ns;
+
+    // Single producer (data thread), single consumer (control thread)
+    midi_event_t events[MIDI_EVENT_SLOTS];
+    _Atomic uint32_t head;
+    _Atomic uint32_t tail;
+    _Atomic uint64_t received;
+    _Atomic uint64_t dropped;       // Matched while the event queue was full
+
+    // Control thread, track manager lock held
+    uint64_t actions;
+    uint64_t failed;
+    uint64_t late;
+    uint64_t late_max_ns;
+};
+
+static const char *action_name(const midi_action_type_t action) {
+    switch (action) {
+        case MIDI_ACTION_PLAY: return "play";
+        case MIDI_ACTION_STOP: return "stop";
+        case MIDI_ACTION_VOLUME: return "volume";
+        case MIDI_ACTION_GO: return "go";
+        case MIDI_ACTION_GOTO: return "goto";
+        default: return "?";
+    }
+}
+
+// --- Data thread ---
+
+static void push_event(midi_input_t *midi, const uint64_t time_ns, const int mapping, const uint8_t value) {
+    const uint32_t head = atomic_load_explicit(&midi->head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&midi->tail, memory_order_acquire) >= MIDI_EVENT_SLOTS) {
+        atomic_fetch_add_explicit(&midi->dropped, 1, memory_order_relaxed);
+        return;
+    }
+    midi->events[head & (MIDI_EVENT_SLOTS - 1)] = (midi_event_t) {
+            .time_ns = time_ns,
+            .mapping = (uint16_t) mapping,
+            .value = value
+    };
+    atomic_store_explicit(&midi->head, head + 1, memory_order_release);
+}
+
+// Match one message against every mapping; a message can trigger several
+static void match_message(midi_input_t *midi, const uint8_t *data, const uint32_t size, const uint64_t time_ns) {
+    if (size < 2) return;   // Real-time and truncated messages
+    atomic_fetch_add_explicit(&midi->received, 1, memory_order_relaxed);
+
+    const int channel = (data[0] & 0x0f) + 1;
+    const int number = data[1] & 0x7f;
+    const uint8_t value = size >= 3 ? data[2] & 0x7f : 0;
+    midi_event_type_t type;
+    switch (data[0] & 0xf0) {
+        case 0x90:
+            type = value > 0 ? MIDI_EVENT_NOTE_ON : MIDI_EVENT_NOTE_OFF;
+            break;
+        case 0x80:
+            type = MIDI_EVENT_NOTE_OFF;
+            break;
+        case 0xb0:
+            type = MIDI_EVENT_CC;
+            break;
+        case 0xc0:
+            type = MIDI_EVENT_PROGRAM;
+            break;
+        default:
+            return;
+    }
+    if (type != MIDI_EVENT_PROGRAM && size < 3) return;
+
+    for (int i = 0; i < midi->config->midi.mapping_count; i++) {
+        const midi_mapping_t *mapping = &midi->config->midi.mappings[i];
+        if (mapping->event == type && (mapping->channel == 0 || mapping->channel == channel) &&
+            (mapping->number < 0 || mapping->number == number)) {
+            push_event(midi, time_ns, i, type == MIDI_EVENT_PROGRAM ? (uint8_t) number : value);
+        }
+    }
+}
+
+static void on_process(void *userdata, struct spa_io_position *position) {
+    midi_input_t *midi = userdata;
+    thread_policy_register_data_thread();
+
+    struct pw_buffer *b = pw_filter_dequeue_buffer(midi->port);
+    if (!b) return;
+
+    struct spa_data *d = &b->buffer->datas[0];
+    struct spa_pod *pod = d->data ? spa_pod_from_data(d->data, d->maxsize, d->chunk->offset, d->chunk->size) : NULL;
+    if (pod && spa_pod_is_sequence(pod)) {
+        // Events carry their frame offset into the cycle; the cycle start is on CLOCK_MONOTONIC
+        const uint64_t cycle_ns = position ? position->clock.nsec : track_manager_now_ns();
+        const uint32_t rate = position && position->clock.rate.denom ? position->clock.rate.denom : 48000;
+
+        struct spa_pod_control *control;
+        SPA_POD_SEQUENCE_FOREACH((struct spa_pod_sequence *) pod, control) {
+            if (control->type != SPA_CONTROL_Midi) continue;
+            const uint64_t time_ns = cycle_ns + (uint64_t) control->offset * 1000000000ull / rate;
+            match_message(midi, SPA_POD_BODY(&control->value), SPA_POD_BODY_SIZE(&control->value), time_ns);
+        }
+    }
+
+    pw_filter_queue_buffer(midi->port, b);
+}
+
+static const struct pw_filter_events filter_events = {
+        PW_VERSION_FILTER_EVENTS,
+        .process = on_process,
+};
+
+// --- Control thread ---
+
+static void run_event(midi_input_t *midi, const midi_event_t *event) {
+    const midi_mapping_t *mapping = &midi->config->midi.mappings[event->mapping];
+
+    // The same delay for every event keeps their spacing; only events picked up too late are moved
+    const uint64_t at_ns = event->time_ns + midi->latency_ns;
+    const uint64_t now_ns = track_manager_now_ns();
+    if (now_ns > at_ns) {
+        midi->late++;
+        if (now_ns - at_ns > midi->late_max_ns) midi->late_max_ns = now_ns - at_ns;
+    }
+
+    bool ok = false;
+    switch (mapping->action) {
+        case MIDI_ACTION_PLAY:
+            ok = mapping->target && track_manager_play_at(midi->track_manager, mapping->target, at_ns);
+            break;
+        case MIDI_ACTION_STOP:
+            ok = mapping->target && track_manager_stop_at(midi->track_manager, mapping->target, at_ns);
+            break;
+        case MIDI_ACTION_VOLUME:
+            ok = mapping->target && track_manager_set_volume_at(midi->track_manager, mapping->target,
+                                                                mapping->gain * (float) event->value / 127.0f, at_ns);
+            break;
+        case MIDI_ACTION_GO: {
+            bool resumed = false;
+            ok = show_go_at(track_manager_get_show(midi->track_manager), at_ns, &resumed) != NULL;
+            break;
+        }
+        case MIDI_ACTION_GOTO:
+            ok = mapping->target && show_fire_at(track_manager_get_show(midi->track_manager), mapping->target, at_ns);
+            break;
+    }
+
+    midi->actions++;
+    if (!ok) {
+        midi->failed++;
+        log_warn("MIDI: %s %s failed", action_name(mapping->action), mapping->target ? mapping->target : "");
+    }
+}
+
+void midi_input_process(midi_input_t *midi) {
+    if (!midi) return;
+
+    const uint32_t head = atomic_load_explicit(&midi->head, memory_order_acquire);
+    uint32_t tail = atomic_load_explicit(&midi->tail, memory_order_relaxed);
+    for (; tail != head; tail++) {
+        run_event(midi, &midi->events[tail & (MIDI_EVENT_SLOTS - 1)]);
+    }
+    atomic_store_explicit(&midi->tail, tail, memory_order_release);
+}
+
+midi_input_t *midi_input_create(struct pw_loop *loop, const global_config_t *config,
+                                track_manager_ctx_t *track_manager) {
+    if (!config || !config->midi.enabled) return NULL;
+
+    for (int i = 0; i < config->midi.mapping_count; i++) {
+        const midi_mapping_t *mapping = &config->midi.mappings[i];
+        if (!mapping->target && mapping->action != MIDI_ACTION_GO) {
+            log_warn("MIDI: mapping %d (%s) has no %s", i + 1, action_name(mapping->action),
+                     mapping->action == MIDI_ACTION_GOTO ? "cue" : "track");
+        }
+    }
+    if (config->midi.mapping_count == 0) {
+        log_warn("MIDI: no mappings, messages will be counted only");
+    }
+
+    midi_input_t *midi = calloc(1, sizeof(midi_input_t));
+    if (!midi) {
+        log_error("Failed to allocate MIDI input");
+        return NULL;
+    }
+    midi->config = config;
+    midi->track_manager = track_manager;
+    midi->latency_ns = (uint64_t) (config->midi.latency_ms > 0 ? config->midi.latency_ms
+                                                               : MIDI_DEFAULT_LATENCY_MS) * 1000000ull;
+    snprintf(midi->name, sizeof(midi->name), "%s", config->midi.name ? config->midi.name : MIDI_DEFAULT_NAME);
+    atomic_init(&midi->head, 0);
+    atomic_init(&midi->tail, 0);
+
+    struct pw_properties *props = pw_properties_new(
+            PW_KEY_MEDIA_TYPE, "Midi",
+            PW_KEY_MEDIA_CATEGORY, "Filter",
+            PW_KEY_MEDIA_ROLE, "DSP",
+            PW_KEY_NODE_NAME, midi->name,
+            PW_KEY_NODE_DESCRIPTION, "PAPA MIDI triggers",
+            NULL
+    );
+    if (!props) {
+        log_error("Failed to create MIDI node properties");
+        free(midi);
+        return NULL;
+    }
+
+    // Takes ownership of props
+    midi->filter = pw_filter_new_simple(loop, midi->name, props, &filter_events, midi);
+    if (!midi->filter) {
+        log_error("Failed to create MIDI node %s", midi->name);
+        free(midi);
+        return NULL;
+    }
+
+    midi->port = pw_filter_add_port(midi->filter, PW_DIRECTION_INPUT, PW_FILTER_PORT_FLAG_MAP_BUFFERS, 0,
+                                    pw_properties_new(
+                                            PW_KEY_FORMAT_DSP, "8 bit raw midi",
+                                            PW_KEY_PORT_NAME, "input",
+                                            NULL),
+                                    NULL, 0);
+    if (!midi->port || pw_filter_connect(midi->filter, PW_FILTER_FLAG_RT_PROCESS, NULL, 0) < 0) {
+        log_error("Failed to connect MIDI node %s", midi->name);
+        pw_filter_destroy(midi->filter);
+        free(midi);
+        return NULL;
+    }
+
+    log_info("MIDI: input %s with %d mappings, actions %.0f ms after their message", midi->name,
+             config->midi.mapping_count, (double) midi->latency_ns / 1e6);
+    return midi;
+}
+
+int midi_input_format_status(midi_input_t *midi, char *buffer, size_t size) {
+    if (!midi) return 0;
+
+    return snprintf(buffer, size, "MIDI: %s, %llu messages, %llu actions, %llu failed, %llu dropped, %llu late "
+                                  "(max %.1f ms), latency %.0f ms\n",
+                    midi->name, (unsigned long long) atomic_load(&midi->received), (unsigned long long) midi->actions,
+                    (unsigned long long) midi->failed, (unsigned long long) atomic_load(&midi->dropped),
+                    (unsigned long long) midi->late, (double) midi->late_max_ns / 1e6,
+                    (double) midi->latency_ns / 1e6);
+}
+
+void midi_input_destroy(midi_input_t *midi) {
+    if (!midi) return;
+
+    pw_filter_destroy(midi->filter);
+    free(midi);
+}
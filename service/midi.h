@@ -0,0 +1,28 @@
+#ifndef ASYNC_AUDIO_PLAYER_MIDI_H
+#define ASYNC_AUDIO_PLAYER_MIDI_H
+
+#include <stddef.h>
+#include <pipewire/pipewire.h>
+#include "types.h"
+
+typedef struct track_manager_ctx track_manager_ctx_t;
+
+// PipeWire MIDI input. The data thread matches each message against the configured mappings in the
+// process cycle and stamps it with its frame's time; the control thread carries the matched actions out
+// at that time plus a fixed latency, so their spacing follows the MIDI timestamps to the frame.
+typedef struct midi_input midi_input_t;
+
+// Create the MIDI input node on loop; NULL when MIDI is disabled or the node cannot be created
+midi_input_t *midi_input_create(struct pw_loop *loop, const global_config_t *config,
+                                track_manager_ctx_t *track_manager);
+
+// Carry out the actions matched since the last call (control thread, track manager lock held)
+void midi_input_process(midi_input_t *midi);
+
+// Format message counts and how late actions were
+int midi_input_format_status(midi_input_t *midi, char *buffer, size_t size);
+
+// Remove the node
+void midi_input_destroy(midi_input_t *midi);
+
+#endif // ASYNC_AUDIO_PLAYER_MIDI_H
@@ -0,0 +1,427 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "osc.h"
+#include "commands.h"
+#include "track_manager.h"
+#include "thread_policy.h"
+#include "log.h"
+
+#define OSC_DEFAULT_PORT 9000
+#define OSC_DEFAULT_BIND "127.0.0.1"
+#define OSC_PREFIX "/papa/"
+#define OSC_PACKET_MAX 8192
+#define OSC_COMMAND_MAX 256
+#define OSC_MAX_DEPTH 4                     // Bundles nested deeper are dropped
+#define OSC_MAX_HELD 64                     // Untimed messages waiting for their bundle time
+#define OSC_POLL_MS 100
+#define OSC_TIMETAG_NOW 1ull                // The OSC timetag for "immediately"
+#define OSC_NTP_UNIX_OFFSET 2208988800ull   // Seconds from 1900, where timetags count from, to 1970
+
+// Message of a future bundle whose command cannot be scheduled in the engine
+typedef struct {
+    uint64_t at_ns;
+    struct sockaddr_in from;
+    char command[OSC_COMMAND_MAX];
+} osc_held_t;
+
+// Cursor over a received packet; reads check the bounds and keep the 4-byte alignment of OSC
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    size_t pos;
+} osc_reader_t;
+
+struct osc_server {
+    const global_config_t *config;
+    track_manager_ctx_t *track_manager;
+    int fd;
+    char address[64];
+    pthread_t thread;
+    _Atomic bool running;
+
+    // OSC thread only
+    osc_held_t held[OSC_MAX_HELD];      // Sorted by time
+    int held_count;
+    uint8_t packet[OSC_PACKET_MAX];
+    char response[16384];
+
+    // Read by status
+    _Atomic uint64_t messages;
+    _Atomic uint64_t bundled;           // Messages that came in bundles
+    _Atomic uint64_t failed;            // Malformed messages and failed commands
+    _Atomic uint64_t late;              // Bundles whose time had passed on arrival
+    _Atomic int held_now;
+};
+
+// --- Parsing, in place on the received packet ---
+
+static bool read_u32(osc_reader_t *reader, uint32_t *value) {
+    if (reader->size - reader->pos < 4) return false;
+    uint32_t raw;
+    memcpy(&raw, reader->data + reader->pos, sizeof(raw));
+    *value = ntohl(raw);
+    reader->pos += 4;
+    return true;
+}
+
+static bool read_u64(osc_reader_t *reader, uint64_t *value) {
+    uint32_t high, low;
+    if (!read_u32(reader, &high) || !read_u32(reader, &low)) return false;
+    *value = (uint64_t) high << 32 | low;
+    return true;
+}
+
+// Strings are NUL terminated and padded to four bytes
+static const char *read_string(osc_reader_t *reader) {
+    const char *start = (const char *) reader->data + reader->pos;
+    const size_t available = reader->size - reader->pos;
+    const char *end = memchr(start, '\0', available);
+    if (!end) return NULL;
+    const size_t padded = ((size_t) (end - start) + 4) & ~(size_t) 3;
+    if (padded > available) return NULL;
+    reader->pos += padded;
+    return start;
+}
+
+static bool append(char *command, size_t *length, const char *text) {
+    const size_t n = strlen(text);
+    if (*length + n >= OSC_COMMAND_MAX) return false;
+    memcpy(command + *length, text, n + 1);
+    *length += n;
+    return true;
+}
+
+// Turn a message into a socket command: the address words after the prefix, then the arguments
+static bool message_to_command(osc_reader_t *reader, char *command, const char **error) {
+    *error = "Malformed message";
+    const char *address = read_string(reader);
+    if (!address) return false;
+    if (strncmp(address, OSC_PREFIX, strlen(OSC_PREFIX)) != 0 || !address[strlen(OSC_PREFIX)]) {
+        *error = "Address outside " OSC_PREFIX;
+        return false;
+    }
+
+    size_t length = 0;
+    command[0] = '\0';
+    if (!append(command, &length, address + strlen(OSC_PREFIX))) {
+        *error = "Command too long";
+        return false;
+    }
+    for (char *c = command; *c; c++) {
+        if (*c == '/') *c = ' ';
+    }
+
+    // Senders from before type tags send none and no arguments
+    if (reader->pos == reader->size) return true;
+    const char *tags = read_string(reader);
+    if (!tags || tags[0] != ',') return false;
+
+    for (const char *tag = tags + 1; *tag; tag++) {
+        char number[48];
+        const char *argument = number;
+        uint32_t u32;
+        uint64_t u64;
+        switch (*tag) {
+            case 'i':
+                if (!read_u32(reader, &u32)) return false;
+                snprintf(number, sizeof(number), "%d", (int32_t) u32);
+                break;
+            case 'f': {
+                if (!read_u32(reader, &u32)) return false;
+                float value;
+                memcpy(&value, &u32, sizeof(value));
+                snprintf(number, sizeof(number), "%g", value);
+                break;
+            }
+            case 'h':
+                if (!read_u64(reader, &u64)) return false;
+                snprintf(number, sizeof(number), "%lld", (long long) (int64_t) u64);
+                break;
+            case 'd': {
+                if (!read_u64(reader, &u64)) return false;
+                double value;
+                memcpy(&value, &u64, sizeof(value));
+                snprintf(number, sizeof(number), "%.10g", value);
+                break;
+            }
+            case 's':
+            case 'S':
+                argument = read_string(reader);
+                if (!argument) return false;
+                break;
+            case 'T':
+            case 'F':
+            case 'N':
+            case 'I':
+                continue;   // No data and no word in the command
+            default:
+                *error = "Unsupported argument type";
+                return false;
+        }
+        if (!append(command, &length, " ") || !append(command, &length, argument)) {
+            *error = "Command too long";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Convert an NTP timetag to CLOCK_MONOTONIC; 0 for "immediately" and for times that have passed
+static uint64_t timetag_to_ns(osc_server_t *server, const uint64_t timetag) {
+    if (timetag == OSC_TIMETAG_NOW) return 0;
+
+    const uint64_t seconds = timetag >> 32;
+    if (seconds < OSC_NTP_UNIX_OFFSET) return 0;
+    const uint64_t wall_ns = (seconds - OSC_NTP_UNIX_OFFSET) * 1000000000ull +
+                             ((timetag & 0xffffffffull) * 1000000000ull >> 32);
+
+    // Timetags are wall clock time; the engine schedules on the monotonic clock
+    struct timespec real;
+    clock_gettime(CLOCK_REALTIME, &real);
+    const uint64_t now_ns = track_manager_now_ns();
+    const uint64_t real_ns = (uint64_t) real.tv_sec * 1000000000ull + (uint64_t) real.tv_nsec;
+    if (wall_ns <= real_ns) {
+        atomic_fetch_add(&server->late, 1);
+        return 0;
+    }
+    return now_ns + (wall_ns - real_ns);
+}
+
+// --- Dispatch ---
+
+static bool put_string(uint8_t *packet, size_t *size, const size_t capacity, const char *text) {
+    if (*size + 4 > capacity) return false;
+    // Long responses (status) are cut to what fits one datagram
+    size_t length = strlen(text);
+    if (length > capacity - *size - 4) length = capacity - *size - 4;
+    const size_t padded = (length + 4) & ~(size_t) 3;
+    memset(packet + *size, 0, padded);
+    memcpy(packet + *size, text, length);
+    *size += padded;
+    return true;
+}
+
+static void send_reply(osc_server_t *server, const struct sockaddr_in *to, const bool ok, const char *text) {
+    if (!server->config->osc.reply) return;
+
+    uint8_t packet[OSC_PACKET_MAX];
+    size_t size = 0;
+    put_string(packet, &size, sizeof(packet), ok ? OSC_PREFIX "ok" : OSC_PREFIX "error");
+    put_string(packet, &size, sizeof(packet), ",s");
+    put_string(packet, &size, sizeof(packet), text);
+    sendto(server->fd, packet, size, MSG_DONTWAIT, (const struct sockaddr *) to, sizeof(*to));
+}
+
+static void run_command(osc_server_t *server, const char *command, const uint64_t at_ns,
+                        const struct sockaddr_in *from) {
+    log_debug("OSC: %s", command);
+    if (commands_is_slow(command)) {
+        // Would stall every other message behind it
+        atomic_fetch_add(&server->failed, 1);
+        send_reply(server, from, false, "ERROR: Only available on the control socket");
+        return;
+    }
+    const bool ok = commands_execute(server->track_manager, command, at_ns, server->response,
+                                     sizeof(server->response)) == 0;
+    if (!ok) atomic_fetch_add(&server->failed, 1);
+    send_reply(server, from, ok, server->response);
+}
+
+static void hold_command(osc_server_t *server, const char *command, const uint64_t at_ns,
+                         const struct sockaddr_in *from) {
+    if (server->held_count == OSC_MAX_HELD) {
+        atomic_fetch_add(&server->failed, 1);
+        log_warn("OSC: %d messages already wait for their time, dropped %s", OSC_MAX_HELD, command);
+        send_reply(server, from, false, "ERROR: Too many scheduled messages");
+        return;
+    }
+
+    // After those due at the same time, so a bundle runs in order
+    int index = server->held_count;
+    while (index > 0 && server->held[index - 1].at_ns > at_ns) index--;
+    memmove(&server->held[index + 1], &server->held[index], (size_t) (server->held_count - index) * sizeof(osc_held_t));
+    osc_held_t *held = &server->held[index];
+    held->at_ns = at_ns;
+    held->from = *from;
+    snprintf(held->command, sizeof(held->command), "%s", command);
+    server->held_count++;
+    atomic_store(&server->held_now, server->held_count);
+}
+
+static void dispatch_message(osc_server_t *server, osc_reader_t *reader, const uint64_t at_ns,
+                             const struct sockaddr_in *from) {
+    atomic_fetch_add(&server->messages, 1);
+
+    char command[OSC_COMMAND_MAX];
+    const char *error;
+    if (!message_to_command(reader, command, &error)) {
+        atomic_fetch_add(&server->failed, 1);
+        log_warn("OSC: dropped message from %s: %s", inet_ntoa(from->sin_addr), error);
+        char reply[64];
+        snprintf(reply, sizeof(reply), "ERROR: %s", error);
+        send_reply(server, from, false, reply);
+        return;
+    }
+
+    // Timed commands go to the engine with their time, sample accurate; the rest wait here
+    if (at_ns == 0 || commands_is_timed(command)) {
+        run_command(server, command, at_ns, from);
+    } else {
+        hold_command(server, command, at_ns, from);
+    }
+}
+
+static void dispatch_packet(osc_server_t *server, const uint8_t *data, const size_t size, const uint64_t at_ns,
+                            const int depth, const struct sockaddr_in *from) {
+    osc_reader_t reader = {.data = data, .size = size};
+    if (size < 8 || memcmp(data, "#bundle", 8) != 0) {
+        if (depth > 0) atomic_fetch_add(&server->bundled, 1);
+        dispatch_message(server, &reader, at_ns, from);
+        return;
+    }
+
+    reader.pos = 8;
+    uint64_t timetag;
+    if (depth >= OSC_MAX_DEPTH || !read_u64(&reader, &timetag)) {
+        atomic_fetch_add(&server->failed, 1);
+        log_warn("OSC: dropped malformed bundle from %s", inet_ntoa(from->sin_addr));
+        return;
+    }
+    // A nested bundle to run immediately belongs to the time of the one around it
+    const uint64_t bundle_ns = timetag == OSC_TIMETAG_NOW ? at_ns : timetag_to_ns(server, timetag);
+
+    while (reader.pos < reader.size) {
+        uint32_t element_size;
+        if (!read_u32(&reader, &element_size) || element_size % 4 != 0 || element_size > reader.size - reader.pos) {
+            atomic_fetch_add(&server->failed, 1);
+            log_warn("OSC: dropped rest of malformed bundle from %s", inet_ntoa(from->sin_addr));
+            return;
+        }
+        dispatch_packet(server, data + reader.pos, element_size, bundle_ns, depth + 1, from);
+        reader.pos += element_size;
+    }
+}
+
+// Run held messages whose time has come, returns the poll timeout until the next one
+static int run_due(osc_server_t *server) {
+    const uint64_t now_ns = track_manager_now_ns();
+    int done = 0;
+    while (done < server->held_count && server->held[done].at_ns <= now_ns) {
+        run_command(server, server->held[done].command, 0, &server->held[done].from);
+        done++;
+    }
+    if (done > 0) {
+        server->held_count -= done;
+        memmove(&server->held[0], &server->held[done], (size_t) server->held_count * sizeof(osc_held_t));
+        atomic_store(&server->held_now, server->held_count);
+    }
+
+    if (server->held_count == 0) return OSC_POLL_MS;
+    const uint64_t wait_ms = (server->held[0].at_ns - now_ns + 999999) / 1000000;
+    return wait_ms < OSC_POLL_MS ? (int) wait_ms : OSC_POLL_MS;
+}
+
+static void *osc_thread(void *arg) {
+    osc_server_t *server = arg;
+    thread_policy_apply(THREAD_ROLE_CONTROL);
+
+    int timeout_ms = OSC_POLL_MS;
+    while (atomic_load(&server->running)) {
+        struct pollfd pfd = {.fd = server->fd, .events = POLLIN};
+        const int ready = poll(&pfd, 1, timeout_ms);
+
+        while (ready > 0) {
+            struct sockaddr_in from;
+            socklen_t from_len = sizeof(from);
+            const ssize_t n = recvfrom(server->fd, server->packet, sizeof(server->packet), MSG_DONTWAIT | MSG_TRUNC,
+                                       (struct sockaddr *) &from, &from_len);
+            if (n <= 0) break;
+            if ((size_t) n > sizeof(server->packet) || n % 4 != 0) {
+                atomic_fetch_add(&server->failed, 1);
+                log_warn("OSC: dropped %zd byte packet from %s", n, inet_ntoa(from.sin_addr));
+                continue;
+            }
+            dispatch_packet(server, server->packet, (size_t) n, 0, 0, &from);
+        }
+
+        timeout_ms = run_due(server);
+    }
+    return NULL;
+}
+
+osc_server_t *osc_server_create(const global_config_t *config, track_manager_ctx_t *track_manager) {
+    if (!config || !config->osc.enabled) return NULL;
+
+    osc_server_t *server = calloc(1, sizeof(osc_server_t));
+    if (!server) {
+        log_error("Failed to allocate OSC server");
+        return NULL;
+    }
+    server->config = config;
+    server->track_manager = track_manager;
+
+    const char *bind_address = config->osc.bind ? config->osc.bind : OSC_DEFAULT_BIND;
+    const int port = config->osc.port > 0 ? config->osc.port : OSC_DEFAULT_PORT;
+    struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = htons((uint16_t) port)};
+    if (inet_pton(AF_INET, bind_address, &addr.sin_addr) != 1) {
+        log_error("OSC: invalid bind address %s", bind_address);
+        free(server);
+        return NULL;
+    }
+    snprintf(server->address, sizeof(server->address), "%s:%d", bind_address, port);
+
+    server->fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (server->fd < 0 || bind(server->fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+        log_error("OSC: cannot listen on UDP %s: %s", server->address, strerror(errno));
+        if (server->fd >= 0) close(server->fd);
+        free(server);
+        return NULL;
+    }
+
+    atomic_init(&server->running, true);
+    if (pthread_create(&server->thread, NULL, osc_thread, server) != 0) {
+        log_error("OSC: failed to start thread");
+        close(server->fd);
+        free(server);
+        return NULL;
+    }
+
+    if (addr.sin_addr.s_addr != htonl(INADDR_LOOPBACK)) {
+        log_warn("OSC: listening on %s, any host that reaches it controls papad", server->address);
+    } else {
+        log_info("OSC: listening on UDP %s", server->address);
+    }
+    return server;
+}
+
+int osc_server_format_status(osc_server_t *server, char *buffer, size_t size) {
+    if (!server) return 0;
+
+    return snprintf(buffer, size, "OSC: UDP %s, %llu messages (%llu in bundles), %llu failed, %d held, %llu late\n",
+                    server->address, (unsigned long long) atomic_load(&server->messages),
+                    (unsigned long long) atomic_load(&server->bundled),
+                    (unsigned long long) atomic_load(&server->failed), atomic_load(&server->held_now),
+                    (unsigned long long) atomic_load(&server->late));
+}
+
+void osc_server_destroy(osc_server_t *server) {
+    if (!server) return;
+
+    atomic_store(&server->running, false);
+    pthread_join(server->thread, NULL);
+    if (server->held_count > 0) {
+        log_info("OSC: dropped %d scheduled messages", server->held_count);
+    }
+    close(server->fd);
+    free(server);
+}
@@ -0,0 +1,24 @@
+#ifndef ASYNC_AUDIO_PLAYER_OSC_H
+#define ASYNC_AUDIO_PLAYER_OSC_H
+
+#include <stddef.h>
+#include "types.h"
+
+typedef struct track_manager_ctx track_manager_ctx_t;
+
+// OSC control input over UDP. A message to /papa/<command>[/<word>...] runs the socket command of the same
+// words followed by its arguments, so /papa/volume ,sf rain 0.4 is "volume rain 0.4". Bundle timetags
+// schedule their messages: timed commands (play, stop, go, goto, volume, pan) are handed to the engine
+// with the matching CLOCK_MONOTONIC time, the others are held until then.
+typedef struct osc_server osc_server_t;
+
+// Start listening; NULL when OSC is disabled or the socket cannot be bound
+osc_server_t *osc_server_create(const global_config_t *config, track_manager_ctx_t *track_manager);
+
+// Format the listening address and message counts
+int osc_server_format_status(osc_server_t *server, char *buffer, size_t size);
+
+// Stop the thread and drop held messages
+void osc_server_destroy(osc_server_t *server);
+
+#endif // ASYNC_AUDIO_PLAYER_OSC_H
@@ -0,0 +1,380 @@
+#include <math.h>
+#include <sndfile.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "output_stage.h"
+#include "arena.h"
+#include "convolver.h"
+#include "delay.h"
+#include "dsp.h"
+#include "eq.h"
+#include "log.h"
+
+#define STAGE_BLOCK 256     // Frames processed per pass, bounds the per-frame scratch arrays
+#define IR_MAX_SECONDS 4    // Longer impulse responses are truncated
+
+// Look-ahead brickwall limiter. The required gain of each frame is run through a sliding minimum
+// over the window and a moving average of the same length; with the audio delayed by window - 1
+// frames, every sample is scaled by at most the gain its own peak requires.
+typedef struct {
+    limiter_mode_t mode;
+    float ceiling;
+    uint32_t window;            // Look-ahead frames + 1
+    float release_coef;
+
+    float *delay;               // window - 1 interleaved frames
+    uint32_t delay_pos;
+
+    // Monotonic deque of required gains for the sliding minimum
+    float *min_value;
+    uint64_t *min_frame;
+    uint32_t min_head;
+    uint32_t min_count;
+    uint64_t frame;
+
+    float hold;                 // Sliding minimum after release smoothing
+    float *average;             // Last window values of hold
+    double average_sum;
+    uint32_t average_pos;
+
+    _Atomic float reduction;    // Lowest gain of the last block, for status
+} limiter_t;
+
+struct output_stage {
+    const output_stage_config_t *config;
+    int channels;
+    int samplerate;
+    eq_t *eq;
+    convolver_t *convolver;
+    delay_t *delay;
+    limiter_t limiter;
+    float peaks[STAGE_BLOCK];
+    float gains[STAGE_BLOCK];
+};
+
+static const output_stage_config_t *find_config(const global_config_t *config, const char *device) {
+    const char *name = device ? device : "default";
+    for (int i = 0; i < config->output_count; i++) {
+        const char *entry = config->outputs[i].device ? config->outputs[i].device : "default";
+        if (strcmp(entry, name) == 0) return &config->outputs[i];
+    }
+    return NULL;
+}
+
+static bool limiter_init(limiter_t *limiter, const limiter_config_t *config, int channels, int samplerate) {
+    limiter->mode = config->mode;
+    limiter->ceiling = powf(10.0f, config->ceiling_db / 20.0f);
+    limiter->hold = 1.0f;
+    atomic_init(&limiter->reduction, 1.0f);
+    if (limiter->mode != LIMITER_LOOKAHEAD) return true;
+
+    const uint32_t lookahead = (uint32_t) lrintf(config->lookahead_ms * samplerate / 1000.0f);
+    limiter->window = (lookahead > 0 ? lookahead : 1) + 1;
+    limiter->release_coef = config->release_ms > 0.0f ? expf(-1000.0f / (config->release_ms * samplerate)) : 0.0f;
+
+    limiter->delay = arena_calloc((size_t) (limiter->window - 1) * channels, sizeof(float));
+    limiter->min_value = arena_calloc(limiter->window, sizeof(float));
+    limiter->min_frame = arena_calloc(limiter->window, sizeof(uint64_t));
+    limiter->average = arena_calloc(limiter->window, sizeof(float));
+    if (!limiter->delay || !limiter->min_value || !limiter->min_frame || !limiter->average) return false;
+
+    for (uint32_t i = 0; i < limiter->window; i++) {
+        limiter->average[i] = 1.0f;
+    }
+    limiter->average_sum = limiter->window;
+    return true;
+}
+
+static void limiter_free(limiter_t *limiter) {
+    arena_free(limiter->delay);
+    arena_free(limiter->min_value);
+    arena_free(limiter->min_frame);
+    arena_free(limiter->average);
+}
+
+// Highest absolute sample of each frame
+DSP_VECTORIZE
+static void frame_peaks(const float *restrict samples, size_t n_frames, int channels, float *restrict peaks) {
+    for (size_t f = 0; f < n_frames; f++) {
+        float peak = 0.0f;
+        for (int ch = 0; ch < channels; ch++) {
+            const float a = fabsf(samples[f * channels + ch]);
+            peak = peak > a ? peak : a;
+        }
+        peaks[f] = peak;
+    }
+}
+
+// Per-frame gain from the sliding minimum and moving average (serial by nature)
+static void limiter_gains(limiter_t *limiter, const float *peaks, float *gains, size_t n_frames) {
+    const uint32_t window = limiter->window;
+
+    for (size_t f = 0; f < n_frames; f++) {
+        const float required = peaks[f] > limiter->ceiling ? limiter->ceiling / peaks[f] : 1.0f;
+        const uint64_t frame = limiter->frame++;
+
+        // Expire the front once it leaves the window, drop larger gains from the back, then push
+        if (limiter->min_count > 0 && limiter->min_frame[limiter->min_head] + window <= frame) {
+            limiter->min_head = (limiter->min_head + 1) % window;
+            limiter->min_count--;
+        }
+        while (limiter->min_count > 0) {
+            const uint32_t back = (limiter->min_head + limiter->min_count - 1) % window;
+            if (limiter->min_value[back] < required) break;
+            limiter->min_count--;
+        }
+        const uint32_t slot = (limiter->min_head + limiter->min_count) % window;
+        limiter->min_value[slot] = required;
+        limiter->min_frame[slot] = frame;
+        limiter->min_count++;
+        const float minimum = limiter->min_value[limiter->min_head];
+
+        // Instant attack, smoothed release
+        limiter->hold = minimum < limiter->hold ? minimum : minimum + (limiter->hold - minimum) * limiter->release_coef;
+
+        limiter->average_sum += limiter->hold - limiter->average[limiter->average_pos];
+        limiter->average[limiter->average_pos] = limiter->hold;
+        limiter->average_pos = (limiter->average_pos + 1) % window;
+
+        const float gain = (float) (limiter->average_sum / window);
+        gains[f] = gain < 1.0f ? gain : 1.0f;
+    }
+}
+
+// Swap each frame through the delay line and apply its gain, clamped to the ceiling as a safety net
+DSP_VECTORIZE
+static void limiter_apply(limiter_t *limiter, float *restrict samples, const float *restrict gains,
+                          size_t n_frames, int channels) {
+    const uint32_t length = limiter->window - 1;
+    const float ceiling = limiter->ceiling;
+
+    for (size_t f = 0; f < n_frames; f++) {
+        float *restrict delayed = limiter->delay + (size_t) limiter->delay_pos * channels;
+        float *restrict frame = samples + f * channels;
+        const float gain = gains[f];
+
+        for (int ch = 0; ch < channels; ch++) {
+            const float out = delayed[ch] * gain;
+            delayed[ch] = frame[ch];
+            frame[ch] = out > ceiling ? ceiling : (out < -ceiling ? -ceiling : out);
+        }
+        limiter->delay_pos = limiter->delay_pos + 1 < length ? limiter->delay_pos + 1 : 0;
+    }
+}
+
+// tanh-shaped saturation reaching the ceiling at three times its level, no latency
+DSP_VECTORIZE
+static void soft_clip(float *restrict samples, size_t count, float ceiling) {
+    const float inverse = 1.0f / ceiling;
+    for (size_t i = 0; i < count; i++) {
+        float t = samples[i] * inverse;
+        t = t > 3.0f ? 3.0f : t;
+        t = t < -3.0f ? -3.0f : t;
+        samples[i] = ceiling * t * (27.0f + t * t) / (27.0f + 9.0f * t * t);
+    }
+}
+
+// Read the first channel of an impulse response; it must match the stream rate
+static float *load_ir(const char *path, int samplerate, size_t *length) {
+    SF_INFO info;
+    memset(&info, 0, sizeof(info));
+    SNDFILE *file = sf_open(path, SFM_READ, &info);
+    if (!file) {
+        log_warn("Cannot open impulse response %s: %s", path, sf_strerror(NULL));
+        return NULL;
+    }
+    if (info.samplerate != samplerate) {
+        log_warn("Impulse response %s is %d Hz, the stream runs at %d Hz", path, info.samplerate, samplerate);
+        sf_close(file);
+        return NULL;
+    }
+
+    sf_count_t frames = info.frames;
+    if (frames > (sf_count_t) IR_MAX_SECONDS * samplerate) {
+        log_warn("Impulse response %s truncated to %d s", path, IR_MAX_SECONDS);
+        frames = (sf_count_t) IR_MAX_SECONDS * samplerate;
+    }
+
+    float *interleaved = malloc((size_t) frames * info.channels * sizeof(float));
+    float *ir = malloc((size_t) frames * sizeof(float));
+    const sf_count_t read = interleaved && ir ? sf_readf_float(file, interleaved, frames) : 0;
+    sf_close(file);
+    if (read <= 0) {
+        log_warn("Cannot read impulse response %s", path);
+        free(interleaved);
+        free(ir);
+        return NULL;
+    }
+
+    for (sf_count_t i = 0; i < read; i++) {
+        ir[i] = interleaved[i * info.channels];
+    }
+    free(interleaved);
+    *length = (size_t) read;
+    return ir;
+}
+
+// Load the impulse responses of the named channels; returns NULL when no channel has one
+static convolver_t *create_convolver(const output_stage_config_t *config, const char *const *names, int channels,
+                                     int samplerate) {
+    float *irs[OUTPUT_STAGE_MAX_CHANNELS] = {NULL};
+    size_t lengths[OUTPUT_STAGE_MAX_CHANNELS] = {0};
+    int loaded = 0;
+
+    for (int ch = 0; ch < channels; ch++) {
+        for (int i = 0; i < config->channel_count; i++) {
+            const output_channel_config_t *channel = &config->channels[i];
+            if (!channel->ir || !channel->name || strcmp(channel->name, names[ch]) != 0) continue;
+            irs[ch] = load_ir(channel->ir, samplerate, &lengths[ch]);
+            if (irs[ch]) loaded++;
+            break;
+        }
+    }
+
+    convolver_t *convolver = NULL;
+    if (loaded > 0) {
+        convolver = convolver_create((const float *const *) irs, lengths, channels, (uint32_t) config->fir_partition);
+        if (!convolver) {
+            log_error("Failed to create convolver with partition %d (must be a power of two >= 16)",
+                      config->fir_partition);
+        }
+    }
+    for (int ch = 0; ch < channels; ch++) {
+        free(irs[ch]);
+    }
+    return convolver;
+}
+
+output_stage_t *output_stage_create(const global_config_t *config, const char *device, const char *const *names,
+                                    int channels, int samplerate) {
+    if (!config || channels <= 0 || channels > OUTPUT_STAGE_MAX_CHANNELS || samplerate <= 0) return NULL;
+
+    const output_stage_config_t *entry = find_config(config, device);
+    if (!entry || (entry->limiter.mode == LIMITER_OFF && entry->channel_count == 0)) return NULL;
+
+    // Channels without a name are addressed by their AUX position
+    char fallback[OUTPUT_STAGE_MAX_CHANNELS][8];
+    const char *resolved[OUTPUT_STAGE_MAX_CHANNELS];
+    for (int ch = 0; ch < channels; ch++) {
+        resolved[ch] = names ? names[ch] : NULL;
+        if (!resolved[ch]) {
+            snprintf(fallback[ch], sizeof(fallback[ch]), "AUX%d", ch);
+            resolved[ch] = fallback[ch];
+        }
+    }
+
+    output_stage_t *stage = arena_calloc(1, sizeof(output_stage_t));
+    if (!stage) {
+        log_error("Failed to allocate output stage for %s", device ? device : "default");
+        return NULL;
+    }
+    stage->config = entry;
+    stage->channels = channels;
+    stage->samplerate = samplerate;
+
+    if (!limiter_init(&stage->limiter, &entry->limiter, channels, samplerate)) {
+        log_error("Failed to allocate limiter for %s", device ? device : "default");
+        output_stage_destroy(stage);
+        return NULL;
+    }
+
+    stage->eq = eq_create(entry, resolved, channels, samplerate);
+    stage->convolver = create_convolver(entry, resolved, channels, samplerate);
+    stage->delay = delay_create(entry, resolved, channels, samplerate);
+    if (!stage->eq && !stage->convolver && !stage->delay && stage->limiter.mode == LIMITER_OFF) {
+        output_stage_destroy(stage);
+        return NULL;
+    }
+
+    log_debug("Output stage for %s: %d channels, %u frames latency", device ? device : "default", channels,
+              output_stage_latency(stage));
+    return stage;
+}
+
+void output_stage_process(output_stage_t *stage, float *samples, size_t n_frames) {
+    if (!stage) return;
+
+    limiter_t *limiter = &stage->limiter;
+    const int channels = stage->channels;
+
+    eq_process(stage->eq, samples, n_frames);
+    convolver_process(stage->convolver, samples, n_frames);
+    delay_process(stage->delay, samples, n_frames);
+
+    if (limiter->mode == LIMITER_OFF) return;
+    if (limiter->mode == LIMITER_SOFTCLIP) {
+        soft_clip(samples, n_frames * channels, limiter->ceiling);
+        return;
+    }
+
+    float reduction = 1.0f;
+    for (size_t offset = 0; offset < n_frames; offset += STAGE_BLOCK) {
+        const size_t block = n_frames - offset < STAGE_BLOCK ? n_frames - offset : STAGE_BLOCK;
+        float *frames = samples + offset * channels;
+
+        frame_peaks(frames, block, channels, stage->peaks);
+        limiter_gains(limiter, stage->peaks, stage->gains, block);
+        limiter_apply(limiter, frames, stage->gains, block, channels);
+
+        for (size_t f = 0; f < block; f++) {
+            if (stage->gains[f] < reduction) reduction = stage->gains[f];
+        }
+    }
+    atomic_store_explicit(&limiter->reduction, reduction, memory_order_relaxed);
+}
+
+const char *output_stage_device(const output_stage_t *stage) {
+    return stage && stage->config->device ? stage->config->device : "default";
+}
+
+bool output_stage_set_delay(output_stage_t *stage, const char *channel, float ms) {
+    return stage && delay_set(stage->delay, channel, ms);
+}
+
+uint32_t output_stage_latency(const output_stage_t *stage) {
+    if (!stage) return 0;
+    const uint32_t limiter = stage->limiter.mode == LIMITER_LOOKAHEAD ? stage->limiter.window - 1 : 0;
+    return limiter + convolver_latency(stage->convolver);
+}
+
+int output_stage_format_status(const output_stage_t *stage, char *buffer, size_t size) {
+    if (!stage) return 0;
+
+    int written = eq_format_status(stage->eq, buffer, size);
+    if (stage->convolver) {
+        const int n = snprintf(buffer + written, size > (size_t) written ? size - written : 0, "%s",
+                               written > 0 ? ", " : "");
+        if (n > 0) written += n;
+        written += convolver_format_status(stage->convolver, stage->samplerate, buffer + written,
+                                           size > (size_t) written ? size - written : 0);
+    }
+
+    if (stage->delay) {
+        const int n = snprintf(buffer + written, size > (size_t) written ? size - written : 0, "%s",
+                               written > 0 ? ", " : "");
+        if (n > 0) written += n;
+        written += delay_format_status(stage->delay, buffer + written, size > (size_t) written ? size - written : 0);
+    }
+
+    const limiter_t *limiter = &stage->limiter;
+    if (limiter->mode == LIMITER_OFF) return written;
+
+    const float reduction = atomic_load_explicit(&limiter->reduction, memory_order_relaxed);
+    const uint32_t latency = limiter->mode == LIMITER_LOOKAHEAD ? limiter->window - 1 : 0;
+    const int n = snprintf(buffer + written, size > (size_t) written ? size - written : 0,
+                           "%s%s %.1f dBFS, %.1f dB reduction, latency %u frames (%.2f ms)", written > 0 ? ", " : "",
+                           limiter->mode == LIMITER_SOFTCLIP ? "soft clip" : "limiter",
+                           stage->config->limiter.ceiling_db, reduction > 1e-6f ? 20.0f * log10f(reduction) : -120.0f,
+                           latency, latency * 1000.0 / stage->samplerate);
+    return n > 0 ? written + n : written;
+}
+
+void output_stage_destroy(output_stage_t *stage) {
+    if (!stage) return;
+    eq_destroy(stage->eq);
+    convolver_destroy(stage->convolver);
+    delay_destroy(stage->delay);
+    limiter_free(&stage->limiter);
+    arena_free(stage);
+}
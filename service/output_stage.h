@@ -0,0 +1,37 @@
+#ifndef ASYNC_AUDIO_PLAYER_OUTPUT_STAGE_H
+#define ASYNC_AUDIO_PLAYER_OUTPUT_STAGE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "types.h"
+
+#define OUTPUT_STAGE_MAX_CHANNELS 64
+
+// Processing applied to everything a stream sends to its device, last in the chain:
+// per-channel filters, impulse response convolution, alignment delays, then the limiter
+typedef struct output_stage output_stage_t;
+
+// Build the stage configured for a device; names are the stream's channel names and may be NULL
+// (unnamed channels are AUX<n>). Returns NULL when the device has nothing configured.
+output_stage_t *output_stage_create(const global_config_t *config, const char *device, const char *const *names,
+                                    int channels, int samplerate);
+
+// Process one interleaved block in place (data thread); a NULL stage passes audio through
+void output_stage_process(output_stage_t *stage, float *samples, size_t n_frames);
+
+// Device name of the outputs entry the stage was built from
+const char *output_stage_device(const output_stage_t *stage);
+
+// Change a channel's alignment delay with a short crossfade; false without a delay line for it
+bool output_stage_set_delay(output_stage_t *stage, const char *channel, float ms);
+
+// Delay the stage adds, in frames; the convolution part is known once audio has run
+uint32_t output_stage_latency(const output_stage_t *stage);
+
+// Format a one-line summary of the stage
+int output_stage_format_status(const output_stage_t *stage, char *buffer, size_t size);
+
+void output_stage_destroy(output_stage_t *stage);
+
+#endif // ASYNC_AUDIO_PLAYER_OUTPUT_STAGE_H
@@ -0,0 +1,176 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "panner.h"
+#include "arena.h"
+#include "log.h"
+
+#define DBAP_ROLLOFF_DEFAULT_DB 6.0f
+
+typedef struct {
+    int channel;            // Output channel fed by the speaker
+    float x, y;
+    float azimuth;          // Radians, clockwise from the front
+} speaker_t;
+
+// Adjacent speakers of the VBAP ring with the inverse of their direction matrix
+typedef struct {
+    int a, b;               // Indexes into speakers, a before b clockwise
+    float inverse[4];
+} speaker_pair_t;
+
+struct panner {
+    panner_mode_t mode;
+    int channels;
+    int count;
+    speaker_t speakers[PANNER_MAX_SPEAKERS];    // Sorted by azimuth
+    speaker_pair_t pairs[PANNER_MAX_SPEAKERS];
+    int pair_count;
+    float exponent;         // DBAP distance exponent from the rolloff per doubling
+    float blur_square;      // DBAP spatial blur, keeps gains finite at a speaker position
+};
+
+void panner_polar(float azimuth, float distance, float *x, float *y) {
+    const float radians = azimuth * (float) M_PI / 180.0f;
+    *x = distance * sinf(radians);
+    *y = distance * cosf(radians);
+}
+
+panner_t *panner_create(const panner_config_t *config, const char *const *names, int channels) {
+    if (!config || config->mode == PANNER_OFF || config->speaker_count == 0) return NULL;
+
+    panner_t *panner = arena_calloc(1, sizeof(panner_t));
+    if (!panner) return NULL;
+
+    panner->mode = config->mode;
+    panner->channels = channels;
+    const float rolloff = config->rolloff_db > 0.0f ? config->rolloff_db : DBAP_ROLLOFF_DEFAULT_DB;
+    panner->exponent = rolloff / (20.0f * log10f(2.0f));
+    panner->blur_square = config->blur * config->blur;
+
+    for (int i = 0; i < config->speaker_count && panner->count < PANNER_MAX_SPEAKERS; i++) {
+        const speaker_config_t *speaker = &config->speakers[i];
+        int channel = -1;
+        for (int ch = 0; ch < channels && channel < 0; ch++) {
+            if (speaker->name && names[ch] && strcmp(speaker->name, names[ch]) == 0) channel = ch;
+        }
+        if (channel < 0) {
+            log_warn("Panner speaker %s is not an output channel", speaker->name ? speaker->name : "?");
+            continue;
+        }
+
+        // Insertion keeps the ring sorted by azimuth
+        speaker_t entry = {channel, speaker->x, speaker->y, atan2f(speaker->x, speaker->y)};
+        int pos = panner->count++;
+        while (pos > 0 && panner->speakers[pos - 1].azimuth > entry.azimuth) {
+            panner->speakers[pos] = panner->speakers[pos - 1];
+            pos--;
+        }
+        panner->speakers[pos] = entry;
+    }
+
+    if (panner->count == 0) {
+        log_warn("Panner has no usable speakers");
+        arena_free(panner);
+        return NULL;
+    }
+
+    // Neighbouring speakers less than 180 degrees apart form the VBAP pairs
+    for (int i = 0; panner->count > 1 && i < panner->count; i++) {
+        const int j = (i + 1) % panner->count;
+        const speaker_t *a = &panner->speakers[i];
+        const speaker_t *b = &panner->speakers[j];
+        float span = b->azimuth - a->azimuth;
+        if (span <= 0.0f) span += 2.0f * (float) M_PI;
+        if (span >= (float) M_PI - 1e-4f) continue;
+
+        const float ax = sinf(a->azimuth), ay = cosf(a->azimuth);
+        const float bx = sinf(b->azimuth), by = cosf(b->azimuth);
+        const float det = ax * by - bx * ay;
+        if (fabsf(det) < 1e-6f) continue;
+
+        speaker_pair_t *pair = &panner->pairs[panner->pair_count++];
+        pair->a = i;
+        pair->b = j;
+        pair->inverse[0] = by / det;
+        pair->inverse[1] = -bx / det;
+        pair->inverse[2] = -ay / det;
+        pair->inverse[3] = ax / det;
+    }
+    return panner;
+}
+
+static void vbap_gains(const panner_t *panner, float x, float y, float *gains) {
+    const float length = sqrtf(x * x + y * y);
+    if (length < 1e-6f) {
+        // No direction at the listener position: spread evenly
+        const float even = 1.0f / sqrtf((float) panner->count);
+        for (int i = 0; i < panner->count; i++) gains[panner->speakers[i].channel] = even;
+        return;
+    }
+
+    const float px = x / length, py = y / length;
+    for (int i = 0; i < panner->pair_count; i++) {
+        const speaker_pair_t *pair = &panner->pairs[i];
+        const float ga = pair->inverse[0] * px + pair->inverse[1] * py;
+        const float gb = pair->inverse[2] * px + pair->inverse[3] * py;
+        if (ga < -1e-5f || gb < -1e-5f) continue;
+
+        const float a = ga > 0.0f ? ga : 0.0f;
+        const float b = gb > 0.0f ? gb : 0.0f;
+        const float norm = 1.0f / sqrtf(a * a + b * b);
+        gains[panner->speakers[pair->a].channel] = a * norm;
+        gains[panner->speakers[pair->b].channel] = b * norm;
+        return;
+    }
+
+    // Outside a partial ring (or a single speaker): snap to the closest speaker
+    const float azimuth = atan2f(x, y);
+    int closest = 0;
+    float best = 4.0f * (float) M_PI;
+    for (int i = 0; i < panner->count; i++) {
+        float diff = fabsf(panner->speakers[i].azimuth - azimuth);
+        if (diff > (float) M_PI) diff = 2.0f * (float) M_PI - diff;
+        if (diff < best) {
+            best = diff;
+            closest = i;
+        }
+    }
+    gains[panner->speakers[closest].channel] = 1.0f;
+}
+
+static void dbap_gains(const panner_t *panner, float x, float y, float *gains) {
+    float power = 0.0f;
+    for (int i = 0; i < panner->count; i++) {
+        const speaker_t *speaker = &panner->speakers[i];
+        const float dx = x - speaker->x, dy = y - speaker->y;
+        const float distance = sqrtf(dx * dx + dy * dy + panner->blur_square);
+        const float gain = powf(distance > 1e-6f ? distance : 1e-6f, -panner->exponent);
+        gains[speaker->channel] = gain;
+        power += gain * gain;
+    }
+
+    const float norm = 1.0f / sqrtf(power);
+    for (int i = 0; i < panner->count; i++) {
+        gains[panner->speakers[i].channel] *= norm;
+    }
+}
+
+void panner_gains(const panner_t *panner, float x, float y, float *gains) {
+    memset(gains, 0, panner->channels * sizeof(float));
+    if (panner->mode == PANNER_DBAP) {
+        dbap_gains(panner, x, y, gains);
+    } else {
+        vbap_gains(panner, x, y, gains);
+    }
+}
+
+int panner_format_status(const panner_t *panner, char *buffer, size_t size) {
+    if (!panner) return 0;
+    return snprintf(buffer, size, "%s over %d speakers", panner->mode == PANNER_DBAP ? "dbap" : "vbap",
+                    panner->count);
+}
+
+void panner_destroy(panner_t *panner) {
+    arena_free(panner);
+}
@@ -0,0 +1,26 @@
+#ifndef ASYNC_AUDIO_PLAYER_PANNER_H
+#define ASYNC_AUDIO_PLAYER_PANNER_H
+
+#include "types.h"
+
+#define PANNER_MAX_SPEAKERS 64
+
+// Amplitude panning over a 2D speaker layout. Coordinates are in metres with the listener at the
+// origin, x to the right and y to the front; azimuth 0 is straight ahead, positive to the right.
+typedef struct panner panner_t;
+
+// Place the configured speakers on the named output channels; NULL when panning is off
+panner_t *panner_create(const panner_config_t *config, const char *const *names, int channels);
+
+// Power-normalized gain of every output channel for a source at (x, y); channels without a speaker get 0
+void panner_gains(const panner_t *panner, float x, float y, float *gains);
+
+// Position on the circle of the given radius at an azimuth in degrees
+void panner_polar(float azimuth, float distance, float *x, float *y);
+
+// Format mode and speaker count
+int panner_format_status(const panner_t *panner, char *buffer, size_t size);
+
+void panner_destroy(panner_t *panner);
+
+#endif // ASYNC_AUDIO_PLAYER_PANNER_H
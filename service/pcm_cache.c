@@ -0,0 +1,355 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <sndfile.h>
+#include "pcm_cache.h"
+#include "thread_policy.h"
+#include "log.h"
+
+#define CACHE_DEFAULT_SUBDIR "papa"
+#define CACHE_HASH_SAMPLE (64 * 1024)   // Bytes hashed from head and tail of a source
+#define CACHE_DECODE_FRAMES 4096
+
+// One configured source file and its cache file, once a worker validated it
+typedef struct {
+    char *source_path;
+    char cache_path[PATH_MAX];
+    atomic_bool ready;
+} cache_entry_t;
+
+static struct {
+    bool initialized;
+    char directory[PATH_MAX - 32];    // Leaves room for "/<key>.pcm" in cache paths
+    cache_entry_t *entries;
+    int entry_count;
+    pthread_t *workers;
+    int worker_count;
+    atomic_int next_job;
+    atomic_bool stop;
+} cache;
+
+static int64_t mtime_ns(const struct stat *st) {
+    return (int64_t) st->st_mtim.tv_sec * 1000000000LL + st->st_mtim.tv_nsec;
+}
+
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t len) {
+    const unsigned char *p = data;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// Content key: source size plus the first and last CACHE_HASH_SAMPLE bytes
+static bool hash_source(const char *path, const struct stat *st, uint64_t *key) {
+    unsigned char *sample = malloc(CACHE_HASH_SAMPLE);
+    if (!sample) return false;
+
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        free(sample);
+        return false;
+    }
+
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    const uint64_t size = (uint64_t) st->st_size;
+    hash = fnv1a(hash, &size, sizeof(size));
+
+    ssize_t n = pread(fd, sample, CACHE_HASH_SAMPLE, 0);
+    if (n > 0) hash = fnv1a(hash, sample, (size_t) n);
+
+    if (st->st_size > (off_t) (2 * CACHE_HASH_SAMPLE)) {
+        n = pread(fd, sample, CACHE_HASH_SAMPLE, st->st_size - CACHE_HASH_SAMPLE);
+        if (n > 0) hash = fnv1a(hash, sample, (size_t) n);
+    }
+
+    close(fd);
+    free(sample);
+    *key = hash;
+    return true;
+}
+
+// Sources already stored as plain PCM gain nothing from the cache
+static bool is_compressed(const SF_INFO *info) {
+    switch (info->format & SF_FORMAT_SUBMASK) {
+        case SF_FORMAT_PCM_S8:
+        case SF_FORMAT_PCM_U8:
+        case SF_FORMAT_PCM_16:
+        case SF_FORMAT_PCM_24:
+        case SF_FORMAT_PCM_32:
+        case SF_FORMAT_FLOAT:
+        case SF_FORMAT_DOUBLE:
+            return false;
+        default:
+            return true;
+    }
+}
+
+// Check a cache file header against the current state of its source
+static bool header_valid(int fd, const struct stat *src, pcm_cache_header_t *header) {
+    struct stat st;
+    if (pread(fd, header, sizeof(*header), 0) != (ssize_t) sizeof(*header)) return false;
+    if (memcmp(header->magic, PCM_CACHE_MAGIC, 4) != 0 || header->version != PCM_CACHE_VERSION) return false;
+    if (header->channels == 0 || header->samplerate == 0) return false;
+    if (header->source_size != (uint64_t) src->st_size || header->source_mtime != mtime_ns(src)) return false;
+    if (fstat(fd, &st) != 0) return false;
+
+    return (uint64_t) st.st_size == sizeof(*header) + header->frames * header->channels * sizeof(float);
+}
+
+static bool write_all(int fd, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        const ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        len -= (size_t) n;
+    }
+    return true;
+}
+
+// Decode a source into a temporary file and atomically move it into place
+static bool build_cache_file(cache_entry_t *entry, SNDFILE *src, const SF_INFO *info, const struct stat *st) {
+    char tmp_path[PATH_MAX + 32];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp.%d", entry->cache_path, (int) getpid());
+
+    const int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        log_error("Failed to create cache file %s: %s", tmp_path, strerror(errno));
+        return false;
+    }
+
+    pcm_cache_header_t header = {
+            .version = PCM_CACHE_VERSION,
+            .channels = (uint32_t) info->channels,
+            .samplerate = (uint32_t) info->samplerate,
+            .frames = 0,
+            .source_size = (uint64_t) st->st_size,
+            .source_mtime = mtime_ns(st),
+    };
+    memcpy(header.magic, PCM_CACHE_MAGIC, 4);
+
+    float *buffer = malloc(CACHE_DECODE_FRAMES * info->channels * sizeof(float));
+    bool ok = buffer && write_all(fd, &header, sizeof(header));
+
+    while (ok && !atomic_load(&cache.stop)) {
+        const sf_count_t n = sf_readf_float(src, buffer, CACHE_DECODE_FRAMES);
+        if (n <= 0) break;
+        ok = write_all(fd, buffer, (size_t) n * info->channels * sizeof(float));
+        header.frames += (uint64_t) n;
+    }
+    free(buffer);
+
+    // Finalize header only once every frame is on disk
+    ok = ok && !atomic_load(&cache.stop) && pwrite(fd, &header, sizeof(header), 0) == (ssize_t) sizeof(header);
+    if (close(fd) != 0) ok = false;
+
+    if (!ok || rename(tmp_path, entry->cache_path) != 0) {
+        unlink(tmp_path);
+        return false;
+    }
+    return true;
+}
+
+static void process_entry(cache_entry_t *entry) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    struct stat st;
+    uint64_t key;
+    if (stat(entry->source_path, &st) != 0 || !hash_source(entry->source_path, &st, &key)) {
+        log_warn("Cache: cannot read source %s", entry->source_path);
+        return;
+    }
+    snprintf(entry->cache_path, sizeof(entry->cache_path), "%s/%016llx.pcm", cache.directory, (unsigned long long) key);
+
+    // Reuse an existing cache file if it still matches the source
+    const int fd = open(entry->cache_path, O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        pcm_cache_header_t header;
+        const bool valid = header_valid(fd, &st, &header);
+        close(fd);
+        if (valid) {
+            atomic_store(&entry->ready, true);
+            log_debug("Cache: hit for %s", entry->source_path);
+            return;
+        }
+    }
+
+    SF_INFO info;
+    memset(&info, 0, sizeof(info));
+    SNDFILE *src = sf_open(entry->source_path, SFM_READ, &info);
+    if (!src) {
+        log_warn("Cache: cannot decode %s (%s)", entry->source_path, sf_strerror(NULL));
+        return;
+    }
+
+    if (!is_compressed(&info)) {
+        log_debug("Cache: %s is plain PCM, not caching", entry->source_path);
+        sf_close(src);
+        return;
+    }
+
+    const bool built = build_cache_file(entry, src, &info, &st);
+    sf_close(src);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    const double ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+    if (built) {
+        atomic_store(&entry->ready, true);
+        log_info("Cache: decoded %s in %.1f ms", entry->source_path, ms);
+    } else if (!atomic_load(&cache.stop)) {
+        log_error("Cache: failed to build cache for %s", entry->source_path);
+    }
+}
+
+static void *cache_worker_thread(void *arg) {
+    (void) arg;
+    thread_policy_apply(THREAD_ROLE_WORKER);
+
+    while (!atomic_load(&cache.stop)) {
+        const int job = atomic_fetch_add(&cache.next_job, 1);
+        if (job >= cache.entry_count) break;
+        process_entry(&cache.entries[job]);
+    }
+    return NULL;
+}
+
+// Create the directory and its parent if missing
+static bool ensure_directory(const char *path) {
+    char parent[PATH_MAX];
+    snprintf(parent, sizeof(parent), "%s", path);
+    char *slash = strrchr(parent, '/');
+    if (slash && slash != parent) {
+        *slash = '\0';
+        if (mkdir(parent, 0755) < 0 && errno != EEXIST) return false;
+    }
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+static bool resolve_directory(const global_config_t *config) {
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    int len;
+
+    if (config->cache.directory) {
+        len = snprintf(cache.directory, sizeof(cache.directory), "%s", config->cache.directory);
+    } else if (xdg && xdg[0] != '\0') {
+        len = snprintf(cache.directory, sizeof(cache.directory), "%s/%s", xdg, CACHE_DEFAULT_SUBDIR);
+    } else if (home && home[0] != '\0') {
+        len = snprintf(cache.directory, sizeof(cache.directory), "%s/.cache/%s", home, CACHE_DEFAULT_SUBDIR);
+    } else {
+        len = snprintf(cache.directory, sizeof(cache.directory), "/var/cache/%s", CACHE_DEFAULT_SUBDIR);
+    }
+
+    if (len >= (int) sizeof(cache.directory)) {
+        log_error("Cache directory path too long");
+        return false;
+    }
+    if (!ensure_directory(cache.directory)) {
+        log_error("Failed to create cache directory %s: %s", cache.directory, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool pcm_cache_init(const global_config_t *config) {
+    if (!config || !config->cache.enabled) return true;
+    if (cache.initialized) pcm_cache_cleanup();
+
+    if (!resolve_directory(config)) return false;
+
+    cache.entries = calloc(config->track_count > 0 ? config->track_count : 1, sizeof(cache_entry_t));
+    if (!cache.entries) {
+        log_error("Failed to allocate cache index");
+        return false;
+    }
+
+    // One entry per distinct source file
+    for (int i = 0; i < config->track_count; i++) {
+        const char *path = config->tracks[i].file_path;
+        bool seen = !path;
+        for (int j = 0; j < cache.entry_count && !seen; j++) {
+            seen = strcmp(cache.entries[j].source_path, path) == 0;
+        }
+        if (seen) continue;
+
+        cache.entries[cache.entry_count].source_path = strdup(path);
+        atomic_init(&cache.entries[cache.entry_count].ready, false);
+        cache.entry_count++;
+    }
+
+    atomic_init(&cache.next_job, 0);
+    atomic_init(&cache.stop, false);
+    cache.initialized = true;
+
+    int workers = config->cache.workers > 0 ? config->cache.workers : 1;
+    if (workers > cache.entry_count) workers = cache.entry_count;
+
+    cache.workers = calloc(workers > 0 ? workers : 1, sizeof(pthread_t));
+    for (int i = 0; cache.workers && i < workers; i++) {
+        if (pthread_create(&cache.workers[i], NULL, cache_worker_thread, NULL) != 0) {
+            log_error("Failed to create cache worker thread");
+            break;
+        }
+        cache.worker_count++;
+    }
+
+    log_info("PCM cache at %s (%d sources, %d workers)", cache.directory, cache.entry_count, cache.worker_count);
+    return true;
+}
+
+int pcm_cache_open(const char *source_path, pcm_cache_header_t *header) {
+    if (!cache.initialized || !source_path || !header) return -1;
+
+    for (int i = 0; i < cache.entry_count; i++) {
+        cache_entry_t *entry = &cache.entries[i];
+        if (strcmp(entry->source_path, source_path) != 0) continue;
+        if (!atomic_load(&entry->ready)) return -1;
+
+        // Revalidate against the source in case it changed since startup
+        struct stat st;
+        if (stat(source_path, &st) != 0) return -1;
+
+        const int fd = open(entry->cache_path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return -1;
+        if (!header_valid(fd, &st, header)) {
+            log_warn("Cache: stale entry for %s, decoding source", source_path);
+            atomic_store(&entry->ready, false);
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    return -1;
+}
+
+void pcm_cache_cleanup(void) {
+    if (!cache.initialized) return;
+
+    atomic_store(&cache.stop, true);
+    for (int i = 0; i < cache.worker_count; i++) {
+        pthread_join(cache.workers[i], NULL);
+    }
+    free(cache.workers);
+
+    for (int i = 0; i < cache.entry_count; i++) {
+        free(cache.entries[i].source_path);
+    }
+    free(cache.entries);
+
+    memset(&cache, 0, sizeof(cache));
+}
@@ -0,0 +1,31 @@
+#ifndef ASYNC_AUDIO_PLAYER_PCM_CACHE_H
+#define ASYNC_AUDIO_PLAYER_PCM_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "types.h"
+
+#define PCM_CACHE_MAGIC "PAPC"
+#define PCM_CACHE_VERSION 1
+
+// On-disk header of a cache file; interleaved float frames follow directly
+typedef struct {
+    char magic[4];          // PCM_CACHE_MAGIC
+    uint32_t version;       // PCM_CACHE_VERSION
+    uint32_t channels;
+    uint32_t samplerate;
+    uint64_t frames;
+    uint64_t source_size;   // Size of the source file the cache was built from
+    int64_t source_mtime;   // Source modification time in nanoseconds
+} pcm_cache_header_t;
+
+// Index configured tracks and start background decode workers
+bool pcm_cache_init(const global_config_t *config);
+
+// Open a valid cache file for a source; returns a read-only fd or -1 on miss
+int pcm_cache_open(const char *source_path, pcm_cache_header_t *header);
+
+// Stop workers and release the cache index
+void pcm_cache_cleanup(void);
+
+#endif // ASYNC_AUDIO_PLAYER_PCM_CACHE_H
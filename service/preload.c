@@ -0,0 +1,244 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <sndfile.h>
+#include "preload.h"
+#include "sample_cache.h"
+#include "thread_policy.h"
+#include "log.h"
+
+#define PRELOAD_PROBE_FRAMES 4096
+
+// Per-track outcome of the preload phase
+typedef struct {
+    const track_config_t *track;
+    bool ok;
+    char message[160];
+    int channels;
+    int samplerate;
+    off_t bytes;
+    bool cached;            // Decoded into the sample cache
+    double warm_ms;
+    double validate_ms;
+} preload_result_t;
+
+typedef struct {
+    preload_result_t *results;
+    int count;
+    bool fill_sample_cache;     // Decode validated files into the in-memory sample cache
+    atomic_int next_job;
+} preload_ctx_t;
+
+static double elapsed_ms(const struct timespec *start, const struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1e3 + (end->tv_nsec - start->tv_nsec) / 1e6;
+}
+
+// Pull the whole file into the page cache
+static bool warm_file(const char *path, preload_result_t *result) {
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        snprintf(result->message, sizeof(result->message), "cannot open: %s", strerror(errno));
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        snprintf(result->message, sizeof(result->message), "cannot stat: %s", strerror(errno));
+        close(fd);
+        return false;
+    }
+    result->bytes = st.st_size;
+
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    if (readahead(fd, 0, (size_t) st.st_size) != 0) {
+        log_debug("Preload: readahead failed for %s: %s", path, strerror(errno));
+    }
+
+    close(fd);
+    return true;
+}
+
+// Check that the file decodes and matches its output mapping
+static bool validate_file(const track_config_t *track, preload_result_t *result) {
+    SF_INFO info;
+    memset(&info, 0, sizeof(info));
+
+    SNDFILE *file = sf_open(track->file_path, SFM_READ, &info);
+    if (!file) {
+        snprintf(result->message, sizeof(result->message), "unsupported format: %s", sf_strerror(NULL));
+        return false;
+    }
+
+    result->channels = info.channels;
+    result->samplerate = info.samplerate;
+    bool ok = false;
+
+    if (!sf_format_check(&info)) {
+        snprintf(result->message, sizeof(result->message), "invalid format 0x%08x", info.format);
+    } else if (info.samplerate <= 0 || info.frames <= 0) {
+        snprintf(result->message, sizeof(result->message), "empty file or invalid sample rate %d", info.samplerate);
+    } else if (track->output.mapping_count > 0 && track->output.mapping_count != info.channels) {
+        snprintf(result->message, sizeof(result->message), "file has %d channels but mapping has %d",
+                 info.channels, track->output.mapping_count);
+    } else {
+        // Decode the first block so codec errors surface now rather than at play time
+        float *probe = malloc(PRELOAD_PROBE_FRAMES * info.channels * sizeof(float));
+        if (!probe) {
+            snprintf(result->message, sizeof(result->message), "out of memory");
+        } else if (sf_readf_float(file, probe, PRELOAD_PROBE_FRAMES) <= 0) {
+            snprintf(result->message, sizeof(result->message), "decode failed: %s", sf_strerror(file));
+        } else {
+            ok = true;
+        }
+        free(probe);
+    }
+
+    sf_close(file);
+    return ok;
+}
+
+static void preload_work(preload_ctx_t *ctx) {
+    for (;;) {
+        const int job = atomic_fetch_add(&ctx->next_job, 1);
+        if (job >= ctx->count) break;
+
+        preload_result_t *result = &ctx->results[job];
+        struct timespec t0, t1, t2;
+
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        const bool warmed = warm_file(result->track->file_path, result);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        result->ok = warmed && validate_file(result->track, result);
+        if (result->ok && ctx->fill_sample_cache) {
+            result->cached = sample_cache_load(result->track->file_path);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t2);
+
+        result->warm_ms = elapsed_ms(&t0, &t1);
+        result->validate_ms = elapsed_ms(&t1, &t2);
+    }
+}
+
+static void *preload_worker_thread(void *arg) {
+    thread_policy_apply(THREAD_ROLE_WORKER);
+    preload_work(arg);
+    return NULL;
+}
+
+// Tracks sharing a device at different rates force PipeWire to resample
+static void check_shared_rates(const preload_result_t *results, int count) {
+    for (int i = 0; i < count; i++) {
+        if (!results[i].ok || results[i].track->bus) continue;
+        const char *dev_i = results[i].track->output.device ? results[i].track->output.device : "default";
+
+        for (int j = i + 1; j < count; j++) {
+            if (!results[j].ok || results[j].track->bus || results[j].samplerate == results[i].samplerate) continue;
+            const char *dev_j = results[j].track->output.device ? results[j].track->output.device : "default";
+            if (strcmp(dev_i, dev_j) != 0) continue;
+
+            log_warn("Preload: tracks %s (%d Hz) and %s (%d Hz) share device %s at different rates",
+                     results[i].track->id, results[i].samplerate,
+                     results[j].track->id, results[j].samplerate, dev_i);
+        }
+    }
+}
+
+// Bus members are mixed without resampling, so they must exist and match the bus rate
+static void check_buses(const global_config_t *config, preload_result_t *results, int count) {
+    for (int i = 0; i < count; i++) {
+        preload_result_t *r = &results[i];
+        if (!r->ok || !r->track->bus) continue;
+
+        const bus_config_t *bus = NULL;
+        for (int j = 0; j < config->bus_count && !bus; j++) {
+            if (config->buses[j].id && strcmp(config->buses[j].id, r->track->bus) == 0) bus = &config->buses[j];
+        }
+
+        if (!bus) {
+            snprintf(r->message, sizeof(r->message), "unknown bus %s", r->track->bus);
+            r->ok = false;
+        } else if (bus->samplerate != r->samplerate) {
+            snprintf(r->message, sizeof(r->message), "file is %d Hz but bus %s runs at %d Hz",
+                     r->samplerate, bus->id, bus->samplerate);
+            r->ok = false;
+        }
+    }
+}
+
+bool preload_run(const global_config_t *config) {
+    if (!config || !config->preload.enabled || config->track_count == 0) return true;
+
+    preload_ctx_t ctx = {0};
+    ctx.results = calloc(config->track_count, sizeof(preload_result_t));
+    if (!ctx.results) {
+        log_error("Failed to allocate preload results");
+        return false;
+    }
+    for (int i = 0; i < config->track_count; i++) {
+        if (!config->tracks[i].file_path) continue;
+        ctx.results[ctx.count++].track = &config->tracks[i];
+    }
+    ctx.fill_sample_cache = config->sample_cache.budget_mb > 0;
+    atomic_init(&ctx.next_job, 0);
+
+    int workers = config->preload.workers;
+    if (workers <= 0) {
+        const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = cpus > 0 ? (int) cpus : 1;
+    }
+    if (workers > ctx.count) workers = ctx.count;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    pthread_t *threads = calloc(workers > 0 ? workers : 1, sizeof(pthread_t));
+    int started = 0;
+    for (int i = 0; threads && i < workers; i++) {
+        if (pthread_create(&threads[i], NULL, preload_worker_thread, &ctx) != 0) {
+            log_warn("Preload: failed to start worker thread %d", i);
+            break;
+        }
+        started++;
+    }
+
+    // Run on the calling thread too, under its own policy; this also covers the case where no worker could start
+    preload_work(&ctx);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    check_buses(config, ctx.results, ctx.count);
+
+    int failed = 0;
+    off_t total_bytes = 0;
+    for (int i = 0; i < ctx.count; i++) {
+        const preload_result_t *r = &ctx.results[i];
+        total_bytes += r->bytes;
+        if (r->ok) {
+            log_info("Preload: %s ok (%d ch, %d Hz, %.1f MiB, warm %.1f ms, validate %.1f ms%s)",
+                     r->track->id, r->channels, r->samplerate, r->bytes / (1024.0 * 1024.0),
+                     r->warm_ms, r->validate_ms, r->cached ? ", in memory" : "");
+        } else {
+            log_error("Preload: %s (%s) failed: %s", r->track->id, r->track->file_path, r->message);
+            failed++;
+        }
+    }
+    check_shared_rates(ctx.results, ctx.count);
+
+    log_info("Preload: %d files, %.1f MiB in %.1f ms on %d threads (%d failed)",
+             ctx.count, total_bytes / (1024.0 * 1024.0), elapsed_ms(&start, &end), started + 1, failed);
+
+    free(ctx.results);
+    return failed == 0;
+}
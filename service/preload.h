@@ -0,0 +1,11 @@
+#ifndef ASYNC_AUDIO_PLAYER_PRELOAD_H
+#define ASYNC_AUDIO_PLAYER_PRELOAD_H
+
+#include <stdbool.h>
+#include "types.h"
+
+// Open, validate and warm every configured track file in parallel.
+// Returns false if any track failed validation.
+bool preload_run(const global_config_t *config);
+
+#endif // ASYNC_AUDIO_PLAYER_PRELOAD_H
@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include "reconnect.h"
+
+#define NS_PER_MS 1000000ull
+
+void reconnect_lost(reconnect_state_t *state, const uint64_t now_ns, const uint32_t initial_ms) {
+    if (state->waiting) {
+        return;
+    }
+    state->waiting = true;
+    state->lost_ns = now_ns;
+    state->next_ns = now_ns + initial_ms * NS_PER_MS;
+    state->backoff_ms = initial_ms > 0 ? initial_ms : 1;
+    state->attempts = 0;
+    state->attempt_ns = 0;
+    state->skipped_ns = now_ns;
+}
+
+void reconnect_device_added(reconnect_state_t *state, const uint64_t now_ns) {
+    if (state->waiting) {
+        state->next_ns = now_ns;
+    }
+}
+
+bool reconnect_due(reconnect_state_t *state, const uint64_t now_ns, const uint32_t max_ms) {
+    if (!state->waiting || now_ns < state->next_ns) {
+        return false;
+    }
+
+    // Give the attempt the current backoff to come up before the next one
+    state->attempts++;
+    state->attempt_ns = now_ns;
+    state->next_ns = now_ns + state->backoff_ms * NS_PER_MS;
+    state->backoff_ms = state->backoff_ms * 2 < max_ms ? state->backoff_ms * 2 : max_ms;
+    return true;
+}
+
+uint64_t reconnect_take_skipped(reconnect_state_t *state, const uint64_t now_ns) {
+    if (!state->waiting || now_ns < state->skipped_ns) {
+        return 0;
+    }
+    const uint64_t skipped = now_ns - state->skipped_ns;
+    state->skipped_ns = now_ns;
+    return skipped;
+}
+
+uint64_t reconnect_done(reconnect_state_t *state, const uint64_t now_ns) {
+    if (!state->waiting) {
+        return 0;
+    }
+    state->waiting = false;
+    state->reconnects++;
+    state->last_outage_ns = now_ns - state->lost_ns;
+    state->last_attempt_ns = state->attempt_ns ? now_ns - state->attempt_ns : 0;
+    return state->last_outage_ns;
+}
+
+int reconnect_format_status(const reconnect_state_t *state, const uint64_t now_ns, char *buffer,
+                            const size_t size) {
+    if (state->waiting) {
+        return snprintf(buffer, size, "waiting for device %.1f s, %u attempts",
+                        (double) (now_ns - state->lost_ns) / 1e9, state->attempts);
+    }
+    return snprintf(buffer, size, "reconnects %u, last outage %.0f ms (reconnect %.0f ms)", state->reconnects,
+                    (double) state->last_outage_ns / 1e6, (double) state->last_attempt_ns / 1e6);
+}
@@ -0,0 +1,41 @@
+#ifndef ASYNC_AUDIO_PLAYER_RECONNECT_H
+#define ASYNC_AUDIO_PLAYER_RECONNECT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Outage bookkeeping of a stream whose device went away: when it was lost, when to try again and how
+// long earlier outages took. Owned by the main loop thread.
+typedef struct {
+    bool waiting;               // Lost, a reconnect is pending
+    uint64_t lost_ns;           // CLOCK_MONOTONIC time output stopped
+    uint64_t next_ns;           // Earliest time of the next attempt
+    uint32_t backoff_ms;        // Wait after the next failed attempt
+    uint32_t attempts;          // Attempts in the current outage
+    uint32_t reconnects;        // Outages recovered from
+    uint64_t last_outage_ns;    // From losing the device to streaming again, last outage
+    uint64_t last_attempt_ns;   // From the successful attempt to streaming again, last outage
+    uint64_t attempt_ns;        // Time of the latest attempt
+    uint64_t skipped_ns;        // Time up to which reconnect_take_skipped accounted for the outage
+} reconnect_state_t;
+
+// Start an outage at now_ns; the first attempt waits initial_ms. Repeated calls keep the first loss time.
+void reconnect_lost(reconnect_state_t *state, uint64_t now_ns, uint32_t initial_ms);
+
+// The device reappeared, try right away
+void reconnect_device_added(reconnect_state_t *state, uint64_t now_ns);
+
+// True when an attempt is due; the attempt is counted and the next one pushed back, doubling up to max_ms
+bool reconnect_due(reconnect_state_t *state, uint64_t now_ns, uint32_t max_ms);
+
+// Outage time since the loss or the previous call, for skipping ahead on each attempt
+uint64_t reconnect_take_skipped(reconnect_state_t *state, uint64_t now_ns);
+
+// The stream is streaming again: close the outage and return its length in nanoseconds
+uint64_t reconnect_done(reconnect_state_t *state, uint64_t now_ns);
+
+// Format "reconnects N, last outage X ms (reconnect Y ms)", or the pending state while waiting
+int reconnect_format_status(const reconnect_state_t *state, uint64_t now_ns, char *buffer, size_t size);
+
+#endif // ASYNC_AUDIO_PLAYER_RECONNECT_H
@@ -0,0 +1,372 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "registry.h"
+#include "log.h"
+
+#define REGISTRY_MAX_NODES 512
+#define REGISTRY_MAX_PORTS 4096
+#define REGISTRY_HASH_SIZE 8192     // Power of two, at least twice the entries it indexes
+
+typedef struct {
+    uint32_t id;
+    uint32_t node_id;
+    char channel[16];
+    bool monitor;
+} registry_port_t;
+
+// Open addressing with linear probing; ref is node index + 1, -(port index + 1), or 0 when empty
+typedef struct {
+    uint32_t id;
+    int32_t ref;
+} id_entry_t;
+
+struct registry {
+    struct pw_core *core;
+    struct pw_registry *proxy;
+    struct spa_hook core_listener;
+    struct spa_hook registry_listener;
+    int sync_seq;
+    bool synced;
+
+    registry_node_t nodes[REGISTRY_MAX_NODES];
+    bool node_used[REGISTRY_MAX_NODES];
+    registry_port_t ports[REGISTRY_MAX_PORTS];
+    bool port_used[REGISTRY_MAX_PORTS];
+
+    id_entry_t by_id[REGISTRY_HASH_SIZE];
+    int32_t by_name[REGISTRY_HASH_SIZE];    // Node index + 1, 0 when empty
+
+    registry_hotplug_fn hotplug;
+    void *hotplug_data;
+};
+
+static uint32_t hash_id(uint32_t id) {
+    id ^= id >> 16;
+    id *= 0x7feb352du;
+    id ^= id >> 15;
+    return id & (REGISTRY_HASH_SIZE - 1);
+}
+
+// FNV-1a
+static uint32_t hash_name(const char *name) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *) name; *p; p++) {
+        hash = (hash ^ *p) * 16777619u;
+    }
+    return hash & (REGISTRY_HASH_SIZE - 1);
+}
+
+static int32_t id_lookup(const registry_t *registry, uint32_t id) {
+    for (uint32_t i = hash_id(id);; i = (i + 1) & (REGISTRY_HASH_SIZE - 1)) {
+        const id_entry_t *entry = &registry->by_id[i];
+        if (entry->ref == 0) return 0;
+        if (entry->id == id) return entry->ref;
+    }
+}
+
+static void id_insert(registry_t *registry, uint32_t id, int32_t ref) {
+    uint32_t i = hash_id(id);
+    while (registry->by_id[i].ref != 0 && registry->by_id[i].id != id) {
+        i = (i + 1) & (REGISTRY_HASH_SIZE - 1);
+    }
+    registry->by_id[i].id = id;
+    registry->by_id[i].ref = ref;
+}
+
+// Backward-shift deletion keeps probe sequences intact without tombstones
+static void id_remove(registry_t *registry, uint32_t id) {
+    uint32_t i = hash_id(id);
+    while (registry->by_id[i].ref != 0 && registry->by_id[i].id != id) {
+        i = (i + 1) & (REGISTRY_HASH_SIZE - 1);
+    }
+    if (registry->by_id[i].ref == 0) return;
+
+    for (uint32_t j = (i + 1) & (REGISTRY_HASH_SIZE - 1); registry->by_id[j].ref != 0;
+         j = (j + 1) & (REGISTRY_HASH_SIZE - 1)) {
+        const uint32_t home = hash_id(registry->by_id[j].id);
+        // Move j into the hole when its home slot is not cyclically within (i, j]
+        if (((j - home) & (REGISTRY_HASH_SIZE - 1)) >= ((j - i) & (REGISTRY_HASH_SIZE - 1))) {
+            registry->by_id[i] = registry->by_id[j];
+            i = j;
+        }
+    }
+    registry->by_id[i].ref = 0;
+}
+
+static int32_t name_lookup(const registry_t *registry, const char *name) {
+    for (uint32_t i = hash_name(name);; i = (i + 1) & (REGISTRY_HASH_SIZE - 1)) {
+        const int32_t ref = registry->by_name[i];
+        if (ref == 0) return 0;
+        if (strcmp(registry->nodes[ref - 1].name, name) == 0) return ref;
+    }
+}
+
+static void name_insert(registry_t *registry, int index) {
+    uint32_t i = hash_name(registry->nodes[index].name);
+    while (registry->by_name[i] != 0) {
+        i = (i + 1) & (REGISTRY_HASH_SIZE - 1);
+    }
+    registry->by_name[i] = index + 1;
+}
+
+static void name_remove(registry_t *registry, int index) {
+    uint32_t i = hash_name(registry->nodes[index].name);
+    while (registry->by_name[i] != 0 && registry->by_name[i] != index + 1) {
+        i = (i + 1) & (REGISTRY_HASH_SIZE - 1);
+    }
+    if (registry->by_name[i] == 0) return;
+
+    for (uint32_t j = (i + 1) & (REGISTRY_HASH_SIZE - 1); registry->by_name[j] != 0;
+         j = (j + 1) & (REGISTRY_HASH_SIZE - 1)) {
+        const uint32_t home = hash_name(registry->nodes[registry->by_name[j] - 1].name);
+        if (((j - home) & (REGISTRY_HASH_SIZE - 1)) >= ((j - i) & (REGISTRY_HASH_SIZE - 1))) {
+            registry->by_name[i] = registry->by_name[j];
+            i = j;
+        }
+    }
+    registry->by_name[i] = 0;
+}
+
+// Rebuild a node's channel list from its cached ports, after one went away
+static void rebuild_channels(registry_t *registry, registry_node_t *node) {
+    node->channels[0] = '\0';
+    node->port_count = 0;
+    size_t used = 0;
+    for (int i = 0; i < REGISTRY_MAX_PORTS; i++) {
+        const registry_port_t *port = &registry->ports[i];
+        if (!registry->port_used[i] || port->node_id != node->id || port->monitor) continue;
+        const int n = snprintf(node->channels + used, sizeof(node->channels) - used, "%s%s",
+                               node->port_count > 0 ? "," : "", port->channel[0] ? port->channel : "?");
+        if (n > 0 && (size_t) n < sizeof(node->channels) - used) used += n;
+        node->port_count++;
+    }
+}
+
+static void copy_prop(char *dst, size_t size, const struct spa_dict *props, const char *key) {
+    const char *value = spa_dict_lookup(props, key);
+    snprintf(dst, size, "%s", value ? value : "");
+}
+
+static void add_node(registry_t *registry, uint32_t id, const struct spa_dict *props) {
+    const char *media_class = spa_dict_lookup(props, PW_KEY_MEDIA_CLASS);
+    const char *name = spa_dict_lookup(props, PW_KEY_NODE_NAME);
+    if (!media_class || strncmp(media_class, "Audio/", 6) != 0 || !name) return;
+
+    int index = -1;
+    for (int i = 0; i < REGISTRY_MAX_NODES && index < 0; i++) {
+        if (!registry->node_used[i]) index = i;
+    }
+    if (index < 0) {
+        log_warn("Registry cache full, ignoring node %s", name);
+        return;
+    }
+
+    registry_node_t *node = &registry->nodes[index];
+    memset(node, 0, sizeof(*node));
+    node->id = id;
+    const char *serial = spa_dict_lookup(props, PW_KEY_OBJECT_SERIAL);
+    node->serial = serial ? strtoull(serial, NULL, 10) : id;
+    snprintf(node->name, sizeof(node->name), "%s", name);
+    copy_prop(node->description, sizeof(node->description), props, PW_KEY_NODE_DESCRIPTION);
+    snprintf(node->media_class, sizeof(node->media_class), "%s", media_class);
+
+    registry->node_used[index] = true;
+    id_insert(registry, id, index + 1);
+    name_insert(registry, index);
+
+    if (registry->synced) {
+        log_info("Device added: %s (id %u)", node->name, id);
+        if (registry->hotplug) registry->hotplug(registry->hotplug_data, node, true);
+    }
+}
+
+static void add_port(registry_t *registry, uint32_t id, const struct spa_dict *props) {
+    const char *node_id = spa_dict_lookup(props, PW_KEY_NODE_ID);
+    if (!node_id) return;
+
+    const int32_t ref = id_lookup(registry, (uint32_t) strtoul(node_id, NULL, 10));
+    if (ref <= 0) return;   // Port of a node that is not cached
+
+    int index = -1;
+    for (int i = 0; i < REGISTRY_MAX_PORTS && index < 0; i++) {
+        if (!registry->port_used[i]) index = i;
+    }
+    if (index < 0) return;
+
+    registry_port_t *port = &registry->ports[index];
+    port->id = id;
+    port->node_id = registry->nodes[ref - 1].id;
+    copy_prop(port->channel, sizeof(port->channel), props, PW_KEY_AUDIO_CHANNEL);
+    const char *monitor = spa_dict_lookup(props, PW_KEY_PORT_MONITOR);
+    port->monitor = monitor && strcmp(monitor, "true") == 0;
+    registry->port_used[index] = true;
+    id_insert(registry, id, -(index + 1));
+
+    if (port->monitor) return;
+    registry_node_t *node = &registry->nodes[ref - 1];
+    const size_t used = strlen(node->channels);
+    snprintf(node->channels + used, sizeof(node->channels) - used, "%s%s", node->port_count > 0 ? "," : "",
+             port->channel[0] ? port->channel : "?");
+    node->port_count++;
+}
+
+static void on_global(void *data, uint32_t id, uint32_t permissions, const char *type, uint32_t version,
+                      const struct spa_dict *props) {
+    registry_t *registry = data;
+    (void) permissions;
+    (void) version;
+    if (!props) return;
+
+    if (strcmp(type, PW_TYPE_INTERFACE_Node) == 0) {
+        add_node(registry, id, props);
+    } else if (strcmp(type, PW_TYPE_INTERFACE_Port) == 0) {
+        add_port(registry, id, props);
+    }
+}
+
+static void on_global_remove(void *data, uint32_t id) {
+    registry_t *registry = data;
+    const int32_t ref = id_lookup(registry, id);
+    if (ref == 0) return;
+    id_remove(registry, id);
+
+    if (ref < 0) {
+        const int index = -ref - 1;
+        registry->port_used[index] = false;
+        const int32_t node_ref = id_lookup(registry, registry->ports[index].node_id);
+        if (node_ref > 0) rebuild_channels(registry, &registry->nodes[node_ref - 1]);
+        return;
+    }
+
+    const int index = ref - 1;
+    registry_node_t *node = &registry->nodes[index];
+    log_info("Device removed: %s (id %u)", node->name, id);
+    if (registry->hotplug) registry->hotplug(registry->hotplug_data, node, false);
+    name_remove(registry, index);
+    registry->node_used[index] = false;
+}
+
+static const struct pw_registry_events registry_events = {
+        PW_VERSION_REGISTRY_EVENTS,
+        .global = on_global,
+        .global_remove = on_global_remove,
+};
+
+static void on_core_done(void *data, uint32_t id, int seq) {
+    registry_t *registry = data;
+    if (id == PW_ID_CORE && seq == registry->sync_seq) {
+        registry->synced = true;
+    }
+}
+
+static void on_core_error(void *data, uint32_t id, int seq, int res, const char *message) {
+    (void) data;
+    (void) seq;
+    log_error("PipeWire core error on object %u: %s (%d)", id, message ? message : "unknown", res);
+}
+
+static const struct pw_core_events core_events = {
+        PW_VERSION_CORE_EVENTS,
+        .done = on_core_done,
+        .error = on_core_error,
+};
+
+registry_t *registry_create(struct pw_context *context) {
+    if (!context) return NULL;
+
+    registry_t *registry = calloc(1, sizeof(registry_t));
+    if (!registry) {
+        log_error("Failed to allocate registry cache");
+        return NULL;
+    }
+
+    registry->core = pw_context_connect(context, NULL, 0);
+    if (!registry->core) {
+        log_error("Failed to connect to PipeWire for the registry");
+        free(registry);
+        return NULL;
+    }
+
+    registry->proxy = pw_core_get_registry(registry->core, PW_VERSION_REGISTRY, 0);
+    if (!registry->proxy) {
+        log_error("Failed to get the PipeWire registry");
+        pw_core_disconnect(registry->core);
+        free(registry);
+        return NULL;
+    }
+
+    pw_core_add_listener(registry->core, &registry->core_listener, &core_events, registry);
+    pw_registry_add_listener(registry->proxy, &registry->registry_listener, &registry_events, registry);
+    registry->sync_seq = pw_core_sync(registry->core, PW_ID_CORE, 0);
+    return registry;
+}
+
+bool registry_sync(registry_t *registry, struct pw_loop *loop, int timeout_ms) {
+    if (!registry || !loop) return false;
+
+    for (int waited = 0; !registry->synced && waited < timeout_ms; waited += 10) {
+        pw_loop_iterate(loop, 10);
+    }
+    if (!registry->synced) {
+        log_warn("PipeWire registry did not sync within %d ms", timeout_ms);
+    }
+    return registry->synced;
+}
+
+void registry_set_hotplug(registry_t *registry, registry_hotplug_fn fn, void *data) {
+    if (!registry) return;
+    registry->hotplug = fn;
+    registry->hotplug_data = data;
+}
+
+const registry_node_t *registry_find(const registry_t *registry, const char *name) {
+    if (!registry || !name) return NULL;
+    const int32_t ref = name_lookup(registry, name);
+    return ref > 0 ? &registry->nodes[ref - 1] : NULL;
+}
+
+bool registry_target(const registry_t *registry, const char *device, char *buffer, size_t size) {
+    if (!device || strcmp(device, "default") == 0) return false;
+
+    const registry_node_t *node = registry_find(registry, device);
+    if (node) {
+        snprintf(buffer, size, "%" PRIu64, node->serial);
+    } else {
+        // Not present (yet): the session manager resolves the name when the device shows up
+        snprintf(buffer, size, "%s", device);
+    }
+    return true;
+}
+
+bool registry_available(const registry_t *registry, const char *device) {
+    if (!registry || !device || strcmp(device, "default") == 0) return true;
+    return name_lookup(registry, device) > 0;
+}
+
+int registry_format_devices(const registry_t *registry, char *buffer, size_t size) {
+    if (!registry) return snprintf(buffer, size, "No registry connection\n");
+
+    int written = snprintf(buffer, size, "%-6s %-8s %-20s %-48s %-24s %s\n", "ID", "SERIAL", "CLASS", "NAME",
+                           "CHANNELS", "DESCRIPTION");
+    for (int i = 0; i < REGISTRY_MAX_NODES && written >= 0 && (size_t) written < size; i++) {
+        if (!registry->node_used[i]) continue;
+        const registry_node_t *node = &registry->nodes[i];
+        const int n = snprintf(buffer + written, size - written, "%-6u %-8" PRIu64 " %-20s %-48s %-24s %s\n",
+                               node->id, node->serial, node->media_class, node->name,
+                               node->channels[0] ? node->channels : "-", node->description);
+        if (n < 0) break;
+        written += n;
+    }
+    return written < (int) size ? written : (int) size - 1;
+}
+
+void registry_destroy(registry_t *registry) {
+    if (!registry) return;
+    spa_hook_remove(&registry->registry_listener);
+    spa_hook_remove(&registry->core_listener);
+    pw_proxy_destroy((struct pw_proxy *) registry->proxy);
+    pw_core_disconnect(registry->core);
+    free(registry);
+}
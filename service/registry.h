@@ -0,0 +1,50 @@
+#ifndef ASYNC_AUDIO_PLAYER_REGISTRY_H
+#define ASYNC_AUDIO_PLAYER_REGISTRY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pipewire/pipewire.h>
+
+// Live cache of the PipeWire audio nodes and their ports, kept current by a registry listener on the
+// main loop. Lookups by id and node name are hashed. Access it from the main loop thread or with the
+// track manager lock held.
+typedef struct registry registry_t;
+
+typedef struct {
+    uint32_t id;
+    uint64_t serial;            // object.serial, stable for the lifetime of the node
+    char name[128];             // node.name, what output.device refers to
+    char description[128];
+    char media_class[32];       // Audio/Sink, Audio/Source, ...
+    char channels[256];         // Comma-separated audio.channel of the node's non-monitor ports
+    int port_count;
+} registry_node_t;
+
+// Called when an audio device node appears (added) or goes away
+typedef void (*registry_hotplug_fn)(void *data, const registry_node_t *node, bool added);
+
+// Connect a core on the context and start listening
+registry_t *registry_create(struct pw_context *context);
+
+// Iterate the loop until the initial set of objects has arrived or timeout_ms passes
+bool registry_sync(registry_t *registry, struct pw_loop *loop, int timeout_ms);
+
+void registry_set_hotplug(registry_t *registry, registry_hotplug_fn fn, void *data);
+
+// Node by node.name, NULL when it is not present
+const registry_node_t *registry_find(const registry_t *registry, const char *name);
+
+// Value for PW_KEY_TARGET_OBJECT: the cached serial when the device is present, else the name itself.
+// Returns false for NULL or "default", which leave routing to the session manager.
+bool registry_target(const registry_t *registry, const char *device, char *buffer, size_t size);
+
+// False only when the cache knows the device is absent; NULL, "default" and no registry count as available
+bool registry_available(const registry_t *registry, const char *device);
+
+// Format one line per audio device: id, serial, class, name, channels and description
+int registry_format_devices(const registry_t *registry, char *buffer, size_t size);
+
+void registry_destroy(registry_t *registry);
+
+#endif // ASYNC_AUDIO_PLAYER_REGISTRY_H
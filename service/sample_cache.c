@@ -0,0 +1,369 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include "sample_cache.h"
+#include "pcm_cache.h"
+#include "arena.h"
+#include "thread_policy.h"
+#include "log.h"
+
+#define SAMPLE_CACHE_MAX_ENTRIES 256
+#define SAMPLE_CACHE_QUEUE_SIZE 32
+#define STATUS_BUFFER_SIZE 4096
+
+static struct {
+    bool initialized;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    size_t budget;
+    size_t resident;
+    uint64_t tick;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+
+    sample_cache_entry_t *entries[SAMPLE_CACHE_MAX_ENTRIES];
+    int entry_count;
+
+    char **pinned_paths;
+    int pinned_count;
+
+    // Background loads requested by cache misses
+    char *queue[SAMPLE_CACHE_QUEUE_SIZE];
+    int queue_count;
+    pthread_t loader;
+    bool loader_running;
+    bool stop;
+} cache = {
+        .lock = PTHREAD_MUTEX_INITIALIZER,
+        .wake = PTHREAD_COND_INITIALIZER,
+};
+
+static bool is_pinned_path(const char *path) {
+    for (int i = 0; i < cache.pinned_count; i++) {
+        if (strcmp(cache.pinned_paths[i], path) == 0) return true;
+    }
+    return false;
+}
+
+static sample_cache_entry_t *find_entry(const char *path) {
+    for (int i = 0; i < cache.entry_count; i++) {
+        if (strcmp(cache.entries[i]->source_path, path) == 0) return cache.entries[i];
+    }
+    return NULL;
+}
+
+static void free_entry(sample_cache_entry_t *entry) {
+    free(entry->source_path);
+    arena_free(entry->samples);
+    free(entry);
+}
+
+// Drop least recently used, unreferenced, unpinned entries until `needed` more bytes fit
+static void evict_for(size_t needed) {
+    while (cache.resident + needed > cache.budget) {
+        int victim = -1;
+        for (int i = 0; i < cache.entry_count; i++) {
+            const sample_cache_entry_t *e = cache.entries[i];
+            if (e->pinned || e->refcount > 0) continue;
+            if (victim < 0 || e->last_used < cache.entries[victim]->last_used) victim = i;
+        }
+        if (victim < 0) return;
+
+        sample_cache_entry_t *e = cache.entries[victim];
+        log_debug("Sample cache: evicting %s (%.1f MiB)", e->source_path, e->bytes / (1024.0 * 1024.0));
+        cache.resident -= e->bytes;
+        cache.evictions++;
+        cache.entries[victim] = cache.entries[--cache.entry_count];
+        free_entry(e);
+    }
+}
+
+// Read a whole file, preferring the decoded PCM cache over libsndfile
+static bool decode_file(const char *path, sample_cache_entry_t *entry) {
+    pcm_cache_header_t header;
+    const int fd = pcm_cache_open(path, &header);
+    if (fd >= 0) {
+        const size_t bytes = header.frames * header.channels * sizeof(float);
+        entry->samples = arena_alloc(bytes > 0 ? bytes : 1);
+        size_t done = 0;
+        while (entry->samples && done < bytes) {
+            const ssize_t n = pread(fd, (char *) entry->samples + done, bytes - done, sizeof(header) + done);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            done += (size_t) n;
+        }
+        close(fd);
+
+        if (!entry->samples || done != bytes) return false;
+        entry->frames = (sf_count_t) header.frames;
+        entry->channels = (int) header.channels;
+        entry->samplerate = (int) header.samplerate;
+        return true;
+    }
+
+    SF_INFO info;
+    memset(&info, 0, sizeof(info));
+    SNDFILE *file = sf_open(path, SFM_READ, &info);
+    if (!file) {
+        log_error("Sample cache: failed to open %s (%s)", path, sf_strerror(NULL));
+        return false;
+    }
+
+    // Frame counts of some compressed formats are estimates, so grow as needed
+    sf_count_t capacity = info.frames > 0 ? info.frames : info.samplerate;
+    sf_count_t frames = 0;
+    entry->samples = arena_alloc(capacity * info.channels * sizeof(float));
+    while (entry->samples) {
+        if (frames == capacity) {
+            capacity *= 2;
+            float *grown = arena_realloc(entry->samples, capacity * info.channels * sizeof(float));
+            if (!grown) {
+                arena_free(entry->samples);
+                entry->samples = NULL;
+                break;
+            }
+            entry->samples = grown;
+        }
+        const sf_count_t n = sf_readf_float(file, entry->samples + frames * info.channels, capacity - frames);
+        if (n <= 0) break;
+        frames += n;
+    }
+    sf_close(file);
+
+    if (!entry->samples) {
+        log_error("Sample cache: out of memory decoding %s", path);
+        return false;
+    }
+    entry->frames = frames;
+    entry->channels = info.channels;
+    entry->samplerate = info.samplerate;
+    return true;
+}
+
+bool sample_cache_load(const char *path) {
+    if (!path) return false;
+
+    pthread_mutex_lock(&cache.lock);
+    const bool skip = cache.budget == 0 || find_entry(path) != NULL;
+    pthread_mutex_unlock(&cache.lock);
+    if (skip) return cache.budget > 0;
+
+    sample_cache_entry_t *entry = calloc(1, sizeof(sample_cache_entry_t));
+    if (!entry) return false;
+    entry->source_path = strdup(path);
+    if (!entry->source_path || !decode_file(path, entry)) {
+        free_entry(entry);
+        return false;
+    }
+    entry->bytes = (size_t) entry->frames * entry->channels * sizeof(float);
+
+    pthread_mutex_lock(&cache.lock);
+    bool stored = false;
+    if (find_entry(path)) {
+        stored = true; // Loaded concurrently by another thread
+    } else if (cache.entry_count < SAMPLE_CACHE_MAX_ENTRIES) {
+        entry->pinned = is_pinned_path(path);
+        evict_for(entry->bytes);
+
+        if (cache.resident + entry->bytes <= cache.budget || entry->pinned) {
+            if (entry->pinned && cache.resident + entry->bytes > cache.budget) {
+                log_warn("Sample cache: critical file %s exceeds the memory budget", path);
+            }
+            entry->last_used = ++cache.tick;
+            cache.entries[cache.entry_count++] = entry;
+            cache.resident += entry->bytes;
+            stored = true;
+            entry = NULL;
+        } else {
+            log_warn("Sample cache: %s (%.1f MiB) does not fit in the budget", path,
+                     entry->bytes / (1024.0 * 1024.0));
+        }
+    }
+    pthread_mutex_unlock(&cache.lock);
+
+    if (entry) free_entry(entry);
+    return stored;
+}
+
+static void *loader_thread(void *arg) {
+    (void) arg;
+    thread_policy_apply(THREAD_ROLE_WORKER);
+
+    pthread_mutex_lock(&cache.lock);
+    while (!cache.stop) {
+        if (cache.queue_count == 0) {
+            pthread_cond_wait(&cache.wake, &cache.lock);
+            continue;
+        }
+
+        char *path = cache.queue[0];
+        memmove(cache.queue, cache.queue + 1, sizeof(char *) * --cache.queue_count);
+        pthread_mutex_unlock(&cache.lock);
+
+        sample_cache_load(path);
+        free(path);
+
+        pthread_mutex_lock(&cache.lock);
+    }
+    pthread_mutex_unlock(&cache.lock);
+    return NULL;
+}
+
+// Queue a background load unless one is already pending (lock held)
+static void queue_load(const char *path) {
+    for (int i = 0; i < cache.queue_count; i++) {
+        if (strcmp(cache.queue[i], path) == 0) return;
+    }
+    if (cache.queue_count >= SAMPLE_CACHE_QUEUE_SIZE) return;
+
+    char *copy = strdup(path);
+    if (!copy) return;
+    cache.queue[cache.queue_count++] = copy;
+    pthread_cond_signal(&cache.wake);
+}
+
+const sample_cache_entry_t *sample_cache_acquire(const char *path) {
+    if (!path) return NULL;
+
+    pthread_mutex_lock(&cache.lock);
+    if (cache.budget == 0) {
+        pthread_mutex_unlock(&cache.lock);
+        return NULL;
+    }
+
+    sample_cache_entry_t *entry = find_entry(path);
+    if (entry) {
+        entry->refcount++;
+        entry->last_used = ++cache.tick;
+        cache.hits++;
+    } else {
+        cache.misses++;
+        if (cache.loader_running) queue_load(path);
+    }
+    pthread_mutex_unlock(&cache.lock);
+
+    return entry;
+}
+
+void sample_cache_release(const sample_cache_entry_t *entry) {
+    if (!entry) return;
+
+    pthread_mutex_lock(&cache.lock);
+    for (int i = 0; i < cache.entry_count; i++) {
+        if (cache.entries[i] == entry) {
+            cache.entries[i]->refcount--;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&cache.lock);
+}
+
+bool sample_cache_init(const global_config_t *config) {
+    if (!config) return false;
+
+    pthread_mutex_lock(&cache.lock);
+
+    // Refresh pinning from the critical tracks of this configuration
+    for (int i = 0; i < cache.pinned_count; i++) {
+        free(cache.pinned_paths[i]);
+    }
+    free(cache.pinned_paths);
+    cache.pinned_paths = calloc(config->track_count > 0 ? config->track_count : 1, sizeof(char *));
+    cache.pinned_count = 0;
+    for (int i = 0; cache.pinned_paths && i < config->track_count; i++) {
+        if (config->tracks[i].critical && config->tracks[i].file_path) {
+            cache.pinned_paths[cache.pinned_count++] = strdup(config->tracks[i].file_path);
+        }
+    }
+    for (int i = 0; i < cache.entry_count; i++) {
+        cache.entries[i]->pinned = is_pinned_path(cache.entries[i]->source_path);
+    }
+
+    cache.budget = config->sample_cache.budget_mb > 0 ? (size_t) config->sample_cache.budget_mb * 1024 * 1024 : 0;
+    evict_for(0);
+
+    bool ok = true;
+    if (cache.budget > 0 && !cache.loader_running) {
+        cache.stop = false;
+        if (pthread_create(&cache.loader, NULL, loader_thread, NULL) == 0) {
+            cache.loader_running = true;
+        } else {
+            log_error("Failed to create sample cache loader thread");
+            ok = false;
+        }
+    }
+    cache.initialized = true;
+
+    if (cache.budget > 0) {
+        log_info("Sample cache budget %d MiB (%d pinned files)", config->sample_cache.budget_mb, cache.pinned_count);
+    }
+    pthread_mutex_unlock(&cache.lock);
+    return ok;
+}
+
+char *sample_cache_print_status(void) {
+    char *status = malloc(STATUS_BUFFER_SIZE);
+    if (!status) return NULL;
+    int offset = 0;
+
+    pthread_mutex_lock(&cache.lock);
+    const uint64_t lookups = cache.hits + cache.misses;
+    offset += snprintf(status + offset, STATUS_BUFFER_SIZE - offset,
+                       "Sample cache: %d entries, %.1f / %.1f MiB resident\n"
+                       "Hits: %llu, misses: %llu, hit rate: %.1f%%, evictions: %llu\n",
+                       cache.entry_count, cache.resident / (1024.0 * 1024.0), cache.budget / (1024.0 * 1024.0),
+                       (unsigned long long) cache.hits, (unsigned long long) cache.misses,
+                       lookups ? 100.0 * cache.hits / lookups : 0.0, (unsigned long long) cache.evictions);
+
+    for (int i = 0; i < cache.entry_count && offset < STATUS_BUFFER_SIZE; i++) {
+        const sample_cache_entry_t *e = cache.entries[i];
+        offset += snprintf(status + offset, STATUS_BUFFER_SIZE - offset, "  %s: %.1f MiB, refs %d%s\n",
+                           e->source_path, e->bytes / (1024.0 * 1024.0), e->refcount, e->pinned ? ", pinned" : "");
+    }
+    pthread_mutex_unlock(&cache.lock);
+
+    return status;
+}
+
+void sample_cache_cleanup(void) {
+    pthread_mutex_lock(&cache.lock);
+    if (!cache.initialized) {
+        pthread_mutex_unlock(&cache.lock);
+        return;
+    }
+    cache.stop = true;
+    pthread_cond_signal(&cache.wake);
+    const bool join = cache.loader_running;
+    cache.loader_running = false;
+    pthread_mutex_unlock(&cache.lock);
+
+    if (join) pthread_join(cache.loader, NULL);
+
+    pthread_mutex_lock(&cache.lock);
+    for (int i = 0; i < cache.queue_count; i++) {
+        free(cache.queue[i]);
+    }
+    for (int i = 0; i < cache.entry_count; i++) {
+        if (cache.entries[i]->refcount > 0) {
+            log_warn("Sample cache: freeing %s while still referenced", cache.entries[i]->source_path);
+        }
+        free_entry(cache.entries[i]);
+    }
+    for (int i = 0; i < cache.pinned_count; i++) {
+        free(cache.pinned_paths[i]);
+    }
+    free(cache.pinned_paths);
+
+    cache.pinned_paths = NULL;
+    cache.pinned_count = 0;
+    cache.queue_count = 0;
+    cache.entry_count = 0;
+    cache.resident = 0;
+    cache.budget = 0;
+    cache.initialized = false;
+    pthread_mutex_unlock(&cache.lock);
+}
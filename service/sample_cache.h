@@ -0,0 +1,41 @@
+#ifndef ASYNC_AUDIO_PLAYER_SAMPLE_CACHE_H
+#define ASYNC_AUDIO_PLAYER_SAMPLE_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sndfile.h>
+#include "types.h"
+
+// Fully decoded audio kept in memory, shared by every audio_file_t playing it
+typedef struct sample_cache_entry {
+    char *source_path;
+    float *samples;         // Interleaved float frames
+    sf_count_t frames;
+    int channels;
+    int samplerate;
+    size_t bytes;
+    int refcount;           // Open audio files using the samples; never evicted while > 0
+    uint64_t last_used;     // LRU tick of the last acquire
+    bool pinned;            // Belongs to a critical track; never evicted
+} sample_cache_entry_t;
+
+// Apply budget and pinning from the configuration; keeps resident samples across reloads
+bool sample_cache_init(const global_config_t *config);
+
+// Decode a file into the cache on the calling thread
+bool sample_cache_load(const char *path);
+
+// Take a reference on cached samples; a miss queues a background load and returns NULL
+const sample_cache_entry_t *sample_cache_acquire(const char *path);
+
+// Drop a reference taken by sample_cache_acquire
+void sample_cache_release(const sample_cache_entry_t *entry);
+
+// Format cache statistics (caller frees)
+char *sample_cache_print_status(void);
+
+// Free all cached samples and stop the loader thread
+void sample_cache_cleanup(void);
+
+#endif // ASYNC_AUDIO_PLAYER_SAMPLE_CACHE_H
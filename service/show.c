@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "show.h"
+#include "track_manager.h"
+#include "log.h"
+
+#define MAX_PENDING_ACTIONS 256
+#define DEFAULT_PREROLL_MS 250
+
+// Action waiting for its due time to come within the preroll window
+typedef struct {
+    const cue_config_t *cue;
+    const cue_action_t *action;
+    uint64_t due_ns;
+} pending_action_t;
+
+struct show_ctx {
+    track_manager_ctx_t *track_manager;
+    const global_config_t *config;
+    uint64_t preroll_ns;
+    int playhead;               // Index of the next cue to fire
+    const char *last_cue;
+    bool paused;
+    uint64_t paused_at_ns;
+    pending_action_t pending[MAX_PENDING_ACTIONS];
+    int pending_count;
+    show_fire_fn fire_hook;     // Tells the sync followers about fired cues
+    void *fire_data;
+};
+
+show_ctx_t *show_init(track_manager_ctx_t *track_manager, const global_config_t *config) {
+    show_ctx_t *show = calloc(1, sizeof(show_ctx_t));
+    if (!show) {
+        log_error("Failed to allocate show context");
+        return NULL;
+    }
+
+    show->track_manager = track_manager;
+    show->config = config;
+    const int preroll_ms = config->show.preroll_ms > 0 ? config->show.preroll_ms : DEFAULT_PREROLL_MS;
+    show->preroll_ns = (uint64_t) preroll_ms * 1000000ULL;
+
+    if (config->cue_count > 0) {
+        log_info("Show: %d cues loaded, preroll %d ms", config->cue_count, preroll_ms);
+    }
+    return show;
+}
+
+// Dispatch one action at its exact due time (track manager lock held)
+static void arm_action(show_ctx_t *show, const pending_action_t *p) {
+    const cue_action_t *action = p->action;
+    bool ok = false;
+
+    switch (action->type) {
+        case CUE_ACTION_PLAY:
+            ok = track_manager_play_at(show->track_manager, action->track, p->due_ns);
+            break;
+        case CUE_ACTION_STOP:
+            ok = track_manager_stop_at(show->track_manager, action->track, p->due_ns);
+            break;
+        case CUE_ACTION_VOLUME:
+            ok = track_manager_set_volume_at(show->track_manager, action->track, action->value, p->due_ns);
+            break;
+        case CUE_ACTION_PAN:
+            ok = track_manager_set_position(show->track_manager, action->track, action->x, action->y,
+                                            action->duration, p->due_ns);
+            break;
+    }
+
+    if (!ok) {
+        log_warn("Show: cue %s action on track %s failed", p->cue->id, action->track ? action->track : "?");
+    }
+}
+
+static void fire_cue_at(show_ctx_t *show, const cue_config_t *cue, const uint64_t base_ns) {
+    for (int i = 0; i < cue->action_count; i++) {
+        const cue_action_t *action = &cue->actions[i];
+        if (!action->track) continue;
+        if (show->pending_count >= MAX_PENDING_ACTIONS) {
+            log_error("Show: too many pending actions, dropping the rest of cue %s", cue->id);
+            break;
+        }
+
+        pending_action_t *p = &show->pending[show->pending_count++];
+        p->cue = cue;
+        p->action = action;
+        p->due_ns = base_ns + (uint64_t) (action->at > 0 ? action->at * 1e9 : 0);
+    }
+
+    show->last_cue = cue->id;
+    log_info("Show: fired cue %s (%d actions)", cue->id, cue->action_count);
+    if (show->fire_hook) {
+        show->fire_hook(show->fire_data, cue->id, base_ns);
+    }
+
+    // Actions due right away should reach their streams as early as possible
+    show_tick(show);
+}
+
+static void fire_cue(show_ctx_t *show, const cue_config_t *cue) {
+    fire_cue_at(show, cue, track_manager_now_ns() + show->preroll_ns);
+}
+
+static void resume(show_ctx_t *show) {
+    const uint64_t held_ns = track_manager_now_ns() - show->paused_at_ns;
+    for (int i = 0; i < show->pending_count; i++) {
+        show->pending[i].due_ns += held_ns;
+    }
+    show->paused = false;
+    log_info("Show: resumed after %.1f ms", held_ns / 1e6);
+}
+
+const char *show_go(show_ctx_t *show, bool *resumed) {
+    return show_go_at(show, 0, resumed);
+}
+
+const char *show_go_at(show_ctx_t *show, uint64_t base_ns, bool *resumed) {
+    if (resumed) *resumed = false;
+    if (!show) return NULL;
+
+    track_manager_lock(show->track_manager);
+    const char *fired = NULL;
+
+    if (show->paused) {
+        resume(show);
+        if (resumed) *resumed = true;
+        fired = show->last_cue;
+    } else if (show->playhead < show->config->cue_count) {
+        const cue_config_t *cue = &show->config->cues[show->playhead++];
+        if (base_ns) {
+            fire_cue_at(show, cue, base_ns);
+        } else {
+            fire_cue(show, cue);
+        }
+        fired = cue->id;
+    }
+
+    track_manager_unlock(show->track_manager);
+    return fired;
+}
+
+bool show_goto(show_ctx_t *show, const char *cue_id) {
+    return show_fire_at(show, cue_id, 0);
+}
+
+bool show_fire_at(show_ctx_t *show, const char *cue_id, uint64_t base_ns) {
+    if (!show || !cue_id) return false;
+
+    track_manager_lock(show->track_manager);
+    bool found = false;
+    for (int i = 0; i < show->config->cue_count; i++) {
+        if (show->config->cues[i].id && strcmp(show->config->cues[i].id, cue_id) == 0) {
+            if (show->paused) resume(show);
+            show->playhead = i + 1;
+            if (base_ns) {
+                fire_cue_at(show, &show->config->cues[i], base_ns);
+            } else {
+                fire_cue(show, &show->config->cues[i]);
+            }
+            found = true;
+            break;
+        }
+    }
+    track_manager_unlock(show->track_manager);
+
+    if (!found) log_warn("Show: unknown cue %s", cue_id);
+    return found;
+}
+
+uint64_t show_get_preroll_ns(const show_ctx_t *show) {
+    return show ? show->preroll_ns : (uint64_t) DEFAULT_PREROLL_MS * 1000000ULL;
+}
+
+void show_set_fire_hook(show_ctx_t *show, show_fire_fn fn, void *data) {
+    if (!show) return;
+
+    track_manager_lock(show->track_manager);
+    show->fire_hook = fn;
+    show->fire_data = data;
+    track_manager_unlock(show->track_manager);
+}
+
+bool show_pause(show_ctx_t *show) {
+    if (!show) return false;
+
+    track_manager_lock(show->track_manager);
+    if (!show->paused) {
+        show->paused = true;
+        show->paused_at_ns = track_manager_now_ns();
+        log_info("Show: paused with %d pending actions", show->pending_count);
+    }
+    track_manager_unlock(show->track_manager);
+    return true;
+}
+
+void show_tick(show_ctx_t *show) {
+    if (!show) return;
+
+    track_manager_lock(show->track_manager);
+    if (show->paused) {
+        track_manager_unlock(show->track_manager);
+        return;
+    }
+    const uint64_t horizon = track_manager_now_ns() + show->preroll_ns;
+
+    // Arm in due order so a stop never reaches a track before its play
+    for (;;) {
+        int next = -1;
+        for (int i = 0; i < show->pending_count; i++) {
+            if (show->pending[i].due_ns <= horizon &&
+                (next < 0 || show->pending[i].due_ns < show->pending[next].due_ns)) {
+                next = i;
+            }
+        }
+        if (next < 0) break;
+
+        const pending_action_t p = show->pending[next];
+        show->pending[next] = show->pending[--show->pending_count];
+        arm_action(show, &p);
+    }
+    track_manager_unlock(show->track_manager);
+}
+
+int show_format_status(show_ctx_t *show, char *buffer, size_t size) {
+    if (!show || show->config->cue_count == 0) return snprintf(buffer, size, "Show: no cues\n");
+
+    const char *next = show->playhead < show->config->cue_count ? show->config->cues[show->playhead].id : "<end>";
+    return snprintf(buffer, size, "Show: next cue %s (%d/%d), last %s, %d pending actions%s\n",
+                    next, show->playhead + 1, show->config->cue_count,
+                    show->last_cue ? show->last_cue : "-", show->pending_count, show->paused ? ", paused" : "");
+}
+
+void show_cleanup(show_ctx_t *show) {
+    free(show);
+}
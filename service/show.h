@@ -0,0 +1,51 @@
+#ifndef ASYNC_AUDIO_PLAYER_SHOW_H
+#define ASYNC_AUDIO_PLAYER_SHOW_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "types.h"
+
+typedef struct track_manager_ctx track_manager_ctx_t;
+
+// Cue list sequencer context
+typedef struct show_ctx show_ctx_t;
+
+// Create a sequencer for the cues in the configuration
+show_ctx_t *show_init(track_manager_ctx_t *track_manager, const global_config_t *config);
+
+// Fire the cue at the playhead and advance it; resumes instead when paused.
+// Returns the fired cue ID, or NULL when the cue list is exhausted.
+const char *show_go(show_ctx_t *show, bool *resumed);
+
+// show_go with the fired cue's actions timed from base_ns (0 = now plus preroll)
+const char *show_go_at(show_ctx_t *show, uint64_t base_ns, bool *resumed);
+
+// Move the playhead to a cue and fire it; returns false for an unknown cue
+bool show_goto(show_ctx_t *show, const char *cue_id);
+
+// Fire a cue with its actions timed from base_ns (0 = now plus preroll), moving the playhead past it;
+// returns false for an unknown cue
+bool show_fire_at(show_ctx_t *show, const char *cue_id, uint64_t base_ns);
+
+// Lead time between a cue firing and its first action
+uint64_t show_get_preroll_ns(const show_ctx_t *show);
+
+// Called under the track manager lock whenever a cue fires, with the time its actions count from
+typedef void (*show_fire_fn)(void *data, const char *cue_id, uint64_t base_ns);
+
+void show_set_fire_hook(show_ctx_t *show, show_fire_fn fn, void *data);
+
+// Hold actions that are not yet armed until the next go
+bool show_pause(show_ctx_t *show);
+
+// Hand actions that fall inside the preroll window to the track manager
+void show_tick(show_ctx_t *show);
+
+// Format the sequencer state
+int show_format_status(show_ctx_t *show, char *buffer, size_t size);
+
+// Free the sequencer
+void show_cleanup(show_ctx_t *show);
+
+#endif // ASYNC_AUDIO_PLAYER_SHOW_H
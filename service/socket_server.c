@@ -1,262 +1,443 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <poll.h>
 #include <pthread.h>
 #include <sys/stat.h>
 #include <limits.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
 #include "socket_server.h"
 #include "log.h"
-#ifndef RUNTIME_SUBDIR
-#define RUNTIME_SUBDIR "papa"
-#endif
-
-// Socket command handling
+#include "commands.h"
+#include "thread_policy.h"
+#include "socket_path.h"
+
+#define MAX_CONNECTIONS 32
+#define SESSION_HELLO "session\n"     // First line of a persistent, pipelined connection
+#define SESSION_VERSION 1
+#define SESSION_WRITE_TIMEOUT_MS 1000
+#define SESSION_OUTPUT_LIMIT 65536      // Unsent replies after which a session's commands wait
+#define RESPONSE_MAX 16384              // Large enough for status and meters of every track
+
+// Slow command running on its own thread so the poll loop keeps answering everyone else
 typedef struct {
-    const char *cmd;
-
-    int (*handler)(track_manager_ctx_t *mgr, const char *arg, char *response, size_t resp_size);
-} command_handler_t;
-
-// Command handlers
-static int handle_play(track_manager_ctx_t *mgr, const char *track_id, char *response, size_t resp_size) {
-    if (!track_id || !track_id[0]) {
-        snprintf(response, resp_size, "ERROR: Missing track ID");
-        return -1;
+    pthread_t thread;
+    socket_server_ctx_t *server;
+    track_manager_ctx_t *track_manager;     // Kept alive by socket_server_quiesce waiting for the job
+    atomic_bool done;
+    char command[COMMAND_MAX_LENGTH];
+    char response[RESPONSE_MAX];
+} slow_job_t;
+
+// Open control connection; one-shot until its first line asks for a session
+typedef struct {
+    int fd;
+    bool session;
+    size_t length;
+    char buffer[COMMAND_MAX_LENGTH];
+    char *out;                  // Replies the client has not taken yet
+    size_t out_len, out_sent, out_cap;
+    slow_job_t *job;            // Slow command whose reply the rest of the connection waits for
+} connection_t;
+
+// Answer "trigger-ring" with a fresh ring's memfd attached to the response (SCM_RIGHTS)
+static void send_trigger_ring(socket_server_ctx_t *ctx, const int client_fd) {
+    struct ucred cred;
+    socklen_t cred_len = sizeof(cred);
+    int ring_fd = -1;
+    const char *response;
+
+    pthread_mutex_lock(&ctx->lock);
+    trigger_server_t *triggers = ctx->track_manager ? track_manager_get_triggers(ctx->track_manager) : NULL;
+    if (!ctx->track_manager) {
+        response = "ERROR: Reloading configuration, try again";
+    } else if (!triggers) {
+        response = "ERROR: Trigger rings are disabled";
+    } else if (getsockopt(client_fd, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len) < 0) {
+        response = "ERROR: Cannot identify the controller process";
+    } else if ((ring_fd = trigger_server_attach(triggers, cred.pid)) < 0) {
+        response = "ERROR: No trigger ring available";
+    } else {
+        response = "OK: Trigger ring attached";
     }
-
-    if (track_manager_play(mgr, track_id)) {
-        snprintf(response, resp_size, "OK: Playing track %s", track_id);
-        return 0;
+    pthread_mutex_unlock(&ctx->lock);
+
+    struct iovec iov = {.iov_base = (void *) response, .iov_len = strlen(response)};
+    union {
+        char buf[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg = {.msg_iov = &iov, .msg_iovlen = 1};
+    if (ring_fd >= 0) {
+        memset(&control, 0, sizeof(control));
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &ring_fd, sizeof(int));
+    }
+    if (sendmsg(client_fd, &msg, MSG_NOSIGNAL) < 0) {
+        log_warn("Failed to hand over trigger ring: %s", strerror(errno));
+    }
+    if (ring_fd >= 0) {
+        close(ring_fd);
     }
-
-    snprintf(response, resp_size, "ERROR: Failed to play track %s", track_id);
-    return -1;
 }
 
-static int handle_stop(track_manager_ctx_t *mgr, const char *track_id, char *response, size_t resp_size) {
-    if (!track_id || !track_id[0]) {
-        snprintf(response, resp_size, "ERROR: Missing track ID");
-        return -1;
+// Write all of data, waiting up to a second for a slow reader; false when the client is gone or stuck
+static bool write_all(const int fd, const char *data, size_t length) {
+    while (length > 0) {
+        const ssize_t n = write(fd, data, length);
+        if (n > 0) {
+            data += n;
+            length -= (size_t) n;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            struct pollfd pfd = {.fd = fd, .events = POLLOUT};
+            if (poll(&pfd, 1, SESSION_WRITE_TIMEOUT_MS) <= 0) return false;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return false;
+        }
     }
+    return true;
+}
 
-    if (track_manager_stop(mgr, track_id)) {
-        snprintf(response, resp_size, "OK: Stopped track %s", track_id);
-        return 0;
+// Session replies are framed as "<length>\n<body>" since bodies span several lines
+static bool queue_frame(connection_t *conn, const char *body) {
+    char header[32];
+    const size_t length = strlen(body);
+    const int header_length = snprintf(header, sizeof(header), "%zu\n", length);
+    const size_t needed = conn->out_len + (size_t) header_length + length;
+
+    if (needed > conn->out_cap) {
+        size_t cap = conn->out_cap ? conn->out_cap : 4096;
+        while (cap < needed) cap *= 2;
+        char *grown = realloc(conn->out, cap);
+        if (!grown) return false;
+        conn->out = grown;
+        conn->out_cap = cap;
     }
-
-    snprintf(response, resp_size, "ERROR: Failed to stop track %s", track_id);
-    return -1;
+    memcpy(conn->out + conn->out_len, header, (size_t) header_length);
+    memcpy(conn->out + conn->out_len + header_length, body, length);
+    conn->out_len = needed;
+    return true;
 }
 
-static int handle_stop_all(track_manager_ctx_t *mgr, const char *arg, char *response, size_t resp_size) {
-    (void) arg; // Unused
+static size_t output_pending(const connection_t *conn) {
+    return conn->out_len - conn->out_sent;
+}
 
-    if (track_manager_stop_all(mgr)) {
-        snprintf(response, resp_size, "OK: Stopped all tracks");
-        return 0;
+// Send queued replies without blocking; false when the client is gone
+static bool flush_connection(connection_t *conn) {
+    while (output_pending(conn) > 0) {
+        const ssize_t n = send(conn->fd, conn->out + conn->out_sent, output_pending(conn), MSG_NOSIGNAL);
+        if (n > 0) {
+            conn->out_sent += (size_t) n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        }
     }
-
-    snprintf(response, resp_size, "ERROR: Failed to stop all tracks");
-    return -1;
+    conn->out_len = conn->out_sent = 0;
+    return true;
 }
 
-static int handle_list(track_manager_ctx_t *mgr, const char *arg, char *response, size_t resp_size) {
-    (void) arg; // Unused
-    (void) mgr; // Use track manager to get list
+static void *slow_job_thread(void *arg) {
+    slow_job_t *job = arg;
+    socket_server_ctx_t *server = job->server;
+    thread_policy_apply(THREAD_ROLE_WORKER);
+
+    commands_execute(job->track_manager, job->command, 0, job->response, sizeof(job->response));
 
-    // For now, just return a simple message
-    // In a full implementation, format a proper list of tracks
-    snprintf(response, resp_size, "OK: Track listing not yet implemented");
-    return 0;
+    // From here on the track manager may go away
+    pthread_mutex_lock(&server->lock);
+    server->slow_jobs--;
+    pthread_cond_broadcast(&server->jobs_done);
+    pthread_mutex_unlock(&server->lock);
+
+    atomic_store(&job->done, true);
+    const char wake = 1;
+    if (write(server->wake_fds[1], &wake, 1) < 0 && errno != EAGAIN) {
+        log_warn("Failed to wake the socket server: %s", strerror(errno));
+    }
+    return NULL;
 }
 
-static int handle_status(track_manager_ctx_t *mgr, const char *arg, char *response, size_t resp_size) {
-    (void) arg; // Unused
-    char* status = track_manager_print_status(mgr);
-    if (!status) {
-        snprintf(response, resp_size, "ERROR: Failed to get status");
-        return -1;
+// Start a slow command for conn; false with an error in response when it cannot run now
+static bool start_slow_job(socket_server_ctx_t *ctx, connection_t *conn, const char *command, char *response,
+                           const size_t resp_size) {
+    pthread_mutex_lock(&ctx->lock);
+    bool started = false;
+    slow_job_t *job = NULL;
+    if (!ctx->track_manager) {
+        snprintf(response, resp_size, "ERROR: Reloading configuration, try again");
+    } else if (ctx->slow_jobs > 0) {
+        // One at a time: two measurements would hear each other
+        snprintf(response, resp_size, "ERROR: Another measurement is running");
+    } else if (!(job = calloc(1, sizeof(slow_job_t)))) {
+        snprintf(response, resp_size, "ERROR: Out of memory");
+    } else {
+        job->server = ctx;
+        job->track_manager = ctx->track_manager;
+        atomic_init(&job->done, false);
+        snprintf(job->command, sizeof(job->command), "%s", command);
+
+        if (pthread_create(&job->thread, NULL, slow_job_thread, job) != 0) {
+            free(job);
+            snprintf(response, resp_size, "ERROR: Failed to start command");
+        } else {
+            conn->job = job;
+            ctx->slow_jobs++;
+            started = true;
+        }
     }
+    pthread_mutex_unlock(&ctx->lock);
+    return started;
+}
 
-    snprintf(response, resp_size, "%s", status);
-    free(status);
-    return 0;
+// Run a command against the current track manager; none is set while a reload replaces it
+static void execute_command(socket_server_ctx_t *ctx, const char *command, char *response, const size_t resp_size) {
+    pthread_mutex_lock(&ctx->lock);
+    if (ctx->track_manager) {
+        commands_execute(ctx->track_manager, command, 0, response, resp_size);
+    } else {
+        snprintf(response, resp_size, "ERROR: Reloading configuration, try again");
+    }
+    pthread_mutex_unlock(&ctx->lock);
 }
 
-static int handle_reload(track_manager_ctx_t *mgr, const char *arg, char *response, size_t resp_size) {
-    (void) arg; // Unused
-    (void) mgr; // In a full implementation, this would reload the config
+// Wait for conn's slow command and take its reply off the job
+static void finish_slow_job(connection_t *conn, char *response, const size_t resp_size) {
+    pthread_join(conn->job->thread, NULL);
+    snprintf(response, resp_size, "%s", conn->job->response);
+    free(conn->job);
+    conn->job = NULL;
+}
 
-    // This would trigger a reload signal
-    snprintf(response, resp_size, "OK: Reload signal not yet implemented");
-    return 0;
+static void close_connection(connection_t *conn) {
+    close(conn->fd);
+    free(conn->out);
+    memset(conn, 0, sizeof(*conn));
+    conn->fd = -1;
 }
 
-// Command table
-static const command_handler_t COMMANDS[] = {
-        {"play",     handle_play},
-        {"stop",     handle_stop},
-        {"stop-all", handle_stop_all},
-        {"list",     handle_list},
-        {"status",   handle_status},
-        {"reload",   handle_reload},
-        {NULL, NULL} // Terminator
-};
-
-// Process a command string
-static int process_command(const char *cmd_str, track_manager_ctx_t *mgr, char *response, size_t resp_size) {
-    char cmd_buf[256];
-    strncpy(cmd_buf, cmd_str, sizeof(cmd_buf) - 1);
-    cmd_buf[sizeof(cmd_buf) - 1] = '\0';
-
-    // Split command and argument
-    char *cmd = strtok(cmd_buf, " ");
-    char *arg = strtok(NULL, "");
-
-    if (!cmd) {
-        snprintf(response, resp_size, "ERROR: Empty command");
-        return -1;
-    }
-
-    // Find command handler
-    for (const command_handler_t *handler = COMMANDS; handler->cmd != NULL; handler++) {
-        if (strcmp(handler->cmd, cmd) == 0) {
-            return handler->handler(mgr, arg, response, resp_size);
+// Handle what a connection sent so far; false when it is done and has to be closed
+static bool handle_input(socket_server_ctx_t *ctx, connection_t *conn, char *response, const size_t resp_size) {
+    if (conn->job) return true;     // Resumed when the slow command is done
+    conn->buffer[conn->length] = '\0';
+
+    if (!conn->session) {
+        const size_t hello_length = strlen(SESSION_HELLO);
+        if (conn->length < hello_length && strncmp(conn->buffer, SESSION_HELLO, conn->length) == 0) {
+            return true;    // Could still become a session, wait for the rest
+        }
+        if (strncmp(conn->buffer, SESSION_HELLO, hello_length) != 0) {
+            // One-shot client: a single command answered before the connection closes
+            log_debug("Received command: %s", conn->buffer);
+            if (strcmp(conn->buffer, "trigger-ring") == 0) {
+                // Commands that hand over a descriptor answer on the connection themselves
+                send_trigger_ring(ctx, conn->fd);
+            } else if (commands_is_slow(conn->buffer)) {
+                // Answered once the job is done; the connection stays open until then
+                if (start_slow_job(ctx, conn, conn->buffer, response, resp_size)) return true;
+                write_all(conn->fd, response, strlen(response));
+            } else {
+                execute_command(ctx, conn->buffer, response, resp_size);
+                write_all(conn->fd, response, strlen(response));
+            }
+            return false;
+        }
+
+        conn->session = true;
+        memmove(conn->buffer, conn->buffer + hello_length, conn->length - hello_length + 1);
+        conn->length -= hello_length;
+        snprintf(response, resp_size, "OK: session %d", SESSION_VERSION);
+        if (!queue_frame(conn, response)) return false;
+    }
+
+    // Pipelined commands, one per line, answered in order. A client that does not read its replies
+    // keeps the rest of its commands waiting here instead of growing the output without bound, and
+    // commands after a slow one wait for its reply.
+    char *line = conn->buffer;
+    char *end;
+    while (!conn->job && output_pending(conn) < SESSION_OUTPUT_LIMIT && (end = strchr(line, '\n')) != NULL) {
+        *end = '\0';
+        if (end > line && end[-1] == '\r') end[-1] = '\0';
+        if (line[0] != '\0') {
+            log_debug("Received command: %s", line);
+            if (strcmp(line, "trigger-ring") == 0) {
+                snprintf(response, resp_size, "ERROR: Request trigger rings on a one-shot connection");
+            } else if (commands_is_slow(line)) {
+                if (start_slow_job(ctx, conn, line, response, resp_size)) {
+                    line = end + 1;
+                    break;
+                }
+            } else {
+                execute_command(ctx, line, response, resp_size);
+            }
+            if (!queue_frame(conn, response)) return false;
         }
+        line = end + 1;
     }
 
-    snprintf(response, resp_size, "ERROR: Unknown command '%s'", cmd);
-    return -1;
+    conn->length -= (size_t) (line - conn->buffer);
+    memmove(conn->buffer, line, conn->length + 1);
+    if (conn->length >= sizeof(conn->buffer) - 1 && !strchr(conn->buffer, '\n')) {
+        queue_frame(conn, "ERROR: Command too long");
+        flush_connection(conn);
+        return false;
+    }
+    return flush_connection(conn);
 }
 
-// Socket server thread function
+// Socket server thread function: one poll loop over the listening socket and every open connection
 static void *socket_server_thread(void *arg) {
     socket_server_ctx_t *ctx = (socket_server_ctx_t *) arg;
-    char buffer[1024];
-    char response[1024];
+    char response[RESPONSE_MAX];
+
+    thread_policy_apply(THREAD_ROLE_CONTROL);
 
     static int thread_launch_count = 0;
     log_debug("Socket server thread started (%d)", ++thread_launch_count);
     log_info("Socket server thread started");
 
-    while (ctx->running) {
-        // Accept connection
-        struct sockaddr_un client_addr;
-        socklen_t client_len = sizeof(client_addr);
-        int client_fd = accept(ctx->server_fd, (struct sockaddr *) &client_addr, &client_len);
+    connection_t *connections = calloc(MAX_CONNECTIONS, sizeof(connection_t));
+    if (!connections) {
+        log_error("Failed to allocate socket connections");
+        return NULL;
+    }
+    for (int i = 0; i < MAX_CONNECTIONS; i++) {
+        connections[i].fd = -1;
+    }
 
-        if (client_fd < 0) {
-            if (ctx->running) {
-                log_error("Socket accept failed: %s", strerror(errno));
+    while (ctx->running) {
+        struct pollfd pfds[MAX_CONNECTIONS + 2];
+        int slot_of[MAX_CONNECTIONS + 2];
+        nfds_t count = 0;
+        pfds[count++] = (struct pollfd) {.fd = ctx->server_fd, .events = POLLIN};
+        pfds[count++] = (struct pollfd) {.fd = ctx->wake_fds[0], .events = POLLIN};
+        for (int i = 0; i < MAX_CONNECTIONS; i++) {
+            const connection_t *conn = &connections[i];
+            // Left alone while a slow command runs, so a hangup cannot free the connection under it
+            if (conn->fd < 0 || conn->job) continue;
+
+            // Read only while there is room for commands and the replies are not backed up
+            short events = 0;
+            if (output_pending(conn) > 0) events |= POLLOUT;
+            if (output_pending(conn) < SESSION_OUTPUT_LIMIT && conn->length < sizeof(conn->buffer) - 1) {
+                events |= POLLIN;
             }
-            continue;
+            slot_of[count] = i;
+            pfds[count++] = (struct pollfd) {.fd = conn->fd, .events = events};
         }
 
-        // Read client request
-        ssize_t bytes_read = read(client_fd, buffer, sizeof(buffer) - 1);
-        if (bytes_read > 0) {
-            buffer[bytes_read] = '\0';
-            log_debug("Received command: %s", buffer);
-
-            // Process command
-            process_command(buffer, ctx->track_manager, response, sizeof(response));
-
-            // Send response
-            write(client_fd, response, strlen(response));
+        if (poll(pfds, count, -1) < 0) {
+            if (errno != EINTR) {
+                log_error("Socket poll failed: %s", strerror(errno));
+            }
+            continue;
         }
+        if (!ctx->running) break;
 
-        close(client_fd);
-    }
-
-    log_info("Socket server thread stopped");
-    return NULL;
-}
-
-// Get the socket path for the current user
-char *get_socket_path(char *buffer, size_t size) {
-    if (!buffer || size == 0) {
-        return NULL;
-    }
-
-    const char *xdg = getenv("XDG_RUNTIME_DIR");
-    char dir_path[PATH_MAX];
-    bool usable = false;
-
-    // Prefer XDG_RUNTIME_DIR, otherwise /run/user/<uid>
-    if (xdg && xdg[0] != '\0') {
-        if (snprintf(dir_path, sizeof(dir_path), "%s/%s", xdg, RUNTIME_SUBDIR) >= (int)sizeof(dir_path)) {
-            return NULL; // path too long
-        }
-    } else {
-        uid_t uid = getuid();
-        if (snprintf(dir_path, sizeof(dir_path), "/run/user/%d/%s", (int)uid, RUNTIME_SUBDIR) >= (int)sizeof(dir_path)) {
-            return NULL; // path too long
+        // Accept connection
+        if (pfds[0].revents & POLLIN) {
+            const int client_fd = accept4(ctx->server_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (client_fd < 0) {
+                log_error("Socket accept failed: %s", strerror(errno));
+            } else {
+                connection_t *conn = NULL;
+                for (int i = 0; i < MAX_CONNECTIONS && !conn; i++) {
+                    if (connections[i].fd < 0) conn = &connections[i];
+                }
+                if (conn) {
+                    conn->fd = client_fd;
+                } else {
+                    log_warn("Too many open control connections, refusing one");
+                    close(client_fd);
+                }
+            }
         }
-    }
 
-    // Ensure the runtime subdirectory exists with 0700 and is writable
-    if (mkdir(dir_path, 0700) == 0) {
-        usable = true;
-    } else if (errno == EEXIST) {
-        struct stat st;
-        if (stat(dir_path, &st) == 0 && S_ISDIR(st.st_mode) && access(dir_path, W_OK | X_OK) == 0) {
-            usable = true;
-        } else {
-            log_warn("Runtime dir not writable: %s; will fall back to /tmp", dir_path);
+        // Answer connections whose slow command is done, then carry on with what they sent meanwhile
+        if (pfds[1].revents & POLLIN) {
+            char drain[64];
+            while (read(ctx->wake_fds[0], drain, sizeof(drain)) > 0) {}
+
+            for (int i = 0; i < MAX_CONNECTIONS; i++) {
+                connection_t *conn = &connections[i];
+                if (!conn->job || !atomic_load(&conn->job->done)) continue;
+
+                finish_slow_job(conn, response, sizeof(response));
+                if (!conn->session) {
+                    write_all(conn->fd, response, strlen(response));
+                    close_connection(conn);
+                } else if (!queue_frame(conn, response) || !handle_input(ctx, conn, response, sizeof(response))) {
+                    close_connection(conn);
+                }
+            }
         }
-    } else {
-        log_warn("Failed to create runtime dir %s (errno=%d); will fall back to /tmp", dir_path, errno);
-    }
 
-    // Fall back to /tmp/<subdir>-<uid>, then mkdtemp if necessary
-    if (!usable) {
-        uid_t uid = getuid();
-        if (snprintf(dir_path, sizeof(dir_path), "/tmp/%s-%d", RUNTIME_SUBDIR, (int)uid) >= (int)sizeof(dir_path)) {
-            return NULL;
-        }
-        if (mkdir(dir_path, 0700) < 0 && errno != EEXIST) {
-            char tmpl[PATH_MAX];
-            if (snprintf(tmpl, sizeof(tmpl), "/tmp/%s-%d-XXXXXX", RUNTIME_SUBDIR, (int)uid) >= (int)sizeof(tmpl)) {
-                return NULL;
+        // Read client requests
+        for (nfds_t p = 2; p < count; p++) {
+            connection_t *conn = &connections[slot_of[p]];
+
+            // Replies drained: carry on with the commands that waited for them
+            if (pfds[p].revents & POLLOUT) {
+                if (!flush_connection(conn) ||
+                    (output_pending(conn) < SESSION_OUTPUT_LIMIT &&
+                     !handle_input(ctx, conn, response, sizeof(response)))) {
+                    close_connection(conn);
+                    continue;
+                }
             }
-            if (!mkdtemp(tmpl)) {
-                log_error("Failed to create fallback temp dir for socket");
-                return NULL;
+            if (!(pfds[p].revents & (POLLIN | POLLHUP | POLLERR)) || conn->length >= sizeof(conn->buffer) - 1) {
+                continue;
             }
-            strncpy(dir_path, tmpl, sizeof(dir_path) - 1);
-            dir_path[sizeof(dir_path) - 1] = '\0';
-        } else {
-            // If exists, ensure it's writable; otherwise try mkdtemp
-            if (access(dir_path, W_OK | X_OK) != 0) {
-                char tmpl[PATH_MAX];
-                if (snprintf(tmpl, sizeof(tmpl), "/tmp/%s-%d-XXXXXX", RUNTIME_SUBDIR, (int)uid) >= (int)sizeof(tmpl)) {
-                    return NULL;
-                }
-                if (!mkdtemp(tmpl)) {
-                    log_error("Failed to create fallback temp dir for socket");
-                    return NULL;
+
+            const ssize_t bytes_read = read(conn->fd, conn->buffer + conn->length,
+                                            sizeof(conn->buffer) - 1 - conn->length);
+            if (bytes_read < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+            if (bytes_read <= 0) {
+                // A client that stopped sending still gets the replies it is owed
+                if (bytes_read == 0 && output_pending(conn) > 0) {
+                    write_all(conn->fd, conn->out + conn->out_sent, output_pending(conn));
                 }
-                strncpy(dir_path, tmpl, sizeof(dir_path) - 1);
-                dir_path[sizeof(dir_path) - 1] = '\0';
+                close_connection(conn);
+                continue;
+            }
+            conn->length += (size_t) bytes_read;
+            if (!handle_input(ctx, conn, response, sizeof(response))) {
+                close_connection(conn);
             }
         }
-        log_info("Using fallback runtime dir for socket: %s", dir_path);
     }
 
-    // Construct the socket path
-    if (snprintf(buffer, size, "%s/%s", dir_path, "papad.sock") >= (int)size) {
-        return NULL; // path too long for provided buffer
+    for (int i = 0; i < MAX_CONNECTIONS; i++) {
+        if (connections[i].job) finish_slow_job(&connections[i], response, sizeof(response));
+        if (connections[i].fd >= 0) close_connection(&connections[i]);
     }
+    free(connections);
+    log_info("Socket server thread stopped");
+    return NULL;
+}
 
-    return buffer;
+// Get the socket path for the current user
+char *get_socket_path(char *buffer, size_t size) {
+    return papa_socket_path(buffer, size, true);
 }
 
 // Initialize socket server
-socket_server_ctx_t *socket_server_init(track_manager_ctx_t *track_manager) {
+socket_server_ctx_t *socket_server_init(track_manager_ctx_t *track_manager, const char *path) {
     socket_server_ctx_t *ctx = calloc(1, sizeof(socket_server_ctx_t));
     if (!ctx) {
         log_error("Failed to allocate socket server context");
@@ -264,7 +445,9 @@ socket_server_ctx_t *socket_server_init(track_manager_ctx_t *track_manager) {
     }
 
     // Get the socket path
-    if (!get_socket_path(ctx->socket_path, sizeof(ctx->socket_path))) {
+    if (path) {
+        snprintf(ctx->socket_path, sizeof(ctx->socket_path), "%s", path);
+    } else if (!get_socket_path(ctx->socket_path, sizeof(ctx->socket_path))) {
         log_error("Failed to get socket path");
         free(ctx);
         return NULL;
@@ -280,6 +463,8 @@ socket_server_ctx_t *socket_server_init(track_manager_ctx_t *track_manager) {
     ctx->track_manager = track_manager;
     ctx->running = false;
     ctx->server_fd = -1;
+    pthread_mutex_init(&ctx->lock, NULL);
+    pthread_cond_init(&ctx->jobs_done, NULL);
 
     // Remove socket if it already exists
     if (unlink(ctx->socket_path) < 0 && errno != ENOENT) {
@@ -326,10 +511,41 @@ socket_server_ctx_t *socket_server_init(track_manager_ctx_t *track_manager) {
         return NULL;
     }
 
+    if (pipe2(ctx->wake_fds, O_NONBLOCK | O_CLOEXEC) < 0) {
+        log_error("Failed to create socket server wake pipe: %s", strerror(errno));
+        close(ctx->server_fd);
+        free(ctx);
+        return NULL;
+    }
+
     log_info("Socket server initialized at %s", ctx->socket_path);
     return ctx;
 }
 
+void socket_server_quiesce(socket_server_ctx_t *ctx) {
+    if (!ctx) return;
+
+    pthread_mutex_lock(&ctx->lock);
+    track_manager_ctx_t *track_manager = ctx->track_manager;
+    ctx->track_manager = NULL;
+    if (track_manager && ctx->slow_jobs > 0) {
+        log_info("Waiting for %d running command(s) to stop", ctx->slow_jobs);
+        track_manager_cancel_measurements(track_manager);
+    }
+    while (ctx->slow_jobs > 0) {
+        pthread_cond_wait(&ctx->jobs_done, &ctx->lock);
+    }
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+void socket_server_set_track_manager(socket_server_ctx_t *ctx, track_manager_ctx_t *track_manager) {
+    if (!ctx) return;
+
+    pthread_mutex_lock(&ctx->lock);
+    ctx->track_manager = track_manager;
+    pthread_mutex_unlock(&ctx->lock);
+}
+
 // Start socket server thread
 bool socket_server_start(socket_server_ctx_t *ctx) {
     if (!ctx) return false;
@@ -353,6 +569,9 @@ bool socket_server_start(socket_server_ctx_t *ctx) {
 void socket_server_cleanup(socket_server_ctx_t *ctx) {
     if (!ctx) return;
 
+    // Slow commands give up instead of holding the exit for seconds
+    socket_server_quiesce(ctx);
+
     // Signal thread to stop if running
     if (ctx->running) {
         ctx->running = false;
@@ -380,6 +599,11 @@ void socket_server_cleanup(socket_server_ctx_t *ctx) {
         ctx->server_fd = -1;
     }
 
+    close(ctx->wake_fds[0]);
+    close(ctx->wake_fds[1]);
+    pthread_cond_destroy(&ctx->jobs_done);
+    pthread_mutex_destroy(&ctx->lock);
+
     // Clean up socket file
     unlink(ctx->socket_path);
     free(ctx);
@@ -7,9 +7,13 @@
 
 // Socket server context
 typedef struct {
-    track_manager_ctx_t *track_manager;
+    track_manager_ctx_t *track_manager;     // NULL while quiesced for a reload; guarded by lock
+    pthread_mutex_t lock;
+    pthread_cond_t jobs_done;
     pthread_t thread;
     int server_fd;
+    int wake_fds[2];        // Slow commands that finished wake the poll loop through this pipe
+    int slow_jobs;          // Slow commands running; guarded by lock
     bool running;
     char socket_path[256];
 } socket_server_ctx_t;
@@ -17,12 +21,19 @@ typedef struct {
 // Get the socket path for the current user
 char* get_socket_path(char* buffer, size_t size);
 
-// Initialize socket server
-socket_server_ctx_t *socket_server_init(track_manager_ctx_t *track_manager);
+// Initialize socket server on path, or on the default socket path when NULL
+socket_server_ctx_t *socket_server_init(track_manager_ctx_t *track_manager, const char *path);
 
 // Start socket server thread
 bool socket_server_start(socket_server_ctx_t *ctx);
 
+// Stop using the track manager: commands are refused and running slow commands (latency measurements)
+// are cancelled and waited for, so the caller can clean the track manager up
+void socket_server_quiesce(socket_server_ctx_t *ctx);
+
+// Run commands against track_manager from now on, after socket_server_quiesce
+void socket_server_set_track_manager(socket_server_ctx_t *ctx, track_manager_ctx_t *track_manager);
+
 // Stop and cleanup socket server
 void socket_server_cleanup(socket_server_ctx_t *ctx);
 
@@ -0,0 +1,235 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include "thread_policy.h"
+#include "log.h"
+
+static const char *ROLE_NAMES[THREAD_ROLE_COUNT] = {"data_loop", "workers", "control"};
+
+// Requested and effective policy of a role, as last applied by one of its threads
+typedef struct {
+    cpu_set_t cpus;
+    bool pin;
+    int priority;
+
+    bool applied;
+    int effective_policy;
+    int effective_priority;
+    cpu_set_t effective_cpus;
+} role_state_t;
+
+static pthread_mutex_t policy_mutex = PTHREAD_MUTEX_INITIALIZER;
+static role_state_t roles[THREAD_ROLE_COUNT];
+static atomic_uint generation = 1;
+
+#define MAX_DATA_THREADS 4
+
+enum {
+    DATA_SLOT_FREE,
+    DATA_SLOT_CLAIMED,
+    DATA_SLOT_READY
+};
+
+// Data thread registered from a process callback, policy applied by the control thread
+typedef struct {
+    atomic_int state;
+    pthread_t thread;
+    unsigned int applied_generation;
+} data_thread_t;
+
+static data_thread_t data_threads[MAX_DATA_THREADS];
+static atomic_uint data_epoch = 1;
+
+// Affinity of the process at startup, restored for roles without explicit CPUs
+static cpu_set_t process_cpus;
+static bool process_cpus_valid;
+
+static void load_role(role_state_t *state, const thread_config_t *config) {
+    memset(state, 0, sizeof(*state));
+    CPU_ZERO(&state->cpus);
+    for (int i = 0; i < config->cpu_count; i++) {
+        if (config->cpus[i] >= 0 && config->cpus[i] < CPU_SETSIZE) {
+            CPU_SET(config->cpus[i], &state->cpus);
+            state->pin = true;
+        }
+    }
+
+    // New threads inherit their creator's pinning, so undo it for unpinned roles
+    if (!state->pin && process_cpus_valid) {
+        state->cpus = process_cpus;
+        state->pin = true;
+    }
+    state->priority = config->priority;
+}
+
+void thread_policy_init(const global_config_t *config) {
+    if (!config) return;
+
+    pthread_mutex_lock(&policy_mutex);
+    if (!process_cpus_valid) {
+        process_cpus_valid = sched_getaffinity(0, sizeof(cpu_set_t), &process_cpus) == 0;
+    }
+    load_role(&roles[THREAD_ROLE_DATA], &config->threads.data_loop);
+    load_role(&roles[THREAD_ROLE_WORKER], &config->threads.workers);
+    load_role(&roles[THREAD_ROLE_CONTROL], &config->threads.control);
+    pthread_mutex_unlock(&policy_mutex);
+
+    // Make threads that already applied an older configuration apply again
+    atomic_fetch_add(&generation, 1);
+}
+
+static bool apply_to_thread(thread_role_t role, const pthread_t self) {
+    if (role < 0 || role >= THREAD_ROLE_COUNT) return false;
+
+    pthread_mutex_lock(&policy_mutex);
+    role_state_t *state = &roles[role];
+    bool ok = true;
+
+    if (state->pin) {
+        const int err = pthread_setaffinity_np(self, sizeof(cpu_set_t), &state->cpus);
+        if (err != 0) {
+            log_warn("Failed to set %s CPU affinity: %s", ROLE_NAMES[role], strerror(err));
+            ok = false;
+        }
+    }
+
+    if (state->priority > 0) {
+        struct sched_param param = {.sched_priority = state->priority};
+        const int err = pthread_setschedparam(self, SCHED_FIFO, &param);
+        if (err != 0) {
+            log_warn("Failed to set SCHED_FIFO priority %d for %s: %s (grant rtprio or use RTKit via PipeWire's module-rt)",
+                     state->priority, ROLE_NAMES[role], strerror(err));
+            ok = false;
+        }
+    } else if (role != THREAD_ROLE_DATA) {
+        // Drop realtime scheduling inherited from the creating thread;
+        // the data loop keeps whatever PipeWire's module-rt gave it
+        int policy;
+        struct sched_param param;
+        if (pthread_getschedparam(self, &policy, &param) == 0 && (policy == SCHED_FIFO || policy == SCHED_RR)) {
+            param.sched_priority = 0;
+            pthread_setschedparam(self, SCHED_OTHER, &param);
+        }
+    }
+
+    // Record what the kernel actually gave us
+    struct sched_param param;
+    if (pthread_getschedparam(self, &state->effective_policy, &param) == 0) {
+        state->effective_priority = param.sched_priority;
+    }
+    if (pthread_getaffinity_np(self, sizeof(cpu_set_t), &state->effective_cpus) != 0) {
+        CPU_ZERO(&state->effective_cpus);
+    }
+    state->applied = true;
+    pthread_mutex_unlock(&policy_mutex);
+
+    return ok;
+}
+
+bool thread_policy_apply(thread_role_t role) {
+    return apply_to_thread(role, pthread_self());
+}
+
+void thread_policy_register_data_thread(void) {
+    static __thread unsigned int registered_epoch;
+
+    const unsigned int epoch = atomic_load_explicit(&data_epoch, memory_order_relaxed);
+    if (registered_epoch == epoch) return;
+    registered_epoch = epoch;
+
+    // Claim a free slot; the control thread only looks at it once it is ready
+    for (int i = 0; i < MAX_DATA_THREADS; i++) {
+        data_thread_t *slot = &data_threads[i];
+        int expected = DATA_SLOT_FREE;
+        if (atomic_compare_exchange_strong_explicit(&slot->state, &expected, DATA_SLOT_CLAIMED,
+                                                    memory_order_acquire, memory_order_relaxed)) {
+            slot->thread = pthread_self();
+            slot->applied_generation = 0;
+            atomic_store_explicit(&slot->state, DATA_SLOT_READY, memory_order_release);
+            return;
+        }
+    }
+}
+
+void thread_policy_apply_data_threads(void) {
+    const unsigned int current = atomic_load_explicit(&generation, memory_order_relaxed);
+    for (int i = 0; i < MAX_DATA_THREADS; i++) {
+        data_thread_t *slot = &data_threads[i];
+        if (atomic_load_explicit(&slot->state, memory_order_acquire) != DATA_SLOT_READY ||
+            slot->applied_generation == current) {
+            continue;
+        }
+        slot->applied_generation = current;
+        apply_to_thread(THREAD_ROLE_DATA, slot->thread);
+    }
+}
+
+void thread_policy_forget_data_threads(void) {
+    for (int i = 0; i < MAX_DATA_THREADS; i++) {
+        atomic_store_explicit(&data_threads[i].state, DATA_SLOT_FREE, memory_order_relaxed);
+    }
+    atomic_fetch_add(&data_epoch, 1);
+}
+
+static const char *policy_name(int policy) {
+    switch (policy) {
+        case SCHED_FIFO:
+            return "SCHED_FIFO";
+        case SCHED_RR:
+            return "SCHED_RR";
+        case SCHED_OTHER:
+            return "SCHED_OTHER";
+        case SCHED_BATCH:
+            return "SCHED_BATCH";
+        case SCHED_IDLE:
+            return "SCHED_IDLE";
+        default:
+            return "unknown";
+    }
+}
+
+// Render a CPU set as a compact list like "0-1,3"
+static void format_cpus(const cpu_set_t *cpus, char *buffer, size_t size) {
+    size_t offset = 0;
+    buffer[0] = '\0';
+
+    for (int cpu = 0; cpu < CPU_SETSIZE && offset < size; cpu++) {
+        if (!CPU_ISSET(cpu, cpus)) continue;
+        int last = cpu;
+        while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, cpus)) last++;
+
+        int n = last > cpu
+                ? snprintf(buffer + offset, size - offset, "%s%d-%d", offset ? "," : "", cpu, last)
+                : snprintf(buffer + offset, size - offset, "%s%d", offset ? "," : "", cpu);
+        if (n < 0) break;
+        offset += (size_t) n;
+        cpu = last;
+    }
+
+    if (buffer[0] == '\0') snprintf(buffer, size, "-");
+}
+
+int thread_policy_format_status(char *buffer, size_t size) {
+    int offset = 0;
+
+    pthread_mutex_lock(&policy_mutex);
+    for (int role = 0; role < THREAD_ROLE_COUNT && (size_t) offset < size; role++) {
+        const role_state_t *state = &roles[role];
+        if (!state->applied) {
+            offset += snprintf(buffer + offset, size - offset, "Thread %s: not started\n", ROLE_NAMES[role]);
+            continue;
+        }
+
+        char cpus[128];
+        format_cpus(&state->effective_cpus, cpus, sizeof(cpus));
+        offset += snprintf(buffer + offset, size - offset, "Thread %s: %s priority %d, cpus %s\n",
+                           ROLE_NAMES[role], policy_name(state->effective_policy), state->effective_priority, cpus);
+    }
+    pthread_mutex_unlock(&policy_mutex);
+
+    return offset;
+}
@@ -0,0 +1,35 @@
+#ifndef ASYNC_AUDIO_PLAYER_THREAD_POLICY_H
+#define ASYNC_AUDIO_PLAYER_THREAD_POLICY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "types.h"
+
+// Thread roles with independently configurable scheduling
+typedef enum {
+    THREAD_ROLE_DATA,       // PipeWire realtime data loop
+    THREAD_ROLE_WORKER,     // Decode, preload and cache threads
+    THREAD_ROLE_CONTROL,    // Main loop and socket server
+    THREAD_ROLE_COUNT
+} thread_role_t;
+
+// Store the scheduling configuration; threads pick it up on their next apply
+void thread_policy_init(const global_config_t *config);
+
+// Apply the role's affinity and priority to the calling thread
+bool thread_policy_apply(thread_role_t role);
+
+// Note the calling PipeWire data thread; the data role is applied to it later from the control thread.
+// Lock-free and without system calls, so it is safe in realtime process callbacks.
+void thread_policy_register_data_thread(void);
+
+// Apply the data role to registered data threads that have not had the current configuration
+void thread_policy_apply_data_threads(void);
+
+// Drop the registered data threads once the loop that ran them is gone
+void thread_policy_forget_data_threads(void);
+
+// Format the effective policy of each role
+int thread_policy_format_status(char *buffer, size_t size);
+
+#endif // ASYNC_AUDIO_PLAYER_THREAD_POLICY_H
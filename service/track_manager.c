@@ -1,5 +1,18 @@
 #include "track_manager.h"
 #include "log.h"
+#include "arena.h"
+#include "thread_policy.h"
+#include "show.h"
+#include "bus.h"
+#include "output_stage.h"
+#include "generator.h"
+#include "latency.h"
+#include "registry.h"
+#include "drift.h"
+#include "clock_sync.h"
+#include "osc.h"
+#include "midi.h"
+#include "trigger.h"
 #include <math.h>
 #include <pipewire/pipewire.h>
 #include <spa/param/audio/format-utils.h>
@@ -7,19 +20,36 @@
 #include <spa/pod/builder.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 #define MAX_TRACKS 32
+#define MAX_BUSES 16
 #define BUFFER_SIZE 4096
+#define REGISTRY_SYNC_TIMEOUT_MS 1000
+#define VOLUME_RAMP_FRAMES 64   // Ramp length for scheduled volume changes, avoids zipper clicks
 
 #include <stdint.h>
 #include <spa/param/audio/raw.h>
 
 struct track_manager_ctx {
     global_config_t *config;
-    track_instance_t tracks[MAX_TRACKS];
+    track_instance_t pool[MAX_TRACKS];      // Instance storage; streams hold pointers into it
+    track_instance_t *tracks[MAX_TRACKS];   // Active instances in start order
     int active_tracks;
     struct pw_context *pw_context;
     struct pw_main_loop *pw_loop;
+    registry_t *registry;                   // Node cache, updated on the main loop
+    pthread_mutex_t lock;                   // Serializes control threads, recursive
+    show_ctx_t *show;
+    clock_sync_t *sync;                     // Shared cue timebase with other instances, NULL when off
+    trigger_server_t *triggers;             // Shared-memory trigger rings, NULL when off
+    osc_server_t *osc;                      // OSC control input, NULL when off
+    midi_input_t *midi;                     // PipeWire MIDI input, NULL when off
+    bus_t *buses[MAX_BUSES];
+    int bus_count;
+    double reference_speed;                 // Last measured speed of clock.reference, 1 = system clock
+    atomic_bool measure_cancelled;          // Set before cleanup so running measurements give up
     bool initialized;
 };
 
@@ -94,6 +124,102 @@ enum spa_audio_channel get_channel_position(const char *port_name) {
     return SPA_AUDIO_CHANNEL_UNKNOWN;
 }
 
+uint64_t track_manager_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Frame within a cycle starting at cycle_ns at which a scheduled time falls, clamped to n_frames
+static size_t frame_offset(uint64_t at_ns, uint64_t cycle_ns, uint32_t rate, size_t n_frames) {
+    if (at_ns <= cycle_ns) return 0;
+    const uint64_t frames = (at_ns - cycle_ns) * rate / 1000000000ULL;
+    return frames < n_frames ? (size_t) frames : n_frames;
+}
+
+// Apply the track gain to frames [begin, end), ramping to a scheduled volume from its exact frame
+static void apply_track_gain(track_instance_t *track, float *dst, size_t begin, size_t end, int channels,
+                             uint64_t cycle_ns, uint32_t rate) {
+    size_t change = end;
+    const uint64_t volume_at = atomic_load_explicit(&track->volume_at_ns, memory_order_acquire);
+    if (volume_at) {
+        change = frame_offset(volume_at, cycle_ns, rate, end);
+        if (change < begin) change = begin;
+    }
+
+    size_t f = begin;
+    while (f < end) {
+        if (f == change) {
+            track->ramp_target = atomic_load_explicit(&track->volume_target, memory_order_relaxed);
+            track->ramp_step = (track->ramp_target - track->gain) / VOLUME_RAMP_FRAMES;
+            track->ramp_frames = VOLUME_RAMP_FRAMES;
+            // Leave a newer request pending if one arrived meanwhile
+            uint64_t expected = volume_at;
+            atomic_compare_exchange_strong(&track->volume_at_ns, &expected, 0);
+            change = end;
+        }
+        const size_t boundary = change > f ? change : end;
+
+        if (track->ramp_frames > 0) {
+            const size_t n = track->ramp_frames < boundary - f ? track->ramp_frames : boundary - f;
+            for (size_t i = f; i < f + n; i++) {
+                track->gain += track->ramp_step;
+                for (int ch = 0; ch < channels; ch++) {
+                    dst[i * channels + ch] *= track->gain;
+                }
+            }
+            track->ramp_frames -= (uint32_t) n;
+            if (track->ramp_frames == 0) track->gain = track->ramp_target;
+            f += n;
+        } else {
+            if (track->gain != 1.0f) {
+                for (size_t i = f * channels; i < boundary * channels; i++) {
+                    dst[i] *= track->gain;
+                }
+            }
+            f = boundary;
+        }
+    }
+}
+
+// Render one cycle of a track, honoring its scheduled start, stop and volume changes
+static void render_track(track_instance_t *track, float *dst, size_t n_frames, uint64_t cycle_ns) {
+    audio_file_t *af = track->audio_file;
+    const int channels = af->info.channels;
+    const uint32_t rate = (uint32_t) af->info.samplerate;
+
+    memset(dst, 0, n_frames * channels * sizeof(float));
+    if (track->state != TRACK_STATE_PLAYING) return;
+
+    // Silence until the scheduled start frame
+    const uint64_t start = atomic_load_explicit(&track->start_ns, memory_order_acquire);
+    const size_t begin = start ? frame_offset(start, cycle_ns, rate, n_frames) : 0;
+    if (begin >= n_frames) return;
+    if (start) atomic_store_explicit(&track->start_ns, 0, memory_order_relaxed);
+
+    // Audio up to the scheduled stop frame
+    const uint64_t stop = atomic_load_explicit(&track->stop_ns, memory_order_acquire);
+    size_t end = stop ? frame_offset(stop, cycle_ns, rate, n_frames) : n_frames;
+    if (end < begin) end = begin;
+
+    const size_t frames_read = audio_file_read(af, dst + begin * channels, end - begin);
+    apply_track_gain(track, dst, begin, begin + frames_read, channels, cycle_ns, rate);
+    meter_process(&track->meter, dst, n_frames, channels);
+
+    if (begin + frames_read < end && !af->loop) {
+        // End of file reached and not looping
+        log_info("Track finished: %s", track->config->id);
+        track->state = TRACK_STATE_STOPPED;
+    } else if (stop && end < n_frames) {
+        track->state = TRACK_STATE_STOPPED;
+    }
+}
+
+// Source side of a track's drift resampler
+static void render_track_source(void *data, float *dst, size_t n_frames, uint64_t cycle_ns) {
+    render_track(data, dst, n_frames, cycle_ns);
+}
+
 // PipeWire stream callback
 static void on_process(void *userdata) {
     track_instance_t *track = userdata;
@@ -101,6 +227,8 @@ static void on_process(void *userdata) {
     struct spa_buffer *buf;
     float *dst;
 
+    thread_policy_register_data_thread();
+
     if ((b = pw_stream_dequeue_buffer(track->stream)) == NULL) {
         log_error("Out of buffers");
         return;
@@ -111,31 +239,32 @@ static void on_process(void *userdata) {
     if (dst == NULL)
         return;
 
-    const size_t n_frames = buf->datas[0].maxsize / sizeof(float) / track->audio_file->info.channels;
+    const int channels = track->audio_file->info.channels;
+    size_t n_frames = buf->datas[0].maxsize / sizeof(float) / channels;
+    if (b->requested > 0 && b->requested < n_frames) {
+        n_frames = b->requested;
+    }
 
-    // Read audio data
-    const size_t frames_read = audio_file_read(track->audio_file, dst, n_frames);
+    // All streams of a graph cycle share its start time, which anchors scheduled events
+    struct pw_time time;
+    uint64_t cycle_ns = 0;
+    const bool have_time = pw_stream_get_time_n(track->stream, &time, sizeof(time)) == 0 && time.now > 0;
+    if (have_time) {
+        cycle_ns = (uint64_t) time.now;
+    } else {
+        cycle_ns = track_manager_now_ns();
+    }
 
-    if (frames_read < n_frames) {
-        if (!track->audio_file->loop) {
-            // End of file reached and not looping
-            if (track->state != TRACK_STATE_STOPPED) {
-                log_info("Track finished: %s", track->config->id);
-                track->state = TRACK_STATE_STOPPED;
-            }
-        }
-        // Fill remaining buffer with silence
-        memset(
-                dst + (frames_read * track->audio_file->info.channels),
-                0,
-                (n_frames - frames_read) * track->audio_file->info.channels *
-                sizeof(float)
-        );
+    if (track->drift) {
+        drift_process(track->drift, have_time ? &time : NULL, render_track_source, track, dst, n_frames, cycle_ns);
+    } else {
+        render_track(track, dst, n_frames, cycle_ns);
     }
+    output_stage_process(track->output_stage, dst, n_frames);
 
     buf->datas[0].chunk->offset = 0;
-    buf->datas[0].chunk->stride = track->audio_file->info.channels * sizeof(float);
-    buf->datas[0].chunk->size = n_frames * track->audio_file->info.channels * sizeof(float);
+    buf->datas[0].chunk->stride = channels * sizeof(float);
+    buf->datas[0].chunk->size = n_frames * channels * sizeof(float);
 
     pw_stream_queue_buffer(track->stream, b);
 }
@@ -156,11 +285,17 @@ static void on_stream_state_changed(
 
     switch (state) {
         case PW_STREAM_STATE_ERROR:
-            track->state = TRACK_STATE_ERROR;
             if (track->error.message) {
                 free(track->error.message);
             }
             track->error.message = error ? strdup(error) : strdup("Unknown error");
+            if (track->reconnect.waiting) {
+                // A reconnect attempt that failed, the next one follows after the backoff
+                track->state = TRACK_STATE_DISCONNECTED;
+                log_warn("Reconnect of %s failed: %s", track->config->id, track->error.message);
+                break;
+            }
+            track->state = TRACK_STATE_ERROR;
             log_error("Stream error: %s", track->error.message);
             break;
 
@@ -177,7 +312,13 @@ static void on_stream_state_changed(
         case PW_STREAM_STATE_STREAMING:
             if (old != PW_STREAM_STATE_STREAMING) {
                 track->is_connected = true;
-                log_info("Stream started: %s", track->config->id);
+                if (track->reconnect.waiting) {
+                    const uint64_t outage_ns = reconnect_done(&track->reconnect, track_manager_now_ns());
+                    log_info("Stream reconnected: %s after %.0f ms (%u attempts)", track->config->id, outage_ns / 1e6,
+                             track->reconnect.attempts);
+                } else {
+                    log_info("Stream started: %s", track->config->id);
+                }
                 if (track->state != TRACK_STATE_PLAYING) {
                     track->state = TRACK_STATE_PLAYING;
                 }
@@ -189,6 +330,8 @@ static void on_stream_state_changed(
             if (track->state == TRACK_STATE_PLAYING) {
                 track->state = TRACK_STATE_DISCONNECTED;
                 log_warn("Stream disconnected: %s", track->config->id);
+            } else if (track->reconnect.waiting) {
+                track->state = TRACK_STATE_DISCONNECTED;
             }
             break;
 
@@ -248,13 +391,18 @@ static bool init_track_pipewire(
         goto cleanup;
     }
 
-    // Add a device target if specified
-    if (track->config->output.device) {
-        if (strcmp(track->config->output.device, "default") != 0) {
-            if (pw_properties_set(props, PW_KEY_TARGET_OBJECT, track->config->output.device) != 0) {
-                log_error("Failed to set target device property");
-                goto cleanup;
-            }
+    // Add a device target if specified, by serial when the registry already knows the node
+    char target[128];
+    if (registry_target(ctx->registry, track->config->output.device, target, sizeof(target))) {
+        if (pw_properties_set(props, PW_KEY_TARGET_OBJECT, target) != 0) {
+            log_error("Failed to set target device property");
+            goto cleanup;
+        }
+        const registry_node_t *node = registry_find(ctx->registry, track->config->output.device);
+        track->target_id = node ? node->id : 0;
+        // Wait for this device to come back rather than being moved to another one
+        if (ctx->config->reconnect.enabled) {
+            pw_properties_set(props, PW_KEY_NODE_DONT_RECONNECT, "true");
         }
     }
 
@@ -294,8 +442,112 @@ static bool init_track_pipewire(
     return success;
 }
 
+// Create the track's stream and connect it with the file's format (main loop, lock held)
+static bool connect_track_stream(track_manager_ctx_t *ctx, track_instance_t *track) {
+    if (!init_track_pipewire(ctx, track)) {
+        return false;
+    }
+
+    // Set up stream parameters
+    uint8_t buffer[1024];
+    struct spa_pod_builder b;
+    spa_pod_builder_init(&b, buffer, sizeof(buffer));
+
+    struct spa_audio_info_raw audio_info = {
+            .format = SPA_AUDIO_FORMAT_F32,
+            .channels = track->config->output.mapping_count > 0 ? track->config->output.mapping_count
+                                                                : track->audio_file->info.channels,
+            .rate = track->audio_file->info.samplerate
+    };
+
+    // Set channel positions
+    if (track->config->output.mapping_count > 0) {
+        // Set default mapping first
+        for (uint8_t i = 0; i < SPA_AUDIO_MAX_CHANNELS; i++) {
+            audio_info.position[i] = SPA_AUDIO_CHANNEL_UNKNOWN;
+        }
+
+        // Map each channel according to configuration
+        for (uint8_t i = 0; i < track->config->output.mapping_count && i < SPA_AUDIO_MAX_CHANNELS; i++) {
+            const char *port_name = track->config->output.mapping[i];
+            audio_info.position[i] = get_channel_position(port_name);
+            if (audio_info.position[i] == SPA_AUDIO_CHANNEL_UNKNOWN) {
+                log_warn("Unknown channel name '%s', using UNKNOWN", port_name);
+            }
+        }
+        audio_info.channels = track->config->output.mapping_count;
+    } else {
+        // If no mapping specified, use sequential AUX channels
+        audio_info.channels = track->audio_file->info.channels;
+        for (uint8_t i = 0; i < audio_info.channels && i < SPA_AUDIO_MAX_CHANNELS; i++) {
+            audio_info.position[i] = SPA_AUDIO_CHANNEL_AUX0 + i;
+        }
+    }
+
+    const struct spa_pod *params[1];
+    params[0] = spa_format_audio_raw_build(&b, SPA_PARAM_EnumFormat, &audio_info);
+
+    if (pw_stream_connect(
+            track->stream,
+            PW_DIRECTION_OUTPUT,
+            PW_ID_ANY,
+            PW_STREAM_FLAG_AUTOCONNECT | PW_STREAM_FLAG_MAP_BUFFERS | PW_STREAM_FLAG_RT_PROCESS,
+            params,
+            1
+    ) < 0) {
+        log_error("Failed to connect stream");
+        pw_stream_destroy(track->stream);
+        track->stream = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+// Report configured outputs coming and going, and let streams on them wait for the device or retry
+static void on_device_hotplug(void *data, const registry_node_t *node, bool added) {
+    track_manager_ctx_t *ctx = data;
+    const global_config_t *config = ctx->config;
+
+    bool configured = false;
+    for (int i = 0; i < config->track_count && !configured; i++) {
+        configured = config->tracks[i].output.device && strcmp(config->tracks[i].output.device, node->name) == 0;
+    }
+    for (int i = 0; i < config->bus_count && !configured; i++) {
+        configured = config->buses[i].output.device && strcmp(config->buses[i].output.device, node->name) == 0;
+    }
+    if (!configured) {
+        return;
+    }
+    log_info("Configured output %s %s", node->name, added ? "is available" : "went away");
+    if (!config->reconnect.enabled) {
+        return;
+    }
+
+    const uint64_t now_ns = track_manager_now_ns();
+    for (int i = 0; i < ctx->active_tracks; i++) {
+        track_instance_t *track = ctx->tracks[i];
+        if (!track->stream || track->generator || !track->config->output.device ||
+            strcmp(track->config->output.device, node->name) != 0) {
+            continue;
+        }
+        if (added) {
+            reconnect_device_added(&track->reconnect, now_ns);
+        } else if (track->state != TRACK_STATE_STOPPED) {
+            // The stream may not have noticed yet; a stopped track has nothing to resume
+            track->state = TRACK_STATE_DISCONNECTED;
+            track->is_connected = false;
+            reconnect_lost(&track->reconnect, now_ns, (uint32_t) config->reconnect.initial_backoff_ms);
+        }
+    }
+    for (int i = 0; i < ctx->bus_count; i++) {
+        bus_device_changed(ctx->buses[i], node->name, added, now_ns);
+    }
+}
+
 track_manager_ctx_t *track_manager_init(global_config_t *config) {
-    track_manager_ctx_t *ctx = calloc(1, sizeof(track_manager_ctx_t));
+    // Track instances live inside the context, so keep it in the locked arena
+    track_manager_ctx_t *ctx = arena_calloc(1, sizeof(track_manager_ctx_t));
     if (!ctx) {
         log_error("Failed to allocate track manager context");
         return NULL;
@@ -303,6 +555,13 @@ track_manager_ctx_t *track_manager_init(global_config_t *config) {
 
     ctx->config = config;
     ctx->active_tracks = 0;
+    atomic_init(&ctx->measure_cancelled, false);
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&ctx->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
 
     // Initialize PipeWire
     pw_init(NULL, NULL);
@@ -310,7 +569,8 @@ track_manager_ctx_t *track_manager_init(global_config_t *config) {
     ctx->pw_loop = pw_main_loop_new(NULL);
     if (!ctx->pw_loop) {
         log_error("Failed to create PipeWire main loop");
-        free(ctx);
+        pthread_mutex_destroy(&ctx->lock);
+        arena_free(ctx);
         return NULL;
     }
 
@@ -319,10 +579,42 @@ track_manager_ctx_t *track_manager_init(global_config_t *config) {
     if (!ctx->pw_context) {
         log_error("Failed to create PipeWire context");
         pw_main_loop_destroy(ctx->pw_loop);
-        free(ctx);
+        pthread_mutex_destroy(&ctx->lock);
+        arena_free(ctx);
         return NULL;
     }
 
+    // Device lookups are answered from the cache, so fill it before the first stream connects
+    ctx->registry = registry_create(ctx->pw_context);
+    if (ctx->registry) {
+        registry_set_hotplug(ctx->registry, on_device_hotplug, ctx);
+        registry_sync(ctx->registry, pw_main_loop_get_loop(ctx->pw_loop), REGISTRY_SYNC_TIMEOUT_MS);
+    } else {
+        log_warn("No registry cache, devices are resolved by name on every connect");
+    }
+
+    // Buses run from startup so routing a track into one never waits for a new stream
+    for (int i = 0; i < config->bus_count; i++) {
+        if (ctx->bus_count >= MAX_BUSES) {
+            log_warn("Maximum number of buses reached, ignoring bus %s", config->buses[i].id);
+            break;
+        }
+        bus_t *bus = bus_create(pw_main_loop_get_loop(ctx->pw_loop), ctx->registry, config, &config->buses[i],
+                                render_track);
+        if (bus) {
+            ctx->buses[ctx->bus_count++] = bus;
+        } else {
+            log_error("Failed to create bus %s", config->buses[i].id ? config->buses[i].id : "?");
+        }
+    }
+
+    ctx->show = show_init(ctx, config);
+    ctx->sync = clock_sync_create(config, ctx->show);
+    ctx->triggers = trigger_server_create(config, ctx);
+    ctx->osc = osc_server_create(config, ctx);
+    ctx->midi = midi_input_create(pw_main_loop_get_loop(ctx->pw_loop), config, ctx);
+    ctx->reference_speed = 1.0;
+
     ctx->initialized = true;
     return ctx;
 }
@@ -331,24 +623,85 @@ void track_manager_cleanup(track_manager_ctx_t *ctx) {
     if (!ctx)
         return;
 
+    // Control inputs first, so nothing starts tracks again after they are stopped
+    osc_server_destroy(ctx->osc);
+    trigger_server_destroy(ctx->triggers);
+    midi_input_destroy(ctx->midi);
+
     // Stop all tracks
     track_manager_stop_all(ctx);
+    clock_sync_destroy(ctx->sync);
+    show_cleanup(ctx->show);
+    for (int i = 0; i < ctx->bus_count; i++) {
+        bus_destroy(ctx->buses[i]);
+    }
 
     // Cleanup PipeWire
+    registry_destroy(ctx->registry);
     if (ctx->pw_context)
         pw_context_destroy(ctx->pw_context);
+    thread_policy_forget_data_threads();
     if (ctx->pw_loop)
         pw_main_loop_destroy(ctx->pw_loop);
 
     pw_deinit();
 
-    free(ctx);
+    pthread_mutex_destroy(&ctx->lock);
+    arena_free(ctx);
 }
 
-bool track_manager_play(track_manager_ctx_t *ctx, const char *track_id) {
-    if (!ctx || !track_id)
-        return false;
+void track_manager_lock(track_manager_ctx_t *ctx) {
+    pthread_mutex_lock(&ctx->lock);
+}
+
+void track_manager_unlock(track_manager_ctx_t *ctx) {
+    pthread_mutex_unlock(&ctx->lock);
+}
 
+show_ctx_t *track_manager_get_show(track_manager_ctx_t *ctx) {
+    return ctx ? ctx->show : NULL;
+}
+
+trigger_server_t *track_manager_get_triggers(track_manager_ctx_t *ctx) {
+    return ctx ? ctx->triggers : NULL;
+}
+
+// Take a free instance slot from the pool (lock held)
+static track_instance_t *alloc_instance(track_manager_ctx_t *ctx) {
+    if (ctx->active_tracks >= MAX_TRACKS) return NULL;
+
+    for (int slot = 0; slot < MAX_TRACKS; slot++) {
+        bool used = false;
+        for (int i = 0; i < ctx->active_tracks && !used; i++) {
+            used = ctx->tracks[i] == &ctx->pool[slot];
+        }
+        if (!used) return &ctx->pool[slot];
+    }
+    return NULL;
+}
+
+// Find a bus by ID
+static bus_t *find_bus(track_manager_ctx_t *ctx, const char *bus_id) {
+    for (int i = 0; i < ctx->bus_count; i++) {
+        if (strcmp(bus_get_id(ctx->buses[i]), bus_id) == 0) {
+            return ctx->buses[i];
+        }
+    }
+    return NULL;
+}
+
+// Find an active instance by track ID (lock held)
+static track_instance_t *find_instance(track_manager_ctx_t *ctx, const char *track_id) {
+    for (int i = 0; i < ctx->active_tracks; i++) {
+        if (strcmp(ctx->tracks[i]->config->id, track_id) == 0) {
+            return ctx->tracks[i];
+        }
+    }
+    return NULL;
+}
+
+// Start or restart a track (lock held)
+static bool play_locked(track_manager_ctx_t *ctx, const char *track_id, const uint64_t start_ns) {
     // Find track configuration
     track_config_t *config = NULL;
     for (int i = 0; i < ctx->config->track_count; i++) {
@@ -364,37 +717,49 @@ bool track_manager_play(track_manager_ctx_t *ctx, const char *track_id) {
     }
 
     // Check if track is already active
-    for (int i = 0; i < ctx->active_tracks; i++) {
-        if (strcmp(ctx->tracks[i].config->id, track_id) == 0) {
-            track_instance_t *track = &ctx->tracks[i];
-
-            // If track is stopped (finished), restart it
-            if (track->state == TRACK_STATE_STOPPED && track->audio_file) {
-                audio_file_seek(track->audio_file, 0);
-                track->state = TRACK_STATE_PLAYING;
-                log_info("Restarting track: %s", track_id);
-                return true;
-            }
-
-            // Otherwise it's already playing
-            log_info("Track already playing: %s", track_id);
+    track_instance_t *track = find_instance(ctx, track_id);
+    if (track) {
+        // If track is stopped (finished), restart it
+        if (track->state == TRACK_STATE_STOPPED && track->audio_file) {
+            // Start from the initial gain, not wherever a fade left it; the data thread leaves a stopped
+            // track's gain alone, and state is set last
+            track->gain = 1.0f;
+            track->ramp_target = 1.0f;
+            track->ramp_step = 0.0f;
+            track->ramp_frames = 0;
+            atomic_store(&track->volume_at_ns, 0);
+            atomic_store(&track->volume_target, 1.0f);
+            atomic_store(&track->stop_ns, 0);
+            atomic_store(&track->start_ns, start_ns);
+            audio_file_seek(track->audio_file, 0);
+            track->state = TRACK_STATE_PLAYING;
+            log_info("Restarting track: %s", track_id);
             return true;
         }
+
+        // Otherwise it's already playing
+        log_info("Track already playing: %s", track_id);
+        return true;
     }
 
     // Initialize new track instance
-    if (ctx->active_tracks >= MAX_TRACKS) {
+    track = alloc_instance(ctx);
+    if (!track) {
         log_error("Maximum number of active tracks reached");
         return false;
     }
 
-    track_instance_t *track = &ctx->tracks[ctx->active_tracks];
     memset(track, 0, sizeof(track_instance_t));
     track->config = config;
     track->state = TRACK_STATE_STOPPED;
     track->is_connected = false;
     track->error.message = NULL;
     track->error.code = 0;
+    track->gain = 1.0f;
+    atomic_init(&track->start_ns, start_ns);
+    atomic_init(&track->stop_ns, 0);
+    atomic_init(&track->volume_at_ns, 0);
+    atomic_init(&track->volume_target, 1.0f);
 
     // Open audio file
     track->audio_file = audio_file_open(config->file_path, config->loop, config->volume);
@@ -402,81 +767,75 @@ bool track_manager_play(track_manager_ctx_t *ctx, const char *track_id) {
         log_error("Failed to open audio file: %s", config->file_path);
         return false;
     }
-
-    // Initialize PipeWire
-    if (!init_track_pipewire(ctx, track)) {
-        log_error("Failed to initialize PipeWire for track: %s", track_id);
-        audio_file_close(track->audio_file);
-        return false;
-    }
-
-    // Set up stream parameters
-    uint8_t buffer[1024];
-    struct spa_pod_builder b;
-    spa_pod_builder_init(&b, buffer, sizeof(buffer));
-
-    struct spa_audio_info_raw audio_info = {
-            .format = SPA_AUDIO_FORMAT_F32,
-            .channels = track->config->output.mapping_count > 0 ? track->config->output.mapping_count
-                                                                : track->audio_file->info.channels,
-            .rate = track->audio_file->info.samplerate
-    };
-
-    // Set channel positions
-    if (track->config->output.mapping_count > 0) {
-        // Set default mapping first
-        for (uint8_t i = 0; i < SPA_AUDIO_MAX_CHANNELS; i++) {
-            audio_info.position[i] = SPA_AUDIO_CHANNEL_UNKNOWN;
-        }
-
-        // Map each channel according to configuration
-        for (uint8_t i = 0; i < track->config->output.mapping_count && i < SPA_AUDIO_MAX_CHANNELS; i++) {
-            const char *port_name = track->config->output.mapping[i];
-            audio_info.position[i] = get_channel_position(port_name);
-            if (audio_info.position[i] == SPA_AUDIO_CHANNEL_UNKNOWN) {
-                log_warn("Unknown channel name '%s', using UNKNOWN", port_name);
-            }
+    meter_init(&track->meter, track->audio_file->info.channels, track->audio_file->info.samplerate);
+
+    // Tracks on a bus are rendered by the bus stream instead of getting one of their own
+    if (config->bus) {
+        bus_t *bus = find_bus(ctx, config->bus);
+        if (!bus) {
+            log_error("Bus not found for track %s: %s", track_id, config->bus);
+            audio_file_close(track->audio_file);
+            return false;
         }
-        audio_info.channels = track->config->output.mapping_count;
-    } else {
-        // If no mapping specified, use sequential AUX channels
-        audio_info.channels = track->audio_file->info.channels;
-        for (uint8_t i = 0; i < audio_info.channels && i < SPA_AUDIO_MAX_CHANNELS; i++) {
-            audio_info.position[i] = SPA_AUDIO_CHANNEL_AUX0 + i;
+        if (!bus_attach(bus, track)) {
+            audio_file_close(track->audio_file);
+            return false;
         }
+
+        track->bus = bus;
+        track->is_connected = true;
+        track->state = TRACK_STATE_PLAYING;
+        ctx->tracks[ctx->active_tracks++] = track;
+        log_info("Started playback of track: %s (bus %s)", track_id, config->bus);
+        return true;
     }
 
-    const struct spa_pod *params[1];
-    params[0] = spa_format_audio_raw_build(&b, SPA_PARAM_EnumFormat, &audio_info);
+    // Device processing runs in on_process, so it must exist before the stream connects
+    const char *names[OUTPUT_STAGE_MAX_CHANNELS] = {NULL};
+    for (int i = 0; i < config->output.mapping_count && i < OUTPUT_STAGE_MAX_CHANNELS; i++) {
+        names[i] = config->output.mapping[i];
+    }
+    track->output_stage = output_stage_create(ctx->config, config->output.device, names,
+                                              track->audio_file->info.channels, track->audio_file->info.samplerate);
+    track->drift = drift_create(ctx->config, track->audio_file->info.channels, track->audio_file->info.samplerate);
 
-    if (pw_stream_connect(
-            track->stream,
-            PW_DIRECTION_OUTPUT,
-            PW_ID_ANY,
-            PW_STREAM_FLAG_AUTOCONNECT | PW_STREAM_FLAG_MAP_BUFFERS | PW_STREAM_FLAG_RT_PROCESS,
-            params,
-            1
-    ) < 0) {
-        log_error("Failed to connect stream");
-        pw_stream_destroy(track->stream);
+    if (!connect_track_stream(ctx, track)) {
+        log_error("Failed to initialize PipeWire for track: %s", track_id);
+        output_stage_destroy(track->output_stage);
+        drift_destroy(track->drift);
         audio_file_close(track->audio_file);
         return false;
     }
 
     track->state = TRACK_STATE_PLAYING;
-    ctx->active_tracks++;
+    ctx->tracks[ctx->active_tracks++] = track;
     log_info("Started playback of track: %s", track_id);
 
     return true;
 }
 
+bool track_manager_play(track_manager_ctx_t *ctx, const char *track_id) {
+    return track_manager_play_at(ctx, track_id, 0);
+}
+
+bool track_manager_play_at(track_manager_ctx_t *ctx, const char *track_id, const uint64_t start_ns) {
+    if (!ctx || !track_id)
+        return false;
+
+    pthread_mutex_lock(&ctx->lock);
+    const bool result = play_locked(ctx, track_id, start_ns);
+    pthread_mutex_unlock(&ctx->lock);
+    return result;
+}
+
 bool track_manager_stop(track_manager_ctx_t *ctx, const char *track_id) {
     if (!ctx || !track_id)
         return false;
 
+    pthread_mutex_lock(&ctx->lock);
     for (int i = 0; i < ctx->active_tracks; i++) {
-        if (strcmp(ctx->tracks[i].config->id, track_id) == 0) {
-            track_instance_t *track = &ctx->tracks[i];
+        if (strcmp(ctx->tracks[i]->config->id, track_id) == 0) {
+            track_instance_t *track = ctx->tracks[i];
 
             // Clean up error message if any
             if (track->error.message) {
@@ -484,11 +843,21 @@ bool track_manager_stop(track_manager_ctx_t *ctx, const char *track_id) {
                 track->error.message = NULL;
             }
 
-            // Destroy PipeWire stream
+            // Destroy PipeWire stream, or leave the bus mix before the file goes away
             if (track->stream) {
                 pw_stream_destroy(track->stream);
                 track->stream = NULL;
             }
+            output_stage_destroy(track->output_stage);
+            track->output_stage = NULL;
+            drift_destroy(track->drift);
+            track->drift = NULL;
+            generator_destroy(track->generator);
+            track->generator = NULL;
+            if (track->bus) {
+                bus_detach(track->bus, track);
+                track->bus = NULL;
+            }
 
             // Close audio file if it exists
             if (track->audio_file) {
@@ -496,32 +865,207 @@ bool track_manager_stop(track_manager_ctx_t *ctx, const char *track_id) {
                 track->audio_file = NULL;
             }
 
-            // Remove track from active tracks
+            // Remove track from active tracks; instances stay put in the pool since
+            // the streams of the remaining tracks hold pointers to them
             if (i < ctx->active_tracks - 1) {
                 memmove(
                         &ctx->tracks[i],
                         &ctx->tracks[i + 1],
-                        sizeof(track_instance_t) * (ctx->active_tracks - i - 1)
+                        sizeof(track_instance_t *) * (ctx->active_tracks - i - 1)
                 );
             }
             ctx->active_tracks--;
 
+            pthread_mutex_unlock(&ctx->lock);
             log_info("Stopped track: %s", track_id);
             return true;
         }
     }
+    pthread_mutex_unlock(&ctx->lock);
 
     log_warn("Track not playing: %s", track_id);
     return false;
 }
 
+bool track_manager_stop_at(track_manager_ctx_t *ctx, const char *track_id, const uint64_t stop_ns) {
+    if (!ctx || !track_id)
+        return false;
+    if (stop_ns == 0)
+        return track_manager_stop(ctx, track_id);
+
+    pthread_mutex_lock(&ctx->lock);
+    track_instance_t *track = find_instance(ctx, track_id);
+    if (track) {
+        // The data thread ends output at the exact frame; process_events reaps the stream
+        atomic_store(&track->stop_ns, stop_ns);
+    }
+    pthread_mutex_unlock(&ctx->lock);
+
+    if (!track) {
+        log_warn("Track not playing: %s", track_id);
+        return false;
+    }
+    return true;
+}
+
+bool track_manager_set_volume_at(track_manager_ctx_t *ctx, const char *track_id, const float gain, const uint64_t at_ns) {
+    if (!ctx || !track_id)
+        return false;
+
+    pthread_mutex_lock(&ctx->lock);
+    track_instance_t *track = find_instance(ctx, track_id);
+    if (track) {
+        // Target first: the data thread reads it once it sees the timestamp
+        atomic_store(&track->volume_target, gain);
+        atomic_store(&track->volume_at_ns, at_ns ? at_ns : track_manager_now_ns());
+    }
+    pthread_mutex_unlock(&ctx->lock);
+
+    if (!track) {
+        log_warn("Track not playing: %s", track_id);
+        return false;
+    }
+    return true;
+}
+
+bool track_manager_set_volume(track_manager_ctx_t *ctx, const char *track_id, const float gain) {
+    return track_manager_set_volume_at(ctx, track_id, gain, 0);
+}
+
+bool track_manager_set_bus_gain(track_manager_ctx_t *ctx, const char *bus_id, const float gain) {
+    if (!ctx || !bus_id)
+        return false;
+
+    bus_t *bus = find_bus(ctx, bus_id);
+    if (!bus) {
+        log_warn("Bus not found: %s", bus_id);
+        return false;
+    }
+
+    bus_set_gain(bus, gain);
+    log_info("Bus %s gain %.2f", bus_id, gain);
+    return true;
+}
+
+bool track_manager_set_bus_mute(track_manager_ctx_t *ctx, const char *bus_id, const bool mute) {
+    if (!ctx || !bus_id)
+        return false;
+
+    bus_t *bus = find_bus(ctx, bus_id);
+    if (!bus) {
+        log_warn("Bus not found: %s", bus_id);
+        return false;
+    }
+
+    bus_set_mute(bus, mute);
+    log_info("Bus %s %s", bus_id, mute ? "muted" : "unmuted");
+    return true;
+}
+
+bool track_manager_set_position(track_manager_ctx_t *ctx, const char *track_id, const float x, const float y,
+                                const double seconds, const uint64_t at_ns) {
+    if (!ctx || !track_id)
+        return false;
+
+    pthread_mutex_lock(&ctx->lock);
+    track_instance_t *track = find_instance(ctx, track_id);
+    const bool ok = track && track->bus && bus_set_position(track->bus, track, x, y, seconds, at_ns);
+    pthread_mutex_unlock(&ctx->lock);
+
+    if (!ok) {
+        log_warn("Track %s is not a playing spatial source", track_id);
+        return false;
+    }
+    log_debug("Track %s moving to (%.2f, %.2f) over %.2f s", track_id, x, y, seconds);
+    return true;
+}
+
+bool track_manager_set_output_delay(track_manager_ctx_t *ctx, const char *device, const char *channel,
+                                    const float ms) {
+    if (!ctx || !device || !channel || ms < 0.0f)
+        return false;
+
+    pthread_mutex_lock(&ctx->lock);
+    int updated = 0;
+    for (int i = 0; i < ctx->active_tracks; i++) {
+        output_stage_t *stage = ctx->tracks[i]->output_stage;
+        if (stage && strcmp(output_stage_device(stage), device) == 0 && output_stage_set_delay(stage, channel, ms)) {
+            updated++;
+        }
+    }
+    for (int i = 0; i < ctx->bus_count; i++) {
+        output_stage_t *stage = bus_get_output_stage(ctx->buses[i]);
+        if (stage && strcmp(output_stage_device(stage), device) == 0 && output_stage_set_delay(stage, channel, ms)) {
+            updated++;
+        }
+    }
+
+    // Streams started later pick the new value up from the configuration
+    for (int i = 0; i < ctx->config->output_count; i++) {
+        output_stage_config_t *output = &ctx->config->outputs[i];
+        if (strcmp(output->device ? output->device : "default", device) != 0) continue;
+        for (int j = 0; j < output->channel_count; j++) {
+            if (output->channels[j].name && strcmp(output->channels[j].name, channel) == 0) {
+                output->channels[j].delay_ms = ms;
+                output->channels[j].delay_samples = -1;
+                updated++;
+            }
+        }
+    }
+    pthread_mutex_unlock(&ctx->lock);
+
+    if (updated == 0) {
+        log_warn("No delay line for channel %s on %s (or %.2f ms exceeds max_delay_ms)", channel, device, ms);
+        return false;
+    }
+    log_info("Output %s channel %s delay %.2f ms", device, channel, ms);
+    return true;
+}
+
+char *track_manager_format_meters(track_manager_ctx_t *ctx) {
+    if (!ctx)
+        return NULL;
+
+    const size_t size = 16384;
+    char *meters = malloc(size);
+    if (!meters)
+        return NULL;
+
+    size_t offset = 0;
+    meters[0] = '\0';
+
+    pthread_mutex_lock(&ctx->lock);
+    for (int i = 0; i < ctx->active_tracks && offset < size; i++) {
+        const track_instance_t *track = ctx->tracks[i];
+        const output_config_t *output = &track->config->output;
+
+        offset += snprintf(meters + offset, size - offset, "track %s", track->config->id);
+        if (offset >= size) break;
+        offset += meter_format(&track->meter, output->mapping_count > 0 ? (const char *const *) output->mapping : NULL,
+                               meters + offset, size - offset);
+        if (offset >= size) break;
+        offset += snprintf(meters + offset, size - offset, "\n");
+    }
+    for (int i = 0; i < ctx->bus_count && offset < size; i++) {
+        offset += bus_format_meters(ctx->buses[i], meters + offset, size - offset);
+    }
+    pthread_mutex_unlock(&ctx->lock);
+
+    if (offset >= size) {
+        meters[size - 1] = '\0';
+    }
+    return meters;
+}
+
 bool track_manager_stop_all(track_manager_ctx_t *ctx) {
     if (!ctx)
         return false;
 
+    pthread_mutex_lock(&ctx->lock);
     while (ctx->active_tracks > 0) {
-        track_manager_stop(ctx, ctx->tracks[0].config->id);
+        track_manager_stop(ctx, ctx->tracks[0]->config->id);
     }
+    pthread_mutex_unlock(&ctx->lock);
 
     return true;
 }
@@ -530,13 +1074,12 @@ bool track_manager_is_playing(track_manager_ctx_t *ctx, const char *track_id) {
     if (!ctx || !track_id)
         return false;
 
-    for (int i = 0; i < ctx->active_tracks; i++) {
-        if (strcmp(ctx->tracks[i].config->id, track_id) == 0) {
-            return ctx->tracks[i].state == TRACK_STATE_PLAYING;
-        }
-    }
+    pthread_mutex_lock(&ctx->lock);
+    const track_instance_t *track = find_instance(ctx, track_id);
+    const bool playing = track && track->state == TRACK_STATE_PLAYING;
+    pthread_mutex_unlock(&ctx->lock);
 
-    return false;
+    return playing;
 }
 
 void track_manager_list_tracks(track_manager_ctx_t *ctx) {
@@ -546,9 +1089,9 @@ void track_manager_list_tracks(track_manager_ctx_t *ctx) {
     printf("Configured tracks:\n");
     for (int i = 0; i < ctx->config->track_count; i++) {
         track_config_t *track = &ctx->config->tracks[i];
+        printf("  %s:\n", track->id);
         bool is_playing = track_manager_is_playing(ctx, track->id);
 
-        printf("  %s:\n", track->id);
         printf("    File: %s\n", track->file_path);
         printf("    Loop: %s\n", track->loop ? "yes" : "no");
         printf("    Volume: %.2f\n", track->volume);
@@ -557,20 +1100,29 @@ void track_manager_list_tracks(track_manager_ctx_t *ctx) {
 }
 
 char *track_manager_print_status(track_manager_ctx_t *ctx) {
-    char *status = malloc(4096); // Generous buffer size
-    int offset = 0;
+    // Same size as the socket reply; every formatter is only handed the room that is left
+    const size_t size = 16384;
+    char *status = malloc(size);
+    if (!status)
+        return NULL;
+
+    size_t offset = 0;
+    status[0] = '\0';
 
     if (!ctx) {
-        snprintf(status, 4096, "Track manager not initialized\n");
+        snprintf(status, size, "Track manager not initialized\n");
         return status;
     }
 
-    offset += snprintf(status + offset, 4096 - offset, "Active tracks: %d\n", ctx->active_tracks);
+    pthread_mutex_lock(&ctx->lock);
+    offset += snprintf(status + offset, size - offset, "Active tracks: %d\n", ctx->active_tracks);
+    if (offset < size) offset += arena_format_status(status + offset, size - offset);
+    if (offset < size) offset += thread_policy_format_status(status + offset, size - offset);
 
-    for (int i = 0; i < ctx->active_tracks; i++) {
+    for (int i = 0; i < ctx->active_tracks && offset < size; i++) {
         const char *state_str;
-        track_instance_t *track = &ctx->tracks[i];
-        switch (ctx->tracks[i].state) {
+        track_instance_t *track = ctx->tracks[i];
+        switch (ctx->tracks[i]->state) {
             case TRACK_STATE_PLAYING:
                 state_str = "playing";
                 break;
@@ -593,18 +1145,54 @@ char *track_manager_print_status(track_manager_ctx_t *ctx) {
 
         offset += snprintf(
             status + offset,
-            4096 - offset,
+            size - offset,
             "Track %s: %s (connected: %s)\n",
-            ctx->tracks[i].config->id,
+            ctx->tracks[i]->config->id,
             state_str,
-            ctx->tracks[i].is_connected ? "yes" : "no"
+            ctx->tracks[i]->is_connected ? "yes" : "no"
         );
 
-        if (ctx->tracks[i].state == TRACK_STATE_ERROR && ctx->tracks[i].error.message) {
-            offset += snprintf(status + offset, 4096 - offset, "  Error: %s\n", ctx->tracks[i].error.message);
+        if (offset < size && ctx->tracks[i]->state == TRACK_STATE_ERROR && ctx->tracks[i]->error.message) {
+            offset += snprintf(status + offset, size - offset, "  Error: %s\n", ctx->tracks[i]->error.message);
+        }
+
+        // Component lines are formatted on their own so a long one is cut short instead of overrunning status
+        char line[1024];
+        if (offset < size && ctx->tracks[i]->output_stage) {
+            line[0] = '\0';
+            output_stage_format_status(ctx->tracks[i]->output_stage, line, sizeof(line));
+            offset += snprintf(status + offset, size - offset, "  Output: %s\n", line);
+        }
+        if (offset < size && track->drift) {
+            line[0] = '\0';
+            drift_format_status(track->drift, line, sizeof(line));
+            offset += snprintf(status + offset, size - offset, "  Clock: %s\n", line);
+        }
+        if (offset < size && (track->reconnect.waiting || track->reconnect.reconnects > 0)) {
+            line[0] = '\0';
+            reconnect_format_status(&track->reconnect, track_manager_now_ns(), line, sizeof(line));
+            offset += snprintf(status + offset, size - offset, "  Reconnect: %s\n", line);
+        }
+        if (offset < size && ctx->tracks[i]->generator) {
+            line[0] = '\0';
+            generator_format_status(ctx->tracks[i]->generator, line, sizeof(line));
+            offset += snprintf(status + offset, size - offset, "  Signal: %s\n", line);
         }
     }
 
+    for (int i = 0; i < ctx->bus_count && offset < size; i++) {
+        offset += bus_format_status(ctx->buses[i], status + offset, size - offset);
+    }
+    if (offset < size) offset += show_format_status(ctx->show, status + offset, size - offset);
+    if (offset < size) offset += clock_sync_format_status(ctx->sync, status + offset, size - offset);
+    if (offset < size) offset += trigger_server_format_status(ctx->triggers, status + offset, size - offset);
+    if (offset < size) offset += osc_server_format_status(ctx->osc, status + offset, size - offset);
+    if (offset < size) offset += midi_input_format_status(ctx->midi, status + offset, size - offset);
+    pthread_mutex_unlock(&ctx->lock);
+
+    if (offset >= size) {
+        status[size - 1] = '\0';
+    }
     return status;
 }
 
@@ -620,20 +1208,63 @@ static track_config_t TEST_TONE_CONFIG = {
         }
 };
 
-// Helper function to parse channel mapping string
+// Channel names the test signal was last started with, owned here
+static char **test_tone_mapping = NULL;
+static int test_tone_mapping_count = 0;
+
+static void free_test_tone_mapping(void) {
+    for (int i = 0; i < test_tone_mapping_count; i++) {
+        free(test_tone_mapping[i]);
+    }
+    free(test_tone_mapping);
+    test_tone_mapping = NULL;
+    test_tone_mapping_count = 0;
+}
+
+// Helper function to parse channel mapping string: "FL,FR,..." or a channel count meaning AUX0..AUX<n-1>
 static bool parse_channel_mapping(const char *mapping_str, track_config_t *config) {
     if (!mapping_str || !config) return false;
 
+    char *end;
+    const long aux_count = strtol(mapping_str, &end, 10);
+    const bool numbered = end != mapping_str && *end == '\0';
+
     // Count commas to determine number of channels
     int count = 1;
-    for (const char *p = mapping_str; *p; p++) {
-        if (*p == ',') count++;
+    if (numbered) {
+        count = (int) aux_count;
+    } else {
+        for (const char *p = mapping_str; *p; p++) {
+            if (*p == ',') count++;
+        }
+    }
+    if (count <= 0 || count > (int) SPA_AUDIO_MAX_CHANNELS) {
+        log_error("Test signal needs 1 to %d channels", SPA_AUDIO_MAX_CHANNELS);
+        return false;
     }
 
     // Allocate space for channel names
     char **mappings = calloc(count, sizeof(char *));
     if (!mappings) return false;
 
+    if (numbered) {
+        for (int i = 0; i < count; i++) {
+            char name[16];
+            snprintf(name, sizeof(name), "AUX%d", i);
+            mappings[i] = strdup(name);
+            if (!mappings[i]) {
+                for (int j = 0; j < i; j++) {
+                    free(mappings[j]);
+                }
+                free(mappings);
+                return false;
+            }
+        }
+        config->output.mapping = mappings;
+        config->output.mapping_count = count;
+        return true;
+    }
+
     // Copy the string so we can modify it
     char *str = strdup(mapping_str);
     if (!str) {
@@ -661,40 +1292,20 @@ static bool parse_channel_mapping(const char *mapping_str, track_config_t *confi
 
     // Update config
     config->output.mapping = mappings;
-    config->output.mapping_count = count;
+    config->output.mapping_count = i;
 
     free(str);
     return true;
 }
 
-static void generate_test_tone(
-        float *buffer,
-        size_t frames,
-        int channels,
-        int sample_rate
-) {
-    static float phase = 0.0f;
-    const float frequency = 440.0f; // A4 note
-    const float increment = 2.0f * M_PI * frequency / sample_rate;
-
-    for (size_t i = 0; i < frames; i++) {
-        float sample = sinf(phase) * 0.5f; // 50% amplitude
-        for (int ch = 0; ch < channels; ch++) {
-            buffer[i * channels + ch] = sample;
-        }
-        phase += increment;
-        if (phase >= 2.0f * M_PI) {
-            phase -= 2.0f * M_PI;
-        }
-    }
-}
-
 static void on_test_tone_process(void *userdata) {
     track_instance_t *track = userdata;
     struct pw_buffer *b;
     struct spa_buffer *buf;
     float *dst;
 
+    thread_policy_register_data_thread();
+
     if ((b = pw_stream_dequeue_buffer(track->stream)) == NULL) {
         log_error("Out of buffers");
         return;
@@ -705,21 +1316,52 @@ static void on_test_tone_process(void *userdata) {
     if (dst == NULL)
         return;
 
-    size_t n_frames = buf->datas[0].maxsize / sizeof(float) /
-                      track->config->output.mapping_count;
+    const int channels = track->config->output.mapping_count;
+    size_t n_frames = buf->datas[0].maxsize / sizeof(float) / channels;
+    if (b->requested > 0 && b->requested < n_frames) {
+        n_frames = b->requested;
+    }
 
-    // Generate test tone
-    generate_test_tone(dst, n_frames, track->config->output.mapping_count, 48000);
+    generator_process(track->generator, dst, n_frames);
+    meter_process(&track->meter, dst, n_frames, channels);
 
     buf->datas[0].chunk->offset = 0;
-    buf->datas[0].chunk->stride = track->config->output.mapping_count * sizeof(float);
-    buf->datas[0].chunk->size = n_frames * track->config->output.mapping_count * sizeof(float);
+    buf->datas[0].chunk->stride = channels * sizeof(float);
+    buf->datas[0].chunk->size = n_frames * channels * sizeof(float);
 
     pw_stream_queue_buffer(track->stream, b);
 }
 
-bool track_manager_play_test_tone(track_manager_ctx_t *ctx, const char *channel_mapping) {
-    // Reset test tone configuration
+// The test stream leaves the rate open; follow whatever the graph negotiates
+static void on_test_tone_param_changed(void *userdata, uint32_t id, const struct spa_pod *param) {
+    track_instance_t *track = userdata;
+    if (!param || id != SPA_PARAM_Format) return;
+
+    struct spa_audio_info_raw info = {0};
+    if (spa_format_audio_raw_parse(param, &info) < 0 || info.rate == 0) return;
+
+    generator_set_rate(track->generator, info.rate);
+    log_info("Test signal running at %u Hz", info.rate);
+}
+
+static const struct pw_stream_events test_tone_events = {
+        PW_VERSION_STREAM_EVENTS,
+        .process = on_test_tone_process,
+        .state_changed = on_stream_state_changed,
+        .param_changed = on_test_tone_param_changed,
+};
+
+// Start the test signal stream (lock held)
+static bool play_test_tone_locked(track_manager_ctx_t *ctx, const generator_config_t *signal,
+                                  const char *channel_mapping) {
+    if (!ctx)
+        return false;
+
+    // Stop any existing test signal before its channel names go away
+    if (find_instance(ctx, TEST_TONE_CONFIG.id)) {
+        track_manager_stop(ctx, TEST_TONE_CONFIG.id);
+    }
+    free_test_tone_mapping();
     TEST_TONE_CONFIG.output.mapping = NULL;
     TEST_TONE_CONFIG.output.mapping_count = 0;
 
@@ -729,6 +1371,8 @@ bool track_manager_play_test_tone(track_manager_ctx_t *ctx, const char *channel_
             log_error("Failed to parse channel mapping: %s", channel_mapping);
             return false;
         }
+        test_tone_mapping = TEST_TONE_CONFIG.output.mapping;
+        test_tone_mapping_count = TEST_TONE_CONFIG.output.mapping_count;
     } else {
         // Default mapping if none provided
         static char *default_mapping[] = {"FL", "FR"};
@@ -736,24 +1380,32 @@ bool track_manager_play_test_tone(track_manager_ctx_t *ctx, const char *channel_
         TEST_TONE_CONFIG.output.mapping_count = 2;
     }
 
-    if (!ctx)
-        return false;
-
-    // Stop any existing test tone
-    track_manager_stop(ctx, TEST_TONE_CONFIG.id);
+    generator_config_t defaults;
+    if (!signal) {
+        generator_defaults(&defaults, GENERATOR_SINE);
+        signal = &defaults;
+    }
 
     // Initialize new track instance
-    if (ctx->active_tracks >= MAX_TRACKS) {
+    track_instance_t *track = alloc_instance(ctx);
+    if (!track) {
         log_error("Maximum number of active tracks reached");
         return false;
     }
 
-    track_instance_t *track = &ctx->tracks[ctx->active_tracks];
     memset(track, 0, sizeof(track_instance_t));
     track->config = (track_config_t *) &TEST_TONE_CONFIG;
     track->state = TRACK_STATE_STOPPED;
 
-    // Set up PipeWire stream
+    const int channels = track->config->output.mapping_count;
+    track->generator = generator_create(signal, (const char *const *) track->config->output.mapping, channels, 48000);
+    if (!track->generator) {
+        log_error("Failed to create test signal generator");
+        return false;
+    }
+    meter_init(&track->meter, channels, 48000);
+
+    // Set up PipeWire stream; pw_stream_new_simple takes ownership of the properties
     struct pw_properties *props = pw_properties_new(
             PW_KEY_MEDIA_TYPE,
             "Audio",
@@ -770,33 +1422,32 @@ bool track_manager_play_test_tone(track_manager_ctx_t *ctx, const char *channel_
 
     if (!props) {
         log_error("Failed to create stream properties");
+        generator_destroy(track->generator);
+        track->generator = NULL;
         return false;
     }
 
     // Set up channel mapping
     char channelNames[1024] = "";
-    for (int i = 0; i < track->config->output.mapping_count; i++) {
+    for (int i = 0; i < channels; i++) {
         if (i > 0)
             strcat(channelNames, ",");
         strcat(channelNames, track->config->output.mapping[i]);
     }
     pw_properties_set(props, PW_KEY_NODE_CHANNELNAMES, channelNames);
 
-    // Create stream with test tone process callback
-    struct pw_stream_events test_events = stream_events;
-    test_events.process = on_test_tone_process;
-
     track->stream = pw_stream_new_simple(
             pw_main_loop_get_loop(ctx->pw_loop),
             "test_tone",
             props,
-            &test_events,
+            &test_tone_events,
             track
     );
 
     if (!track->stream) {
         log_error("Failed to create test tone stream");
-        pw_properties_free(props);
+        generator_destroy(track->generator);
+        track->generator = NULL;
         return false;
     }
 
@@ -805,10 +1456,10 @@ bool track_manager_play_test_tone(track_manager_ctx_t *ctx, const char *channel_
     struct spa_pod_builder b;
     spa_pod_builder_init(&b, buffer, sizeof(buffer));
 
+    // No rate: the stream runs at the graph rate instead of being resampled from a fixed one
     struct spa_audio_info_raw audio_info = {
             .format = SPA_AUDIO_FORMAT_F32,
-            .channels = track->config->output.mapping_count,
-            .rate = 48000
+            .channels = channels
     };
 
     // Set channel positions
@@ -832,22 +1483,237 @@ bool track_manager_play_test_tone(track_manager_ctx_t *ctx, const char *channel_
     ) < 0) {
         log_error("Failed to connect test tone stream");
         pw_stream_destroy(track->stream);
-        pw_properties_free(props);
+        generator_destroy(track->generator);
+        track->generator = NULL;
         return false;
     }
 
     track->state = TRACK_STATE_PLAYING;
-    ctx->active_tracks++;
-    log_info("Started test tone playback");
+    ctx->tracks[ctx->active_tracks++] = track;
 
-    pw_properties_free(props);
+    char description[256];
+    generator_format_status(track->generator, description, sizeof(description));
+    log_info("Started test signal on %d channels: %s", channels, description);
     return true;
 }
 
+bool track_manager_play_test_tone(track_manager_ctx_t *ctx, const generator_config_t *signal,
+                                  const char *channel_mapping) {
+    if (!ctx)
+        return false;
+
+    pthread_mutex_lock(&ctx->lock);
+    const bool result = play_test_tone_locked(ctx, signal, channel_mapping);
+    pthread_mutex_unlock(&ctx->lock);
+    return result;
+}
+
+char *track_manager_format_devices(track_manager_ctx_t *ctx) {
+    if (!ctx)
+        return NULL;
+
+    const size_t size = 16384;
+    char *devices = malloc(size);
+    if (!devices)
+        return NULL;
+
+    pthread_mutex_lock(&ctx->lock);
+    registry_format_devices(ctx->registry, devices, size);
+    pthread_mutex_unlock(&ctx->lock);
+    return devices;
+}
+
+bool track_manager_measure_latency(track_manager_ctx_t *ctx, const char *device, const char *channel,
+                                   const char *capture_device, const char *capture_channel,
+                                   latency_signal_t signal, latency_result_t *result) {
+    if (!ctx || !channel || !result)
+        return false;
+
+    pthread_mutex_lock(&ctx->lock);
+    latency_probe_t *probe = latency_probe_create(pw_main_loop_get_loop(ctx->pw_loop), ctx->registry, ctx->config,
+                                                  device, channel, capture_device, capture_channel, signal);
+    pthread_mutex_unlock(&ctx->lock);
+    if (!probe)
+        return false;
+
+    // The main thread keeps iterating the loop, so wait without holding the lock
+    const uint64_t deadline = track_manager_now_ns() + (uint64_t) (latency_probe_timeout(probe) * 1e9);
+    while (!latency_probe_finished(probe) && track_manager_now_ns() < deadline &&
+           !atomic_load(&ctx->measure_cancelled)) {
+        usleep(20000);
+    }
+    if (atomic_load(&ctx->measure_cancelled)) {
+        log_warn("Latency measurement of %s cancelled", channel);
+    } else if (!latency_probe_finished(probe)) {
+        log_error("Latency measurement of %s timed out", channel);
+    }
+
+    pthread_mutex_lock(&ctx->lock);
+    latency_probe_stop(probe);
+    pthread_mutex_unlock(&ctx->lock);
+
+    const bool result_ok = latency_probe_analyze(probe, result);
+    latency_probe_destroy(probe);
+    return result_ok;
+}
+
+void track_manager_cancel_measurements(track_manager_ctx_t *ctx) {
+    if (ctx)
+        atomic_store(&ctx->measure_cancelled, true);
+}
+
+// Move a track past the outage when it resumes in advance mode; no stream may be rendering it (lock held).
+// False when a track that does not loop would have ended meanwhile.
+static bool resume_track(const track_manager_ctx_t *ctx, track_instance_t *track, const uint64_t now_ns,
+                         uint64_t skipped_ns) {
+    const resume_mode_t mode = track->config->resume != RESUME_DEFAULT ? track->config->resume
+                                                                       : ctx->config->reconnect.resume;
+    audio_file_t *af = track->audio_file;
+    if (mode != RESUME_ADVANCE || !af || af->info.frames <= 0) {
+        return true;
+    }
+
+    // A start still pending only skips the part of the outage after it
+    const uint64_t start_ns = atomic_load(&track->start_ns);
+    if (start_ns) {
+        skipped_ns = start_ns < now_ns ? (now_ns - start_ns < skipped_ns ? now_ns - start_ns : skipped_ns) : 0;
+    }
+
+    sf_count_t position = af->position + (sf_count_t) ((double) skipped_ns * af->info.samplerate / 1e9);
+    if (position >= af->info.frames) {
+        if (!af->loop) {
+            return false;
+        }
+        position %= af->info.frames;
+    }
+    return audio_file_seek(af, position);
+}
+
+// Bring back streams whose device went away, once it is present again and the backoff allows (lock held)
+static void reconnect_streams(track_manager_ctx_t *ctx) {
+    const global_config_t *config = ctx->config;
+    if (!config->reconnect.enabled) {
+        return;
+    }
+    const uint64_t now_ns = track_manager_now_ns();
+
+    for (int i = ctx->active_tracks - 1; i >= 0; i--) {
+        track_instance_t *track = ctx->tracks[i];
+        if (track->bus || track->generator || track->state == TRACK_STATE_STOPPED) {
+            continue;
+        }
+        if (track->state == TRACK_STATE_DISCONNECTED) {
+            reconnect_lost(&track->reconnect, now_ns, (uint32_t) config->reconnect.initial_backoff_ms);
+        }
+        if (!registry_available(ctx->registry, track->config->output.device) ||
+            !reconnect_due(&track->reconnect, now_ns, (uint32_t) config->reconnect.max_backoff_ms)) {
+            continue;
+        }
+
+        log_info("Reconnecting track %s to %s (attempt %u)", track->config->id,
+                 track->config->output.device ? track->config->output.device : "default", track->reconnect.attempts);
+        if (track->stream) {
+            pw_stream_destroy(track->stream);
+            track->stream = NULL;
+        }
+        if (!resume_track(ctx, track, now_ns, reconnect_take_skipped(&track->reconnect, now_ns))) {
+            log_info("Track %s ended during the outage", track->config->id);
+            track_manager_stop(ctx, track->config->id);
+            continue;
+        }
+
+        // A fresh stream resolves the target again, the node has a new serial after a replug
+        if (connect_track_stream(ctx, track)) {
+            track->state = TRACK_STATE_CONNECTING;
+        } else {
+            track->state = TRACK_STATE_DISCONNECTED;
+        }
+    }
+
+    for (int i = 0; i < ctx->bus_count; i++) {
+        uint64_t skipped_ns = 0;
+        if (!bus_reconnect(ctx->buses[i], pw_main_loop_get_loop(ctx->pw_loop), ctx->registry, now_ns, &skipped_ns)) {
+            continue;
+        }
+
+        // The new stream cannot render before the main loop negotiates its format, so members may be moved now
+        for (int j = ctx->active_tracks - 1; j >= 0; j--) {
+            track_instance_t *track = ctx->tracks[j];
+            if (track->bus == ctx->buses[i] && !resume_track(ctx, track, now_ns, skipped_ns)) {
+                log_info("Track %s ended during the outage", track->config->id);
+                track_manager_stop(ctx, track->config->id);
+            }
+        }
+    }
+}
+
+// Hand the reference clock to every drift resampler (lock held). The reference device's speed comes from
+// any stream playing to it; while none does, the last measurement stays in use.
+static void update_clock_reference(track_manager_ctx_t *ctx) {
+    const char *reference = ctx->config->clock.reference;
+    if (!ctx->config->clock.compensate) {
+        return;
+    }
+
+    if (reference) {
+        for (int i = 0; i < ctx->active_tracks; i++) {
+            const track_instance_t *track = ctx->tracks[i];
+            const double speed = drift_get_speed(track->drift);
+            if (speed > 0.0 && track->config->output.device && strcmp(track->config->output.device, reference) == 0) {
+                ctx->reference_speed = speed;
+                break;
+            }
+        }
+        for (int i = 0; i < ctx->bus_count; i++) {
+            const char *device = bus_get_device(ctx->buses[i]);
+            const double speed = drift_get_speed(bus_get_drift(ctx->buses[i]));
+            if (speed > 0.0 && device && strcmp(device, reference) == 0) {
+                ctx->reference_speed = speed;
+                break;
+            }
+        }
+    }
+
+    for (int i = 0; i < ctx->active_tracks; i++) {
+        const char *device = ctx->tracks[i]->config->output.device;
+        drift_set_reference(ctx->tracks[i]->drift, ctx->reference_speed,
+                            reference && device && strcmp(device, reference) == 0);
+    }
+    for (int i = 0; i < ctx->bus_count; i++) {
+        const char *device = bus_get_device(ctx->buses[i]);
+        drift_set_reference(bus_get_drift(ctx->buses[i]), ctx->reference_speed,
+                            reference && device && strcmp(device, reference) == 0);
+    }
+}
+
 void track_manager_process_events(track_manager_ctx_t *ctx) {
     if (!ctx || !ctx->pw_loop)
         return;
 
+    pthread_mutex_lock(&ctx->lock);
+
     // Iterate the PipeWire main loop once with no timeout (non-blocking)
     pw_loop_iterate(pw_main_loop_get_loop(ctx->pw_loop), 0);
+
+    // Reap tracks that reached a scheduled stop on the data thread
+    for (int i = ctx->active_tracks - 1; i >= 0; i--) {
+        const track_instance_t *track = ctx->tracks[i];
+        if (atomic_load(&track->stop_ns) != 0 && track->state == TRACK_STATE_STOPPED) {
+            track_manager_stop(ctx, track->config->id);
+        }
+    }
+
+    // MIDI actions the data thread matched since the last tick
+    midi_input_process(ctx->midi);
+
+    // Scheduling for data threads is set from here, never from their process callbacks
+    thread_policy_apply_data_threads();
+
+    reconnect_streams(ctx);
+    update_clock_reference(ctx);
+
+    // Arm cue actions that fall inside the preroll window
+    show_tick(ctx->show);
+
+    pthread_mutex_unlock(&ctx->lock);
 }
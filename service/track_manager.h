@@ -2,6 +2,10 @@
 #define ASYNC_AUDIO_PLAYER_TRACK_MANAGER_H
 
 #include "types.h"
+#include "show.h"
+#include "generator.h"
+#include "latency.h"
+#include "trigger.h"
 #include <spa/param/audio/raw.h>
 
 // Track manager context
@@ -20,14 +24,59 @@ void track_manager_cleanup(track_manager_ctx_t *ctx);
 bool track_manager_play(track_manager_ctx_t *ctx, const char *track_id);
 bool track_manager_stop(track_manager_ctx_t *ctx, const char *track_id);
 bool track_manager_stop_all(track_manager_ctx_t *ctx);
+bool track_manager_set_volume(track_manager_ctx_t *ctx, const char *track_id, float gain);
+
+// Submix bus controls, applied within one quantum
+bool track_manager_set_bus_gain(track_manager_ctx_t *ctx, const char *bus_id, float gain);
+bool track_manager_set_bus_mute(track_manager_ctx_t *ctx, const char *bus_id, bool mute);
+
+// Move a spatial track on its bus to (x, y) metres over seconds, starting at at_ns (0 = now)
+bool track_manager_set_position(track_manager_ctx_t *ctx, const char *track_id, float x, float y, double seconds,
+                                uint64_t at_ns);
+
+// Change the alignment delay of a channel on every stream to the device, crossfaded
+bool track_manager_set_output_delay(track_manager_ctx_t *ctx, const char *device, const char *channel, float ms);
+
+// Scheduled control on the CLOCK_MONOTONIC timeline; 0 means as soon as possible
+bool track_manager_play_at(track_manager_ctx_t *ctx, const char *track_id, uint64_t start_ns);
+bool track_manager_stop_at(track_manager_ctx_t *ctx, const char *track_id, uint64_t stop_ns);
+bool track_manager_set_volume_at(track_manager_ctx_t *ctx, const char *track_id, float gain, uint64_t at_ns);
+uint64_t track_manager_now_ns(void);
+
+// Serialize access from the socket and main threads (recursive)
+void track_manager_lock(track_manager_ctx_t *ctx);
+void track_manager_unlock(track_manager_ctx_t *ctx);
+
+// Cue list sequencer
+show_ctx_t *track_manager_get_show(track_manager_ctx_t *ctx);
+
+// Shared-memory trigger rings, NULL when disabled
+trigger_server_t *track_manager_get_triggers(track_manager_ctx_t *ctx);
 
 // Status functions
 bool track_manager_is_playing(track_manager_ctx_t *ctx, const char *track_id);
 void track_manager_list_tracks(track_manager_ctx_t *ctx);
 char* track_manager_print_status(track_manager_ctx_t *ctx);
 
-// Test tone functionality
-bool track_manager_play_test_tone(track_manager_ctx_t *ctx, const char *channel_mapping);
+// Levels of every active track and bus output as "track|bus <id> NAME=peak/rms/clips ..." lines (caller frees)
+char *track_manager_format_meters(track_manager_ctx_t *ctx);
+
+// Test signal on its own stream at the graph rate, default sine when signal is NULL.
+// The mapping is "FL,FR,..." or a channel count for AUX0..AUX<n-1>; NULL means FL,FR.
+bool track_manager_play_test_tone(track_manager_ctx_t *ctx, const generator_config_t *signal,
+                                  const char *channel_mapping);
+
+// Audio devices from the registry cache, one per line (caller frees)
+char *track_manager_format_devices(track_manager_ctx_t *ctx);
+
+// Play a test signal on one output channel through the track path and find it in a loopback capture.
+// Blocks for a few seconds while the main thread runs the loop, so never call it from there.
+bool track_manager_measure_latency(track_manager_ctx_t *ctx, const char *device, const char *channel,
+                                   const char *capture_device, const char *capture_channel,
+                                   latency_signal_t signal, latency_result_t *result);
+
+// Make running and later latency measurements return early; the ctx is about to be cleaned up
+void track_manager_cancel_measurements(track_manager_ctx_t *ctx);
 
 // Process pending events (must be called regularly)
 void track_manager_process_events(track_manager_ctx_t *ctx);
@@ -0,0 +1,292 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include "trigger.h"
+#include "track_manager.h"
+#include "show.h"
+#include "thread_policy.h"
+#include "log.h"
+
+#define TRIGGER_MAX_RINGS 8
+#define TRIGGER_DEFAULT_PERIOD_US 500
+#define TRIGGER_OWNER_CHECK_NS 1000000000ull    // How often rings of exited controllers are looked for
+
+typedef struct {
+    bool active;
+    trigger_ring_t *ring;
+    pid_t pid;                  // Controller owning the ring
+    uint64_t records;
+    uint64_t latency_sum_ns;    // From the controller's timestamp to papad reading the record
+    uint64_t latency_max_ns;
+    uint64_t timed_records;     // Records that carried a timestamp
+} trigger_slot_t;
+
+struct trigger_server {
+    track_manager_ctx_t *track_manager;
+    uint64_t period_ns;
+    pthread_t thread;
+    _Atomic bool running;
+    pthread_mutex_t lock;       // Guards the slot table; never held while records are carried out
+    trigger_slot_t slots[TRIGGER_MAX_RINGS];
+};
+
+static const char *type_name(const uint32_t type) {
+    switch (type) {
+        case TRIGGER_GO: return "go";
+        case TRIGGER_GOTO: return "goto";
+        case TRIGGER_PLAY: return "play";
+        case TRIGGER_STOP: return "stop";
+        case TRIGGER_PING: return "ping";
+        default: return "nop";
+    }
+}
+
+// Carry out one record (consumer thread, no locks held)
+static bool run_record(trigger_server_t *server, const trigger_record_t *record, const uint64_t now_ns) {
+    show_ctx_t *show = track_manager_get_show(server->track_manager);
+    const uint64_t base_ns = (record->time_ns ? record->time_ns : now_ns) + show_get_preroll_ns(show);
+    char id[TRIGGER_ID_MAX];
+    memcpy(id, record->id, sizeof(id));
+    id[sizeof(id) - 1] = '\0';
+
+    switch (record->type) {
+        case TRIGGER_GO: {
+            bool resumed = false;
+            return show_go_at(show, base_ns, &resumed) != NULL;
+        }
+        case TRIGGER_GOTO:
+            return show_fire_at(show, id, base_ns);
+        case TRIGGER_PLAY:
+            return track_manager_play_at(server->track_manager, id, base_ns);
+        case TRIGGER_STOP:
+            return track_manager_stop_at(server->track_manager, id, base_ns);
+        case TRIGGER_NOP:
+        case TRIGGER_PING:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Drain one ring, returns the number of records consumed
+static uint64_t drain_ring(trigger_server_t *server, trigger_ring_t *ring, uint64_t *latency_sum_ns,
+                           uint64_t *latency_max_ns, uint64_t *timed) {
+    const uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    if (head == tail) {
+        return 0;
+    }
+    if (head - tail > TRIGGER_RING_SLOTS) {
+        // The controller wrote past the records it had room for; drop the ring's backlog
+        log_warn("Triggers: ring overrun by %llu records", (unsigned long long) (head - tail - TRIGGER_RING_SLOTS));
+        tail = head - TRIGGER_RING_SLOTS;
+    }
+
+    uint64_t consumed = 0;
+    for (; tail != head; tail++) {
+        const trigger_record_t record = ring->records[tail & (TRIGGER_RING_SLOTS - 1)];
+        const uint64_t now_ns = track_manager_now_ns();
+        if (record.time_ns && record.time_ns <= now_ns) {
+            const uint64_t latency = now_ns - record.time_ns;
+            *latency_sum_ns += latency;
+            if (latency > *latency_max_ns) *latency_max_ns = latency;
+            (*timed)++;
+        }
+
+        if (!run_record(server, &record, now_ns)) {
+            atomic_fetch_add_explicit(&ring->rejected, 1, memory_order_relaxed);
+            log_warn("Triggers: %s %.*s failed", type_name(record.type), TRIGGER_ID_MAX, record.id);
+        }
+        consumed++;
+
+        // Acknowledge each record as it is done so the controller can time it
+        atomic_store_explicit(&ring->consumed_ns, track_manager_now_ns(), memory_order_relaxed);
+        atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    }
+    return consumed;
+}
+
+// Unmap rings whose controller closed them or exited (lock held)
+static void reap_rings(trigger_server_t *server) {
+    for (int i = 0; i < TRIGGER_MAX_RINGS; i++) {
+        trigger_slot_t *slot = &server->slots[i];
+        if (!slot->active) continue;
+        const bool closed = atomic_load(&slot->ring->closed) != 0;
+        if (closed || (kill(slot->pid, 0) < 0 && errno == ESRCH)) {
+            log_info("Triggers: released ring of process %d after %llu records", (int) slot->pid,
+                     (unsigned long long) slot->records);
+            munmap(slot->ring, sizeof(trigger_ring_t));
+            memset(slot, 0, sizeof(*slot));
+        }
+    }
+}
+
+static void *trigger_thread(void *arg) {
+    trigger_server_t *server = arg;
+    thread_policy_apply(THREAD_ROLE_CONTROL);
+
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    uint64_t next_reap_ns = 0;
+
+    while (atomic_load(&server->running)) {
+        // Only this thread unmaps rings, so the pointers stay valid outside the lock
+        trigger_ring_t *rings[TRIGGER_MAX_RINGS] = {0};
+        pthread_mutex_lock(&server->lock);
+        for (int i = 0; i < TRIGGER_MAX_RINGS; i++) {
+            if (server->slots[i].active) rings[i] = server->slots[i].ring;
+        }
+        pthread_mutex_unlock(&server->lock);
+
+        for (int i = 0; i < TRIGGER_MAX_RINGS; i++) {
+            if (!rings[i]) continue;
+            uint64_t latency_sum = 0, latency_max = 0, timed = 0;
+            const uint64_t consumed = drain_ring(server, rings[i], &latency_sum, &latency_max, &timed);
+            if (consumed == 0) continue;
+
+            pthread_mutex_lock(&server->lock);
+            trigger_slot_t *slot = &server->slots[i];
+            slot->records += consumed;
+            slot->latency_sum_ns += latency_sum;
+            slot->timed_records += timed;
+            if (latency_max > slot->latency_max_ns) slot->latency_max_ns = latency_max;
+            pthread_mutex_unlock(&server->lock);
+        }
+
+        const uint64_t now_ns = track_manager_now_ns();
+        if (now_ns >= next_reap_ns) {
+            pthread_mutex_lock(&server->lock);
+            reap_rings(server);
+            pthread_mutex_unlock(&server->lock);
+            next_reap_ns = now_ns + TRIGGER_OWNER_CHECK_NS;
+        }
+
+        next.tv_nsec += (long) server->period_ns;
+        while (next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+    return NULL;
+}
+
+trigger_server_t *trigger_server_create(const global_config_t *config, track_manager_ctx_t *track_manager) {
+    if (!config || !config->triggers.enabled) return NULL;
+
+    trigger_server_t *server = calloc(1, sizeof(trigger_server_t));
+    if (!server) {
+        log_error("Failed to allocate trigger server");
+        return NULL;
+    }
+    server->track_manager = track_manager;
+    const int period_us = config->triggers.period_us > 0 ? config->triggers.period_us : TRIGGER_DEFAULT_PERIOD_US;
+    server->period_ns = (uint64_t) period_us * 1000ull;
+    pthread_mutex_init(&server->lock, NULL);
+
+    atomic_init(&server->running, true);
+    if (pthread_create(&server->thread, NULL, trigger_thread, server) != 0) {
+        log_error("Triggers: failed to start thread");
+        pthread_mutex_destroy(&server->lock);
+        free(server);
+        return NULL;
+    }
+
+    log_info("Triggers: shared-memory rings enabled, polled every %d us", period_us);
+    return server;
+}
+
+int trigger_server_attach(trigger_server_t *server, const pid_t pid) {
+    if (!server) return -1;
+
+    pthread_mutex_lock(&server->lock);
+    trigger_slot_t *slot = NULL;
+    for (int i = 0; i < TRIGGER_MAX_RINGS && !slot; i++) {
+        if (!server->slots[i].active) slot = &server->slots[i];
+    }
+    if (!slot) {
+        pthread_mutex_unlock(&server->lock);
+        log_warn("Triggers: all %d rings are in use", TRIGGER_MAX_RINGS);
+        return -1;
+    }
+
+    const int fd = memfd_create("papa-trigger", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0 || ftruncate(fd, sizeof(trigger_ring_t)) < 0) {
+        log_error("Triggers: cannot create ring: %s", strerror(errno));
+        if (fd >= 0) close(fd);
+        pthread_mutex_unlock(&server->lock);
+        return -1;
+    }
+    trigger_ring_t *ring = mmap(NULL, sizeof(trigger_ring_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ring == MAP_FAILED) {
+        log_error("Triggers: cannot map ring: %s", strerror(errno));
+        close(fd);
+        pthread_mutex_unlock(&server->lock);
+        return -1;
+    }
+
+    // A fixed size keeps a controller from pulling the mapping out from under the consumer
+    fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+    ring->magic = TRIGGER_RING_MAGIC;
+    ring->version = TRIGGER_RING_VERSION;
+    ring->slots = TRIGGER_RING_SLOTS;
+    ring->record_size = sizeof(trigger_record_t);
+
+    memset(slot, 0, sizeof(*slot));
+    slot->ring = ring;
+    slot->pid = pid;
+    slot->active = true;
+    pthread_mutex_unlock(&server->lock);
+
+    log_info("Triggers: ring attached for process %d", (int) pid);
+    return fd;
+}
+
+int trigger_server_format_status(trigger_server_t *server, char *buffer, size_t size) {
+    if (!server) return 0;
+
+    int rings = 0;
+    uint64_t records = 0, latency_sum = 0, timed = 0, latency_max = 0, rejected = 0;
+    pthread_mutex_lock(&server->lock);
+    for (int i = 0; i < TRIGGER_MAX_RINGS; i++) {
+        const trigger_slot_t *slot = &server->slots[i];
+        if (!slot->active) continue;
+        rings++;
+        records += slot->records;
+        latency_sum += slot->latency_sum_ns;
+        timed += slot->timed_records;
+        rejected += atomic_load_explicit(&slot->ring->rejected, memory_order_relaxed);
+        if (slot->latency_max_ns > latency_max) latency_max = slot->latency_max_ns;
+    }
+    pthread_mutex_unlock(&server->lock);
+
+    return snprintf(buffer, size, "Triggers: %d rings, %llu records, pickup avg %.3f ms, max %.3f ms, %llu failed, "
+                                  "polled every %.2f ms\n",
+                    rings, (unsigned long long) records, timed ? (double) latency_sum / (double) timed / 1e6 : 0.0,
+                    (double) latency_max / 1e6, (unsigned long long) rejected, (double) server->period_ns / 1e6);
+}
+
+void trigger_server_destroy(trigger_server_t *server) {
+    if (!server) return;
+
+    atomic_store(&server->running, false);
+    pthread_join(server->thread, NULL);
+
+    for (int i = 0; i < TRIGGER_MAX_RINGS; i++) {
+        trigger_slot_t *slot = &server->slots[i];
+        if (!slot->active) continue;
+        atomic_store(&slot->ring->closed, 1);
+        munmap(slot->ring, sizeof(trigger_ring_t));
+    }
+    pthread_mutex_destroy(&server->lock);
+    free(server);
+}
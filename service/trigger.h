@@ -0,0 +1,29 @@
+#ifndef ASYNC_AUDIO_PLAYER_TRIGGER_H
+#define ASYNC_AUDIO_PLAYER_TRIGGER_H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include "types.h"
+#include "trigger_ring.h"
+
+typedef struct track_manager_ctx track_manager_ctx_t;
+
+// Consumer of the shared-memory trigger rings. A control thread drains every ring once per period and
+// carries the records out, timing each one from the controller's timestamp plus the show preroll, so
+// the delay between a trigger and its sound does not depend on when papad picked it up.
+typedef struct trigger_server trigger_server_t;
+
+// NULL when triggers are disabled in the configuration
+trigger_server_t *trigger_server_create(const global_config_t *config, track_manager_ctx_t *track_manager);
+
+// Create a ring for the controller process pid; returns its memfd for the caller to pass on and close,
+// or -1 when all rings are taken
+int trigger_server_attach(trigger_server_t *server, pid_t pid);
+
+// Format ring count, records consumed and pickup latency
+int trigger_server_format_status(trigger_server_t *server, char *buffer, size_t size);
+
+// Stop consuming and unmap every ring; controllers see the ring closed
+void trigger_server_destroy(trigger_server_t *server);
+
+#endif // ASYNC_AUDIO_PLAYER_TRIGGER_H
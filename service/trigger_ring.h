@@ -0,0 +1,50 @@
+#ifndef ASYNC_AUDIO_PLAYER_TRIGGER_RING_H
+#define ASYNC_AUDIO_PLAYER_TRIGGER_RING_H
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+// Layout of the shared-memory trigger ring. papad creates one ring per controller in a memfd and hands
+// the descriptor over the control socket (SCM_RIGHTS). The controller is the only producer and papad the
+// only consumer, so head and tail are plain release/acquire counters. Shared by papad and the client
+// library, keep it free of service dependencies.
+
+#define TRIGGER_RING_MAGIC 0x50415452u     // "PATR"
+#define TRIGGER_RING_VERSION 1
+#define TRIGGER_RING_SLOTS 256              // Power of two
+#define TRIGGER_ID_MAX 48
+
+typedef enum {
+    TRIGGER_NOP,
+    TRIGGER_GO,         // Fire the next cue, or resume a paused show
+    TRIGGER_GOTO,       // Fire the cue named in id
+    TRIGGER_PLAY,       // Start the track named in id
+    TRIGGER_STOP,       // Stop the track named in id
+    TRIGGER_PING        // Only acknowledged, for latency measurements
+} trigger_type_t;
+
+// One record per cache line
+typedef struct {
+    uint32_t type;              // trigger_type_t
+    uint32_t reserved;
+    uint64_t time_ns;           // CLOCK_MONOTONIC when the controller triggered, 0 = when papad reads it
+    char id[TRIGGER_ID_MAX];    // Cue or track ID, NUL terminated
+} trigger_record_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slots;
+    uint32_t record_size;
+    _Atomic uint32_t closed;                // Set by papad when it stops consuming, by the client on close
+
+    alignas(64) _Atomic uint64_t head;      // Records written, advanced by the controller
+    alignas(64) _Atomic uint64_t tail;      // Records consumed, advanced by papad
+    _Atomic uint64_t consumed_ns;           // When papad last advanced tail
+    _Atomic uint64_t rejected;              // Records papad could not carry out
+
+    alignas(64) trigger_record_t records[TRIGGER_RING_SLOTS];
+} trigger_ring_t;
+
+#endif // ASYNC_AUDIO_PLAYER_TRIGGER_RING_H
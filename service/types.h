@@ -2,6 +2,7 @@
 #define ASYNC_AUDIO_PLAYER_TYPES_H
 
 #include <stdbool.h>
+#include <stdatomic.h>
 #include <pipewire/pipewire.h>
 
 // Signal handling states
@@ -39,16 +40,195 @@ typedef struct {
     int mapping_count;   // Number of channels in mapping
 } output_config_t;
 
+// Thread scheduling configuration
+typedef struct {
+    int *cpus;          // CPUs to pin to, NULL leaves affinity alone
+    int cpu_count;
+    int priority;       // SCHED_FIFO priority (1-99), 0 leaves the policy alone
+} thread_config_t;
+
+// Sidechain ducking a high-priority track applies to lower priorities on its bus
+typedef struct {
+    float amount_db;    // Gain reduction while active, negative; 0 disables ducking
+    float threshold_db; // Sidechain level that triggers ducking (default -40)
+    float attack_ms;    // Time to dip (default 10)
+    float release_ms;   // Time to recover once the track falls silent (default 300)
+} duck_config_t;
+
+// Spatial panning over a bus's speaker layout
+typedef enum {
+    PANNER_OFF,
+    PANNER_VBAP,        // Pairwise vector base amplitude panning on the speaker ring
+    PANNER_DBAP         // Distance-based amplitude panning over all speakers
+} panner_mode_t;
+
+typedef struct {
+    char *name;         // Bus channel the speaker is connected to
+    float x, y;         // Metres from the listening position, x right, y front
+} speaker_config_t;
+
+typedef struct {
+    panner_mode_t mode;
+    speaker_config_t *speakers;
+    int speaker_count;
+    float rolloff_db;   // DBAP level drop per doubling of distance (default 6)
+    float blur;         // DBAP spatial blur in metres (default 0.2)
+} panner_config_t;
+
+// Role of this instance in a show spread over several hosts
+typedef enum {
+    SYNC_OFF,
+    SYNC_LEADER,        // Serves its clock and sends fired cues to the followers
+    SYNC_FOLLOWER       // Tracks the leader's clock and fires the cues it sends
+} sync_role_t;
+
+// Where playback continues after a lost device comes back
+typedef enum {
+    RESUME_DEFAULT,     // Use the global reconnect.resume
+    RESUME_FROZEN,      // From the frame output stopped at
+    RESUME_ADVANCE      // From where it would be had the device stayed, skipping the outage
+} resume_mode_t;
+
 // Track configuration
 typedef struct {
     char *id;           // Unique track identifier
     char *file_path;    // Path to WAV file
     bool loop;          // Loop flag
     float volume;       // Volume level (0.0 - 1.0)
+    bool critical;      // Keep decoded samples pinned in the sample cache
+    char *bus;          // Submix bus to route into instead of a stream of its own
+    int priority;       // Higher priorities duck lower ones on the same bus
+    duck_config_t ducking;
+    bool spatial;       // Panned by its bus's panner instead of routed by mapping
+    float position_x;   // Initial source position in metres
+    float position_y;
+    float spread;       // Angle between the two channels of a stereo source in degrees (default 60)
+    resume_mode_t resume;
     output_config_t output;
 } track_config_t;
 
+// Submix bus configuration
+typedef struct {
+    char *id;
+    float gain;         // Group gain (default 1.0)
+    bool mute;          // Start muted
+    int samplerate;     // Rate of the bus stream; member tracks must match (default 48000)
+    panner_config_t panner;
+    output_config_t output;
+} bus_config_t;
+
+// Output limiter modes
+typedef enum {
+    LIMITER_OFF,
+    LIMITER_LOOKAHEAD,  // Brickwall limiter, adds lookahead_ms of latency
+    LIMITER_SOFTCLIP    // Saturating clipper, no latency
+} limiter_mode_t;
+
+typedef struct {
+    limiter_mode_t mode;
+    float ceiling_db;   // Maximum output level (default -1.0 dBFS)
+    float lookahead_ms; // Look-ahead window (default 1.5)
+    float release_ms;   // Gain recovery time (default 50)
+} limiter_config_t;
+
+// Biquad filter shapes
+typedef enum {
+    FILTER_PEAKING,
+    FILTER_LOWSHELF,
+    FILTER_HIGHSHELF,
+    FILTER_LOWPASS,
+    FILTER_HIGHPASS,
+    FILTER_LR_LOWPASS,  // Linkwitz-Riley crossover, cascaded Butterworth sections
+    FILTER_LR_HIGHPASS
+} filter_type_t;
+
+typedef struct {
+    filter_type_t type;
+    float freq;         // Center or corner frequency in Hz
+    float q;            // Quality factor (default 0.707), unused by crossovers
+    float gain_db;      // Peaking and shelf gain
+    int order;          // Crossover slope: 2, 4 or 8 (default 4)
+} filter_config_t;
+
+// Processing for one channel of an output, matched by channel name
+typedef struct {
+    char *name;         // Channel name as in output.mapping (e.g. "FL", "AUX0")
+    filter_config_t *filters;
+    int filter_count;
+    char *ir;           // Impulse response WAV to convolve with, first channel is used
+    float delay_ms;     // Alignment delay, negative when unset
+    int delay_samples;  // Alignment delay in frames, overrides delay_ms; negative when unset
+} output_channel_config_t;
+
+// Processing for everything sent to one output device
+typedef struct {
+    char *device;       // Device name as used in output.device, "default" for unset
+    limiter_config_t limiter;
+    output_channel_config_t *channels;
+    int channel_count;
+    int fir_partition;  // Convolution block size in frames, power of two (default 256)
+    float max_delay_ms; // Delay line length, the limit for runtime changes (default 50)
+} output_stage_config_t;
+
+// Cue action types
+typedef enum {
+    CUE_ACTION_PLAY,
+    CUE_ACTION_STOP,
+    CUE_ACTION_VOLUME,
+    CUE_ACTION_PAN
+} cue_action_type_t;
+
+// Single timed action inside a cue
+typedef struct {
+    cue_action_type_t type;
+    char *track;        // Target track ID
+    double at;          // Offset from the cue start in seconds
+    float value;        // Gain for CUE_ACTION_VOLUME
+    float x, y;         // Target position for CUE_ACTION_PAN
+    double duration;    // Glide time of CUE_ACTION_PAN in seconds
+} cue_action_t;
+
+// Cue list entry
+typedef struct {
+    char *id;
+    cue_action_t *actions;
+    int action_count;
+} cue_config_t;
+
+// MIDI messages a mapping matches
+typedef enum {
+    MIDI_EVENT_NOTE_ON,     // Note on with velocity 0 counts as note off
+    MIDI_EVENT_NOTE_OFF,
+    MIDI_EVENT_CC,
+    MIDI_EVENT_PROGRAM
+} midi_event_type_t;
+
+typedef enum {
+    MIDI_ACTION_PLAY,
+    MIDI_ACTION_STOP,
+    MIDI_ACTION_VOLUME,     // Gain from the velocity or controller value
+    MIDI_ACTION_GO,
+    MIDI_ACTION_GOTO
+} midi_action_type_t;
+
+// MIDI message to action mapping
+typedef struct {
+    midi_event_type_t event;
+    int channel;        // 1-16, 0 = any
+    int number;         // Note, controller or program number, -1 = any
+    midi_action_type_t action;
+    char *target;       // Track ID, or cue ID for MIDI_ACTION_GOTO
+    float gain;         // Gain of MIDI_ACTION_VOLUME at value 127 (default 1.0)
+} midi_mapping_t;
+
 #include "audio_file.h"
+#include "meter.h"
+#include "reconnect.h"
+
+struct bus;
+struct output_stage;
+struct generator;
+struct drift;
 
 // Active track instance
 typedef struct {
@@ -61,6 +241,26 @@ typedef struct {
     stream_error_t error;      // Stream error information
     uint32_t target_id;       // Target node ID for connection
     bool is_connected;        // Stream connection state
+    struct bus *bus;          // Submix rendering the track, NULL when it owns its stream
+    struct output_stage *output_stage;  // Device processing of the track's own stream
+    struct generator *generator;        // Test signal source in place of a file
+    reconnect_state_t reconnect;        // Outage of the track's own stream
+    struct drift *drift;                // Clock-drift resampler of the track's own stream
+
+    // Sample-accurate scheduling, written by control threads and consumed in on_process.
+    // Times are CLOCK_MONOTONIC nanoseconds, 0 means not scheduled.
+    _Atomic uint64_t start_ns;       // First audible frame
+    _Atomic uint64_t stop_ns;        // First silent frame
+    _Atomic uint64_t volume_at_ns;   // When volume_target takes effect
+    _Atomic float volume_target;
+
+    // Gain state owned by the data thread
+    float gain;
+    float ramp_target;
+    float ramp_step;
+    uint32_t ramp_frames;
+
+    meter_t meter;              // Level after the track gain
 } track_instance_t;
 
 // Global configuration
@@ -69,8 +269,92 @@ typedef struct {
         char *level;
     } logging;
 
+    struct {
+        bool enabled;
+        char *directory;    // Cache directory (default: $XDG_CACHE_HOME/papa)
+        int workers;        // Background decode threads
+    } cache;
+
+    struct {
+        bool enabled;
+        bool strict;        // Abort startup when a track fails validation
+        int workers;        // 0 = one per online CPU
+    } preload;
+
+    struct {
+        int budget_mb;      // Memory budget for decoded audio, 0 disables the cache
+    } sample_cache;
+
+    struct {
+        int arena_mb;       // Locked arena for audio-path buffers, 0 uses the heap
+        bool huge_pages;    // Back the arena with huge pages when available
+        bool lock;          // mlock the arena (default true)
+        bool lock_all;      // mlockall the whole process
+    } memory;
+
+    struct {
+        thread_config_t data_loop;  // PipeWire realtime data loop
+        thread_config_t workers;    // Cache, preload and loader threads
+        thread_config_t control;    // Main loop and socket server
+    } threads;
+
+    struct {
+        int preroll_ms;     // Lead time between a cue firing and its first action
+    } show;
+
+    struct {
+        bool enabled;           // Hand out shared-memory trigger rings to local controllers (default false)
+        int period_us;          // Time between two passes over the rings (default 500)
+    } triggers;
+
+    struct {
+        bool enabled;           // Accept OSC control messages over UDP (default false)
+        char *bind;             // Address to listen on (default 127.0.0.1, loopback only)
+        int port;               // UDP port (default 9000)
+        bool reply;             // Answer each message to its sender with /papa/ok or /papa/error (default false)
+    } osc;
+
+    struct {
+        bool enabled;           // Expose a PipeWire MIDI input port (default false)
+        char *name;             // Node name (default papa_midi)
+        int latency_ms;         // Delay from a MIDI event to its action (default 30)
+        midi_mapping_t *mappings;
+        int mapping_count;
+    } midi;
+
+    struct {
+        sync_role_t role;
+        char *name;             // Reported to the leader (default: host name)
+        char *leader;           // Followers: leader address, host or host:port
+        int port;               // UDP port the leader listens on (default 9870)
+        int interval_ms;        // Time between a follower's clock exchanges (default 250)
+    } sync;
+
+    struct {
+        bool compensate;        // Resample streams to follow the reference clock (default false)
+        char *reference;        // Device whose clock the others follow, NULL for the system clock
+        float bandwidth_hz;     // Loop bandwidth of the drift tracker (default 0.05)
+        float max_ppm;          // Largest rate correction (default 1000)
+    } clock;
+
+    struct {
+        bool enabled;           // Reconnect streams whose device went away (default true)
+        resume_mode_t resume;   // Default resume mode of tracks (default frozen)
+        int initial_backoff_ms; // Wait before the first attempt (default 250)
+        int max_backoff_ms;     // Cap of the doubling wait between attempts (default 8000)
+    } reconnect;
+
     track_config_t *tracks;
     int track_count;
+
+    bus_config_t *buses;
+    int bus_count;
+
+    output_stage_config_t *outputs;
+    int output_count;
+
+    cue_config_t *cues;
+    int cue_count;
 } global_config_t;
 
 #endif // ASYNC_AUDIO_PLAYER_TYPES_H